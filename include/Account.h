@@ -11,6 +11,8 @@
 
 using namespace std;
 
+class DB;
+
 /**
  * @class Account
  * @brief Represents a user account with username and password
@@ -64,16 +66,18 @@ class Account {
         /**
          * @brief Create a new account in the database
          * @param acc The account to create
+         * @param db Database to create the account in
          * @return true if account creation was successful, false if account already exists
          */
-        static bool create(const Account& acc);
+        static bool create(const Account& acc, DB& db);
 
         /**
          * @brief Check if an account exists in the database
          * @param acc The account to check
+         * @param db Database to search
          * @return true if account exists, false otherwise
          */
-        static bool check(const Account& acc);
+        static bool check(const Account& acc, DB& db);
 
         /**
          * @brief Parse a JSON string into a vector of Account objects
@@ -0,0 +1,114 @@
+/**
+ * @file BoardProtocol.h
+ * @brief Header file for the compact board synchronisation protocol
+ *
+ * A full snapshot is sent when a client joins or asks to resync. After that
+ * every called number is sent as a small delta update carrying a sequence
+ * number, the called number, the cells each player gained and the lines
+ * each player completed.
+ */
+
+#ifndef BOARDPROTOCOL_H
+#define BOARDPROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct BoardUpdate
+ * @brief Per-turn delta describing the effect of one called number
+ */
+struct BoardUpdate {
+    uint32_t sequence = 0;          ///< Sequence number, one higher than the previous update
+    int number = 0;                 ///< Number called this turn (1-25)
+    vector<uint32_t> markedDelta;   ///< Cells newly marked on each player's board (25-bit masks)
+    vector<uint16_t> newLines;      ///< Lines newly completed by each player (12-bit masks)
+};
+
+/**
+ * @struct BoardSnapshot
+ * @brief Full game state sent on join or resync, and kept by clients as their mirror
+ */
+struct BoardSnapshot {
+    uint32_t sequence = 0;          ///< Sequence number of the last applied update
+    int currentTurn = 0;            ///< Index of the player whose turn it is
+    vector<string> usernames;       ///< Player names in turn order
+    vector<vector<int>> boards;     ///< 25 board numbers per player in row-major order
+    vector<uint32_t> marked;        ///< Marked cells per player (25-bit masks)
+    vector<uint16_t> lines;         ///< Completed lines per player (12-bit masks)
+};
+
+/**
+ * @class BoardProtocol
+ * @brief Static encoder/decoder for board snapshots and delta updates
+ *
+ * Updates are encoded as:
+ *   varint sequence, byte number, then per player:
+ *   byte cell count, one byte per newly marked cell index, varint line mask.
+ * A two-player update with one mark each is typically 8 bytes.
+ */
+class BoardProtocol {
+public:
+    /**
+     * @brief Encodes a delta update
+     * @param update The update to encode
+     * @return Encoded bytes
+     */
+    static vector<uint8_t> encodeUpdate(const BoardUpdate& update);
+
+    /**
+     * @brief Decodes a delta update
+     * @param data Encoded bytes
+     * @param playerCount Number of players in the game
+     * @param update Output update
+     * @return true if the data was well formed, false otherwise
+     */
+    static bool decodeUpdate(const vector<uint8_t>& data, size_t playerCount, BoardUpdate& update);
+
+    /**
+     * @brief Encodes a full snapshot
+     * @param snapshot The snapshot to encode
+     * @return Encoded bytes
+     */
+    static vector<uint8_t> encodeSnapshot(const BoardSnapshot& snapshot);
+
+    /**
+     * @brief Decodes a full snapshot
+     * @param data Encoded bytes
+     * @param snapshot Output snapshot, with line masks recomputed from the marks
+     * @return true if the data was well formed, false otherwise
+     */
+    static bool decodeSnapshot(const vector<uint8_t>& data, BoardSnapshot& snapshot);
+
+    /**
+     * @brief Applies an update to a client mirror
+     * @param state Mirror built from a snapshot and earlier updates
+     * @param update The next update
+     * @return true if applied; false if the sequence is out of order and a resync is needed
+     */
+    static bool applyUpdate(BoardSnapshot& state, const BoardUpdate& update);
+
+    /**
+     * @brief Computes the completed-line mask for a marked-cell mask
+     * @param marked 25-bit marked-cell mask
+     * @return 12-bit line mask, same layout as Player::getLineMask
+     */
+    static uint16_t lineMask(uint32_t marked);
+
+private:
+    /**
+     * @brief Appends an unsigned LEB128 varint
+     */
+    static void putVarint(vector<uint8_t>& out, uint32_t value);
+
+    /**
+     * @brief Reads an unsigned LEB128 varint
+     * @return false if the data ended early or the value overflowed
+     */
+    static bool getVarint(const vector<uint8_t>& data, size_t& pos, uint32_t& value);
+};
+
+#endif // BOARDPROTOCOL_H
\ No newline at end of file
@@ -0,0 +1,74 @@
+/**
+ * @file Checkpoint.h
+ * @brief Header file for the binary checkpoint image of the player table
+ *
+ * The image is one flat file, all integers little-endian and every
+ * position an offset, so it can be mapped and read in place:
+ *   header (HEADER_BYTES): magic, format, file size, checksum, shard
+ *     count, record count, engine name length, string bytes
+ *   shard generations: one u64 per shard
+ *   shard sizes: one u32 record count per shard
+ *   records (RECORD_BYTES each, grouped by shard): offset and length of
+ *     the username and password, game, win and lose counts, version
+ *   strings: engine name, then the usernames and passwords
+ * The checksum (CRC32C, stored in 8 bytes) covers everything after the
+ * header.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "Player.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class Checkpoint
+ * @brief Writes and maps checkpoint images of the parsed player records
+ *
+ * A checkpoint is only valid for the data it was taken from: it records
+ * the storage engine's name and the generation of every account shard,
+ * and read() refuses the image unless all of them still match. A stale,
+ * truncated or damaged image is ignored and the records are parsed from
+ * the engine as usual.
+ */
+class Checkpoint {
+    public:
+        /// Size of the fixed header
+        static constexpr size_t HEADER_BYTES = 64;
+        /// Size of one player record
+        static constexpr size_t RECORD_BYTES = 40;
+        /// Magic number, "CKP1"
+        static constexpr uint32_t MAGIC = 0x31504B43u;
+        /// Format version
+        static constexpr uint32_t FORMAT = 2;
+
+        /**
+         * @brief Writes an image, replacing the previous one atomically
+         * @param path Image path
+         * @param engine Name of the storage engine the records came from
+         * @param stamps Generation of each account shard
+         * @param shards Parsed players of each shard
+         * @return false if the image could not be written
+         */
+        static bool write(const string& path, const string& engine, const vector<uint64_t>& stamps,
+                          const vector<shared_ptr<const PlayerPart>>& shards);
+
+        /**
+         * @brief Maps an image and rebuilds the players if it is current
+         * @param path Image path
+         * @param engine Name of the storage engine in use
+         * @param stamps Current generation of each account shard
+         * @param shards Output players of each shard
+         * @return false if the image is missing, stale or damaged
+         */
+        static bool read(const string& path, const string& engine, const vector<uint64_t>& stamps,
+                         vector<vector<Player>>& shards);
+};
+
+#endif // CHECKPOINT_H
\ No newline at end of file
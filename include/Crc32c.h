@@ -0,0 +1,57 @@
+/**
+ * @file Crc32c.h
+ * @brief Header file for CRC32C (Castagnoli) checksums
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/**
+ * @class Crc32c
+ * @brief CRC32C of byte ranges, using the SSE4.2 crc32 instruction when available
+ *
+ * The instruction set is checked once at startup; other CPUs and
+ * compilers use a table-driven software version (slicing by 8) that gives
+ * the same results.
+ */
+class Crc32c {
+    public:
+        /**
+         * @brief Computes the CRC32C of a byte range
+         * @param data Bytes
+         * @param length Number of bytes
+         * @return Checksum
+         */
+        static uint32_t compute(const char* data, size_t length) {
+            return extend(0, data, length);
+        }
+
+        /**
+         * @brief Computes the CRC32C of a string
+         */
+        static uint32_t compute(const string& data) {
+            return extend(0, data.data(), data.size());
+        }
+
+        /**
+         * @brief Continues a checksum over more bytes
+         * @param crc Checksum of the bytes before
+         * @param data Following bytes
+         * @param length Number of bytes
+         * @return Checksum of the bytes before and these together
+         */
+        static uint32_t extend(uint32_t crc, const char* data, size_t length);
+
+        /**
+         * @brief Checks whether the hardware instruction is used
+         */
+        static bool hardwareAccelerated();
+};
+
+#endif // CRC32C_H
\ No newline at end of file
@@ -12,14 +12,26 @@
 #include "../include/Logger.h"
 #include "../include/Account.h"
 #include "../include/Game.h"
+#include "../include/WriteAheadLog.h"
+#include "../include/FileLock.h"
+#include "../include/StorageEngine.h"
+#include "../include/Metrics.h"
+#include "../include/RankIndex.h"
 
 #include <iostream>
-#include <filesystem>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <typeinfo>
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <map>
+#include <optional>
+#include <unordered_map>
 
 using namespace std;
 
@@ -30,176 +42,951 @@ using namespace std;
  * This class implements the singleton pattern and provides methods for
  * saving, loading, and resetting data in JSON format. It supports different
  * data types through template methods.
+ * 
+ * Records are kept by a StorageEngine chosen at construction: sharded
+ * JSON files (FileEngine), a log-structured merge tree (LsmEngine) or
+ * memory only (MemoryEngine). Either way a
+ * table is split into shards by a stable hash of the record key (username
+ * or game ID). Each shard has its own lock, so writes to different shards
+ * do not serialise.
+ * 
+ * Several processes may share one data directory. With the file engine
+ * every shard has a lock file (Account.3.json.lock); loads take it shared
+ * and transactions take it exclusively, so processes only wait for each
+ * other on the shards they both touch.
+ * 
+ * The parsed player table is also kept as a binary checkpoint image
+ * (Checkpoint.bin, see Checkpoint) so a restart can map it instead of
+ * parsing every account again, as long as no shard changed since.
  */
 class DB {
     public:
+        /// Data directory of the default database
+        inline static const string DEFAULT_ROOT = "../data";
+
+        /**
+         * @brief Storage engines a database can run on
+         */
+        enum class Engine {
+            FILES,      ///< Sharded JSON files behind a write-ahead log
+            LSM,        ///< Log-structured merge tree under <root>/lsm
+            MEMORY      ///< Hash maps in this process, nothing is persisted
+        };
+
         /**
          * @brief Gets the singleton instance of the DB class
-         * @return Reference to the singleton DB instance
+         * @return Reference to the default database, stored under ../data
          */
         static DB& getInstance() {
-            static DB instance;
+            static DB instance(DEFAULT_ROOT, Logger::getInstance(), &WriteAheadLog::getInstance(), defaultEngine());
             return instance;
         }
 
+        /**
+         * @brief Chooses the storage engine of the default database
+         * @param engine Engine to use
+         * 
+         * Only takes effect if called before the first getInstance().
+         */
+        static void setDefaultEngine(Engine engine) {
+            defaultEngine() = engine;
+        }
+
+        /**
+         * @brief Creates a database stored under its own directory
+         * @param root Data directory
+         * @param logger Logger receiving the database's messages
+         * @param engine Storage engine to use
+         * 
+         * The instance has its own write-ahead log and locks, so several
+         * instances with different roots can be used side by side in one
+         * process. init() must be called before use.
+         */
+        explicit DB(const string& root, Logger& logger = Logger::getInstance(), Engine engine = Engine::FILES);
+
+        /**
+         * @brief Gets the data directory
+         */
+        const string& getRoot() const {
+            return DATADIR;
+        }
+
+        /**
+         * @brief Gets the logger receiving the database's messages
+         */
+        Logger& getLogger() const {
+            return logger;
+        }
+
+        /**
+         * @brief Gets the storage engine
+         */
+        StorageEngine& storage() {
+            return *engine;
+        }
+
         // Delete copy constructor and assignment operator
         DB(const DB&) = delete;
         DB& operator=(const DB&) = delete;
 
+        /// Shard count of a new data directory
+        static constexpr size_t DEFAULT_SHARDS = 8;
+
         /**
-         * @brief Initializes the database by creating necessary directories and files
+         * @brief Initializes the database by opening its storage engine
+         * 
+         * The file engine creates the data directory and shard files and
+         * replays the write-ahead log; see FileEngine::open().
          */
         void init();
 
         /**
-         * @brief Generic method to save data to JSON file
+         * @brief Redistributes every record over a new number of shard files
+         * @param newCount New shard count
+         * @return true if the data was rewritten, false on error or when not on the file engine
+         * 
+         * Offline tool: no other thread or process may use the data directory
+         * meanwhile.
+         */
+        bool reshard(size_t newCount);
+
+        /// Shortest interval between periodic checkpoints
+        static constexpr int64_t CHECKPOINT_INTERVAL_MILLIS = 30000;
+
+        /**
+         * @brief Writes the parsed player table as a checkpoint image
+         * @param force Write even if the last checkpoint is recent
+         * @return false if an image was due but could not be written
+         * 
+         * Nothing is written before the player snapshot has been built,
+         * when no account shard changed since the last image, or with the
+         * memory engine.
+         */
+        bool checkpoint(bool force = true);
+
+        /**
+         * @brief Gets the number of shards per data type
+         */
+        size_t shardCount() const {
+            return engine->shardCount();
+        }
+
+        /**
+         * @brief Gets the shard a key belongs to
+         * @param key Username or game ID
+         * @return Shard index (64-bit FNV-1a hash of the key modulo the shard count)
+         */
+        size_t shardOf(const string& key) const {
+            return StorageEngine::shardOf(key, engine->shardCount());
+        }
+
+        /**
+         * @class Transaction
+         * @brief Group of record puts and deletes applied as one batch
+         * 
+         * Each shard is locked the first time the transaction reads or writes
+         * one of its records and stays locked until commit() or rollback(),
+         * so the read-modify-write of every record is isolated from other
+         * writers in this and in other processes.
+         * Reads see the transaction's own staged writes. To avoid deadlock,
+         * transactions touching several shards take account shards before
+         * game shards, each in ascending shard order. A transaction that is
+         * destroyed without commit() is rolled back.
+         */
+        class Transaction {
+            public:
+                /**
+                 * @brief Starts an empty transaction
+                 * @param db Database the transaction writes to
+                 */
+                explicit Transaction(DB& db) : db(db) {}
+
+                Transaction(Transaction&&) = default;
+                Transaction(const Transaction&) = delete;
+                Transaction& operator=(const Transaction&) = delete;
+
+                /**
+                 * @brief Rolls back if not committed
+                 */
+                ~Transaction() { rollback(); }
+
+                /**
+                 * @brief Reads the current JSON of a record
+                 * @param table "Account" or "Game"
+                 * @param key Record key
+                 * @param value Output record JSON
+                 * @return true if the record exists, counting staged writes
+                 */
+                bool get(const string& table, const string& key, string& value);
+
+                /**
+                 * @brief Stages an insert or replacement of a record
+                 * @param table "Account" or "Game"
+                 * @param key Record key
+                 * @param value Record JSON
+                 */
+                void put(const string& table, const string& key, const string& value);
+
+                /**
+                 * @brief Stages a delete of a record
+                 * @param table "Account" or "Game"
+                 * @param key Record key
+                 */
+                void remove(const string& table, const string& key);
+
+                /**
+                 * @brief Locks every shard of a table, in ascending order
+                 * @param table "Account" or "Game"
+                 */
+                void lockTable(const string& table);
+
+                /**
+                 * @brief Locks one shard of a table before any of its records is touched
+                 * @param table "Account" or "Game"
+                 * @param shard Shard index
+                 */
+                void lockShard(const string& table, size_t shard) {
+                    lock(table, shard);
+                }
+
+                /**
+                 * @brief Reads and parses a record
+                 * @tparam T The type of data
+                 * @param key Record key
+                 * @return The record, empty if it does not exist
+                 */
+                template<typename T>
+                optional<T> get(const string& key) {
+                    string json;
+                    if (!get(baseName<T>(), key, json)) return nullopt;
+                    vector<T> records = db.parse<T>("[" + json + "]");
+                    if (records.empty()) return nullopt;
+                    return records.front();
+                }
+
+                /**
+                 * @brief Stages an insert or replacement of a record
+                 * @tparam T The type of data
+                 * @param value The record
+                 */
+                template<typename T>
+                void put(const T& value) {
+                    put(baseName<T>(), recordKey(value), value.to_json());
+                }
+
+                /**
+                 * @brief Stages an insert or replacement of a record given as JSON
+                 * @tparam T The type of data
+                 * @param key Record key
+                 * @param json Record JSON
+                 */
+                template<typename T>
+                void put(const string& key, const string& json) {
+                    put(baseName<T>(), key, json);
+                }
+
+                /**
+                 * @brief Stages a delete of a record
+                 * @tparam T The type of data
+                 * @param key Record key
+                 */
+                template<typename T>
+                void remove(const string& key) {
+                    remove(baseName<T>(), key);
+                }
+
+                /**
+                 * @brief Applies every staged write as one batch and releases the locks
+                 * @return true if the batch was applied
+                 */
+                bool commit();
+
+                /**
+                 * @brief Discards every staged write and releases the locks
+                 */
+                void rollback();
+
+            private:
+                DB& db;                                 ///< Database the transaction writes to
+                WriteBatch batch;                       ///< Staged writes
+                vector<string> lockedShards;            ///< Shards locked by this transaction
+                vector<unique_lock<mutex>> locks;       ///< Locks held on those shards within the process
+                vector<FileLock> processLocks;          ///< Exclusive locks on their lock files
+
+                /**
+                 * @brief Locks a shard the first time the transaction touches it
+                 */
+                void lock(const string& table, size_t shard);
+        };
+
+        /**
+         * @brief Starts a transaction
+         * @return Empty transaction on this database
+         */
+        Transaction begin() {
+            return Transaction(*this);
+        }
+
+        /**
+         * @brief Generic method to save one record
          * @tparam T The type of data to save
          * @param data The data object to save
          * @return true if save was successful, false otherwise
          * 
-         * This method saves data in JSON format. If the file doesn't exist,
-         * it creates a new file with an empty array. New data is appended
-         * to the existing array.
+         * Inserts the record, or replaces the stored record with the same key.
          */
         template<typename T>
         bool save(const T& data) {
-            string filename = getFilename<T>();
-            string jsonData = data.to_json();
-            
             try {
-                // Check if file exists, if not create and initialize with empty array
-                if (!filesystem::exists(filename)) {
-                    ofstream newFile(filename);
-                    newFile << "[]";
-                    newFile.close();
+                Transaction txn = begin();
+                txn.put(data);
+                if (!txn.commit()) {
+                    logger.error("Failed to save " + recordKey(data));
+                    return false;
                 }
+                logger.info("Data saved to " + baseName<T>() + " shard " + to_string(shardOf(recordKey(data))));
+                return true;
+            } catch (const exception& e) {
+                logger.error("Error saving data: " + string(e.what()));
+                return false;
+            }
+        }
 
-                // Read existing file content
-                ifstream inFile(filename);
-                string content;
-                getline(inFile, content);
-                inFile.close();
-
-                // Handle file content
-                if (content.empty()) {
-                    content = "[]";
+        /**
+         * @brief Generic method to add one record that must not exist yet
+         * @tparam T The type of data to add
+         * @param data The data object to add
+         * @return true if added, false if a record with the same key exists or the write failed
+         * 
+         * The existence check and the write hold the lock of the key's
+         * shard, so of two callers racing for one key only one succeeds.
+         */
+        template<typename T>
+        bool insert(const T& data) {
+            try {
+                Transaction txn = begin();
+                string json;
+                if (txn.get(baseName<T>(), recordKey(data), json)) {
+                    logger.info(baseName<T>() + " " + recordKey(data) + " already exists");
+                    return false;
                 }
+                txn.put(data);
+                if (!txn.commit()) {
+                    logger.error("Failed to add " + recordKey(data));
+                    return false;
+                }
+                return true;
+            } catch (const exception& e) {
+                logger.error("Error adding data: " + string(e.what()));
+                return false;
+            }
+        }
 
-                // Insert new data at the end
-                if (content == "[]") {
-                    // If empty array, directly insert data
-                    content = "[" + jsonData + "]";
-                } else {
-                    // Insert new data before the last ']'
-                    content.insert(content.length() - 1, "," + jsonData);
+        /**
+         * @brief Generic method to replace every record of a type with a list
+         * @tparam T The type of data to save
+         * @param data The data objects to save
+         * @return true if save was successful, false otherwise
+         * 
+         * Deletes stored records missing from the list and writes the rest,
+         * all in a single transaction.
+         */
+        template<typename T>
+        bool saveAll(const vector<T>& data) {
+            try {
+                Transaction txn = begin();
+                txn.lockTable(baseName<T>());
+
+                unordered_map<string, bool> kept;
+                for (const T& record : data) kept[recordKey(record)] = true;
+                for (const auto& record : engine->scan(baseName<T>())) {
+                    if (!kept.count(record.first)) txn.remove<T>(record.first);
                 }
+                for (const T& record : data) txn.put(record);
 
-                // Write updated content
-                ofstream outFile(filename);
-                if (!outFile.is_open()) {
-                    LOG_ERROR("Failed to open file: " + filename);
+                if (!txn.commit()) {
+                    logger.error("Failed to write " + baseName<T>() + " shards");
                     return false;
                 }
-                
-                outFile << content;
-                outFile.close();
-                LOG_INFO("Data saved to " + filename);
+                logger.info("Data saved to " + baseName<T>() + " shards");
                 return true;
             } catch (const exception& e) {
-                LOG_ERROR("Error saving data: " + string(e.what()));
+                logger.error("Error saving data: " + string(e.what()));
                 return false;
             }
         }
 
         /**
-         * @brief Generic method to load data from JSON file
+         * @brief Loads one record by key
+         * @tparam T The type of data to load
+         * @param key Username or game ID
+         * @return The record, empty if it does not exist; games are bound to this database
+         * 
+         * Only the key's shard is read, under a shared lock.
+         */
+        template<typename T>
+        optional<T> find(const string& key) {
+            string json;
+            {
+                FileLock lock = lockShared(baseName<T>(), shardOf(key));
+                if (!engine->get(baseName<T>(), key, json)) return nullopt;
+            }
+            try {
+                vector<T> records = parse<T>("[" + json + "]");
+                if (records.empty()) return nullopt;
+                return records.front();
+            } catch (const exception& e) {
+                logger.error("Error loading data: " + string(e.what()));
+                return nullopt;
+            }
+        }
+
+        /**
+         * @brief Generic method to load every record of a type
          * @tparam T The type of data to load
          * @return Vector of objects of type T
          * 
-         * This method loads and parses JSON data from a file into objects.
-         * If the file doesn't exist or is empty, returns an empty vector.
+         * The records are read under a shared lock on every shard, then
+         * parsed in parallel chunks.
          */
         template<typename T>
         vector<T> load() {
-            string filename = getFilename<T>();
-            vector<T> results;
-            
-            try {
-                // Check if file exists
-                if (!filesystem::exists(filename)) {
-                    LOG_INFO("File not found: " + filename);
-                    return results;
+            vector<pair<string, string>> records;
+            {
+                vector<FileLock> shared;
+                for (size_t shard = 0; shard < shardCount(); ++shard) {
+                    shared.push_back(lockShared(baseName<T>(), shard));
                 }
+                records = engine->scan(baseName<T>());
+            }
+            logger.info("Data loaded from " + baseName<T>() + " shards");
+            return parseAll<T>(records);
+        }
 
-                // Read file content
-                ifstream inFile(filename);
-                string content;
-                getline(inFile, content);
-                inFile.close();
+        /**
+         * @brief Gets the time callers waited for shard locks
+         * @return Histogram of lock waits, shared and exclusive
+         */
+        const LatencyHistogram& lockWaits() const {
+            return lockWaitHistogram;
+        }
 
-                // Handle empty file or empty array
-                if (content.empty() || content == "[]") {
-                    return results;
-                }
+        /**
+         * @brief Records of one shard in key order
+         * @tparam T Player or Game
+         * 
+         * Each record is shared, so a commit copies only the pointers of
+         * the part it changes and replaces just the records it wrote.
+         */
+        template<typename T>
+        using Part = vector<shared_ptr<const T>>;
 
-                // Parse JSON array
-                results = T::from_json(content);
+        /**
+         * @brief Gets an immutable snapshot of every record of a type
+         * @tparam T Player or Game
+         * @return Shared, read-only records as of the latest commit
+         * 
+         * Readers only copy a reference-counted pointer, so they never wait
+         * for writers; a snapshot stays valid for as long as a reader holds
+         * it, even after newer commits. Commits only replace the parts of
+         * the shards they wrote (see snapshotParts()); the combined vector
+         * is rebuilt from the parts by the first reader after a commit,
+         * outside every lock, so readers that need one record or one shard
+         * should use snapshotFind() or snapshotParts() instead. Commits by
+         * other processes are noticed by
+         * comparing the engine's shard generations, at most every
+         * SNAPSHOT_RECHECK_MILLIS.
+         */
+        template<typename T>
+        shared_ptr<const vector<T>> snapshot() {
+            SnapshotState<T>& state = snapshotState<T>();
+            shared_ptr<const vector<T>> current = atomic_load(&state.combined);
+            if (current && !changedElsewhere<T>(state)) return current;
 
-                LOG_INFO("Data loaded from " + filename);
-                return results;
-            } catch (const exception& e) {
-                LOG_ERROR("Error loading data: " + string(e.what()));
-                return results;
+            uint64_t sequence = 0;
+            vector<shared_ptr<const Part<T>>> parts = currentParts<T>(sequence);
+            size_t total = 0;
+            for (const auto& part : parts) total += part->size();
+            vector<T> all;
+            all.reserve(total);
+            for (const auto& part : parts) {
+                for (const auto& record : *part) all.push_back(*record);
             }
+            current = make_shared<const vector<T>>(move(all));
+
+            // Keep it unless a commit replaced a part meanwhile
+            lock_guard<mutex> lock(state.publishMutex);
+            if (state.sequence == sequence) atomic_store(&state.combined, current);
+            return current;
         }
 
         /**
-         * @brief Generic method to reset data file
-         * @tparam T The type of data file to reset
-         * @return true if reset was successful
+         * @brief Gets the records of a type as one immutable part per shard
+         * @tparam T Player or Game
+         * @return Parsed records of each shard, in shard order, as of the latest commit
          * 
-         * This method resets the specified data file by creating
-         * a new empty array.
+         * Commits to an account shard republish only that shard's part of
+         * the player records; commits to a game shard drop the game parts.
+         * Readers that can iterate the parts avoid combining them.
          */
         template<typename T>
-        bool reset() {
-            string filename = getFilename<T>();
-            ofstream newFile(filename, ios::trunc);
-            newFile << "[]";
-            newFile.close();
+        vector<shared_ptr<const Part<T>>> snapshotParts() {
+            uint64_t sequence = 0;
+            return currentParts<T>(sequence);
+        }
 
-            return true;
+        /**
+         * @brief Looks one record up in the latest snapshot
+         * @tparam T Player or Game
+         * @param key Username or game ID
+         * @return The shared record, null if it does not exist
+         * 
+         * A binary search in the key's shard part; nothing is combined or
+         * read from storage unless the parts have to be rebuilt.
+         */
+        template<typename T>
+        shared_ptr<const T> snapshotFind(const string& key) {
+            uint64_t sequence = 0;
+            vector<shared_ptr<const Part<T>>> parts = currentParts<T>(sequence);
+            size_t shard = shardOf(key);
+            if (shard >= parts.size()) return nullptr;
+            const Part<T>& part = *parts[shard];
+            auto it = lowerBound(part, key);
+            return it != part.end() && recordKey(**it) == key ? *it : nullptr;
+        }
+
+        /**
+         * @brief Gets the players ranked by win rate
+         * @return Index updated by every commit to an account shard
+         * 
+         * Brings the player parts up to date first, so commits by other
+         * processes are seen. The index is only rebuilt with the snapshot;
+         * commits in this process move just the players they change.
+         */
+        const RankIndex& ranks() {
+            snapshotParts<Player>();
+            return playerRanks;
+        }
+
+        /**
+         * @brief Generic method to delete every record of a type
+         * @tparam T The type of data to reset
+         * @return true if reset was successful
+         */
+        template<typename T>
+        bool reset() {
+            Transaction txn = begin();
+            txn.lockTable(baseName<T>());
+            for (const auto& record : engine->scan(baseName<T>())) {
+                txn.remove<T>(record.first);
+            }
+            return txn.commit();
         }
 
     private:
         /// Path to the data directory
-        const string DATADIR = "../data";
-        /// Path to the account data file
-        const string ACCOUNTDATA = "../data/Account.json";
-        /// Path to the game data file
-        const string GAMEDATA = "../data/Game.json";
+        const string DATADIR;
+
+        /// Logger receiving the database's messages
+        Logger& logger;
+        /// Storage engine holding the records
+        unique_ptr<StorageEngine> engine;
+
+        /**
+         * @struct SnapshotState
+         * @brief Published snapshot of one data type and the per-shard parts it was built from
+         */
+        template<typename T>
+        struct SnapshotState {
+            mutex publishMutex;                             ///< Serialises publishers
+            mutex buildMutex;                               ///< Serialises rebuilds of the parts; never held by writers
+            vector<shared_ptr<const Part<T>>> shards;       ///< Parsed records per shard, empty until first read
+            vector<uint64_t> stamps;                        ///< Generation of each shard when parsed
+            uint64_t sequence = 0;                          ///< Bumped by every commit to the type
+            atomic<int64_t> checkedAt{0};                   ///< When the stamps were last compared, in milliseconds
+            shared_ptr<const vector<T>> combined;           ///< Combined snapshot, read atomically; null after a commit
+        };
+
+        /// Shortest interval between checks for commits by other processes
+        static constexpr int64_t SNAPSHOT_RECHECK_MILLIS = 200;
+
+        /// Latest published player records
+        SnapshotState<Player> playerSnapshots;
+        /// Latest published game records, null until the next read rebuilds it
+        SnapshotState<Game> gameSnapshots;
+        /// Players of the published snapshot by win rate, changed under its publish lock
+        RankIndex playerRanks;
+
+        /// Path of the checkpoint image, empty if the engine keeps nothing on disk
+        const string CHECKPOINT;
+        /// Serialises checkpoint writers
+        mutex checkpointMutex;
+        /// Shard generations of the last image written or loaded
+        vector<uint64_t> checkpointStamps;
+        /// When the last image was written, in milliseconds
+        int64_t checkpointedAt = 0;
+
+        /// Guards the shard lock table
+        mutex lockTableMutex;
+        /// One lock per shard, taken by transactions
+        unordered_map<string, unique_ptr<mutex>> shardLocks;
+        /// Time spent waiting for shard locks
+        LatencyHistogram lockWaitHistogram;
+
+        /**
+         * @brief Creates a database, sharing a write-ahead log if one is given
+         * @param root Data directory
+         * @param logger Logger receiving the database's messages
+         * @param sharedLog Log for the file engine, or null to own a new one
+         * @param engine Storage engine to use
+         */
+        DB(const string& root, Logger& logger, WriteAheadLog* sharedLog, Engine engine);
+
+        /**
+         * @brief Gets the engine chosen for the default database
+         */
+        static Engine& defaultEngine() {
+            static Engine engine = Engine::FILES;
+            return engine;
+        }
+
+        /**
+         * @brief Gets the lock of a shard within the process
+         * @param table "Account" or "Game"
+         * @param shard Shard index
+         * @return Reference to the shard's mutex
+         */
+        mutex& shardLock(const string& table, size_t shard);
+
+        /**
+         * @brief Takes the lock file of a shard, recording the wait
+         * @param table "Account" or "Game"
+         * @param shard Shard index
+         * @param mode Shared for reads, exclusive for writes
+         * @return The held lock, or no lock if the engine is private to this process
+         */
+        FileLock lockFile(const string& table, size_t shard, FileLock::Mode mode);
+
+        /**
+         * @brief Takes the lock file of a shard for reading
+         */
+        FileLock lockShared(const string& table, size_t shard) {
+            return lockFile(table, shard, FileLock::Mode::SHARED);
+        }
 
         /**
-         * @brief Private constructor for singleton pattern
+         * @brief Gets a monotonic clock reading in milliseconds
          */
-        DB() {}
+        static int64_t steadyMillis() {
+            return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @brief Drops a snapshot if another process changed one of its shards
+         * @tparam T Player or Game
+         * @param state Snapshot state of the type
+         * @return true if the snapshot was dropped
+         */
+        template<typename T>
+        bool changedElsewhere(SnapshotState<T>& state) {
+            int64_t now = steadyMillis();
+            int64_t last = state.checkedAt.load(memory_order_relaxed);
+            if (now - last < SNAPSHOT_RECHECK_MILLIS || !state.checkedAt.compare_exchange_strong(last, now)) {
+                return false;
+            }
+
+            lock_guard<mutex> lock(state.publishMutex);
+            for (size_t shard = 0; shard < state.stamps.size(); ++shard) {
+                if (engine->generation(baseName<T>(), shard) != state.stamps[shard]) {
+                    state.shards.clear();
+                    state.stamps.clear();
+                    state.sequence++;
+                    atomic_store(&state.combined, shared_ptr<const vector<T>>());
+                    return true;
+                }
+            }
+            return false;
+        }
 
         /**
-         * @brief Gets the filename for a specific data type
+         * @brief Parses a JSON array of records
          * @tparam T The type of data
-         * @return String containing the filename
+         * @param content JSON array
+         * @return Parsed records; games are bound to this database
+         */
+        template<typename T>
+        vector<T> parse(const string& content) {
+            return T::from_json(content);
+        }
+
+        /**
+         * @brief Parses records returned by the engine
+         * @tparam T The type of data
+         * @param records Pairs of key and record JSON
+         * @return Parsed records, in the given order
+         * 
+         * Large inputs are split into chunks parsed in parallel.
+         */
+        template<typename T>
+        vector<T> parseAll(const vector<pair<string, string>>& records) {
+            auto parseRange = [this, &records](size_t begin, size_t end) {
+                if (begin == end) return vector<T>();
+                string content = "[";
+                for (size_t i = begin; i < end; ++i) {
+                    if (i > begin) content += ",";
+                    content += records[i].second;
+                }
+                try {
+                    return parse<T>(content + "]");
+                } catch (const exception& e) {
+                    logger.error("Error loading data: " + string(e.what()));
+                    return vector<T>();
+                }
+            };
+
+            size_t chunks = min<size_t>(max(1u, thread::hardware_concurrency()), records.size() / PARSE_CHUNK + 1);
+            if (chunks == 1) return parseRange(0, records.size());
+
+            vector<future<vector<T>>> parts;
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                size_t begin = records.size() * chunk / chunks;
+                size_t end = records.size() * (chunk + 1) / chunks;
+                parts.push_back(async(launch::async, parseRange, begin, end));
+            }
+
+            vector<T> results;
+            for (auto& part : parts) {
+                vector<T> parsed = part.get();
+                results.insert(results.end(), make_move_iterator(parsed.begin()), make_move_iterator(parsed.end()));
+            }
+            return results;
+        }
+
+        /// Smallest number of records worth parsing on a thread of its own
+        static constexpr size_t PARSE_CHUNK = 256;
+
+        /**
+         * @brief Gets the snapshot state of a type
+         * @tparam T Player or Game
+         */
+        template<typename T>
+        SnapshotState<T>& snapshotState();
+
+        /**
+         * @brief Loads the parsed records of a type from the checkpoint image
+         * @tparam T Player or Game
+         * @param stamps Current generation of each shard
+         * @param shards Output records of each shard
+         * @return false if there is no current image for the type
+         */
+        template<typename T>
+        bool restoreCheckpoint(const vector<uint64_t>& stamps, vector<vector<T>>& shards);
+
+        /**
+         * @brief Gets the current parts of a type, rebuilding them if needed
+         * @tparam T Player or Game
+         * @param sequence Output commit sequence the parts are current for
+         * @return Parsed records of each shard
+         * 
+         * The raw records and shard generations are copied under every
+         * shard lock of the table and parsed after the locks are released,
+         * so writers never wait for parsing, and parsing game records,
+         * which looks up the player snapshot, never holds a game shard lock
+         * while taking account shard locks. A commit that lands meanwhile
+         * bumps the sequence; the parts are then rebuilt, and after
+         * REBUILD_ATTEMPTS returned to this reader without being kept.
+         */
+        template<typename T>
+        vector<shared_ptr<const Part<T>>> currentParts(uint64_t& sequence) {
+            SnapshotState<T>& state = snapshotState<T>();
+            changedElsewhere<T>(state);
+            {
+                lock_guard<mutex> lock(state.publishMutex);
+                sequence = state.sequence;
+                if (state.shards.size() == shardCount()) return state.shards;
+            }
+
+            lock_guard<mutex> building(state.buildMutex);
+            const string table = baseName<T>();
+            vector<shared_ptr<const Part<T>>> shards;
+            for (int attempt = 0; attempt < REBUILD_ATTEMPTS; ++attempt) {
+                {
+                    lock_guard<mutex> lock(state.publishMutex);
+                    sequence = state.sequence;
+                    if (state.shards.size() == shardCount()) return state.shards;
+                }
+
+                vector<uint64_t> stamps;
+                vector<vector<pair<string, string>>> raw;
+                vector<vector<T>> parsed;
+                {
+                    vector<unique_lock<mutex>> locks;
+                    for (size_t shard = 0; shard < shardCount(); ++shard) {
+                        locks.emplace_back(shardLock(table, shard));
+                    }
+                    vector<FileLock> shared;
+                    for (size_t shard = 0; shard < shardCount(); ++shard) {
+                        shared.push_back(lockShared(table, shard));
+                        stamps.push_back(engine->generation(table, shard));
+                    }
+                    if (!restoreCheckpoint<T>(stamps, parsed)) {
+                        raw.resize(shardCount());
+                        for (auto& record : engine->scan(table)) {
+                            raw[shardOf(record.first)].push_back(move(record));
+                        }
+                    }
+                }
+                for (const auto& records : raw) parsed.push_back(parseAll<T>(records));
+
+                shards.clear();
+                for (auto& records : parsed) shards.push_back(makePart(move(records)));
+
+                lock_guard<mutex> lock(state.publishMutex);
+                if (state.sequence != sequence) continue;
+                state.shards = shards;
+                state.stamps = move(stamps);
+                state.checkedAt.store(steadyMillis(), memory_order_relaxed);
+                rebuildIndex<T>(shards);
+                return shards;
+            }
+            return shards;
+        }
+
+        /// Rebuilds of the parts tried before one is returned without being kept
+        static constexpr int REBUILD_ATTEMPTS = 3;
+
+        /**
+         * @brief Rebuilds the index kept for a type after its parts were rebuilt
+         * @tparam T Player or Game
+         *
+         * Only players are indexed (see the specialisation below); other
+         * types keep nothing, so the parts go unnamed here.
+         */
+        template<typename T>
+        void rebuildIndex(const vector<shared_ptr<const Part<T>>>&) {}
+
+        /**
+         * @brief Shares parsed records as a part in key order
+         * @tparam T Player or Game
+         * @param records Records of one shard
+         * @return The part
+         */
+        template<typename T>
+        static shared_ptr<const Part<T>> makePart(vector<T>&& records) {
+            Part<T> part;
+            part.reserve(records.size());
+            for (T& record : records) part.push_back(make_shared<const T>(move(record)));
+            sort(part.begin(), part.end(), [](const shared_ptr<const T>& a, const shared_ptr<const T>& b) {
+                return recordKey(*a) < recordKey(*b);
+            });
+            return make_shared<const Part<T>>(move(part));
+        }
+
+        /**
+         * @brief Finds the first record of a part whose key is not less than a key
+         * @tparam T Player or Game
+         * @param part Part in key order
+         * @param key Username or game ID
+         * @return Iterator to the record, or the end of the part
+         */
+        template<typename T>
+        static typename Part<T>::const_iterator lowerBound(const Part<T>& part, const string& key) {
+            return lower_bound(part.begin(), part.end(), key, [](const shared_ptr<const T>& record, const string& target) {
+                return recordKey(*record) < target;
+            });
+        }
+
+        /**
+         * @brief Publishes snapshots after a commit
+         * @param batch Writes that were applied
+         * 
+         * Called with the locks of the touched shards held, so snapshots are
+         * published in commit order.
+         */
+        void publish(const WriteBatch& batch);
+
+        /**
+         * @brief Drops every published snapshot
+         */
+        void invalidateSnapshots();
+
+        /**
+         * @brief Gets the key of an account or player record
+         * @param account The account
+         * @return Username
+         */
+        static string recordKey(const Account& account) {
+            return account.getUsername();
+        }
+
+        /**
+         * @brief Gets the key of a game record
+         * @param game The game
+         * @return Game ID
+         */
+        static string recordKey(const Game& game) {
+            return game.getGameId();
+        }
+
+        /**
+         * @brief Gets the table name for a specific data type
+         * @tparam T The type of data
+         * @return "Account" or "Game"
          * @throw runtime_error if data type is not supported
          */
         template<typename T>
-        string getFilename() const {
+        static string baseName() {
             if (typeid(T) == typeid(Account) || typeid(T) == typeid(Player)) {
-                return ACCOUNTDATA;
+                return "Account";
             } 
             else if (typeid(T) == typeid(Game)) {
-                return GAMEDATA;
+                return "Game";
             }
             throw runtime_error("Unsupported data type");
         }
 };
 
+/**
+ * @brief Parses game records, binding them to this database
+ */
+template<>
+inline vector<Game> DB::parse<Game>(const string& content) {
+    return Game::from_json(content, *this);
+}
+
+/**
+ * @brief Gets the player snapshot state
+ */
+template<>
+inline DB::SnapshotState<Player>& DB::snapshotState<Player>() {
+    return playerSnapshots;
+}
+
+/**
+ * @brief Gets the game snapshot state
+ */
+template<>
+inline DB::SnapshotState<Game>& DB::snapshotState<Game>() {
+    return gameSnapshots;
+}
+
+template<>
+bool DB::restoreCheckpoint<Player>(const vector<uint64_t>& stamps, vector<vector<Player>>& shards);
+
+/**
+ * @brief Ranks the players of a new snapshot
+ */
+template<>
+inline void DB::rebuildIndex<Player>(const vector<shared_ptr<const Part<Player>>>& shards) {
+    playerRanks.rebuild(shards);
+}
+
+/**
+ * @brief Games are not checkpointed; they are always parsed from the engine
+ */
+template<>
+inline bool DB::restoreCheckpoint<Game>(const vector<uint64_t>&, vector<vector<Game>>&) {
+    return false;
+}
+
 #endif // DB_H
\ No newline at end of file
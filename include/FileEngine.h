@@ -0,0 +1,225 @@
+/**
+ * @file FileEngine.h
+ * @brief Header file for the storage engine that keeps records in sharded JSON files
+ */
+
+#ifndef FILEENGINE_H
+#define FILEENGINE_H
+
+#include "StorageEngine.h"
+#include "Logger.h"
+#include "WriteAheadLog.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class FileEngine
+ * @brief Storage engine writing each table as shard files of JSON arrays
+ *
+ * Records are partitioned into shard files by a stable hash of their key,
+ * e.g. Account.0.json ... Account.7.json. A batch
+ * rewrites every shard file it touches in one write-ahead log record. The
+ * shard count is kept in Shards.json and changed offline with reshard().
+ * Every shard file has a lock file next to it (Account.3.json.lock) that the
+ * DB takes to serialise processes sharing the directory.
+ *
+ * A shard file starts with the line "FRAME_MAGIC <generation>", followed
+ * by one frame per record:
+ *   <length> <CRC32C, 8 hex digits>\n<record JSON>\n
+ * The generation grows with every rewrite of the file. It is written in the
+ * same log record as the records, under the shard's exclusive lock, so it
+ * tells every process whether a shard changed, however close together two
+ * writes were.
+ * A frame whose checksum does not match is copied to
+ * quarantine/<shard file>.bad, logged and left out; the next write to the
+ * shard drops it. Files still holding a plain JSON array (written before
+ * framing) are read as such and framed on their next write.
+ */
+class FileEngine : public StorageEngine {
+    public:
+        /**
+         * @brief Creates an engine over a data directory
+         * @param root Data directory
+         * @param logger Logger receiving the engine's messages
+         * @param sharedLog Write-ahead log to use, or null to own a new one
+         * @param defaultShards Shard count of a new data directory
+         */
+        FileEngine(const string& root, Logger& logger, WriteAheadLog* sharedLog, size_t defaultShards);
+
+        /**
+         * @brief Creates the data directory and the shard files
+         * @return true if the directory can be used
+         *
+         * Opens the write-ahead log and replays any commits a crash left
+         * unapplied before the data files are read. Single-file data from
+         * before sharding is split into shards on first start.
+         */
+        bool open() override;
+
+        string name() const override {
+            return "file";
+        }
+
+        size_t shardCount() const override {
+            return shards;
+        }
+
+        string lockPath(const string& table, size_t shard) const override {
+            return shardPath(table, shard) + ".lock";
+        }
+
+        uint64_t generation(const string& table, size_t shard) override;
+        bool get(const string& table, const string& key, string& value) override;
+        vector<pair<string, string>> scan(const string& table) override;
+        vector<pair<string, string>> scanShard(const string& table, size_t shard) override;
+        bool apply(const WriteBatch& batch) override;
+
+        /**
+         * @brief Redistributes every record over a new number of shard files
+         * @param newCount New shard count
+         * @return true if the data was rewritten
+         *
+         * Offline tool: no other thread or process may use the data directory
+         * meanwhile. The new shard files and the new count are committed as
+         * one log record.
+         */
+        bool reshard(size_t newCount);
+
+        /**
+         * @brief Gets the path of a shard file
+         * @param table Table name
+         * @param shard Shard index
+         * @return Path such as <root>/Account.3.json
+         */
+        string shardPath(const string& table, size_t shard) const {
+            return DATADIR + "/" + table + "." + to_string(shard) + ".json";
+        }
+
+        /**
+         * @brief Gets the write-ahead log in front of the data files
+         */
+        WriteAheadLog& getLog() {
+            return wal;
+        }
+
+        /**
+         * @brief Splits a JSON array of objects into one string per object
+         * @param json Content of a data file
+         * @return Trimmed JSON object strings, in file order
+         */
+        static vector<string> splitRecords(const string& json);
+
+        /// Start of the first line of a framed shard file
+        inline static const string FRAME_MAGIC = "BINGO-RECORDS 1";
+
+        /**
+         * @brief Builds the content of a framed shard file
+         * @param records Record JSON strings, empty ones skipped
+         * @param generation Generation written to the header line
+         * @return Header line followed by one checksummed frame per record
+         */
+        static string frameRecords(const vector<string>& records, uint64_t generation);
+
+    private:
+        /// Path to the data directory
+        const string DATADIR;
+        /// Path to the account data file from before sharding
+        const string ACCOUNTDATA;
+        /// Path to the game data file from before sharding
+        const string GAMEDATA;
+        /// Path to the shard count manifest
+        const string SHARDDATA;
+        /// Path to the write-ahead log
+        const string WALDATA;
+        /// Directory receiving corrupt records
+        const string QUARANTINEDIR;
+
+        /// Tables stored by the engine
+        inline static const vector<string> TABLES = {"Account", "Game"};
+
+        /// Logger receiving the engine's messages
+        Logger& logger;
+        /// Write-ahead log owned by this instance, null when shared
+        unique_ptr<WriteAheadLog> ownedLog;
+        /// Write-ahead log in front of the data files
+        WriteAheadLog& wal;
+
+        /// Number of shard files per table
+        size_t shards;
+
+        /// Guards the quarantined set
+        mutex quarantineMutex;
+        /// Corrupt frames already quarantined, by file, generation and offset
+        unordered_set<string> quarantined;
+
+        /**
+         * @brief Reads the records of a shard or legacy data file
+         * @param path File path
+         * @param generation Output generation of the file, if not null
+         * @return Record JSON strings whose checksum matched, in file order
+         */
+        vector<string> readRecords(const string& path, uint64_t* generation = nullptr);
+
+        /**
+         * @brief Parses the header line of a framed shard file
+         * @param content Content of the file, or at least its first line
+         * @param body Output offset of the first frame
+         * @param generation Output generation, 0 if the header has none
+         * @return false if the content is not framed
+         */
+        static bool parseHeader(const string& content, size_t& body, uint64_t& generation);
+
+        /**
+         * @brief Reads the generation of a shard file from its header line
+         * @param path File path
+         * @return Generation, 0 if the file is missing or has none
+         */
+        static uint64_t readGeneration(const string& path);
+
+        /**
+         * @brief Gets the generation of the next version of a file
+         * @param current Generation of the current version
+         */
+        static uint64_t nextGeneration(uint64_t current);
+
+        /**
+         * @brief Copies corrupt bytes of a data file to the quarantine directory
+         * @param path Data file
+         * @param generation Generation of the file
+         * @param offset Offset of the bytes in the file
+         * @param bytes Corrupt bytes
+         */
+        void quarantine(const string& path, uint64_t generation, size_t offset, const string& bytes);
+
+        /**
+         * @brief Reads a whole file
+         * @param path File path
+         * @return Content, empty if the file is missing
+         */
+        static string readFile(const string& path);
+
+        /**
+         * @brief Finds the key of a raw record
+         * @param table Table the record belongs to
+         * @param record Record JSON
+         * @param key Output key
+         * @return false if the record has no key field
+         */
+        static bool keyOf(const string& table, const string& record, string& key);
+
+        /**
+         * @brief Rewrites the records of the given source files into shard files
+         * @param sources Files holding the records of each table, in TABLES order
+         * @param newCount New shard count
+         * @return true if the data was rewritten
+         */
+        bool redistribute(const vector<vector<string>>& sources, size_t newCount);
+};
+
+#endif // FILEENGINE_H
\ No newline at end of file
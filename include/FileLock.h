@@ -0,0 +1,74 @@
+/**
+ * @file FileLock.h
+ * @brief Header file for advisory locks shared between processes
+ */
+
+#ifndef FILELOCK_H
+#define FILELOCK_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @class FileLock
+ * @brief Holds a shared or exclusive advisory lock on a lock file until destroyed
+ * 
+ * Every FileLock opens the lock file itself, so two locks conflict whether
+ * they are held by different processes or by different threads of the same
+ * process. The lock file is created if it is missing and never removed
+ * while in use. If it cannot be opened the error is logged and the object
+ * holds no lock.
+ */
+class FileLock {
+    public:
+        /**
+         * @brief Lock modes
+         */
+        enum class Mode {
+            SHARED,     ///< Any number of holders, excludes EXCLUSIVE
+            EXCLUSIVE   ///< A single holder
+        };
+
+        /**
+         * @brief Creates an object that holds no lock
+         */
+        FileLock() = default;
+
+        /**
+         * @brief Takes a lock
+         * @param path Lock file path
+         * @param mode Lock mode
+         * @param wait Whether to wait for a conflicting lock; if false and the
+         *             lock is held elsewhere, the object holds no lock
+         */
+        FileLock(const string& path, Mode mode, bool wait = true);
+
+        /**
+         * @brief Releases the lock
+         */
+        ~FileLock();
+
+        FileLock(FileLock&& other) noexcept;
+        FileLock& operator=(FileLock&& other) noexcept;
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+
+        /**
+         * @brief Checks whether a lock is held
+         * @return true if the lock was taken
+         */
+        bool held() const {
+            return fd >= 0;
+        }
+
+        /**
+         * @brief Releases the lock early
+         */
+        void unlock();
+
+    private:
+        int fd = -1;    ///< Descriptor of the open lock file, -1 when nothing is held
+};
+
+#endif // FILELOCK_H
\ No newline at end of file
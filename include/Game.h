@@ -7,6 +7,7 @@
 #define GAME_H
 
 #include "Player.h"
+#include "BoardProtocol.h"
 
 #include <vector>
 #include <string>
@@ -14,6 +15,8 @@
 
 using namespace std;
 
+class DB;
+
 /**
  * @class Game
  * @brief Manages the game logic and state for a BINGO game
@@ -23,24 +26,76 @@ using namespace std;
  * - Turn management
  * - Game state persistence
  * - Win condition checking
+ * 
+ * Each game is bound to the database it was created with or loaded from,
+ * and is saved back to it.
  */
 class Game {
+    friend class GameLog;
+    friend class Persistence;
+    friend class RoomManager;
+
     private:
         vector<Player> players;      ///< List of players in the game
-        Player* winner;              ///< Pointer to the winning player (nullptr if no winner)
+        int winnerIndex;             ///< Index of the winning player in players (-1 if no winner)
         int currentTurn;            ///< Index of the current player's turn
         bool isOver;                ///< Flag indicating if the game is finished
         bool isSaved = false;       ///< Flag indicating if the game state is saved
         set<int> usedNumbers;       ///< Set of numbers that have been called
         string gameId;              ///< Unique identifier for the game
+        uint32_t sequence = 0;      ///< Number of updates produced so far
+        uint32_t seed = 0;          ///< Seed every player's board was generated from
+        BoardUpdate lastUpdate;     ///< Delta produced by the most recent called number
+        DB* database;               ///< Database the game is saved to
+        bool logged = false;        ///< Whether moves are appended to the game's log
+
+        /**
+         * @brief Replaces or adds game states and drops removed games
+         * @param states Pairs of game ID and game state JSON
+         * @param removals IDs of games to drop
+         * @return true if the changes were written, false otherwise
+         */
+        static bool storeStates(DB& db, const vector<pair<string, string>>& states, const vector<string>& removals = {});
+
+        /**
+         * @brief Passes the turn to the next player without logging it
+         */
+        void advanceTurn();
+
+        /**
+         * @brief Records the next player as the winner without logging it
+         */
+        void endByForfeit();
+
+        /**
+         * @brief Records the result of the finished game
+         * @param report If true, posts a notice once the result is written or given up
+         */
+        void finish(bool report);
+
+        /**
+         * @brief Queues a status line for the next menu
+         * @param notice Line to show
+         */
+        static void postNotice(const string& notice);
 
     public:
+        /// Prefix of hosted room IDs; evicted rooms are stored as games under it and never listed as saved games
+        inline static const string ROOM_PREFIX = "Room_";
+
         /**
-         * @brief Constructor for Game class
+         * @brief Constructor for Game class, bound to the default database
          * @param empty If true, creates an empty game without generating ID
          */
         Game(bool empty = false);
 
+        /**
+         * @brief Constructor for Game class
+         * @param db Database the game is saved to
+         * @param empty If true, creates an empty game without generating ID
+         */
+        explicit Game(DB& db, bool empty = false);
+
         /**
          * @brief Gets the list of players in the game
          * @return Constant reference to the vector of players
@@ -65,9 +120,15 @@ class Game {
          */
         string getCurrentTurn() const;
         
+        /**
+         * @brief Gets the seed the players' boards were generated from
+         * @return Board seed
+         */
+        uint32_t getSeed() const;
+
         /**
          * @brief Sets the winner of the game
-         * @param player Pointer to the winning player
+         * @param player Pointer to the winning player, which must be one of this game's players
          */
         void setWinner(Player* player);
 
@@ -103,6 +164,14 @@ class Game {
          */
         static vector<Game> from_json(const string& json);
 
+        /**
+         * @brief Converts JSON string to vector of Game objects bound to a database
+         * @param json JSON string containing game data
+         * @param db Database the games were read from, also used to look up their players
+         * @return Vector of Game objects
+         */
+        static vector<Game> from_json(const string& json, DB& db);
+
         /**
          * @brief Saves multiple games to storage
          * @param games Vector of games to save
@@ -114,6 +183,38 @@ class Game {
          */
         void save();
 
+        /**
+         * @brief Takes the status lines posted since the last call
+         * @return Notices about saves written in the background, oldest first
+         */
+        static vector<string> takeNotices();
+
+        /**
+         * @brief Writes the current game state to storage without console output
+         * @return true if the state was written, false otherwise
+         */
+        bool persist() const;
+
+        /**
+         * @brief Converts the game state to a JSON string
+         * @return JSON object with ID, players, current turn, winner and every board
+         */
+        string to_json() const;
+
+        /**
+         * @brief Loads a single saved game by ID
+         * @param gameId ID of the game to load
+         * @param game Output game, whose database is searched
+         * @return true if the game was found, false otherwise
+         */
+        static bool loadById(const string& gameId, Game& game);
+
+        /**
+         * @brief Estimates the heap and object memory held by the game
+         * @return Approximate size in bytes
+         */
+        size_t memoryFootprint() const;
+
         /**
          * @brief Parses game status data from JSON
          * @param json The JSON string containing game status
@@ -136,7 +237,7 @@ class Game {
 
         /**
          * @brief Displays list of saved games for given players
-         * @param games Vector of all saved games
+         * @param games Vector of all saved games, narrowed to the games listed
          * @param p1 First player
          * @param p2 Second player
          * @return true if saved games exist for players, false otherwise
@@ -149,11 +250,64 @@ class Game {
          */
         void startGame(vector<Player*> players);
 
+        /**
+         * @brief Sets up players and fresh boards without any console output
+         * @param players Vector of pointers to players
+         * @param seed Board seed; 0 picks a random one
+         */
+        void initPlayers(vector<Player*> players, uint32_t seed = 0);
+
+        /**
+         * @brief Derives the board seed of one player from the game seed
+         * @param gameSeed Seed of the game
+         * @param playerIndex Index of the player
+         * @return Seed passed to Player::generateBoard
+         */
+        static uint32_t boardSeed(uint32_t gameSeed, size_t playerIndex);
+
         /**
          * @brief Handles the logic for a single turn in the game
          */
         void playTurn();
 
+        /**
+         * @brief Calls a number for all players without any console interaction
+         * @param number The number to call (1-25)
+         * @return true if the number was valid and not yet used, false otherwise
+         *
+         * Marks the number on every board, records the delta in the last update
+         * and sets the winner and ends the game if a player has completed five lines.
+         */
+        bool callNumber(int number);
+
+        /**
+         * @brief Passes the turn to the next player without calling a number
+         *
+         * The skip is appended to the game's log, if it has one.
+         */
+        void skipTurn();
+
+        /**
+         * @brief Ends the game with the current player forfeiting
+         *
+         * The next player in turn order is recorded as the winner. The
+         * forfeit is appended to the game's log, if it has one, and the
+         * result is recorded like that of a won game.
+         */
+        void forfeit();
+
+        /**
+         * @brief Gets the delta produced by the most recent called number
+         * @return Constant reference to the last update
+         */
+        const BoardUpdate& getLastUpdate() const;
+
+        /**
+         * @brief Builds a full snapshot of the game for join or resync
+         * @return Snapshot of every player's board and marks
+         */
+        BoardSnapshot snapshot() const;
+
         /**
          * @brief Generates a unique game ID
          * @return String containing the generated game ID
@@ -0,0 +1,179 @@
+/**
+ * @file GameLog.h
+ * @brief Header file for the GameLog class implementing an append-only move log per game
+ */
+
+#ifndef GAMELOG_H
+#define GAMELOG_H
+
+#include "Game.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct GameHistory
+ * @brief Everything recorded in a game log, in order
+ */
+struct GameHistory {
+    uint32_t seed = 0;          ///< Board seed of the game
+    long long startTime = 0;    ///< Unix time the game started (0 if unknown)
+    vector<string> players;     ///< Player names in turn order
+    vector<int> events;         ///< Called numbers (1-25), GameLog::SKIP or GameLog::FORFEIT
+};
+
+/**
+ * @class GameLog
+ * @brief Event-sourced persistence of a game as an append-only log
+ *
+ * Each game has a log file of one JSON event per line, under the root of
+ * the database the game is bound to:
+ * - {"type":"start","seed":N,"time":T,"players":["a","b"]}
+ * - {"type":"call","number":N}
+ * - {"type":"skip"} and {"type":"forfeit"}
+ *
+ * The boards are regenerated from the seed and every event is replayed in
+ * order, so the state is rebuilt exactly. Every CHECKPOINT_INTERVAL calls a
+ * small checkpoint (marked masks, turn and log offset) is written next to
+ * the log, and rebuilding only replays the events after it.
+ */
+class GameLog {
+    public:
+        static const int CHECKPOINT_INTERVAL = 8;  ///< Calls between checkpoints
+        static const int SKIP = 0;                 ///< History code of a skipped turn
+        static const int FORFEIT = -1;             ///< History code of a forfeit
+
+        /**
+         * @brief Starts a new log for a game, replacing any previous one
+         * @param game The freshly started game
+         * @return true if the log was written, false otherwise
+         */
+        static bool start(const Game& game);
+
+        /**
+         * @brief Appends a called number and checkpoints if due
+         * @param game The game after the number was called
+         * @param number The called number
+         * @return true if the event was appended, false otherwise
+         */
+        static bool appendCall(const Game& game, int number);
+
+        /**
+         * @brief Appends a skipped turn
+         * @param game The game after the turn was skipped
+         * @return true if the event was appended, false otherwise
+         */
+        static bool appendSkip(const Game& game);
+
+        /**
+         * @brief Appends a forfeit by the player whose turn it was
+         * @param game The game after the forfeit
+         * @return true if the event was appended, false otherwise
+         */
+        static bool appendForfeit(const Game& game);
+
+        /**
+         * @brief Writes a checkpoint of the game's current state
+         * @param game The game to checkpoint
+         * @return true if the checkpoint was written, false otherwise
+         */
+        static bool checkpoint(const Game& game);
+
+        /**
+         * @brief Checks whether a log exists for a game
+         * @param db Database the game is bound to
+         * @param gameId ID of the game
+         * @return true if a log exists, false otherwise
+         */
+        static bool exists(const DB& db, const string& gameId);
+
+        /**
+         * @brief Rebuilds a game from its checkpoint and log
+         * @param gameId ID of the game
+         * @param game Output game; its players are looked up in the database it is bound to
+         * @return true if the game was rebuilt, false if the log is missing or invalid
+         */
+        static bool rebuild(const string& gameId, Game& game);
+
+        /**
+         * @brief Reads the full event history of a game
+         * @param db Database the game is bound to
+         * @param gameId ID of the game
+         * @param history Output history
+         * @return true if the log was read, false if it is missing or invalid
+         */
+        static bool readHistory(const DB& db, const string& gameId, GameHistory& history);
+
+        /**
+         * @brief Deletes the log and checkpoint of a game
+         * @param db Database the game is bound to
+         * @param gameId ID of the game
+         */
+        static void remove(const DB& db, const string& gameId);
+
+    private:
+        /// Directory under the database root holding the per-game logs
+        static const string LOGDIR;
+
+        /**
+         * @brief Gets the log path of a game
+         * @param db Database the game is bound to
+         * @param gameId ID of the game
+         * @return Path of the log file
+         */
+        static string logPath(const DB& db, const string& gameId);
+
+        /**
+         * @brief Gets the checkpoint path of a game
+         * @param db Database the game is bound to
+         * @param gameId ID of the game
+         * @return Path of the checkpoint file
+         */
+        static string checkpointPath(const DB& db, const string& gameId);
+
+        /**
+         * @brief Appends one event line to a game's log
+         * @param game The game
+         * @param event JSON event without the trailing newline
+         * @return true if the line was written, false otherwise
+         */
+        static bool append(const Game& game, const string& event);
+
+        /**
+         * @brief Parses the start event of a log
+         * @param event First line of the log
+         * @param history Output seed, start time and players
+         * @return true if the line is a valid start event, false otherwise
+         */
+        static bool parseStart(const string& event, GameHistory& history);
+
+        /**
+         * @brief Converts an event line to its history code
+         * @param event JSON event line
+         * @param code Output: called number, SKIP or FORFEIT
+         * @return true if the event was understood, false otherwise
+         */
+        static bool eventCode(const string& event, int& code);
+
+        /**
+         * @brief Applies one event line to a game being rebuilt
+         * @param game The game
+         * @param event JSON event line
+         * @return true if the event was understood, false otherwise
+         */
+        static bool apply(Game& game, const string& event);
+
+        /**
+         * @brief Reads a numeric field from a JSON line
+         * @param line JSON line
+         * @param field Field name
+         * @param value Output value
+         * @return true if the field was found, false otherwise
+         */
+        static bool readNumber(const string& line, const string& field, long long& value);
+};
+
+#endif // GAMELOG_H
\ No newline at end of file
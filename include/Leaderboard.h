@@ -7,33 +7,129 @@
 #define LEADERBOARD_H
 
 #include "Player.h"
+#include "RankIndex.h"
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 using namespace std;
 
+class DB;
+
 /**
  * @class Leaderboard
  * @brief Class responsible for displaying and managing player rankings
  * 
  * The Leaderboard class maintains a collection of player records and provides
- * functionality to display them in a sorted order based on win rates.
+ * functionality to display them one page at a time, sorted by win rate,
+ * wins, games played or rating. The win-rate order comes from the
+ * database's RankIndex; the other orders select just the requested page
+ * from a compact statistics array cached per player shard part and
+ * ratings version, so a commit only rereads the parts it replaced. Leaderboards of the last day, week or season rank the players
+ * by their games in that period, summed from WindowedStats.
  */
 class Leaderboard {
     public:
+        /**
+         * @brief Creates a leaderboard of the players in a database
+         * @param db Database holding the player records
+         */
+        explicit Leaderboard(DB& db) : db(db) {}
+
         /**
          * @brief Vector containing player records to be displayed
          */
         vector<Player> records;
 
+        /**
+         * @brief Orders a leaderboard can be sorted by, best first
+         * 
+         * Ties are broken by the other statistics and finally by username,
+         * so every order is total and pages never overlap.
+         */
+        enum class SortKey {
+            WIN_RATE,   ///< Win rate, then wins
+            WINS,       ///< Wins, then win rate
+            GAMES,      ///< Games played, then wins
+            RATING      ///< Rating minus twice its deviation, then games played
+        };
+
+        /**
+         * @brief Games a leaderboard counts
+         */
+        enum class Period {
+            ALL_TIME,   ///< Every game
+            DAY,        ///< Games of the last 24 hours
+            WEEK,       ///< Games of the last 7 days
+            SEASON      ///< Games of the last 13 weeks
+        };
+
+        /// Number of players on one page
+        static const size_t PAGE_SIZE = 10;
+
+        /**
+         * @brief Gets one page of the ranking
+         * @param k Maximum number of players returned
+         * @param offset Number of better players to skip
+         * @param key Order of the ranking
+         * @param period Games the statistics count; only players with a game in it are ranked
+         * @return Players ranked offset + 1 to offset + k
+         */
+        vector<RankEntry> top(size_t k, size_t offset = 0, SortKey key = SortKey::WIN_RATE,
+                              Period period = Period::ALL_TIME) const;
+
+        /**
+         * @brief Gets the number of ranked players
+         * @param period Games the statistics count
+         */
+        size_t size(Period period = Period::ALL_TIME) const;
+
         /**
          * @brief Displays the leaderboard with player rankings and statistics
          * 
-         * This method shows a formatted table of players sorted by win rate,
+         * This method shows a formatted table of the best players by win rate,
          * including their rank, name, games played, wins, and win rate.
          * If no records are found, it displays an appropriate message.
          */
         void displayLeaderboard() const;
+
+        /**
+         * @brief Displays one page of the leaderboard
+         * @param offset Number of better players to skip
+         * @param count Maximum number of rows
+         * @param key Order of the ranking
+         * @param period Games the statistics count
+         * @return Total number of ranked players
+         */
+        size_t displayPage(size_t offset, size_t count, SortKey key, Period period = Period::ALL_TIME) const;
+
+        /**
+         * @brief Builds the player snapshot, its ranking, the ratings and the windowed counters ahead of the next display
+         * 
+         * Safe to call from a background thread; later commits only move the
+         * players they change.
+         */
+        void prepare() const;
+
+    private:
+        DB& db;     ///< Database holding the player records
+
+        mutable mutex statsMutex;                               ///< Guards the cached statistics
+        mutable vector<shared_ptr<const PlayerPart>> statsParts; ///< Player parts the statistics were read from
+        mutable vector<vector<RankEntry>> partStats;            ///< Statistics of each of those parts
+        mutable shared_ptr<const vector<RankEntry>> stats;      ///< Statistics of every player of those parts
+        mutable uint64_t statsRatings = 0;                      ///< Ratings version the statistics were read with
+
+        /**
+         * @brief Gets the statistics of the current player snapshot, reading them only if not cached
+         */
+        shared_ptr<const vector<RankEntry>> statistics() const;
+
+        /**
+         * @brief Gets the statistics of the players who played in a period other than ALL_TIME
+         */
+        vector<RankEntry> statistics(Period period) const;
 };
 
 #endif
\ No newline at end of file
@@ -19,8 +19,9 @@ using namespace std;
  * @brief A thread-safe singleton logger class for application-wide logging
  * 
  * This class provides logging functionality with different severity levels,
- * timestamp-based logging, and thread-safe operations. It follows the singleton
- * pattern to ensure a single logging instance across the application.
+ * timestamp-based logging, and thread-safe operations. getInstance() returns
+ * the application-wide logger writing under ../Log; other instances can be
+ * created with their own log directory, e.g. for isolated test runs.
  */
 class Logger {
     public:
@@ -41,6 +42,12 @@ class Logger {
             return instance;
         }
 
+        /**
+         * @brief Creates a logger writing under a directory
+         * @param root Log directory, created by init() if missing
+         */
+        explicit Logger(const string& root = "../Log") : logRoot(root), currentLevel(Level::INFO) {}
+
         /**
          * @brief Initializes the logger with a specified file
          * @param filename Name of the log file
@@ -89,11 +96,6 @@ class Logger {
         }
 
     private:
-        /**
-         * @brief Private constructor for singleton pattern
-         */
-        Logger() : currentLevel(Level::INFO) {}
-        
         // Delete copy constructor and assignment operator
         Logger(const Logger&) = delete;
         Logger& operator=(const Logger&) = delete;
@@ -111,6 +113,7 @@ class Logger {
          */
         string levelToString(Level level) const;
 
+        string logRoot;        ///< Directory holding the log file
         ofstream logFile;      ///< Output file stream for logging
         mutex mtx;            ///< Mutex for thread-safe logging
         Level currentLevel;   ///< Current minimum logging level
@@ -0,0 +1,322 @@
+/**
+ * @file LsmEngine.h
+ * @brief Header file for the log-structured merge-tree storage engine
+ */
+
+#ifndef LSMENGINE_H
+#define LSMENGINE_H
+
+#include "StorageEngine.h"
+#include "SkipList.h"
+#include "SSTable.h"
+#include "FileLock.h"
+#include "Logger.h"
+#include "WriteAheadLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class LsmEngine
+ * @brief Storage engine keeping records in a log-structured merge tree
+ *
+ * Writes go to a redo log and a skip-list memtable. A full memtable is
+ * frozen and written by a background thread as a level-0 table; level-0
+ * tables may overlap, deeper levels are sorted runs of non-overlapping
+ * tables, each level allowed ten times the bytes of the one above. The
+ * same thread merges level 0 into level 1 once it has
+ * L0_COMPACTION_TRIGGER tables, and a table of any level over its budget
+ * into the next one. Deletions are kept as tombstones until they reach the
+ * deepest level holding data.
+ *
+ * A lookup checks the memtables, then every level-0 table from newest to
+ * oldest, then at most one table per deeper level, skipping tables whose
+ * Bloom filter rules the key out. The live tables and the oldest log still
+ * needed are listed in MANIFEST, replaced atomically after every flush and
+ * compaction. The directory belongs to one process at a time.
+ *
+ * Concurrent apply() calls queue up; the first one in the queue appends
+ * the batches of everyone behind it as one write, syncs the log once for
+ * all of them as the durability level requires, and only then takes the
+ * state lock to install them in the memtable, so reads go on while the
+ * log is written and synced.
+ */
+class LsmEngine : public StorageEngine {
+    public:
+        /// Memtable size that triggers a flush
+        static constexpr size_t MEMTABLE_BYTES = 4 << 20;
+        /// Level-0 tables that trigger a compaction into level 1
+        static constexpr size_t L0_COMPACTION_TRIGGER = 4;
+        /// Level-0 tables at which writers wait for compaction to catch up
+        static constexpr size_t L0_STOP_WRITES = 12;
+        /// Byte budget of level 1; each deeper level has ten times more
+        static constexpr uint64_t LEVEL1_BYTES = 10ULL << 20;
+        /// Size at which compaction starts a new output table
+        static constexpr uint64_t TABLE_BYTES = 2ULL << 20;
+        /// Number of levels
+        static constexpr int LEVELS = 7;
+        /// Log bytes one writer appends for a group of batches at most
+        static constexpr size_t GROUP_BYTES = 1 << 20;
+        /// Longest time a BATCHED write stays unsynced
+        static constexpr chrono::milliseconds BATCH_INTERVAL{10};
+
+        /**
+         * @brief Creates an engine over a directory
+         * @param root Directory of the store
+         * @param logger Logger receiving the engine's messages
+         * @param shards Number of shards per table, the DB's unit of locking
+         */
+        LsmEngine(const string& root, Logger& logger, size_t shards);
+
+        /**
+         * @brief Stops the background thread; the memtable stays in the log
+         */
+        ~LsmEngine() override;
+
+        /**
+         * @brief Loads the manifest, replays the logs and starts the background thread
+         * @return false if the directory is used by another process or damaged
+         */
+        bool open() override;
+
+        string name() const override {
+            return "lsm";
+        }
+
+        size_t shardCount() const override {
+            return shards;
+        }
+
+        uint64_t generation(const string& table, size_t shard) override;
+        bool get(const string& table, const string& key, string& value) override;
+        vector<pair<string, string>> scan(const string& table) override;
+        vector<pair<string, string>> scanShard(const string& table, size_t shard) override;
+        bool apply(const WriteBatch& batch) override;
+
+        /**
+         * @brief Writes the memtable to a table and waits for due compactions
+         * @return false if the engine is not open
+         */
+        bool flush();
+
+        /**
+         * @brief Gets the number of tables on each level
+         * @return Text such as "L0 2, L1 5"
+         */
+        string describe() const;
+
+        /**
+         * @brief Sets how durable a batch is when apply() returns
+         * @param level New level; EVERY_COMMIT until set
+         */
+        void setDurability(WriteAheadLog::Durability level);
+
+    private:
+        using Memtable = SkipList<string, optional<string>>;
+
+        /**
+         * @struct Version
+         * @brief Immutable set of live tables; readers keep the one they started with
+         */
+        struct Version {
+            vector<vector<shared_ptr<SSTable>>> levels;     ///< Level 0 newest first, deeper levels by smallest key
+        };
+
+        /**
+         * @struct Writer
+         * @brief A thread waiting in apply() or flush() for its turn to write
+         */
+        struct Writer {
+            const WriteBatch* batch = nullptr;  ///< Batch to log, or null for flush()
+            string record;                      ///< Log record of the batch
+            bool done = false;                  ///< Set once another writer logged the batch
+            bool ok = false;                    ///< Whether the batch was logged and applied
+            condition_variable turn;            ///< Signals done or that the writer is first
+        };
+
+        /**
+         * @struct Compaction
+         * @brief Tables merged into the next level by one compaction
+         */
+        struct Compaction {
+            int level = 0;                              ///< Level of the inputs
+            vector<shared_ptr<SSTable>> inputs;         ///< Tables taken from the level
+            vector<shared_ptr<SSTable>> overlaps;       ///< Overlapping tables of the next level
+        };
+
+        const string DIR;               ///< Store directory
+        const string MANIFEST;          ///< Path of the manifest
+        Logger& logger;                 ///< Logger receiving the engine's messages
+        const size_t shards;            ///< Shards per table
+
+        FileLock dirLock;                               ///< Keeps other processes out of the directory
+        mutable shared_mutex stateMutex;                ///< Guards the fields below
+        condition_variable_any stateChanged;            ///< Signals flushes, compactions and new work
+        shared_ptr<Memtable> memtable;                  ///< Table receiving writes
+        size_t memtableBytes = 0;                       ///< Approximate size of the memtable
+        shared_ptr<const Memtable> immutable;           ///< Frozen memtable being flushed, or null
+        shared_ptr<const Version> version;              ///< Live tables
+        vector<string> compactPointers;                 ///< Largest key last compacted on each level
+        unordered_map<string, vector<uint64_t>> generations;   ///< Write count per table shard
+        uint64_t generationBase = 0;                    ///< Added to every generation, distinct for each open
+        int logFd = -1;                                 ///< Log of the memtable
+        uint64_t logNumber = 0;                         ///< File number of that log
+        uint64_t logBytes = 0;                          ///< Size of that log
+        uint64_t loggedGroups = 0;                      ///< Groups of batches appended to the logs
+        uint64_t syncedGroups = 0;                      ///< Groups covered by the last log sync
+        chrono::steady_clock::time_point lastSync;      ///< Time of the last log sync
+        uint64_t immutableLog = 0;                      ///< File number of the frozen memtable's log
+        atomic<uint64_t> nextFileNumber{1};             ///< Next table or log file number
+        bool opened = false;                            ///< Whether open() succeeded
+        bool stopping = false;                          ///< Set when the engine shuts down
+        bool idle = true;                               ///< Whether the background thread has nothing to do
+        thread worker;                                  ///< Background flush and compaction thread
+        atomic<WriteAheadLog::Durability> durability{WriteAheadLog::Durability::EVERY_COMMIT};
+
+        mutex writersMutex;                             ///< Guards the queue below
+        deque<Writer*> writers;                         ///< Writers in arrival order; the first one writes
+
+        /**
+         * @brief Gets the key of a record within the tree
+         * @return Table name, a NUL byte and the record key
+         */
+        static string internalKey(const string& table, const string& key) {
+            return table + '\0' + key;
+        }
+
+        /**
+         * @brief Gets the path of a table file
+         */
+        string tablePath(uint64_t number) const {
+            return DIR + "/" + to_string(number) + ".sst";
+        }
+
+        /**
+         * @brief Gets the path of a log file
+         */
+        string logPath(uint64_t number) const {
+            return DIR + "/" + to_string(number) + ".log";
+        }
+
+        /**
+         * @brief Reads the live records of a table whose keys pass a filter
+         * @param table Table name
+         * @param keep Filter on the record key
+         * @return Pairs of key and record JSON, in key order
+         */
+        vector<pair<string, string>> scanWhere(const string& table, const function<bool(const string&)>& keep);
+
+        /**
+         * @brief Waits until a writer is first in the queue or done
+         * @param self Writer, added to the queue
+         * @param queue Held lock on the queue
+         */
+        void awaitTurn(Writer& self, unique_lock<mutex>& queue);
+
+        /**
+         * @brief Removes the first writers from the queue and wakes the next one
+         * @param count Number of writers to remove
+         * @param queue Held lock on the queue
+         */
+        void endTurn(size_t count, unique_lock<mutex>& queue);
+
+        /**
+         * @brief Logs a group of batches and installs them in the memtable
+         * @param group Writers whose batches to write, in queue order
+         * @return true if every batch was logged and applied
+         *
+         * Only called by the first writer in the queue.
+         */
+        bool writeGroup(const vector<Writer*>& group);
+
+        /**
+         * @brief Syncs BATCHED writes that are still unsynced
+         * @param lock Held exclusive lock on the state, released during the sync
+         */
+        void syncBatched(unique_lock<shared_mutex>& lock);
+
+        /**
+         * @brief Starts a new log file for the memtable
+         * @return false if the file cannot be created
+         */
+        bool openLog();
+
+        /**
+         * @brief Replays a log file into a memtable
+         * @param path Log file
+         * @param target Memtable to fill
+         * @return Number of batches replayed; replay stops at a torn record
+         */
+        size_t replayLog(const string& path, Memtable& target);
+
+        /**
+         * @brief Replaces the manifest
+         * @param next Tables to list
+         * @return false if the manifest could not be written
+         */
+        bool writeManifest(const Version& next);
+
+        /**
+         * @brief Writes a memtable as a table file
+         * @param source Memtable
+         * @return The new table, or null on error
+         */
+        shared_ptr<SSTable> writeTable(const Memtable& source);
+
+        /**
+         * @brief Waits until the memtable has room and level 0 is not overfull
+         * @param lock Held exclusive lock on the state
+         * @return false if the engine is shutting down or a new log cannot be created
+         */
+        bool makeRoomForWrite(unique_lock<shared_mutex>& lock);
+
+        /**
+         * @brief Freezes the memtable and switches to a new log
+         * @return false if the new log cannot be created
+         */
+        bool freezeMemtable();
+
+        /**
+         * @brief Runs flushes and compactions until the engine stops
+         */
+        void backgroundLoop();
+
+        /**
+         * @brief Picks the next compaction, if any level is over its budget
+         * @return The compaction, or nothing
+         */
+        optional<Compaction> pickCompaction();
+
+        /**
+         * @brief Merges the tables of a compaction into new tables
+         * @param job Tables to merge
+         * @param dropDeletes Whether tombstones can be dropped
+         * @param ok Set to false on a write error
+         * @return New tables of the next level, in key order
+         */
+        vector<shared_ptr<SSTable>> runCompaction(const Compaction& job, bool dropDeletes, bool& ok);
+
+        /**
+         * @brief Gets the byte budget of a level
+         */
+        static uint64_t maxBytes(int level);
+
+        /**
+         * @brief Gets the bytes of a list of tables
+         */
+        static uint64_t totalBytes(const vector<shared_ptr<SSTable>>& tables);
+};
+
+#endif // LSMENGINE_H
\ No newline at end of file
@@ -0,0 +1,136 @@
+/**
+ * @file MPMCQueue.h
+ * @brief Header file for a bounded lock-free multi-producer multi-consumer queue
+ */
+
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @class MPMCQueue
+ * @brief Bounded lock-free queue based on per-cell sequence numbers
+ * @tparam T Element type, must be default constructible and movable
+ *
+ * Each cell carries a sequence number that tells producers and consumers
+ * whether the cell is free or holds data for their lap around the ring.
+ * Producers and consumers claim positions with a single compare-and-swap
+ * on separate cache lines, so no lock is ever taken.
+ */
+template<typename T>
+class MPMCQueue {
+    public:
+        /**
+         * @brief Constructs a queue
+         * @param capacity Maximum number of elements, must be a power of two and at least 2
+         * @throw invalid_argument if the capacity is not a power of two
+         */
+        explicit MPMCQueue(size_t capacity)
+            : buffer(new Cell[capacity]), mask(capacity - 1) {
+            if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+                throw invalid_argument("MPMCQueue capacity must be a power of two");
+            }
+            for (size_t i = 0; i < capacity; ++i) {
+                buffer[i].sequence.store(i, memory_order_relaxed);
+            }
+            enqueuePos.store(0, memory_order_relaxed);
+            dequeuePos.store(0, memory_order_relaxed);
+        }
+
+        // Delete copy constructor and assignment operator
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        /**
+         * @brief Pushes an element
+         * @param value The element to push; left untouched if the queue is full
+         * @return true if pushed, false if the queue is full
+         */
+        bool push(T&& value) {
+            size_t pos = enqueuePos.load(memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = &buffer[pos & mask];
+                size_t seq = cell->sequence.load(memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos.load(memory_order_relaxed);
+                }
+            }
+            cell->data = move(value);
+            cell->sequence.store(pos + 1, memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Pops an element
+         * @param value Output element
+         * @return true if an element was popped, false if the queue is empty
+         */
+        bool pop(T& value) {
+            size_t pos = dequeuePos.load(memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = &buffer[pos & mask];
+                size_t seq = cell->sequence.load(memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos.load(memory_order_relaxed);
+                }
+            }
+            value = move(cell->data);
+            cell->sequence.store(pos + mask + 1, memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Gets an approximate element count
+         * @return Number of elements at some recent instant
+         */
+        size_t sizeApprox() const {
+            size_t head = dequeuePos.load(memory_order_relaxed);
+            size_t tail = enqueuePos.load(memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        /**
+         * @brief Gets the queue capacity
+         * @return Maximum number of elements
+         */
+        size_t capacity() const {
+            return mask + 1;
+        }
+
+    private:
+        /**
+         * @struct Cell
+         * @brief One slot of the ring buffer
+         */
+        struct Cell {
+            atomic<size_t> sequence;  ///< Lap-tagged state of the slot
+            T data;                   ///< Stored element
+        };
+
+        unique_ptr<Cell[]> buffer;                 ///< Ring buffer of cells
+        const size_t mask;                         ///< capacity - 1, for index wrapping
+        alignas(64) atomic<size_t> enqueuePos;     ///< Next position to push
+        alignas(64) atomic<size_t> dequeuePos;     ///< Next position to pop
+};
+
+#endif // MPMCQUEUE_H
\ No newline at end of file
@@ -0,0 +1,153 @@
+/**
+ * @file MatchHistory.h
+ * @brief Header file for the columnar archive of finished games used for statistics
+ */
+
+#ifndef MATCHHISTORY_H
+#define MATCHHISTORY_H
+
+#include "GameLog.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class DB;
+
+/**
+ * @struct HeadToHead
+ * @brief Results of the games two players played together
+ */
+struct HeadToHead {
+    size_t games = 0;   ///< Finished games both players took part in
+    size_t winsA = 0;   ///< Games won by the first player
+    size_t winsB = 0;   ///< Games won by the second player
+};
+
+/**
+ * @struct MatchWindow
+ * @brief Results of the consecutive games of one segment or of the tail
+ */
+struct MatchWindow {
+    uint64_t number = 0;            ///< Number of the segment or tail
+    size_t rows = 0;                ///< Games in the window
+    vector<string> names;           ///< Player names, indexed by the players column
+    vector<uint64_t> finished;      ///< Per game: end time in seconds since the epoch, 0 if unknown
+    vector<uint64_t> playerCounts;  ///< Per game: number of players
+    vector<uint64_t> players;       ///< Players of every game in turn order, as name indices
+    vector<uint64_t> winners;       ///< Per game: winner position + 1, 0 for none
+};
+
+/**
+ * @class MatchHistory
+ * @brief Append-only history of finished games, stored column by column
+ *
+ * Each database has its own history under <root>/History, see of().
+ * Finished games are appended as text rows to History/<n>.tail.
+ * Once it holds SEGMENT_ROWS games the tail is sealed into the columnar
+ * segment History/<n>.col and a new tail is started. A segment
+ * (integers little-endian) is laid out as:
+ *
+ *   header:    "BMH1", row count, column count, reserved (4 bytes each)
+ *   directory: per column its offset, length and CRC32C (24 bytes)
+ *   columns:   player names (the dictionary), start time, duration,
+ *              player count, players (dictionary indices, in turn order),
+ *              winner (player position + 1, 0 for none), turn count and
+ *              calls (1-25, 0 for a skip, 26 for a forfeit)
+ *
+ * Every column but the dictionary is frame-of-reference bit-packed: its
+ * minimum, then each value minus the minimum in as many bits as the
+ * largest one needs. A call takes 5 bits, a turn count at most 7. Queries
+ * read and unpack only the columns they use, into plain arrays that are
+ * then scanned in tight loops; segments without both players are skipped
+ * after reading the dictionary alone.
+ *
+ * replay() hands out the games one window at a time, a window being a
+ * segment or the tail, in the order they were archived.
+ *
+ * Sealing renames the segment into place before it removes the tail, and
+ * a tail whose segment exists is ignored, so a crash in between neither
+ * loses nor counts a game twice.
+ */
+class MatchHistory {
+    public:
+        static const size_t SEGMENT_ROWS = 1024;  ///< Games per sealed segment
+
+        /**
+         * @brief Gets the history of a database
+         * @param db The database
+         * @return History under the database's root, created on first use
+         */
+        static MatchHistory& of(DB& db);
+
+        /**
+         * @brief Creates a history stored in a directory
+         * @param directory Directory of the segments and the tail
+         */
+        explicit MatchHistory(const string& directory) : DIRECTORY(directory) {}
+
+        // Delete copy constructor and assignment operator
+        MatchHistory(const MatchHistory&) = delete;
+        MatchHistory& operator=(const MatchHistory&) = delete;
+
+        /**
+         * @brief Appends a finished game
+         * @param history Players, start time and events of the game
+         * @param winner Username of the winner, empty if nobody won
+         * @return true if the game was written, false otherwise
+         */
+        bool append(const GameHistory& history, const string& winner);
+
+        /**
+         * @brief Gets the record of two players against each other
+         * @param playerA Username of the first player
+         * @param playerB Username of the second player
+         * @return Games played together and the wins of each
+         */
+        HeadToHead headToHead(const string& playerA, const string& playerB);
+
+        /**
+         * @brief Gets the average number of turns of a finished game
+         * @return Average event count, 0 if no game was archived
+         */
+        double averageLength();
+
+        /**
+         * @brief Counts how often each number was called
+         * @return Calls of each number 1-25 at its index; index 0 counts skipped turns
+         */
+        array<uint64_t, 26> callFrequency();
+
+        /**
+         * @brief Gets the number of archived games
+         */
+        size_t count();
+
+        /**
+         * @brief Reads the results of every game from a segment on, in archive order
+         * @param first Number of the first segment or tail to read
+         * @param workers Number of segments decoded at once
+         * @param visit Called with each window in archive order, the tail last
+         */
+        void replay(uint64_t first, size_t workers, const function<void(const MatchWindow&)>& visit);
+
+        /**
+         * @brief Gets the directory of the segments and the tail
+         */
+        const string& getDirectory() const {
+            return DIRECTORY;
+        }
+
+    private:
+        /// Directory of the segments and the tail
+        const string DIRECTORY;
+        /// Serialises appends and queries within the process
+        mutex historyMutex;
+};
+
+#endif // MATCHHISTORY_H
\ No newline at end of file
@@ -0,0 +1,162 @@
+/**
+ * @file Matchmaker.h
+ * @brief Header file for the Matchmaker class that pairs queued players into rooms
+ */
+
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+#include "Player.h"
+#include "RoomManager.h"
+#include "MPMCQueue.h"
+#include "Metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct MatchTicket
+ * @brief A queued request from an authenticated player to be matched
+ */
+struct MatchTicket {
+    Player player;                                    ///< The waiting player
+    chrono::steady_clock::time_point enqueuedAt;      ///< When the player joined the queue
+};
+
+/**
+ * @class Matchmaker
+ * @brief Pairs authenticated players and opens rooms for them
+ *
+ * Players enter a lock-free intake queue. Pairing workers move each ticket
+ * into the queue for its win-rate band and pair it with whoever is already
+ * waiting there, then create the room through the RoomManager. With banding
+ * disabled every player shares a single band.
+ */
+class Matchmaker {
+    public:
+        static const int BAND_COUNT = 5;  ///< Win-rate bands of 20 percentage points each
+
+        /// Callback invoked after a room is created for a matched pair
+        using MatchCallback = function<void(const string& roomId, const Player& p1, const Player& p2)>;
+
+        /**
+         * @brief Constructs a matchmaker
+         * @param rooms Room manager used to open rooms for matched pairs
+         * @param workerCount Number of pairing threads (0 uses the hardware concurrency)
+         * @param useBands If true, only players in the same win-rate band are paired
+         * @param capacity Capacity of each queue, must be a power of two
+         */
+        Matchmaker(RoomManager& rooms, size_t workerCount = 0, bool useBands = true, size_t capacity = 4096);
+
+        /**
+         * @brief Destructor, stops the pairing workers
+         */
+        ~Matchmaker();
+
+        // Delete copy constructor and assignment operator
+        Matchmaker(const Matchmaker&) = delete;
+        Matchmaker& operator=(const Matchmaker&) = delete;
+
+        /**
+         * @brief Starts the pairing workers
+         */
+        void start();
+
+        /**
+         * @brief Stops the pairing workers; unmatched tickets stay queued
+         */
+        void stop();
+
+        /**
+         * @brief Adds a player to the matchmaking queue
+         * @param player The authenticated player
+         * @return true if queued, false if the queue is full
+         */
+        bool enqueue(const Player& player);
+
+        /**
+         * @brief Sets the callback invoked for every match
+         * @param callback Function receiving the room ID and both players
+         *
+         * Must be called before start().
+         */
+        void setMatchCallback(MatchCallback callback);
+
+        /**
+         * @brief Gets the number of players waiting to be matched
+         * @return Queue depth
+         */
+        int64_t queueDepth() const;
+
+        /**
+         * @brief Gets the number of rooms created so far
+         * @return Match count
+         */
+        uint64_t matchCount() const;
+
+        /**
+         * @brief Gets the histogram of time spent in the queue by matched players
+         * @return Constant reference to the wait-time histogram
+         */
+        const LatencyHistogram& waitTimes() const;
+
+        /**
+         * @brief Maps a win rate to a band index
+         * @param winRate Win rate percentage (0-100)
+         * @return Band index from 0 to BAND_COUNT - 1
+         */
+        static int bandOf(double winRate);
+
+    private:
+        RoomManager& rooms;                                     ///< Where matched rooms are created
+        const size_t workerCount;                               ///< Number of pairing threads
+        const bool useBands;                                    ///< Whether to pair within win-rate bands
+        MPMCQueue<unique_ptr<MatchTicket>> intake;              ///< Newly enqueued tickets
+        vector<unique_ptr<MPMCQueue<unique_ptr<MatchTicket>>>> bands;  ///< Tickets waiting for a partner, per band
+        vector<thread> workers;                                 ///< Pairing threads
+        atomic<bool> running{false};                            ///< Worker run flag
+        atomic<int64_t> depth{0};                               ///< Players enqueued but not yet matched
+        atomic<uint64_t> matches{0};                            ///< Rooms created
+        LatencyHistogram waitHistogram;                         ///< Queue wait time of matched players
+        MatchCallback onMatch;                                  ///< Optional match callback
+
+        /**
+         * @brief Main loop of a pairing worker
+         */
+        void workerLoop();
+
+        /**
+         * @brief Moves one ticket from intake into its band, pairing it if possible
+         * @return true if a ticket was processed
+         */
+        bool drainIntake();
+
+        /**
+         * @brief Pairs tickets that were parked in the same band by different workers
+         * @return true if any pair was made
+         */
+        bool sweepBands();
+
+        /**
+         * @brief Parks a ticket in a band queue, retrying while the queue is full
+         * @param band Band index
+         * @param ticket The ticket to park
+         */
+        void park(int band, unique_ptr<MatchTicket> ticket);
+
+        /**
+         * @brief Opens a room for two tickets and records metrics
+         * @param first Ticket that waited longer
+         * @param second Ticket that arrived later
+         */
+        void pair(const MatchTicket& first, const MatchTicket& second);
+};
+
+#endif // MATCHMAKER_H
\ No newline at end of file
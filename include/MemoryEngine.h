@@ -0,0 +1,58 @@
+/**
+ * @file MemoryEngine.h
+ * @brief Header file for the storage engine that keeps every record in memory
+ */
+
+#ifndef MEMORYENGINE_H
+#define MEMORYENGINE_H
+
+#include "StorageEngine.h"
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class MemoryEngine
+ * @brief Storage engine holding every table in hash maps
+ *
+ * Nothing touches the filesystem and nothing survives the process, so game
+ * and leaderboard logic can be measured without disk noise. Readers share a
+ * lock; a batch is applied under the exclusive lock, so it is seen whole.
+ */
+class MemoryEngine : public StorageEngine {
+    public:
+        /**
+         * @brief Creates an empty engine
+         * @param shards Number of shards per table, the DB's unit of locking
+         */
+        explicit MemoryEngine(size_t shards);
+
+        bool open() override {
+            return true;
+        }
+
+        string name() const override {
+            return "memory";
+        }
+
+        size_t shardCount() const override {
+            return shards;
+        }
+
+        uint64_t generation(const string& table, size_t shard) override;
+        bool get(const string& table, const string& key, string& value) override;
+        vector<pair<string, string>> scan(const string& table) override;
+        bool apply(const WriteBatch& batch) override;
+
+    private:
+        const size_t shards;                                                ///< Shards per table
+        shared_mutex tableMutex;                                            ///< Guards tables and generations
+        unordered_map<string, unordered_map<string, string>> tables;       ///< Record JSON by table and key
+        unordered_map<string, vector<uint64_t>> generations;               ///< Write count per table shard
+};
+
+#endif // MEMORYENGINE_H
\ No newline at end of file
@@ -10,9 +10,12 @@
 #include "Leaderboard.h"
 // #include "Game.h"
 
+#include <future>
 #include <vector>
 using namespace std;
 
+class DB;
+
 /**
  * @class Menu
  * @brief Manages the game's main menu and user interface
@@ -23,24 +26,50 @@ using namespace std;
  */
 class Menu {
 private:
+    DB& db;                   ///< Database games and players are loaded from and saved to
     bool isRunning;           ///< Flag to control the main menu loop
     vector<Player> players;   ///< Collection of players
     Leaderboard leaderboard; ///< Leaderboard instance for displaying rankings
 //     Game game;
+    future<void> playersWarm; ///< Background load of the player snapshot, leaderboard order, ratings and windowed counters
+    future<void> gamesWarm;   ///< Background load of the game snapshot
 
     /**
      * @brief Displays the current system time
      */
     void displayCurrentTime();
 
+    /**
+     * @brief Waits for a warm-up task if it has not been joined yet
+     * @param task Task started by warmUp()
+     */
+    void join(future<void>& task);
+
 public:
     /**
      * @brief Constructor for Menu class
      * 
-     * Initializes the menu with isRunning set to true.
+     * Initializes the menu with isRunning set to true, using the default
+     * database.
      */
     Menu();
 
+    /**
+     * @brief Constructor for Menu class
+     * @param db Database games and players are loaded from and saved to
+     */
+    explicit Menu(DB& db);
+
+    /**
+     * @brief Starts loading what the menu needs on background threads
+     * 
+     * Called before the players sign in, so the player and game
+     * snapshots are parsed and the players ranked while credentials
+     * are typed. Menu actions wait for the task they need instead of
+     * loading it themselves.
+     */
+    void warmUp();
+
     /**
      * @brief Displays the game rules to the player
      */
@@ -70,6 +99,11 @@ public:
      */
     void handleViewLeaderboard();
 
+    /**
+     * @brief Handles browsing archived replays turn by turn
+     */
+    void handleWatchReplay();
+
     /**
      * @brief Handles program exit
      * 
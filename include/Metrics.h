@@ -0,0 +1,78 @@
+/**
+ * @file Metrics.h
+ * @brief Header file for lightweight lock-free metrics used by the hosted services
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/**
+ * @class LatencyHistogram
+ * @brief Thread-safe histogram of durations with power-of-two microsecond buckets
+ *
+ * Bucket 0 counts samples below 1us and bucket i counts samples in
+ * [2^(i-1), 2^i) microseconds. Recording is a single relaxed atomic
+ * increment, so it can be called from any number of threads.
+ */
+class LatencyHistogram {
+    public:
+        static const int BUCKETS = 40;  ///< Number of buckets (last bucket is open-ended)
+
+        /**
+         * @brief Records one duration sample
+         * @param duration The duration to record
+         */
+        void record(chrono::nanoseconds duration);
+
+        /**
+         * @brief Gets the total number of samples
+         * @return Sample count
+         */
+        uint64_t count() const;
+
+        /**
+         * @brief Gets the number of samples in one bucket
+         * @param index Bucket index (0 to BUCKETS - 1)
+         * @return Sample count in the bucket
+         */
+        uint64_t bucket(int index) const;
+
+        /**
+         * @brief Gets the mean of all samples
+         * @return Mean duration in microseconds
+         */
+        double meanMicros() const;
+
+        /**
+         * @brief Estimates a percentile from the buckets
+         * @param p Percentile in the range 0-100
+         * @return Upper bound of the bucket containing the percentile, in microseconds
+         */
+        uint64_t percentileMicros(double p) const;
+
+        /**
+         * @brief Formats count, mean, p50 and p99 as one line
+         * @return Summary string suitable for logging
+         */
+        string summary() const;
+
+        /**
+         * @brief Clears all buckets
+         */
+        void reset();
+
+    private:
+        array<atomic<uint64_t>, BUCKETS> buckets{};  ///< Per-bucket sample counts
+        atomic<uint64_t> total{0};                   ///< Total sample count
+        atomic<uint64_t> sumMicros{0};               ///< Sum of all samples in microseconds
+};
+
+#endif // METRICS_H
\ No newline at end of file
@@ -0,0 +1,111 @@
+/**
+ * @file Migration.h
+ * @brief Header file for the Migration class that converts stored records to the current schema
+ */
+
+#ifndef MIGRATION_H
+#define MIGRATION_H
+
+#include "DB.h"
+#include "Logger.h"
+
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class Migration
+ * @brief Streams every stored record through the versioned converters of its table
+ *
+ * The schema version of a data directory is kept in Schema.json; a
+ * directory without one is at version 1. run() walks each table one shard
+ * at a time on a few worker threads: a shard is locked, read, every record
+ * passed through the converters between the stored and the current
+ * version, and the changed records committed as one transaction. Memory is
+ * therefore bounded by the size of the shards in flight, not of the store.
+ *
+ * Finished shards are listed in Migration.json as they commit, so an
+ * interrupted run resumes with the shards still pending. Converters must
+ * leave a record that is already in the new format unchanged, since a
+ * shard interrupted before its commit is converted again. Schema.json is
+ * only updated, and Migration.json removed, once every shard is done.
+ */
+class Migration {
+    public:
+        /// Schema version written by this build
+        static constexpr int CURRENT_VERSION = 2;
+
+        /**
+         * @struct Converter
+         * @brief Conversion of one table's records from one version to the next
+         */
+        struct Converter {
+            string table;                                   ///< "Account" or "Game"
+            int from;                                       ///< Version of the records it reads
+            string description;                             ///< What it changes, for the log
+            function<string(const string&)> convert;        ///< Old record JSON to new record JSON
+        };
+
+        /**
+         * @brief Gets every converter, in version order
+         */
+        static const vector<Converter>& converters();
+
+        /**
+         * @brief Creates a migration of a database
+         * @param db Database whose records are converted; init() must have been called
+         * @param logger Logger receiving the migration's messages
+         */
+        explicit Migration(DB& db, Logger& logger = Logger::getInstance());
+
+        /**
+         * @brief Gets the schema version of the stored records
+         * @return Version from Schema.json, 1 if there is none
+         */
+        int storedVersion() const;
+
+        /**
+         * @brief Converts every stored record to the current schema
+         * @param workers Number of shards converted at once
+         * @return true if the store is at the current version afterwards
+         */
+        bool run(size_t workers = 4);
+
+    private:
+        DB& db;                     ///< Database being migrated
+        Logger& logger;             ///< Logger receiving the migration's messages
+        const string SCHEMA;        ///< Path of Schema.json
+        const string PROGRESS;      ///< Path of Migration.json
+
+        mutex progressMutex;        ///< Serialises updates of the progress file
+        set<string> done;           ///< Shards already converted, as "<table>.<shard>"
+
+        /**
+         * @brief Reads the shards finished by an earlier run of the same migration
+         * @param from Stored version
+         */
+        void loadProgress(int from);
+
+        /**
+         * @brief Records a finished shard in the progress file
+         * @param from Stored version
+         * @param shard Shard name, "<table>.<shard>"
+         * @return false if the progress file could not be written
+         */
+        bool markDone(int from, const string& shard);
+
+        /**
+         * @brief Converts the records of one shard
+         * @param table "Account" or "Game"
+         * @param shard Shard index
+         * @param steps Converters to apply, in order
+         * @return false if a record could not be converted or the commit failed
+         */
+        bool migrateShard(const string& table, size_t shard, const vector<const Converter*>& steps);
+};
+
+#endif // MIGRATION_H
\ No newline at end of file
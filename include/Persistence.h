@@ -0,0 +1,238 @@
+/**
+ * @file Persistence.h
+ * @brief Header file for the Persistence class that writes saves on a background thread
+ */
+
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include "Player.h"
+#include "DB.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class Game;
+
+/**
+ * @class Persistence
+ * @brief Singleton service that coalesces game and player saves and writes them asynchronously
+ *
+ * Pending writes are keyed by game ID and username, so saving the same game
+ * twice before the worker runs only writes the latest state. The worker
+ * takes every pending write at once and applies them with one rewrite of
+ * each game and account shard they touch. The number of pending keys is bounded;
+ * callers block when it is full. Before start() is called, or after stop(),
+ * writes are applied synchronously.
+ *
+ * A batch whose commit fails is put back under any newer pending writes and
+ * retried after a growing pause. After MAX_ATTEMPTS failures in a row it is
+ * given up: its follow-up actions are not run, its completion callbacks
+ * are told it failed, lost() counts it, and flush() reports it.
+ *
+ * Interactive callers pass a completion callback instead of waiting;
+ * flush() is meant for shutdown and for barriers before offline work.
+ *
+ * getInstance() writes to the default database. of() returns the service
+ * of any other DB instance; those apply writes synchronously unless
+ * started.
+ */
+class Persistence {
+    public:
+        /// Maximum number of distinct pending keys
+        static constexpr size_t CAPACITY = 1024;
+        /// Attempts to write a batch before it is given up
+        static constexpr int MAX_ATTEMPTS = 5;
+        /// Pause before the first retry, doubled for each further one
+        static constexpr int RETRY_MILLIS = 50;
+
+        /**
+         * @brief Gets the singleton instance of the Persistence service
+         * @return Reference to the singleton instance
+         */
+        static Persistence& getInstance() {
+            static Persistence instance(DB::getInstance());
+            return instance;
+        }
+
+        /**
+         * @brief Gets the service writing to a database
+         * @param db The database
+         * @return getInstance() for the default database, else a service created on first use
+         */
+        static Persistence& of(DB& db);
+
+        /**
+         * @brief Creates a service writing to a database
+         * @param db The database
+         */
+        explicit Persistence(DB& db) : db(db) {}
+
+        /**
+         * @brief Stops the worker
+         */
+        ~Persistence();
+
+        // Delete copy constructor and assignment operator
+        Persistence(const Persistence&) = delete;
+        Persistence& operator=(const Persistence&) = delete;
+
+        /**
+         * @brief Starts the background writer thread
+         */
+        void start();
+
+        /**
+         * @brief Writes everything pending and stops the writer thread
+         */
+        void stop();
+
+        /**
+         * @brief Queues the current state of a game
+         * @param game The game to save
+         * @param done Optional callback run on the writer thread with whether the state was written
+         */
+        void saveGame(const Game& game, function<void(bool)> done = nullptr);
+
+        /**
+         * @brief Queues removal of a game from the saved-game list
+         * @param gameId ID of the game
+         * @param after Optional action run on the writer thread once the removal is written
+         */
+        void removeGame(const string& gameId, function<void()> after = nullptr);
+
+        /**
+         * @brief Queues the result of a game together with its removal
+         * @param players Players of the game
+         * @param winner Username of the winner
+         * @param gameId ID of the finished game
+         * @param after Optional action run on the writer thread once the batch is written
+         * @param done Optional callback run on the writer thread with whether the result was written
+         *
+         * The result is applied as a win or a loss on top of each stored
+         * record, so games finishing concurrently for the same player never
+         * lose each other's statistics. Everything is queued under one lock,
+         * so it lands in the same batch and is committed in one transaction.
+         */
+        void finishGame(const vector<Player>& players, const string& winner, const string& gameId,
+                        function<void()> after = nullptr, function<void(bool)> done = nullptr);
+
+        /**
+         * @brief Blocks until every write queued before the call is on disk or given up
+         * @return false if a batch was given up while waiting
+         */
+        bool flush();
+
+        /**
+         * @brief Gets the number of pending keys
+         */
+        size_t pending();
+
+        /**
+         * @brief Gets the number of writes absorbed by a newer write of the same key
+         */
+        uint64_t coalesced() const;
+
+        /**
+         * @brief Gets the number of batches written
+         */
+        uint64_t batches() const;
+
+        /**
+         * @brief Gets the number of batches given up after repeated write failures
+         */
+        uint64_t lost() const;
+
+    private:
+        /**
+         * @struct GameWrite
+         * @brief Pending change to one game record
+         */
+        struct GameWrite {
+            string json;                    ///< Game state, unused when removing
+            bool remove = false;            ///< Whether the record is removed
+            vector<function<void()>> after; ///< Actions run after the write
+            vector<function<void(bool)>> done;  ///< Callbacks told whether the write landed
+        };
+
+        /**
+         * @struct PlayerWrite
+         * @brief Pending change to one player record
+         */
+        struct PlayerWrite {
+            int wins = 0;               ///< Wins to add to the stored record
+            int losses = 0;             ///< Losses to add to the stored record
+        };
+
+        /**
+         * @struct Batch
+         * @brief Pending writes taken by the worker in one go
+         */
+        struct Batch {
+            unordered_map<string, GameWrite> games;  ///< Game writes by game ID
+            unordered_map<string, PlayerWrite> players;  ///< Player writes by username
+        };
+
+        DB& db;                         ///< Database the writes go to
+        mutex queueMutex;               ///< Guards the pending batch and the counters below
+        condition_variable wake;        ///< Signals the worker
+        condition_variable progress;    ///< Signals space and completed batches
+        Batch pendingBatch;             ///< Writes not yet taken by the worker
+        uint64_t enqueued = 0;          ///< Number of writes queued
+        uint64_t written = 0;           ///< Number of queued writes on disk
+        bool running = false;           ///< Whether the worker accepts writes
+        thread worker;                  ///< Background writer
+        int failedAttempts = 0;         ///< Consecutive failed writes of the current batch
+        atomic<uint64_t> coalescedCount{0};
+        atomic<uint64_t> batchCount{0};
+        atomic<uint64_t> lostCount{0};
+
+        /**
+         * @brief Waits for room and queues a write
+         * @param key Pending key, used for the capacity bound
+         * @param apply Merges the write into the pending batch
+         */
+        void enqueue(const string& key, const function<void(Batch&)>& apply);
+
+        /**
+         * @brief Writer thread loop
+         */
+        void run();
+
+        /**
+         * @brief Applies a pending player write to the stored record
+         * @param stored Stored record, updated in place with its version bumped
+         * @param write Pending change
+         */
+        static void applyPlayer(Player& stored, const PlayerWrite& write);
+
+        /**
+         * @brief Writes a batch to the data files
+         * @param batch Writes to apply
+         * @return true if the batch was committed
+         */
+        bool write(Batch& batch);
+
+        /**
+         * @brief Tells the completion callbacks of a given-up batch that it failed
+         * @param batch Batch that was given up
+         */
+        static void giveUp(Batch& batch);
+
+        /**
+         * @brief Puts a failed batch back under the pending writes; the caller holds the queue lock
+         * @param failed Batch that could not be written
+         */
+        void requeue(Batch& failed);
+};
+
+#endif // PERSISTENCE_H
\ No newline at end of file
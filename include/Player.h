@@ -9,9 +9,13 @@
 #include "../include/Account.h"
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <memory>
 
 using namespace std;
 
+class DB;
+
 /**
  * @class Player
  * @brief Represents a player in the BINGO game, inheriting from Account
@@ -30,6 +34,7 @@ class Player : public Account {
         int winCount;                ///< Number of games won
         int loseCount;               ///< Number of games lost
         double winRate;              ///< Player's win rate percentage
+        uint64_t version;            ///< Version of the stored record, bumped on every write
         
     public:
         /**
@@ -64,12 +69,36 @@ class Player : public Account {
          */
         double getWinRate() const;
 
+        /**
+         * @brief Get the version of the stored record this player was read from
+         * @return Record version, 0 if never stored
+         */
+        uint64_t getVersion() const;
+
         /**
          * @brief Get the current board state as a JSON string
          * @return JSON string representing the board state
          */
         string getBoardState() const;
 
+        /**
+         * @brief Get the board numbers
+         * @return 5x5 board in row-major order
+         */
+        const vector<vector<int>>& getBoard() const;
+
+        /**
+         * @brief Get the marked cells as a bitmask
+         * @return 25-bit mask, bit (row * 5 + col) set when that cell is marked
+         */
+        uint32_t getMarkedMask() const;
+
+        /**
+         * @brief Get the completed lines as a bitmask
+         * @return 12-bit mask: bits 0-4 rows, 5-9 columns, 10 main diagonal, 11 anti-diagonal
+         */
+        uint16_t getLineMask() const;
+
         // SETTER METHODS
         /**
          * @brief Set the board and marked states
@@ -102,6 +131,12 @@ class Player : public Account {
          */
         void setWinRate(double rate);
 
+        /**
+         * @brief Set the record version
+         * @param version New version value
+         */
+        void setVersion(uint64_t version);
+
         // DATA PROCESSING METHODS
         /**
          * @brief Convert player data to JSON string
@@ -119,29 +154,44 @@ class Player : public Account {
         // OTHER METHODS
         /**
          * @brief Handle player authentication process
+         * @param db Database holding the accounts
          * @return Pointer to authenticated Player object or nullptr
          */
-        static Player* authenticator();
+        static Player* authenticator(DB& db);
 
         /**
          * @brief Create a new player in the database
          * @param p Player object to create
+         * @param db Database to create the player in
          * @return true if creation successful, false otherwise
          */
-        static bool create(const Player& p);
+        static bool create(const Player& p, DB& db);
 
         /**
          * @brief Check if player exists in database
          * @param p Player object to check
+         * @param db Database to search
          * @return true if player exists, false otherwise
          */
-        static bool check(const Player& p);
+        static bool check(const Player& p, DB& db);
 
         /**
          * @brief Generate a new random BINGO board
          */
         void generateBoard();
 
+        /**
+         * @brief Generate a BINGO board deterministically from a seed
+         * @param seed Seed; the same seed always yields the same board
+         */
+        void generateBoard(uint32_t seed);
+
+        /**
+         * @brief Replace the marked cells with a bitmask
+         * @param mask 25-bit mask, bit (row * 5 + col) set when that cell is marked
+         */
+        void setMarkedMask(uint32_t mask);
+
         /**
          * @brief Display the current board state
          */
@@ -167,4 +217,7 @@ class Player : public Account {
         void updateStats(bool won);
 };
 
+/// Player records of one shard in username order, shared with older snapshots
+using PlayerPart = vector<shared_ptr<const Player>>;
+
 #endif // PLAYER_H
\ No newline at end of file
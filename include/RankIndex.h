@@ -0,0 +1,136 @@
+/**
+ * @file RankIndex.h
+ * @brief Header file for the order-statistic index of players by win rate
+ */
+
+#ifndef RANKINDEX_H
+#define RANKINDEX_H
+
+#include "Player.h"
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct RankEntry
+ * @brief Statistics of one ranked player
+ */
+struct RankEntry {
+    string username;        ///< Player name
+    int games = 0;          ///< Games played
+    int wins = 0;           ///< Games won
+    double winRate = 0.0;   ///< Win rate in percent
+    double rating = 0.0;    ///< Glicko rating, filled in by the Leaderboard
+    double deviation = 0.0; ///< Deviation of the rating, filled in by the Leaderboard
+};
+
+/**
+ * @class RankIndex
+ * @brief Players ordered by win rate, with O(log n) updates, rank and position lookups
+ *
+ * An indexable skip list: every link also stores its width, the number of
+ * players it skips over on the bottom level, so walking down the levels
+ * counts positions as it goes. Players are ordered by win rate, then
+ * wins, both descending, then by username.
+ *
+ * All members are thread-safe; lookups share a lock and updates take it
+ * exclusively.
+ */
+class RankIndex {
+    public:
+        RankIndex();
+        ~RankIndex();
+
+        RankIndex(const RankIndex&) = delete;
+        RankIndex& operator=(const RankIndex&) = delete;
+
+        /**
+         * @brief Inserts a player or moves it to the position of its new statistics
+         * @param player The player
+         */
+        void update(const Player& player);
+
+        /**
+         * @brief Removes a player
+         * @param username Player name
+         */
+        void erase(const string& username);
+
+        /**
+         * @brief Replaces the whole index
+         * @param shards Every player to rank, by shard
+         */
+        void rebuild(const vector<shared_ptr<const PlayerPart>>& shards);
+
+        /**
+         * @brief Gets the number of ranked players
+         */
+        size_t size() const;
+
+        /**
+         * @brief Gets the rank of a player
+         * @param username Player name
+         * @return 1 for the best player, 0 if the player is not ranked
+         */
+        size_t rankOf(const string& username) const;
+
+        /**
+         * @brief Gets consecutive players in rank order
+         * @param offset Number of better players to skip
+         * @param limit Maximum number of players returned
+         * @return Players ranked offset + 1 to offset + limit
+         */
+        vector<RankEntry> page(size_t offset, size_t limit) const;
+
+        /**
+         * @brief Gets the best players
+         * @param k Maximum number of players returned
+         */
+        vector<RankEntry> top(size_t k) const {
+            return page(0, k);
+        }
+
+    private:
+        static constexpr int MAX_HEIGHT = 24;  ///< Levels of the tallest node
+
+        /**
+         * @struct Node
+         * @brief Player linked into its levels
+         */
+        struct Node {
+            RankEntry entry;            ///< Ranked statistics
+            vector<Node*> next;         ///< Successor on each level
+            vector<size_t> width;       ///< Bottom-level steps to that successor
+        };
+
+        mutable shared_mutex indexMutex;                    ///< Guards the fields below
+        Node head;                                          ///< Sentinel before the best player
+        int height = 1;                                     ///< Levels in use
+        size_t count = 0;                                   ///< Ranked players
+        unordered_map<string, unique_ptr<Node>> nodes;      ///< Node of each player, by name
+        mt19937 random;                                     ///< Source of node heights
+
+        /**
+         * @brief Checks whether a ranks before b
+         */
+        static bool before(const RankEntry& a, const RankEntry& b);
+
+        /**
+         * @brief Links a player in; the caller holds the exclusive lock
+         */
+        void insertLocked(const RankEntry& entry);
+
+        /**
+         * @brief Unlinks a player; the caller holds the exclusive lock
+         */
+        void eraseLocked(const string& username);
+};
+
+#endif // RANKINDEX_H
\ No newline at end of file
@@ -0,0 +1,169 @@
+/**
+ * @file Ratings.h
+ * @brief Header file for the Glicko skill ratings computed from the match history
+ */
+
+#ifndef RATINGS_H
+#define RATINGS_H
+
+#include "MatchHistory.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct Rating
+ * @brief Skill estimate of one player
+ */
+struct Rating {
+    double rating = 1500.0;         ///< Estimated strength
+    double deviation = 350.0;       ///< Uncertainty of the estimate, one standard deviation
+    uint64_t lastPlayed = 0;        ///< End of the player's last rated game, seconds since the epoch
+    uint32_t games = 0;             ///< Rated games played
+
+    /**
+     * @brief Gets the rating the player is very likely above, used for ranking
+     * @return rating - 2 * deviation
+     */
+    double conservative() const {
+        return rating - 2.0 * deviation;
+    }
+};
+
+/**
+ * @class Ratings
+ * @brief Glicko ratings of every player, kept in step with the match history
+ *
+ * Every archived game is rated in archive order. The winner scores a win
+ * against each other player and each of them a loss against the winner;
+ * all players are updated from their ratings before the game, with the
+ * Glicko formulas for one rating period. Before a game a player's
+ * deviation grows with the days since their last game, so returning
+ * players move faster. A game without a winner is not rated.
+ *
+ * Ratings are a pure function of the match history, so the state is just
+ * the ratings plus the position in the history up to which they are
+ * applied. update() rates the games archived after that position, which
+ * at the end of a game is only the new one. Each database has its own
+ * ratings, rated from its match history and saved to <root>/Ratings.dat
+ * every SAVE_INTERVAL games; on load, games archived after the saved
+ * position, also by other processes, are rated on top.
+ *
+ * recompute() rebuilds every rating from scratch. The history is split
+ * into windows of consecutive games (its segments, which cover successive
+ * stretches of time) that are decoded in parallel, and the windows are
+ * then merged in archive order, so the result is identical to rating the
+ * games one by one and does not depend on the number of threads.
+ */
+class Ratings {
+    public:
+        static constexpr double INITIAL_RATING = 1500.0;     ///< Rating of a new player
+        static constexpr double MAX_DEVIATION = 350.0;       ///< Deviation of a new player
+        static constexpr double MIN_DEVIATION = 30.0;        ///< Floor, so ratings keep moving
+        static constexpr double DAILY_DRIFT = 34.6;          ///< Deviation growth per sqrt(day) idle; 50 to 350 in 100 days
+        static const size_t SAVE_INTERVAL = 64;              ///< Games rated between saves
+
+        /**
+         * @brief Gets the ratings of a database, loading them on first use
+         * @param db The database
+         */
+        static Ratings& of(DB& db);
+
+        /**
+         * @brief Rates every game archived since the last update
+         * @return Number of games rated
+         */
+        size_t update();
+
+        /**
+         * @brief Rebuilds every rating from the whole match history
+         * @param workers Number of history segments decoded at once
+         * @return Number of games rated
+         */
+        size_t recompute(size_t workers = 4);
+
+        /**
+         * @brief Gets the rating of a player
+         * @param username Player name
+         * @return The player's rating, the initial rating if they have no rated game
+         */
+        Rating get(const string& username) const;
+
+        /**
+         * @brief Gets the ratings of every rated player
+         */
+        unordered_map<string, Rating> all() const;
+
+        /**
+         * @brief Gets a counter that changes whenever a rating changes
+         */
+        uint64_t version() const;
+
+        /**
+         * @brief Writes the ratings and their history position to <root>/Ratings.dat
+         * @return true if the file was replaced
+         */
+        bool save();
+
+        /**
+         * @brief Applies one game to a set of ratings
+         * @param ratings Ratings of the players, by name; missing players are added
+         * @param players Players of the game
+         * @param winner Position of the winner in players, or players.size() for none
+         * @param finished End of the game in seconds since the epoch, 0 if unknown
+         */
+        static void rate(unordered_map<string, Rating>& ratings, const vector<string>& players,
+                         size_t winner, uint64_t finished);
+
+    private:
+        /**
+         * @brief Loads the saved ratings and rates the games archived since they were saved
+         * @param history Match history the ratings are computed from
+         * @param path Path of the saved ratings
+         */
+        Ratings(MatchHistory& history, const string& path);
+
+        Ratings(const Ratings&) = delete;
+        Ratings& operator=(const Ratings&) = delete;
+
+        MatchHistory& history;                      ///< Games the ratings are computed from
+        const string PATH;                          ///< Path of the saved ratings
+        mutable mutex ratingsMutex;                 ///< Guards the fields below
+        unordered_map<string, Rating> ratings;      ///< Rating of each player, by name
+        uint64_t window = 0;                        ///< History segment or tail the next game is read from
+        size_t row = 0;                             ///< Games of that window already rated
+        uint64_t changes = 0;                       ///< Bumped whenever a rating changes
+        size_t unsaved = 0;                         ///< Games rated since the last save
+
+        /**
+         * @brief Applies one game to the ratings of its players
+         * @param players Rating of each player of the game, in turn order
+         * @param winner Position of the winner in players, or players.size() for none
+         * @param finished End of the game in seconds since the epoch, 0 if unknown
+         */
+        static void rate(const vector<Rating*>& players, size_t winner, uint64_t finished);
+
+        /**
+         * @brief Reads the saved ratings
+         * @return false if there are none or the file is damaged
+         */
+        bool load();
+
+        /**
+         * @brief Rates the games of one window after the current position; the caller holds the lock
+         * @return Number of games rated
+         */
+        size_t applyLocked(const MatchWindow& matches);
+
+        /**
+         * @brief Writes the ratings; the caller holds the lock
+         */
+        bool saveLocked();
+};
+
+#endif // RATINGS_H
\ No newline at end of file
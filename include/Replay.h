@@ -0,0 +1,190 @@
+/**
+ * @file Replay.h
+ * @brief Header file for the seekable replay archive of finished games
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "BoardProtocol.h"
+#include "GameLog.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct ReplayInfo
+ * @brief Index entry locating one replay inside the archive
+ */
+struct ReplayInfo {
+    string gameId;        ///< ID of the finished game
+    uint64_t offset = 0;  ///< Byte offset of the replay record in the archive
+    uint64_t length = 0;  ///< Length of the replay record in bytes
+};
+
+/**
+ * @class ReplayArchive
+ * @brief Append-only archive of replays with a fixed-size entry index
+ *
+ * Replays are appended to Replay.dat under the root of the game's database
+ * and located through Replay.idx next to it, whose fixed 64-byte entries
+ * can be streamed without loading the archive. A record (all integers little-endian) is laid out as:
+ *
+ *   header:    "BRPL", version, player count, keyframe interval k,
+ *              event count, keyframe count, start time, end time, winner,
+ *              then per player a name and the 25 board numbers
+ *   events:    one byte per event (called number, 0 skip, 255 forfeit)
+ *   index:     one u32 offset per keyframe, relative to the record start
+ *   keyframes: every k events: event index, current turn, game-over flag
+ *              and one marked-cell bitboard per player
+ *
+ * Seeking to any turn therefore costs one index read, one keyframe read and
+ * at most k - 1 replayed events.
+ */
+class ReplayArchive {
+    public:
+        static const int KEYFRAME_INTERVAL = 4;  ///< Events between keyframes
+
+        /**
+         * @brief Archives the replay of a finished game from its move log
+         * @param db Database the game was bound to
+         * @param gameId ID of the game
+         * @return true if the replay was written, false otherwise
+         */
+        static bool record(const DB& db, const string& gameId);
+
+        /**
+         * @brief Archives a replay from an event history
+         * @param db Database the game was bound to
+         * @param gameId ID of the game
+         * @param history Seed, players and events of the game
+         * @return true if the replay was written, false otherwise
+         */
+        static bool write(const DB& db, const string& gameId, const GameHistory& history);
+
+        /**
+         * @brief Finds a replay in the index
+         * @param db Database holding the archive
+         * @param gameId ID of the game
+         * @param info Output index entry
+         * @return true if found, false otherwise
+         */
+        static bool find(const DB& db, const string& gameId, ReplayInfo& info);
+
+        /**
+         * @brief Lists the most recent replays
+         * @param db Database holding the archive
+         * @param limit Maximum number of entries (0 for all)
+         * @return Index entries, most recent first
+         */
+        static vector<ReplayInfo> list(const DB& db, size_t limit = 0);
+
+        /**
+         * @brief Gets the path of the replay archive
+         * @param db Database holding the archive
+         * @return Path of Replay.dat under the database root
+         */
+        static string archivePath(const DB& db);
+
+        /**
+         * @brief Gets the path of the replay index
+         * @param db Database holding the archive
+         * @return Path of Replay.idx under the database root
+         */
+        static string indexPath(const DB& db);
+
+        /// Size of one index entry in bytes
+        static const size_t INDEX_ENTRY = 64;
+};
+
+/**
+ * @class ReplayReader
+ * @brief Streams one replay from the archive and seeks to any turn
+ *
+ * Only the record header is kept in memory; keyframes and events are read
+ * on demand with positioned reads.
+ */
+class ReplayReader {
+    public:
+        /**
+         * @brief Opens the replay of a game
+         * @param db Database holding the archive
+         * @param gameId ID of the game
+         * @return true if the replay was found and its header is valid
+         */
+        bool open(const DB& db, const string& gameId);
+
+        /**
+         * @brief Gets the number of recorded events
+         * @return Event count (the last turn that can be seeked to)
+         */
+        size_t turnCount() const;
+
+        /**
+         * @brief Gets the player names in turn order
+         * @return Constant reference to the names
+         */
+        const vector<string>& getPlayers() const;
+
+        /**
+         * @brief Gets the index of the winning player
+         * @return Winner index, or -1 if nobody won
+         */
+        int getWinner() const;
+
+        /**
+         * @brief Gets the Unix time the game started
+         * @return Start time, 0 if unknown
+         */
+        int64_t getStartTime() const;
+
+        /**
+         * @brief Gets the Unix time the replay was archived
+         * @return End time
+         */
+        int64_t getEndTime() const;
+
+        /**
+         * @brief Gets the called number of an event
+         * @param turn Event index (0-based)
+         * @return Called number, 0 for a skip, 255 for a forfeit, -1 if out of range
+         */
+        int eventAt(size_t turn);
+
+        /**
+         * @brief Reconstructs the state after a given number of events
+         * @param turn Number of events applied (0 is the initial deal)
+         * @param state Output state; sequence holds the event count
+         * @return true on success, false if the turn is out of range or the data is corrupt
+         */
+        bool seek(size_t turn, BoardSnapshot& state);
+
+    private:
+        ifstream file;                    ///< Open archive
+        uint64_t base = 0;                ///< Offset of the record
+        uint8_t interval = 1;             ///< Keyframe interval
+        uint16_t events = 0;              ///< Event count
+        uint16_t keyframes = 0;           ///< Keyframe count
+        int64_t startTime = 0;            ///< Game start time
+        int64_t endTime = 0;              ///< Archive time
+        int winner = -1;                  ///< Winner index
+        vector<string> players;           ///< Player names
+        vector<vector<int>> boards;       ///< Board numbers per player, row-major
+        uint64_t eventsOffset = 0;        ///< Offset of the event bytes, relative to base
+        uint64_t indexOffset = 0;         ///< Offset of the keyframe index, relative to base
+
+        /**
+         * @brief Reads bytes at an offset relative to the record
+         * @param offset Relative offset
+         * @param length Number of bytes
+         * @param out Output buffer
+         * @return true if all bytes were read
+         */
+        bool readAt(uint64_t offset, size_t length, vector<uint8_t>& out);
+};
+
+#endif // REPLAY_H
\ No newline at end of file
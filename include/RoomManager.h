@@ -0,0 +1,181 @@
+/**
+ * @file RoomManager.h
+ * @brief Header file for the RoomManager class that owns hosted game rooms
+ */
+
+#ifndef ROOMMANAGER_H
+#define ROOMMANAGER_H
+
+#include "DB.h"
+#include "Game.h"
+#include "Player.h"
+#include "Metrics.h"
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class RoomManager
+ * @brief Owns the set of open game rooms in hosted mode
+ *
+ * Rooms are spread over independently locked shards by a hash of the room
+ * ID, so creating or updating rooms from many threads never contends on a
+ * single mutex.
+ *
+ * With a memory budget set, each shard keeps its rooms in LRU order and
+ * evicts the least recently used games to the game store once its share
+ * of the budget is exceeded. The victims' states are taken under the
+ * shard lock but written without it, all in one transaction; a room used
+ * while its state was being written stays resident. An evicted room keeps
+ * only its ID in memory and is rehydrated from the store on its next
+ * access. Closing a room that was ever written to the store removes its
+ * stored record.
+ *
+ * Room IDs are Game::ROOM_PREFIX followed by a number counting up from the
+ * microseconds since the epoch at construction, so IDs are not reused
+ * after a restart. The prefix keeps evicted rooms out of the saved-game
+ * list, although they share the game table.
+ */
+class RoomManager {
+    public:
+        /**
+         * @brief Constructs a room manager
+         * @param shardCount Number of independently locked shards
+         * @param memoryBudget Maximum bytes of resident games (0 for unlimited)
+         * @param db Database rooms are evicted to
+         */
+        explicit RoomManager(size_t shardCount = 64, size_t memoryBudget = 0, DB& db = DB::getInstance());
+
+        // Delete copy constructor and assignment operator
+        RoomManager(const RoomManager&) = delete;
+        RoomManager& operator=(const RoomManager&) = delete;
+
+        /**
+         * @brief Creates a room and deals fresh boards to both players
+         * @param p1 First player (moves first)
+         * @param p2 Second player
+         * @return ID of the new room
+         */
+        string createRoom(const Player& p1, const Player& p2);
+
+        /**
+         * @brief Runs a function on a room while holding its shard lock
+         * @param roomId ID of the room
+         * @param fn Function to run on the room's game
+         * @return true if the room exists and is resident or could be rehydrated, false otherwise
+         */
+        bool withRoom(const string& roomId, const function<void(Game&)>& fn);
+
+        /**
+         * @brief Closes a room, releases its game and removes its stored record
+         * @param roomId ID of the room
+         * @return true if the room existed, false otherwise
+         */
+        bool closeRoom(const string& roomId);
+
+        /**
+         * @brief Gets the number of open rooms
+         * @return Open room count
+         */
+        size_t roomCount() const;
+
+        /**
+         * @brief Gets the number of rooms whose game is held in memory
+         * @return Resident room count
+         */
+        size_t residentRooms() const;
+
+        /**
+         * @brief Gets the estimated memory held by resident games
+         * @return Resident bytes
+         */
+        size_t residentBytes() const;
+
+        /**
+         * @brief Gets the number of evictions so far
+         * @return Eviction count
+         */
+        uint64_t evictions() const;
+
+        /**
+         * @brief Gets the histogram of rehydration latency
+         * @return Constant reference to the rehydration histogram
+         */
+        const LatencyHistogram& rehydrationLatency() const;
+
+    private:
+        /**
+         * @struct Room
+         * @brief A room entry; game is null while the room is evicted
+         */
+        struct Room {
+            unique_ptr<Game> game;            ///< Resident game, or null when evicted
+            size_t bytes = 0;                 ///< Footprint counted against the budget
+            list<string>::iterator lruPos;    ///< Position in the shard's LRU list (resident only)
+            uint64_t uses = 0;                ///< Bumped whenever the game may have changed
+            bool evicting = false;            ///< Whether its state is being written for eviction
+            bool stored = false;              ///< Whether the store may hold a record of it
+        };
+
+        /**
+         * @struct Shard
+         * @brief A lock and the rooms that hash to it
+         */
+        struct Shard {
+            mutable mutex mtx;                        ///< Guards rooms, lru and bytes
+            unordered_map<string, Room> rooms;        ///< Rooms keyed by ID
+            list<string> lru;                         ///< Resident room IDs, most recently used first
+            size_t bytes = 0;                         ///< Footprint of resident games
+        };
+
+        vector<unique_ptr<Shard>> shards;       ///< Room shards
+        const size_t shardBudget;               ///< Per-shard byte budget (0 for unlimited)
+        DB& db;                                 ///< Database rooms are evicted to
+        atomic<uint64_t> nextRoomId;            ///< Counter used to generate room IDs
+        atomic<size_t> openRooms{0};            ///< Number of open rooms
+        atomic<size_t> resident{0};             ///< Number of resident rooms
+        atomic<size_t> residentTotal{0};        ///< Footprint of all resident games
+        atomic<uint64_t> evictionCount{0};      ///< Rooms evicted to the store
+        LatencyHistogram rehydrateHistogram;    ///< Time taken to rehydrate rooms
+
+        /**
+         * @brief Gets the shard responsible for a room ID
+         * @param roomId ID of the room
+         * @return Reference to the shard
+         */
+        Shard& shardFor(const string& roomId);
+
+        /**
+         * @brief Makes a room resident and most recently used
+         * @param shard Shard holding the room (lock held)
+         * @param roomId ID of the room
+         * @param room The room entry
+         * @return true if the room's game is resident afterwards
+         */
+        bool touch(Shard& shard, const string& roomId, Room& room);
+
+        /**
+         * @brief Re-measures a resident room after it was used
+         * @param shard Shard holding the room (lock held)
+         * @param room The room entry
+         */
+        void remeasure(Shard& shard, Room& room);
+
+        /**
+         * @brief Evicts least recently used rooms until the shard fits its budget
+         * @param shard Shard to trim
+         * @param lock Held lock of the shard, released while the victims are written
+         * @param keep ID of a room that must stay resident
+         */
+        void enforceBudget(Shard& shard, unique_lock<mutex>& lock, const string& keep);
+};
+
+#endif // ROOMMANAGER_H
\ No newline at end of file
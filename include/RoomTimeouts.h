@@ -0,0 +1,136 @@
+/**
+ * @file RoomTimeouts.h
+ * @brief Header file for the RoomTimeouts class that enforces turn and idle limits
+ */
+
+#ifndef ROOMTIMEOUTS_H
+#define ROOMTIMEOUTS_H
+
+#include "RoomManager.h"
+#include "TimingWheel.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @class RoomTimeouts
+ * @brief Per-room turn timers and idle-room expiry driven by one timing wheel
+ *
+ * Each watched room holds two timers: a turn timer restarted on every move
+ * and on every timeout, and an idle timer restarted only on real moves.
+ * All methods must be called from the server event loop thread, which
+ * calls poll() on every iteration.
+ */
+class RoomTimeouts {
+    public:
+        /**
+         * @brief Action taken when a player lets the turn timer run out
+         */
+        enum class TurnAction {
+            SKIP,     ///< Pass the turn to the next player
+            FORFEIT,  ///< End the game, the other player wins
+        };
+
+        /**
+         * @brief Constructs the timeout service
+         * @param rooms Room manager owning the rooms
+         * @param turnTimeout Time a player has to make a move
+         * @param idleTimeout Time without any move after which the room is closed
+         * @param action What to do when the turn timer expires
+         * @param tick Timer resolution
+         */
+        RoomTimeouts(RoomManager& rooms, chrono::milliseconds turnTimeout, chrono::milliseconds idleTimeout,
+                     TurnAction action = TurnAction::SKIP, chrono::milliseconds tick = chrono::milliseconds(100));
+
+        /**
+         * @brief Starts both timers for a newly opened room
+         * @param roomId ID of the room
+         */
+        void watch(const string& roomId);
+
+        /**
+         * @brief Restarts both timers after a move in a room
+         * @param roomId ID of the room
+         */
+        void onMove(const string& roomId);
+
+        /**
+         * @brief Cancels both timers of a room
+         * @param roomId ID of the room
+         */
+        void unwatch(const string& roomId);
+
+        /**
+         * @brief Fires every expired timer; called by the event loop
+         * @param now Current time
+         * @return Number of timers fired
+         */
+        size_t poll(chrono::steady_clock::time_point now = chrono::steady_clock::now());
+
+        /**
+         * @brief Gets the number of turn timeouts handled
+         * @return Turn timeout count
+         */
+        uint64_t turnTimeouts() const;
+
+        /**
+         * @brief Gets the number of rooms closed for being idle
+         * @return Idle expiry count
+         */
+        uint64_t idleExpiries() const;
+
+        /**
+         * @brief Gets the number of watched rooms
+         * @return Watched room count
+         */
+        size_t watchedRooms() const;
+
+    private:
+        /**
+         * @struct Timers
+         * @brief Timer handles held for one room (0 when not armed)
+         */
+        struct Timers {
+            TimingWheel::TimerId turn = 0;  ///< Turn timer
+            TimingWheel::TimerId idle = 0;  ///< Idle-room timer
+        };
+
+        RoomManager& rooms;                         ///< Rooms being watched
+        TimingWheel wheel;                          ///< Shared wheel for all rooms
+        chrono::milliseconds turnTimeout;           ///< Turn time limit
+        chrono::milliseconds idleTimeout;           ///< Idle-room time limit
+        TurnAction action;                          ///< Turn timeout action
+        unordered_map<string, Timers> timers;       ///< Armed timers by room ID
+        uint64_t turnTimeoutCount = 0;              ///< Turn timeouts handled
+        uint64_t idleExpiryCount = 0;               ///< Rooms closed for idleness
+
+        /**
+         * @brief (Re)arms the turn timer of a room
+         * @param roomId ID of the room
+         */
+        void armTurn(const string& roomId);
+
+        /**
+         * @brief (Re)arms the idle timer of a room
+         * @param roomId ID of the room
+         */
+        void armIdle(const string& roomId);
+
+        /**
+         * @brief Handles an expired turn timer
+         * @param roomId ID of the room
+         */
+        void onTurnTimeout(const string& roomId);
+
+        /**
+         * @brief Handles an expired idle timer
+         * @param roomId ID of the room
+         */
+        void onIdleTimeout(const string& roomId);
+};
+
+#endif // ROOMTIMEOUTS_H
\ No newline at end of file
@@ -0,0 +1,361 @@
+/**
+ * @file SSTable.h
+ * @brief Header file for the immutable sorted tables of the LSM storage engine
+ *
+ * A table file holds entries in strictly ascending key order:
+ *   data blocks, Bloom filter, index, footer
+ * Each data block (about BLOCK_BYTES) is a run of entries:
+ *   varint key length, key, byte kind (0 value, 1 deletion),
+ *   varint value length, value
+ * followed by the block's CRC32C (4 bytes, not counted in its size).
+ * The index starts with the smallest key and lists, for each block, its
+ * last key, offset and size. The fixed footer gives the offsets and sizes
+ * of the filter and the index, the entry count, the number of filter
+ * probes and a magic number. Tables with the older magic "SST1" have no
+ * block checksums and are still read.
+ */
+
+#ifndef SSTABLE_H
+#define SSTABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class SSTable
+ * @brief Read-only view of one table file
+ *
+ * The filter and the index are kept in memory; data blocks are read from
+ * the file on demand, so a point lookup costs at most one block read and
+ * none when the filter rules the key out. A block whose checksum does not
+ * match is logged; lookups in it report CORRUPT, and iterators skip it and
+ * report its key range. Reads only use positioned I/O
+ * and may run concurrently. A table marked obsolete deletes its file once
+ * the last reader lets go of it.
+ */
+class SSTable {
+    public:
+        /**
+         * @brief Result of a point lookup
+         */
+        enum class Lookup {
+            FOUND,      ///< The key has a value in this table
+            DELETED,    ///< The key was deleted in this table
+            MISSING,    ///< The table says nothing about the key
+            CORRUPT     ///< The block that would hold the key cannot be read
+        };
+
+        /// Target size of a data block
+        static constexpr size_t BLOCK_BYTES = 4096;
+
+        /**
+         * @brief Opens a table file
+         * @param path Table file path
+         * @param number File number of the table
+         * @return The table, or null if the file is missing or malformed
+         */
+        static shared_ptr<SSTable> open(const string& path, uint64_t number);
+
+        /**
+         * @brief Closes the file, deleting it if the table is obsolete
+         */
+        ~SSTable();
+
+        SSTable(const SSTable&) = delete;
+        SSTable& operator=(const SSTable&) = delete;
+
+        /**
+         * @brief Looks a key up
+         * @param key Key
+         * @param value Output value when found
+         * @return Whether the key has a value, was deleted, is not in the table or is unreadable
+         */
+        Lookup get(const string& key, string& value) const;
+
+        /**
+         * @brief Checks the Bloom filter
+         * @param key Key
+         * @return false if the key is certainly absent
+         */
+        bool mayContain(const string& key) const;
+
+        /**
+         * @brief Gets the file number
+         */
+        uint64_t number() const {
+            return fileNumber;
+        }
+
+        /**
+         * @brief Gets the smallest key in the table
+         */
+        const string& smallest() const {
+            return smallestKey;
+        }
+
+        /**
+         * @brief Gets the largest key in the table
+         */
+        const string& largest() const {
+            return blocks.back().lastKey;
+        }
+
+        /**
+         * @brief Gets the size of the file in bytes
+         */
+        uint64_t fileSize() const {
+            return size;
+        }
+
+        /**
+         * @brief Gets the number of entries, deletions included
+         */
+        uint64_t entryCount() const {
+            return entries;
+        }
+
+        /**
+         * @brief Deletes the file once the table is no longer used
+         */
+        void markObsolete() {
+            obsolete = true;
+        }
+
+        /**
+         * @class Iterator
+         * @brief Forward iterator over the entries of a table
+         */
+        class Iterator {
+            public:
+                /**
+                 * @brief Creates an iterator positioned on the first entry
+                 * @param table Table to read, kept alive by the iterator
+                 */
+                explicit Iterator(shared_ptr<const SSTable> table);
+
+                /**
+                 * @brief Moves to the first entry not less than a key
+                 */
+                void seek(const string& target);
+
+                /**
+                 * @brief Checks whether the iterator is on an entry
+                 */
+                bool valid() const {
+                    return onEntry;
+                }
+
+                /**
+                 * @brief Gets the current key
+                 */
+                const string& key() const {
+                    return currentKey;
+                }
+
+                /**
+                 * @brief Gets the current value, empty for a deletion
+                 */
+                const optional<string>& value() const {
+                    return currentValue;
+                }
+
+                /**
+                 * @brief Moves to the next entry
+                 */
+                void next();
+
+                /**
+                 * @brief Gets the key ranges of the blocks skipped because they could not be read
+                 * @return Inclusive first and last key of each skipped block
+                 */
+                const vector<pair<string, string>>& damaged() const {
+                    return damagedRanges;
+                }
+
+            private:
+                shared_ptr<const SSTable> table;    ///< Table being read
+                size_t block = 0;                   ///< Index of the loaded block
+                string data;                        ///< Content of the loaded block
+                size_t pos = 0;                     ///< Read position in the block
+                bool onEntry = false;               ///< Whether the iterator is on an entry
+                string currentKey;                  ///< Key of the current entry
+                optional<string> currentValue;      ///< Value of the current entry
+                vector<pair<string, string>> damagedRanges;  ///< Key ranges of unreadable blocks
+
+                /**
+                 * @brief Loads a block and positions before its first entry
+                 * @return false past the last block; a damaged block loads empty and is recorded
+                 */
+                bool load(size_t index);
+        };
+
+        /**
+         * @brief Appends an unsigned LEB128 varint
+         * @param out Output buffer
+         * @param value Value to append
+         */
+        static void putVarint(string& out, uint64_t value);
+
+        /**
+         * @brief Reads an unsigned LEB128 varint
+         * @param data Input buffer
+         * @param pos Read position, advanced past the varint
+         * @param value Output value
+         * @return false if the data ended early or the value overflowed
+         */
+        static bool getVarint(const string& data, size_t& pos, uint64_t& value);
+
+        /**
+         * @brief Appends a little-endian fixed-width integer
+         */
+        static void putFixed(string& out, uint64_t value, int bytes);
+
+        /**
+         * @brief Reads a little-endian fixed-width integer
+         */
+        static uint64_t getFixed(const string& data, size_t pos, int bytes);
+
+        /**
+         * @brief Decodes the entry at a position of a data block
+         * @param data Block content
+         * @param pos Read position, advanced past the entry
+         * @param key Output key
+         * @param value Output value, empty for a deletion
+         * @return false if the entry is malformed
+         */
+        static bool decodeEntry(const string& data, size_t& pos, string& key, optional<string>& value);
+
+    private:
+        friend class SSTableBuilder;
+
+        /**
+         * @struct BlockHandle
+         * @brief Index entry of one data block
+         */
+        struct BlockHandle {
+            string lastKey;     ///< Largest key in the block
+            uint64_t offset;    ///< Offset of the block in the file
+            uint64_t size;      ///< Size of the block in bytes
+        };
+
+        /// Size of the fixed footer in bytes
+        static constexpr size_t FOOTER_BYTES = 48;
+        /// Footer magic number, "SST2"
+        static constexpr uint32_t MAGIC = 0x32545353u;
+        /// Footer magic number of tables without block checksums, "SST1"
+        static constexpr uint32_t UNCHECKED_MAGIC = 0x31545353u;
+
+        string path;                    ///< File path
+        uint64_t fileNumber = 0;        ///< File number
+        int fd = -1;                    ///< Open file descriptor
+        uint64_t size = 0;              ///< File size in bytes
+        uint64_t entries = 0;           ///< Entry count
+        string smallestKey;             ///< Smallest key
+        vector<BlockHandle> blocks;     ///< Block index, in key order
+        string filter;                  ///< Bloom filter bits
+        uint32_t probes = 0;            ///< Bloom filter probes per key
+        bool checksummed = true;        ///< Whether blocks end with a CRC32C
+        bool obsolete = false;          ///< Whether the file is deleted on destruction
+
+        SSTable() = default;
+
+        /**
+         * @brief Reads a data block
+         * @param index Block index
+         * @param out Output content
+         * @return false on a read error or a checksum mismatch
+         */
+        bool readBlock(size_t index, string& out) const;
+
+        /**
+         * @brief Hashes a key for the Bloom filter
+         */
+        static uint64_t hash(const string& key);
+};
+
+/**
+ * @class SSTableBuilder
+ * @brief Writes a new table file from entries given in ascending key order
+ *
+ * The file is written under a temporary name and renamed into place by
+ * finish() after it has been synced, so a crash never leaves a partial
+ * table under its final name.
+ */
+class SSTableBuilder {
+    public:
+        /**
+         * @brief Starts a table
+         * @param path Final file path
+         */
+        explicit SSTableBuilder(const string& path);
+
+        /**
+         * @brief Removes the temporary file unless finish() succeeded
+         */
+        ~SSTableBuilder();
+
+        SSTableBuilder(const SSTableBuilder&) = delete;
+        SSTableBuilder& operator=(const SSTableBuilder&) = delete;
+
+        /**
+         * @brief Appends an entry
+         * @param key Key, greater than every key added before
+         * @param value Value, empty for a deletion
+         * @return false on a write error
+         */
+        bool add(const string& key, const optional<string>& value);
+
+        /**
+         * @brief Writes the filter, index and footer, syncs and renames the file
+         * @return false on a write error
+         */
+        bool finish();
+
+        /**
+         * @brief Gets the number of bytes written so far
+         */
+        uint64_t fileSize() const {
+            return offset + block.size();
+        }
+
+        /**
+         * @brief Gets the number of entries added
+         */
+        uint64_t entryCount() const {
+            return hashes.size();
+        }
+
+    private:
+        /// Bloom filter bits per key, about 1% false positives
+        static constexpr size_t FILTER_BITS_PER_KEY = 10;
+
+        string path;                                ///< Final file path
+        string tempPath;                            ///< Path written until finish()
+        int fd = -1;                                ///< Open file descriptor
+        bool ok = true;                             ///< Whether every write succeeded
+        bool finished = false;                      ///< Whether finish() succeeded
+        uint64_t offset = 0;                        ///< Bytes flushed to the file
+        string block;                               ///< Data block being filled
+        string smallestKey;                         ///< First key added
+        string lastKey;                             ///< Last key added
+        vector<SSTable::BlockHandle> blocks;        ///< Index of the flushed blocks
+        vector<uint64_t> hashes;                    ///< Filter hash of every key
+
+        /**
+         * @brief Writes bytes at the end of the file
+         */
+        void write(const string& data);
+
+        /**
+         * @brief Writes the current data block and adds it to the index
+         */
+        void flushBlock();
+};
+
+#endif // SSTABLE_H
\ No newline at end of file
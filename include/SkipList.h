@@ -0,0 +1,210 @@
+/**
+ * @file SkipList.h
+ * @brief Header file for an ordered map backed by a skip list
+ */
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @class SkipList
+ * @brief Ordered map with expected O(log n) insert and lookup
+ * @tparam K Key type
+ * @tparam V Value type
+ * @tparam Compare Strict weak ordering of keys
+ *
+ * Each node is linked into a random number of levels, a quarter of the
+ * nodes of one level reaching the next. Keys are never removed: the LSM
+ * memtable records deletions as values. The list is not thread-safe; the
+ * owner serialises writers and keeps readers out while one runs.
+ */
+template<typename K, typename V, typename Compare = less<K>>
+class SkipList {
+    private:
+        static constexpr int MAX_HEIGHT = 16;   ///< Levels of the tallest node
+
+        /**
+         * @struct Node
+         * @brief Entry linked into its levels
+         */
+        struct Node {
+            K key;                          ///< Entry key
+            V value;                        ///< Entry value
+            unique_ptr<Node*[]> next;       ///< Successor on each level the node is part of
+
+            Node(K key, V value, int height)
+                : key(move(key)), value(move(value)), next(new Node*[height]()) {}
+        };
+
+    public:
+        /**
+         * @class Iterator
+         * @brief Forward iterator over entries in key order
+         */
+        class Iterator {
+            public:
+                /**
+                 * @brief Checks whether the iterator is on an entry
+                 */
+                bool valid() const {
+                    return node != nullptr;
+                }
+
+                /**
+                 * @brief Gets the current key
+                 */
+                const K& key() const {
+                    return node->key;
+                }
+
+                /**
+                 * @brief Gets the current value
+                 */
+                const V& value() const {
+                    return node->value;
+                }
+
+                /**
+                 * @brief Moves to the next entry
+                 */
+                void next() {
+                    node = node->next[0];
+                }
+
+            private:
+                friend class SkipList;
+                explicit Iterator(const Node* node) : node(node) {}
+                const Node* node;   ///< Current node, null past the end
+        };
+
+        /**
+         * @brief Constructs an empty list
+         * @param seed Seed of the level generator
+         */
+        explicit SkipList(uint32_t seed = 0x9E3779B9u)
+            : head(K(), V(), MAX_HEIGHT), random(seed ? seed : 1) {}
+
+        /**
+         * @brief Frees every node
+         */
+        ~SkipList() {
+            Node* node = head.next[0];
+            while (node) {
+                Node* next = node->next[0];
+                delete node;
+                node = next;
+            }
+        }
+
+        // Delete copy constructor and assignment operator
+        SkipList(const SkipList&) = delete;
+        SkipList& operator=(const SkipList&) = delete;
+
+        /**
+         * @brief Inserts an entry or replaces the value of an existing key
+         * @param key Key
+         * @param value Value
+         * @return true if the key was new
+         */
+        bool insertOrAssign(const K& key, V value) {
+            Node* previous[MAX_HEIGHT];
+            Node* node = findGreaterOrEqual(key, previous);
+            if (node && !compare(key, node->key)) {
+                node->value = move(value);
+                return false;
+            }
+
+            int nodeHeight = randomHeight();
+            if (nodeHeight > height) {
+                for (int level = height; level < nodeHeight; ++level) previous[level] = &head;
+                height = nodeHeight;
+            }
+            node = new Node(key, move(value), nodeHeight);
+            for (int level = 0; level < nodeHeight; ++level) {
+                node->next[level] = previous[level]->next[level];
+                previous[level]->next[level] = node;
+            }
+            ++count;
+            return true;
+        }
+
+        /**
+         * @brief Finds the value of a key
+         * @param key Key
+         * @return Pointer to the value, null if the key is absent
+         */
+        const V* find(const K& key) const {
+            const Node* node = findGreaterOrEqual(key, nullptr);
+            return node && !compare(key, node->key) ? &node->value : nullptr;
+        }
+
+        /**
+         * @brief Gets an iterator on the first entry not less than a key
+         */
+        Iterator lowerBound(const K& key) const {
+            return Iterator(findGreaterOrEqual(key, nullptr));
+        }
+
+        /**
+         * @brief Gets an iterator on the first entry
+         */
+        Iterator begin() const {
+            return Iterator(head.next[0]);
+        }
+
+        /**
+         * @brief Gets the number of entries
+         */
+        size_t size() const {
+            return count;
+        }
+
+    private:
+        Node head;              ///< Sentinel before the first entry, as tall as the tallest node
+        int height = 1;         ///< Levels currently in use
+        size_t count = 0;       ///< Number of entries
+        uint32_t random;        ///< xorshift state of the level generator
+        Compare compare;        ///< Key ordering
+
+        /**
+         * @brief Draws a node height, each level with probability 1/4
+         */
+        int randomHeight() {
+            int nodeHeight = 1;
+            while (nodeHeight < MAX_HEIGHT) {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                if (random % 4 != 0) break;
+                ++nodeHeight;
+            }
+            return nodeHeight;
+        }
+
+        /**
+         * @brief Finds the first node not less than a key
+         * @param key Key
+         * @param previous If not null, receives the last node before it on every level
+         * @return The node, null if every key is less
+         */
+        Node* findGreaterOrEqual(const K& key, Node** previous) const {
+            Node* node = const_cast<Node*>(&head);
+            for (int level = height - 1; level >= 0; --level) {
+                while (node->next[level] && compare(node->next[level]->key, key)) {
+                    node = node->next[level];
+                }
+                if (previous) previous[level] = node;
+            }
+            return node->next[0];
+        }
+};
+
+#endif // SKIPLIST_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+/**
+ * @file StorageEngine.h
+ * @brief Header file for the key-value storage interface behind the DB class
+ */
+
+#ifndef STORAGEENGINE_H
+#define STORAGEENGINE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct WriteBatch
+ * @brief Puts and deletes applied together by StorageEngine::apply()
+ */
+struct WriteBatch {
+    /**
+     * @struct Operation
+     * @brief One staged change
+     */
+    struct Operation {
+        string table;               ///< "Account" or "Game"
+        string key;                 ///< Username or game ID
+        optional<string> value;     ///< Record JSON, empty for a delete
+    };
+
+    vector<Operation> operations;   ///< Changes in the order they were staged
+
+    /**
+     * @brief Stages an insert or replacement of a record
+     */
+    void put(const string& table, const string& key, const string& value) {
+        operations.push_back({table, key, value});
+    }
+
+    /**
+     * @brief Stages a delete of a record
+     */
+    void remove(const string& table, const string& key) {
+        operations.push_back({table, key, nullopt});
+    }
+
+    /**
+     * @brief Checks whether nothing is staged
+     */
+    bool empty() const {
+        return operations.empty();
+    }
+};
+
+/**
+ * @class StorageEngine
+ * @brief Interface of the engines that store records for a DB
+ *
+ * Records are JSON objects kept per table under a string key. Tables are
+ * split into shards by DB::shardOf(); the shard is the unit of locking.
+ * Engines do no locking of their own beyond keeping their structures
+ * consistent: the DB holds the shard locks around every call, and
+ * apply() is only called with the exclusive lock of every shard the batch
+ * touches.
+ */
+class StorageEngine {
+    public:
+        virtual ~StorageEngine() = default;
+
+        /**
+         * @brief Gets the shard a key belongs to for a given shard count
+         * @param key Username or game ID
+         * @param count Shard count
+         * @return 64-bit FNV-1a hash of the key modulo the count
+         */
+        static size_t shardOf(const string& key, size_t count) {
+            uint64_t hash = 14695981039346656037ULL;
+            for (unsigned char c : key) {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            return static_cast<size_t>(hash % count);
+        }
+
+        /**
+         * @brief Prepares the storage for use
+         * @return true if the engine can be used
+         */
+        virtual bool open() = 0;
+
+        /**
+         * @brief Gets the engine's name for messages
+         */
+        virtual string name() const = 0;
+
+        /**
+         * @brief Gets the number of shards per table
+         */
+        virtual size_t shardCount() const = 0;
+
+        /**
+         * @brief Gets the file that serialises a shard across processes
+         * @param table Table name
+         * @param shard Shard index
+         * @return Lock file path, empty if the storage is private to this process
+         */
+        virtual string lockPath(const string&, size_t) const {
+            return "";
+        }
+
+        /**
+         * @brief Gets a stamp that changes whenever a shard is written
+         * @param table Table name
+         * @param shard Shard index
+         * @return Stamp, compared for equality only
+         *
+         * Also changes when another process writes the shard, so readers can
+         * tell that records they cached are stale.
+         */
+        virtual uint64_t generation(const string& table, size_t shard) = 0;
+
+        /**
+         * @brief Reads one record
+         * @param table Table name
+         * @param key Record key
+         * @param value Output record JSON
+         * @return true if the record exists
+         */
+        virtual bool get(const string& table, const string& key, string& value) = 0;
+
+        /**
+         * @brief Reads every record of a table
+         * @param table Table name
+         * @return Pairs of key and record JSON, in no particular order
+         */
+        virtual vector<pair<string, string>> scan(const string& table) = 0;
+
+        /**
+         * @brief Reads the records of one shard of a table
+         * @param table Table name
+         * @param shard Shard index
+         * @return Pairs of key and record JSON, in no particular order
+         *
+         * Lets tools walk a table one shard at a time. The default filters a
+         * full scan; engines that keep shards apart read only the one.
+         */
+        virtual vector<pair<string, string>> scanShard(const string& table, size_t shard) {
+            vector<pair<string, string>> records;
+            for (auto& record : scan(table)) {
+                if (shardOf(record.first, shardCount()) == shard) records.push_back(move(record));
+            }
+            return records;
+        }
+
+        /**
+         * @brief Applies every operation of a batch, all or none
+         * @param batch Changes to apply
+         * @return true if the batch was applied
+         */
+        virtual bool apply(const WriteBatch& batch) = 0;
+
+        /**
+         * @brief Inserts or replaces one record
+         * @return true if written
+         */
+        bool put(const string& table, const string& key, const string& value) {
+            WriteBatch batch;
+            batch.put(table, key, value);
+            return apply(batch);
+        }
+
+        /**
+         * @brief Deletes one record
+         * @return true if the delete was applied, including when there was no record
+         */
+        bool remove(const string& table, const string& key) {
+            WriteBatch batch;
+            batch.remove(table, key);
+            return apply(batch);
+        }
+};
+
+#endif // STORAGEENGINE_H
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * @file TimingWheel.h
+ * @brief Header file for a hierarchical timing wheel
+ */
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class TimingWheel
+ * @brief Hierarchical timing wheel with O(1) schedule and cancel
+ *
+ * Four levels of 256 slots cover 2^32 ticks. A timer is placed on the
+ * lowest level whose span reaches its expiry and cascades down one level
+ * each time the level below wraps around. Timer nodes live in a pooled
+ * vector and are linked into slots by index, so scheduling and cancelling
+ * never allocate once the pool has grown.
+ *
+ * The wheel is not thread-safe: it is owned and advanced by the server
+ * event loop, and callbacks run on that thread.
+ */
+class TimingWheel {
+    public:
+        using TimerId = uint64_t;                 ///< Handle returned by schedule(), 0 is never valid
+        using Callback = function<void()>;        ///< Function run when a timer expires
+
+        /**
+         * @brief Constructs a timing wheel
+         * @param tick Duration of one tick (timer resolution)
+         * @param start Time corresponding to tick 0
+         */
+        explicit TimingWheel(chrono::milliseconds tick = chrono::milliseconds(10),
+                             chrono::steady_clock::time_point start = chrono::steady_clock::now());
+
+        /**
+         * @brief Schedules a timer
+         * @param delay Time until expiry, rounded up to whole ticks
+         * @param callback Function run on expiry
+         * @return Handle used to cancel the timer
+         */
+        TimerId schedule(chrono::milliseconds delay, Callback callback);
+
+        /**
+         * @brief Cancels a pending timer
+         * @param id Handle from schedule()
+         * @return true if the timer was pending, false if it already fired or was cancelled
+         */
+        bool cancel(TimerId id);
+
+        /**
+         * @brief Advances the wheel to the given time and runs every expired timer
+         * @param now Current time
+         * @return Number of timers fired
+         */
+        size_t advance(chrono::steady_clock::time_point now);
+
+        /**
+         * @brief Gets the number of pending timers
+         * @return Pending timer count
+         */
+        size_t pending() const;
+
+    private:
+        static constexpr int LEVELS = 4;               ///< Number of wheel levels
+        static constexpr int SLOT_BITS = 8;            ///< log2 of slots per level
+        static constexpr int SLOTS = 1 << SLOT_BITS;   ///< Slots per level
+        static constexpr uint32_t NIL = UINT32_MAX;    ///< End-of-list marker
+
+        /**
+         * @struct Node
+         * @brief Pooled timer node, linked into a slot list by index
+         */
+        struct Node {
+            uint64_t expiry = 0;       ///< Absolute expiry tick
+            uint32_t prev = NIL;       ///< Previous node in the slot list
+            uint32_t next = NIL;       ///< Next node in the slot list
+            uint32_t generation = 1;   ///< Bumped on release so stale handles are rejected
+            uint16_t slot = 0;         ///< Slot index (level * SLOTS + slot) holding the node
+            bool active = false;       ///< Whether the node is scheduled
+            Callback callback;         ///< Function to run on expiry
+        };
+
+        chrono::milliseconds tickLength;                   ///< Duration of one tick
+        chrono::steady_clock::time_point startTime;        ///< Time of tick 0
+        uint64_t currentTick = 0;                          ///< Last processed tick
+        vector<Node> nodes;                                ///< Timer node pool
+        uint32_t freeHead = NIL;                           ///< Head of the free-node list
+        array<uint32_t, LEVELS * SLOTS> slots;             ///< Head node of each slot list
+        size_t pendingCount = 0;                           ///< Number of scheduled timers
+
+        /**
+         * @brief Links a node into the slot matching its expiry
+         * @param index Node index
+         */
+        void place(uint32_t index);
+
+        /**
+         * @brief Unlinks a node from its slot list
+         * @param index Node index
+         */
+        void unlink(uint32_t index);
+
+        /**
+         * @brief Returns a node to the free list
+         * @param index Node index
+         */
+        void release(uint32_t index);
+
+        /**
+         * @brief Re-places every timer in a higher-level slot
+         * @param level Level of the slot
+         * @param slot Slot index within the level
+         */
+        void cascade(int level, int slot);
+};
+
+#endif // TIMINGWHEEL_H
\ No newline at end of file
@@ -0,0 +1,166 @@
+/**
+ * @file WindowedStats.h
+ * @brief Header file for per-player game counts over the last day, week and season
+ */
+
+#ifndef WINDOWEDSTATS_H
+#define WINDOWEDSTATS_H
+
+#include "MatchHistory.h"
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @enum StatWindow
+ * @brief Rolling time windows the statistics are kept for
+ */
+enum class StatWindow {
+    DAY,        ///< Last 24 hours, in hourly buckets
+    WEEK,       ///< Last 7 days, in daily buckets
+    SEASON      ///< Last 13 weeks, in weekly buckets starting on Monday
+};
+
+/**
+ * @struct WindowTotals
+ * @brief Games and wins of one player within a window
+ */
+struct WindowTotals {
+    string username;    ///< Player name
+    int games = 0;      ///< Games finished in the window
+    int wins = 0;       ///< Games won in the window
+};
+
+/**
+ * @class WindowedStats
+ * @brief Ring-buffered game and win counters of every player, merged per window on query
+ *
+ * Each player has one ring of buckets per window: 24 hours, 7 days and 13
+ * weeks. A game is counted in the bucket of its end time in every ring;
+ * a bucket remembers the period it counts, and one still holding an older
+ * period is cleared when it is reused, so nothing has to expire on a
+ * timer. A query sums the buckets of the last periods of the window, so a
+ * window leaderboard costs one pass over the players and never reads the
+ * game history. Memory per player is fixed at 44 buckets; players with
+ * no game in the last season are dropped when the counters are saved.
+ *
+ * Like Ratings, the counters are a function of the match history and kept
+ * per database: they are saved to <root>/WindowedStats.dat with the
+ * history position they cover, and update() and loading count the games
+ * archived after it.
+ */
+class WindowedStats {
+    public:
+        static const size_t HOURS = 24;             ///< Buckets of the day window
+        static const size_t DAYS = 7;               ///< Buckets of the week window
+        static const size_t WEEKS = 13;             ///< Buckets of the season window
+        static const size_t SAVE_INTERVAL = 64;     ///< Games counted between saves
+
+        /**
+         * @brief Gets the counters of a database, loading them on first use
+         * @param db The database
+         */
+        static WindowedStats& of(DB& db);
+
+        /**
+         * @brief Counts every game archived since the last update
+         * @return Number of games counted
+         */
+        size_t update();
+
+        /**
+         * @brief Gets the totals of one player
+         * @param username Player name
+         * @param window Window to sum
+         * @param now Current time in seconds since the epoch
+         */
+        WindowTotals get(const string& username, StatWindow window, uint64_t now) const;
+
+        /**
+         * @brief Gets the totals of every player who played in a window
+         * @param window Window to sum
+         * @param now Current time in seconds since the epoch
+         * @return One entry per player with at least one game, in no particular order
+         */
+        vector<WindowTotals> totals(StatWindow window, uint64_t now) const;
+
+        /**
+         * @brief Writes the counters and their history position to <root>/WindowedStats.dat
+         * @return true if the file was replaced
+         */
+        bool save();
+
+    private:
+        /**
+         * @struct Bucket
+         * @brief Games of one period
+         */
+        struct Bucket {
+            uint32_t period = 0;    ///< Hour, day or week number since the epoch
+            uint32_t games = 0;     ///< Games finished in the period
+            uint32_t wins = 0;      ///< Games won in the period
+        };
+
+        /**
+         * @struct Counters
+         * @brief Rings of one player
+         */
+        struct Counters {
+            array<Bucket, HOURS> hours;     ///< Day window
+            array<Bucket, DAYS> days;       ///< Week window
+            array<Bucket, WEEKS> weeks;     ///< Season window
+        };
+
+        /**
+         * @brief Loads the saved counters and counts the games archived since they were saved
+         * @param history Match history the counters are computed from
+         * @param path Path of the saved counters
+         */
+        WindowedStats(MatchHistory& history, const string& path);
+
+        WindowedStats(const WindowedStats&) = delete;
+        WindowedStats& operator=(const WindowedStats&) = delete;
+
+        MatchHistory& history;                          ///< Games the counters are computed from
+        const string PATH;                              ///< Path of the saved counters
+        mutable mutex statsMutex;                       ///< Guards the fields below
+        unordered_map<string, Counters> players;        ///< Counters of each player, by name
+        uint64_t window = 0;                            ///< History segment or tail the next game is read from
+        size_t row = 0;                                 ///< Games of that window already counted
+        size_t unsaved = 0;                             ///< Games counted since the last save
+
+        /**
+         * @brief Counts a game in a player's rings; the caller holds the lock
+         */
+        static void recordLocked(Counters& counters, bool won, uint64_t finished);
+
+        /**
+         * @brief Sums a player's buckets of a window; the caller holds the lock
+         */
+        static WindowTotals sum(const Counters& counters, StatWindow window, uint64_t now);
+
+        /**
+         * @brief Counts the games of one history window after the current position; the caller holds the lock
+         * @return Number of games counted
+         */
+        size_t applyLocked(const MatchWindow& matches);
+
+        /**
+         * @brief Reads the saved counters
+         * @return false if there are none or the file is damaged
+         */
+        bool load();
+
+        /**
+         * @brief Drops idle players and writes the counters; the caller holds the lock
+         */
+        bool saveLocked();
+};
+
+#endif // WINDOWEDSTATS_H
\ No newline at end of file
@@ -0,0 +1,259 @@
+/**
+ * @file WriteAheadLog.h
+ * @brief Header file for the WriteAheadLog class that makes data file rewrites crash safe
+ */
+
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class WriteAheadLog
+ * @brief Singleton redo log placed in front of the JSON data files
+ *
+ * A commit appends one record holding the full new content of every file
+ * it writes, makes the record as durable as the configured level requires,
+ * then replaces each file atomically through a temporary file and rename.
+ * Commits are applied in log order. A crash therefore leaves either the old
+ * or the new content, and recover() re-applies every complete record left
+ * in the log. Data files are only synced when the log is truncated, so a
+ * commit costs one log sync at most.
+ *
+ * Record layout:
+ *   "WAL1", u32 file count, u32 checksum, u64 payload length, payload
+ *   payload: per file u32 path length, path, u64 content length, content
+ *
+ * With EVERY_COMMIT, concurrent committers share fsync calls: the first
+ * waiting thread syncs everything appended so far while the others wait
+ * for it, so one fsync covers a whole group of commits. With BATCHED, a
+ * commit that finds the last sync older than the batch interval syncs
+ * itself, and a background thread syncs whatever is left within the
+ * interval, so a record is durable at most one interval after its commit
+ * even when no other commit follows.
+ *
+ * When a sync fails, every record of this process that is not applied yet
+ * is marked as cancelled in place, and every commit waiting for the failed
+ * sync returns false without touching the data files, so recovery skips
+ * them and never replays a commit that was reported as failed. Records of
+ * other processes are left alone.
+ *
+ * Several processes may share one log. Each holds a shared lock on byte 0
+ * of "<log>.lock" while it runs; recovery needs it exclusively, so it only
+ * happens while no other process uses the log. A process also holds a
+ * shared lock on byte 1 while it has records appended but not applied.
+ * Truncation takes that byte exclusively and syncs every file named in the
+ * log first, so any process may truncate once no commit is in flight.
+ */
+class WriteAheadLog {
+    public:
+        /**
+         * @brief How durable a commit is when commit() returns
+         */
+        enum class Durability {
+            NONE,           ///< Log is written but never synced
+            BATCHED,        ///< Log is synced at most once per batch interval
+            EVERY_COMMIT,   ///< Log is synced before commit() returns (group commit)
+        };
+
+        /// Log size after which it is truncated once all commits are applied
+        static constexpr uint64_t CHECKPOINT_BYTES = 4 << 20;
+
+        /**
+         * @brief Gets the singleton instance of the WriteAheadLog
+         * @return Reference to the singleton instance
+         */
+        static WriteAheadLog& getInstance() {
+            static WriteAheadLog instance;
+            return instance;
+        }
+
+        /**
+         * @brief Creates a log that is not open yet
+         * 
+         * getInstance() is the log of the default database; every other DB
+         * instance owns one of its own.
+         */
+        WriteAheadLog() {}
+
+        /**
+         * @brief Stops the sync thread and closes the log file
+         */
+        ~WriteAheadLog();
+
+        // Delete copy constructor and assignment operator
+        WriteAheadLog(const WriteAheadLog&) = delete;
+        WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+        /**
+         * @brief Opens or creates the log file
+         * @param path Path of the log file
+         * @return true if the log is open
+         */
+        bool open(const string& path);
+
+        /**
+         * @brief Re-applies every complete record in the log, then truncates it
+         * @return Number of records applied
+         * 
+         * Skipped unless this process holds the exclusive process lock.
+         * Cancelled records are skipped.
+         */
+        size_t recover();
+
+        /**
+         * @brief Tries to take the exclusive process lock without waiting
+         * @return true if no other process uses the log
+         */
+        bool acquireExclusive();
+
+        /**
+         * @brief Turns the exclusive process lock back into a shared one
+         * 
+         * Other processes waiting in open() continue from here.
+         */
+        void releaseExclusive();
+
+        /**
+         * @brief Logs and applies a full rewrite of one file
+         * @param path File to replace
+         * @param content New content
+         * @return true if the file was written
+         */
+        bool commit(const string& path, const string& content);
+
+        /**
+         * @brief Logs and applies rewrites of several files as one record
+         * @param writes Pairs of path and new content
+         * @return true if every file was written
+         */
+        bool commit(const vector<pair<string, string>>& writes);
+
+        /**
+         * @brief Sets the durability level
+         * @param level New level
+         */
+        void setDurability(Durability level);
+
+        /**
+         * @brief Gets the durability level
+         */
+        Durability getDurability() const;
+
+        /**
+         * @brief Sets the longest time a BATCHED commit stays unsynced
+         * @param interval Batch interval
+         */
+        void setBatchInterval(chrono::milliseconds interval);
+
+        /**
+         * @brief Gets the number of commits
+         */
+        uint64_t commitCount() const;
+
+        /**
+         * @brief Gets the number of log syncs
+         */
+        uint64_t syncCount() const;
+
+    private:
+        mutex logMutex;                     ///< Guards the fields below
+        condition_variable synced;          ///< Signals a completed sync
+        condition_variable applied;         ///< Signals a commit applied to the data files
+        condition_variable unsynced;        ///< Wakes the sync thread
+        int fd = -1;                        ///< Log file descriptor
+        string logPath;                     ///< Path of the log file
+        uint64_t logBytes = 0;              ///< Log size after the last append of this process
+        uint64_t appendedLsn = 0;           ///< Sequence number of the last appended record
+        uint64_t durableLsn = 0;            ///< Sequence number of the last synced record
+        uint64_t failedLsn = 0;             ///< Last record cut from the log after a failed sync
+        bool syncing = false;               ///< Whether a thread is syncing the log
+        bool stopping = false;              ///< Whether the sync thread should exit
+        thread syncer;                      ///< Syncs BATCHED commits within the batch interval
+        uint64_t appliedLsn = 0;            ///< Sequence number of the last applied record
+        map<uint64_t, uint64_t> pendingOffsets; ///< Log offset of each appended record not applied yet
+        chrono::steady_clock::time_point lastSync;
+
+        mutex processMutex;                 ///< Guards the process lock fields
+        int lockFd = -1;                    ///< Descriptor of the process lock file
+        bool exclusive = false;             ///< Whether the process lock is held exclusively
+        atomic<Durability> durability{Durability::EVERY_COMMIT};
+        atomic<long long> batchMillis{10};
+        atomic<uint64_t> commits{0};
+        atomic<uint64_t> syncs{0};
+
+        /**
+         * @brief Waits until a record is synced, syncing the log if no one else is
+         * @param lsn Sequence number of the record
+         * @return true if the sync succeeded
+         */
+        bool waitDurable(uint64_t lsn);
+
+        /**
+         * @brief Takes or drops the shared lock that holds off truncation
+         * @param active Whether this process has records not applied yet
+         *
+         * Must be called with logMutex held.
+         */
+        void setPending(bool active);
+
+        /**
+         * @brief Marks the unsynced records of this process that are not applied yet as cancelled
+         *
+         * Must be called with logMutex held.
+         */
+        void cancelPending();
+
+        /**
+         * @brief Sync thread loop
+         */
+        void syncLoop();
+
+        /**
+         * @brief Syncs the data files and truncates the log once it is large
+         *
+         * Must be called with logMutex held. Skipped while any process has
+         * records not applied yet.
+         */
+        void checkpoint();
+
+        /**
+         * @brief Encodes a record
+         */
+        static string encode(const vector<pair<string, string>>& writes);
+
+        /**
+         * @brief Decodes the complete records at the start of a log
+         * @param log Log bytes
+         * @param latest Receives the last logged content of every file
+         * @return Number of records decoded and the offset where decoding stopped
+         */
+        static pair<size_t, size_t> decode(const string& log, map<string, string>& latest);
+
+        /**
+         * @brief Checksum of a record payload
+         */
+        static uint32_t checksum(const string& data);
+
+        /**
+         * @brief Replaces a file through a temporary file and rename
+         * @param path File to replace
+         * @param content New content
+         * @param sync Whether to sync the temporary file before the rename
+         * @return true if the file was replaced
+         */
+        static bool replaceFile(const string& path, const string& content, bool sync);
+};
+
+#endif // WRITEAHEADLOG_H
\ No newline at end of file
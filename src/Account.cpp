@@ -54,23 +54,24 @@ void Account::setPassword(string pwd) {
 /**
  * @brief Creates a new account in the database
  * @param acc The account to create
- * @return true if account creation was successful, false if account already exists
+ * @param db Database to create the account in
+ * @return true if account creation was successful, false if the username is taken
  */
-bool Account::create(const Account& acc) {
-    if (check(acc)) return false;
-    return DB::getInstance().save(acc);
+bool Account::create(const Account& acc, DB& db) {
+    return db.insert(acc);
 }
 
 /**
  * @brief Checks if an account exists in the database
  * @param acc The account to check
+ * @param db Database to search
  * @return true if account exists, false otherwise
  * 
  * This method loads all accounts from the database and checks if there's
  * a matching username and password combination.
  */
-bool Account::check(const Account& acc) {
-    vector<Account> accList = DB::getInstance().load<Account>();
+bool Account::check(const Account& acc, DB& db) {
+    vector<Account> accList = db.load<Account>();
     if (accList.empty()) {
         return false;
     }
@@ -105,13 +106,14 @@ vector<Account> Account::from_json(const string& json) {
         size_t pos;
 
         // Parse username
-        pos = line.find("username");
-        string username = line.substr(pos + 11); // skip "username":"
+        pos = line.find("\"username\":\"");
+        if (pos == string::npos) continue;
+        string username = line.substr(pos + 12); // skip "username":"
         acc.setUsername(username.substr(0, username.find("\"")));
 
-        // Parse password
-        pos = line.find("password");
-        string password = line.substr(pos + 11); // skip "password":"
+        // Parse password, searched after the username so it cannot match inside it
+        pos = line.find("\"password\":\"", pos + 12 + acc.getUsername().size());
+        string password = pos == string::npos ? "" : line.substr(pos + 12); // skip "password":"
         acc.setPassword(password.substr(0, password.find("\"")));
 
         accounts.push_back(acc);
@@ -0,0 +1,220 @@
+/**
+ * @file BoardProtocol.cpp
+ * @brief Implementation of the compact board synchronisation protocol
+ */
+
+#include "../include/BoardProtocol.h"
+
+#include <bitset>
+
+/**
+ * @brief Encodes a delta update
+ * @param update The update to encode
+ * @return Encoded bytes
+ *
+ * Each player's marked delta is written as a list of cell indices rather
+ * than a raw mask, since a called number marks at most one cell per board.
+ */
+vector<uint8_t> BoardProtocol::encodeUpdate(const BoardUpdate& update) {
+    vector<uint8_t> out;
+    putVarint(out, update.sequence);
+    out.push_back(static_cast<uint8_t>(update.number));
+
+    for (size_t i = 0; i < update.markedDelta.size(); ++i) {
+        uint32_t delta = update.markedDelta[i];
+        out.push_back(static_cast<uint8_t>(bitset<25>(delta).count()));
+        for (uint8_t cell = 0; cell < 25; ++cell) {
+            if (delta & (1u << cell)) out.push_back(cell);
+        }
+        putVarint(out, i < update.newLines.size() ? update.newLines[i] : 0);
+    }
+    return out;
+}
+
+/**
+ * @brief Decodes a delta update
+ * @param data Encoded bytes
+ * @param playerCount Number of players in the game
+ * @param update Output update
+ * @return true if the data was well formed, false otherwise
+ */
+bool BoardProtocol::decodeUpdate(const vector<uint8_t>& data, size_t playerCount, BoardUpdate& update) {
+    size_t pos = 0;
+    BoardUpdate result;
+
+    if (!getVarint(data, pos, result.sequence)) return false;
+    if (pos >= data.size()) return false;
+    result.number = data[pos++];
+    if (result.number < 1 || result.number > 25) return false;
+
+    for (size_t i = 0; i < playerCount; ++i) {
+        if (pos >= data.size()) return false;
+        uint8_t count = data[pos++];
+        if (count > 25 || pos + count > data.size()) return false;
+
+        uint32_t delta = 0;
+        for (uint8_t c = 0; c < count; ++c) {
+            uint8_t cell = data[pos++];
+            if (cell >= 25) return false;
+            delta |= 1u << cell;
+        }
+
+        uint32_t lines;
+        if (!getVarint(data, pos, lines) || lines >= (1u << 12)) return false;
+
+        result.markedDelta.push_back(delta);
+        result.newLines.push_back(static_cast<uint16_t>(lines));
+    }
+
+    if (pos != data.size()) return false;
+    update = result;
+    return true;
+}
+
+/**
+ * @brief Encodes a full snapshot
+ * @param snapshot The snapshot to encode
+ * @return Encoded bytes
+ *
+ * Layout: varint sequence, byte current turn, byte player count, then per
+ * player: byte name length, name, 25 board bytes, varint marked mask.
+ * Cells whose number is unknown (marked cells of a reloaded game) are sent as 0.
+ */
+vector<uint8_t> BoardProtocol::encodeSnapshot(const BoardSnapshot& snapshot) {
+    vector<uint8_t> out;
+    putVarint(out, snapshot.sequence);
+    out.push_back(static_cast<uint8_t>(snapshot.currentTurn));
+    out.push_back(static_cast<uint8_t>(snapshot.usernames.size()));
+
+    for (size_t i = 0; i < snapshot.usernames.size(); ++i) {
+        const string& name = snapshot.usernames[i];
+        size_t length = name.size() > 255 ? 255 : name.size();
+        out.push_back(static_cast<uint8_t>(length));
+        out.insert(out.end(), name.begin(), name.begin() + length);
+
+        for (size_t cell = 0; cell < 25; ++cell) {
+            int value = cell < snapshot.boards[i].size() ? snapshot.boards[i][cell] : 0;
+            out.push_back(static_cast<uint8_t>(value >= 1 && value <= 25 ? value : 0));
+        }
+        putVarint(out, snapshot.marked[i]);
+    }
+    return out;
+}
+
+/**
+ * @brief Decodes a full snapshot
+ * @param data Encoded bytes
+ * @param snapshot Output snapshot, with line masks recomputed from the marks
+ * @return true if the data was well formed, false otherwise
+ */
+bool BoardProtocol::decodeSnapshot(const vector<uint8_t>& data, BoardSnapshot& snapshot) {
+    size_t pos = 0;
+    BoardSnapshot result;
+
+    if (!getVarint(data, pos, result.sequence)) return false;
+    if (pos + 2 > data.size()) return false;
+    result.currentTurn = data[pos++];
+    size_t playerCount = data[pos++];
+    if (playerCount == 0 || static_cast<size_t>(result.currentTurn) >= playerCount) return false;
+
+    for (size_t i = 0; i < playerCount; ++i) {
+        if (pos >= data.size()) return false;
+        size_t length = data[pos++];
+        if (pos + length + 25 > data.size()) return false;
+
+        result.usernames.emplace_back(data.begin() + pos, data.begin() + pos + length);
+        pos += length;
+        result.boards.emplace_back(data.begin() + pos, data.begin() + pos + 25);
+        pos += 25;
+
+        uint32_t marked;
+        if (!getVarint(data, pos, marked) || marked >= (1u << 25)) return false;
+        result.marked.push_back(marked);
+        result.lines.push_back(lineMask(marked));
+    }
+
+    if (pos != data.size()) return false;
+    snapshot = result;
+    return true;
+}
+
+/**
+ * @brief Applies an update to a client mirror
+ * @param state Mirror built from a snapshot and earlier updates
+ * @param update The next update
+ * @return true if applied; false if the sequence is out of order and a resync is needed
+ *
+ * The turn advances after every update unless the update completed a win,
+ * mirroring Game::playTurn.
+ */
+bool BoardProtocol::applyUpdate(BoardSnapshot& state, const BoardUpdate& update) {
+    if (update.sequence != state.sequence + 1) return false;
+    if (update.markedDelta.size() != state.marked.size()) return false;
+
+    bool won = false;
+    for (size_t i = 0; i < state.marked.size(); ++i) {
+        state.marked[i] |= update.markedDelta[i];
+        state.lines[i] |= update.newLines[i];
+        if (bitset<12>(state.lines[i]).count() >= 5) won = true;
+    }
+
+    state.sequence = update.sequence;
+    if (!won) {
+        state.currentTurn = (state.currentTurn + 1) % static_cast<int>(state.marked.size());
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the completed-line mask for a marked-cell mask
+ * @param marked 25-bit marked-cell mask
+ * @return 12-bit line mask: bits 0-4 rows, 5-9 columns, 10 main diagonal, 11 anti-diagonal
+ */
+uint16_t BoardProtocol::lineMask(uint32_t marked) {
+    uint16_t lines = 0;
+
+    for (int i = 0; i < 5; ++i) {
+        uint32_t row = 0x1Fu << (i * 5);
+        uint32_t column = 0x108421u << i;
+        if ((marked & row) == row) lines |= 1u << i;
+        if ((marked & column) == column) lines |= 1u << (5 + i);
+    }
+
+    const uint32_t diagonal = 0x1041041u;      // cells 0, 6, 12, 18, 24
+    const uint32_t antiDiagonal = 0x111110u;   // cells 4, 8, 12, 16, 20
+    if ((marked & diagonal) == diagonal) lines |= 1u << 10;
+    if ((marked & antiDiagonal) == antiDiagonal) lines |= 1u << 11;
+
+    return lines;
+}
+
+/**
+ * @brief Appends an unsigned LEB128 varint
+ * @param out Output buffer
+ * @param value Value to append
+ */
+void BoardProtocol::putVarint(vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief Reads an unsigned LEB128 varint
+ * @param data Input buffer
+ * @param pos Read position, advanced past the varint
+ * @param value Output value
+ * @return false if the data ended early or the value overflowed
+ */
+bool BoardProtocol::getVarint(const vector<uint8_t>& data, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= data.size()) return false;
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
\ No newline at end of file
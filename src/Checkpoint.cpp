@@ -0,0 +1,259 @@
+/**
+ * @file Checkpoint.cpp
+ * @brief Implementation of the Checkpoint class
+ */
+
+#include "../include/Checkpoint.h"
+#include "../include/Crc32c.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    int openFile(const string& path) {
+        return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    int syncFile(int fd) { return _commit(fd); }
+    int closeFile(int fd) { return _close(fd); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return _write(fd, data, static_cast<unsigned int>(length));
+    }
+    int processId() { return _getpid(); }
+
+    /**
+     * @brief Read-only view of a whole file; read into memory on Windows
+     */
+    class MappedFile {
+        public:
+            explicit MappedFile(const string& path) {
+                ifstream in(path, ios::binary);
+                if (in) content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+            }
+            const char* data() const { return content.data(); }
+            size_t size() const { return content.size(); }
+        private:
+            string content;
+    };
+#else
+    int openFile(const string& path) {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    int syncFile(int fd) { return ::fsync(fd); }
+    int closeFile(int fd) { return ::close(fd); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return ::write(fd, data, length);
+    }
+    int processId() { return static_cast<int>(::getpid()); }
+
+    /**
+     * @brief Read-only memory mapping of a whole file
+     */
+    class MappedFile {
+        public:
+            explicit MappedFile(const string& path) {
+                int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) return;
+                struct stat info;
+                if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                    void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (mapped != MAP_FAILED) {
+                        bytes = static_cast<const char*>(mapped);
+                        length = static_cast<size_t>(info.st_size);
+                    }
+                }
+                ::close(fd);
+            }
+            ~MappedFile() {
+                if (bytes) ::munmap(const_cast<char*>(bytes), length);
+            }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            const char* data() const { return bytes; }
+            size_t size() const { return length; }
+        private:
+            const char* bytes = nullptr;
+            size_t length = 0;
+    };
+#endif
+
+    void put32(string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    void put64(string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    uint32_t get32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    uint64_t get64(const char* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+}
+
+/**
+ * @brief Writes an image, replacing the previous one atomically
+ * @param path Image path
+ * @param engine Name of the storage engine the records came from
+ * @param stamps Generation of each account shard
+ * @param shards Parsed players of each shard
+ * @return false if the image could not be written
+ *
+ * The image is built in memory, written to a temporary file, synced and
+ * renamed over the old one, so readers see the old or the new image.
+ */
+bool Checkpoint::write(const string& path, const string& engine, const vector<uint64_t>& stamps,
+                       const vector<shared_ptr<const PlayerPart>>& shards) {
+    if (stamps.size() != shards.size()) return false;
+
+    size_t recordCount = 0;
+    for (const auto& shard : shards) recordCount += shard->size();
+
+    string body;
+    string records;
+    string strings = engine;
+    records.reserve(recordCount * RECORD_BYTES);
+    for (uint64_t stamp : stamps) put64(body, stamp);
+    for (const auto& shard : shards) put32(body, static_cast<uint32_t>(shard->size()));
+    for (const auto& shard : shards) {
+        for (const auto& record : *shard) {
+            const Player& player = *record;
+            const string username = player.getUsername();
+            const string password = player.getPassword();
+            put32(records, static_cast<uint32_t>(strings.size()));
+            put32(records, static_cast<uint32_t>(username.size()));
+            strings += username;
+            put32(records, static_cast<uint32_t>(strings.size()));
+            put32(records, static_cast<uint32_t>(password.size()));
+            strings += password;
+            put32(records, static_cast<uint32_t>(player.getGameCount()));
+            put32(records, static_cast<uint32_t>(player.getWinCount()));
+            put32(records, static_cast<uint32_t>(player.getLoseCount()));
+            put32(records, 0);
+            put64(records, player.getVersion());
+        }
+    }
+    body += records;
+    body += strings;
+
+    string image;
+    image.reserve(HEADER_BYTES + body.size());
+    put32(image, MAGIC);
+    put32(image, FORMAT);
+    put64(image, HEADER_BYTES + body.size());
+    put64(image, Crc32c::compute(body));
+    put32(image, static_cast<uint32_t>(shards.size()));
+    put32(image, static_cast<uint32_t>(recordCount));
+    put32(image, static_cast<uint32_t>(engine.size()));
+    put32(image, 0);
+    put64(image, strings.size());
+    image.resize(HEADER_BYTES, '\0');
+    image += body;
+
+    // One temporary file per process, in case several share the directory
+    string tmpPath = path + "." + to_string(processId()) + ".tmp";
+    int fd = openFile(tmpPath);
+    bool ok = fd >= 0;
+    size_t done = 0;
+    while (ok && done < image.size()) {
+        long long n = writeSome(fd, image.data() + done, image.size() - done);
+        if (n <= 0) ok = false;
+        else done += static_cast<size_t>(n);
+    }
+    ok = ok && syncFile(fd) == 0;
+    if (fd >= 0) closeFile(fd);
+
+    error_code ec;
+    if (ok) filesystem::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps an image and rebuilds the players if it is current
+ * @param path Image path
+ * @param engine Name of the storage engine in use
+ * @param stamps Current generation of each account shard
+ * @param shards Output players of each shard
+ * @return false if the image is missing, stale or damaged
+ *
+ * The cheap checks (size, engine, shard generations) run before the
+ * checksum, so a stale image is rejected without reading all of it.
+ * Every offset is bounds-checked before it is followed.
+ */
+bool Checkpoint::read(const string& path, const string& engine, const vector<uint64_t>& stamps,
+                      vector<vector<Player>>& shards) {
+    MappedFile file(path);
+    const char* data = file.data();
+    size_t size = file.size();
+    if (!data || size < HEADER_BYTES) return false;
+    if (get32(data) != MAGIC || get32(data + 4) != FORMAT || get64(data + 8) != size) return false;
+
+    uint64_t shardCount = get32(data + 24);
+    uint64_t recordCount = get32(data + 28);
+    uint64_t engineLength = get32(data + 32);
+    uint64_t stringBytes = get64(data + 40);
+    if (shardCount != stamps.size()) return false;
+
+    const uint64_t stampsAt = HEADER_BYTES;
+    const uint64_t countsAt = stampsAt + 8 * shardCount;
+    const uint64_t recordsAt = countsAt + 4 * shardCount;
+    const uint64_t stringsAt = recordsAt + RECORD_BYTES * recordCount;
+    if (stringsAt > size || size - stringsAt != stringBytes || engineLength > stringBytes) return false;
+
+    const char* strings = data + stringsAt;
+    if (engine.compare(0, string::npos, strings, engineLength) != 0) return false;
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        if (get64(data + stampsAt + 8 * shard) != stamps[shard]) return false;
+    }
+    if (get64(data + 16) != Crc32c::compute(data + HEADER_BYTES, size - HEADER_BYTES)) return false;
+
+    vector<vector<Player>> players(shardCount);
+    const char* record = data + recordsAt;
+    uint64_t remaining = recordCount;
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        uint64_t count = get32(data + countsAt + 4 * shard);
+        if (count > remaining) return false;
+        remaining -= count;
+        players[shard].reserve(count);
+        for (uint64_t i = 0; i < count; ++i, record += RECORD_BYTES) {
+            uint64_t nameAt = get32(record), nameLength = get32(record + 4);
+            uint64_t passwordAt = get32(record + 8), passwordLength = get32(record + 12);
+            if (nameAt + nameLength > stringBytes || passwordAt + passwordLength > stringBytes) return false;
+
+            Player player(string(strings + nameAt, nameLength), string(strings + passwordAt, passwordLength));
+            player.setGameCount(static_cast<int>(get32(record + 16)));
+            player.setWinCount(static_cast<int>(get32(record + 20)));
+            player.setLoseCount(static_cast<int>(get32(record + 24)));
+            player.setVersion(get64(record + 32));
+            players[shard].push_back(move(player));
+        }
+    }
+    if (remaining != 0) return false;
+
+    shards = move(players);
+    return true;
+}
\ No newline at end of file
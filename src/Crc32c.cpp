@@ -0,0 +1,135 @@
+/**
+ * @file Crc32c.cpp
+ * @brief Implementation of the Crc32c class
+ */
+
+#include "../include/Crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+    /// Reflected CRC32C polynomial
+    const uint32_t POLYNOMIAL = 0x82F63B78u;
+
+    /**
+     * @brief Lookup tables for slicing by 8: table[k][b] is the CRC of byte b followed by k zero bytes
+     */
+    struct Tables {
+        uint32_t table[8][256];
+
+        Tables() {
+            for (uint32_t b = 0; b < 256; ++b) {
+                uint32_t crc = b;
+                for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+                table[0][b] = crc;
+            }
+            for (uint32_t b = 0; b < 256; ++b) {
+                for (int k = 1; k < 8; ++k) table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+            }
+        }
+    };
+
+    const Tables& tables() {
+        static const Tables instance;
+        return instance;
+    }
+
+    /**
+     * @brief Software CRC over the raw (uninverted) state
+     */
+    uint32_t software(uint32_t crc, const unsigned char* p, size_t length) {
+        const auto& t = tables().table;
+        while (length >= 8) {
+            uint32_t low, high;
+            memcpy(&low, p, 4);
+            memcpy(&high, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            low = __builtin_bswap32(low);
+            high = __builtin_bswap32(high);
+#endif
+            low ^= crc;
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                  t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+            p += 8;
+            length -= 8;
+        }
+        while (length-- > 0) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+        return crc;
+    }
+
+#ifdef CRC32C_X86
+    /**
+     * @brief CRC with the SSE4.2 crc32 instruction, 8 bytes per step
+     */
+#ifndef _MSC_VER
+    __attribute__((target("sse4.2")))
+#endif
+    uint32_t hardware(uint32_t crc, const unsigned char* p, size_t length) {
+        uint64_t state = crc;
+        while (length >= 8) {
+            uint64_t word;
+            memcpy(&word, p, 8);
+            state = _mm_crc32_u64(state, word);
+            p += 8;
+            length -= 8;
+        }
+        uint32_t crc32 = static_cast<uint32_t>(state);
+        while (length-- > 0) crc32 = _mm_crc32_u8(crc32, *p++);
+        return crc32;
+    }
+
+    bool cpuHasSse42() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    }
+#endif
+
+    using Implementation = uint32_t (*)(uint32_t, const unsigned char*, size_t);
+
+    /**
+     * @brief Picks the implementation once, on first use
+     */
+    Implementation implementation() {
+#ifdef CRC32C_X86
+        static const Implementation chosen = cpuHasSse42() ? hardware : software;
+#else
+        static const Implementation chosen = software;
+#endif
+        return chosen;
+    }
+}
+
+/**
+ * @brief Continues a checksum over more bytes
+ * @param crc Checksum of the bytes before
+ * @param data Following bytes
+ * @param length Number of bytes
+ * @return Checksum of the bytes before and these together
+ */
+uint32_t Crc32c::extend(uint32_t crc, const char* data, size_t length) {
+    return ~implementation()(~crc, reinterpret_cast<const unsigned char*>(data), length);
+}
+
+/**
+ * @brief Checks whether the hardware instruction is used
+ */
+bool Crc32c::hardwareAccelerated() {
+#ifdef CRC32C_X86
+    return implementation() == hardware;
+#else
+    return false;
+#endif
+}
\ No newline at end of file
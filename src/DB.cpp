@@ -1,60 +1,346 @@
 /**
  * @file DB.cpp
- * @brief Implementation of the DB class initialization method
+ * @brief Implementation of the DB class initialization, engine selection and transactions
  */
 
 #include "../include/DB.h"
 #include "../include/Logger.h"
 #include "../include/Account.h"
+#include "../include/Checkpoint.h"
+#include "../include/FileEngine.h"
+#include "../include/LsmEngine.h"
+#include "../include/MemoryEngine.h"
 
 #include <iostream>
-#include <filesystem>
+
+/**
+ * @brief Creates a database stored under its own directory
+ * @param root Data directory
+ * @param logger Logger receiving the database's messages
+ * @param engine Storage engine to use
+ */
+DB::DB(const string& root, Logger& logger, Engine engine) : DB(root, logger, nullptr, engine) {}
+
+/**
+ * @brief Creates a database, sharing a write-ahead log if one is given
+ * @param root Data directory
+ * @param logger Logger receiving the database's messages
+ * @param sharedLog Log for the file engine, or null to own a new one
+ * @param engine Storage engine to use
+ */
+DB::DB(const string& root, Logger& logger, WriteAheadLog* sharedLog, Engine engine)
+    : DATADIR(root),
+      logger(logger),
+      CHECKPOINT(engine == Engine::MEMORY ? "" : root + "/Checkpoint.bin") {
+    if (engine == Engine::MEMORY) {
+        this->engine = make_unique<MemoryEngine>(DEFAULT_SHARDS);
+    } else if (engine == Engine::LSM) {
+        // The durability level is configured on the shared log; the LSM store keeps a log of its own
+        auto lsm = make_unique<LsmEngine>(root + "/lsm", logger, DEFAULT_SHARDS);
+        if (sharedLog) lsm->setDurability(sharedLog->getDurability());
+        this->engine = move(lsm);
+    } else {
+        this->engine = make_unique<FileEngine>(root, logger, sharedLog, DEFAULT_SHARDS);
+    }
+}
 
 /**
  * @brief Initializes the database system
  * 
- * This method performs the following initialization steps:
- * 1. Checks if the data directory exists, creates it if it doesn't
- * 2. Creates Account.json file with empty array if it doesn't exist
- * 3. Creates Game.json file with empty array if it doesn't exist
- * 
- * All operations are logged using the Logger system.
+ * Opens the storage engine. All operations are logged using the Logger
+ * system.
  */
 void DB::init() {
-    LOG_INFO("Database checking...");
-    // Check and create data directory
-    if (!filesystem::exists(DATADIR)) {
-        try {
-            LOG_INFO("Data directory creating...");
-            filesystem::create_directories(DATADIR);
-            LOG_INFO("Data directory created!");
-        } catch (const filesystem::filesystem_error& e) {
-            LOG_ERROR("Error creating data directory: " + string(e.what()));
-        }
+    logger.info("Database checking...");
+    if (!engine->open()) {
+        logger.error("Error opening " + engine->name() + " storage");
+        return;
     }
-    else {
-        LOG_INFO("Data directory exists!");
+    logger.info("Storage engine: " + engine->name() + ", " + to_string(engine->shardCount()) + " shards");
+}
+
+/**
+ * @brief Redistributes every record over a new number of shard files
+ * @param newCount New shard count
+ * @return true if the data was rewritten
+ */
+bool DB::reshard(size_t newCount) {
+    FileEngine* files = dynamic_cast<FileEngine*>(engine.get());
+    if (!files) {
+        logger.error("Resharding needs the file engine");
+        return false;
     }
+    if (!files->reshard(newCount)) return false;
+    invalidateSnapshots();
+    return true;
+}
 
-    // Initialize Account.json if it doesn't exist
-    if (!filesystem::exists(ACCOUNTDATA)) {
-        try {
-            ofstream file(ACCOUNTDATA);
-            file << "[]";
-            file.close();
-        } catch (const exception& e) {
-            LOG_ERROR("Error creating Account.json: " + string(e.what()));
-        }
+/**
+ * @brief Writes the parsed player table as a checkpoint image
+ * @param force Write even if the last checkpoint is recent
+ * @return false if an image was due but could not be written
+ * 
+ * The shard parts and their generations are copied under the publish
+ * lock, so the image matches the shards it claims to; the file is then
+ * written without holding any lock readers or writers need. The publish
+ * lock is released before the checkpoint lock is taken, since snapshot
+ * builders take them in the other order.
+ */
+bool DB::checkpoint(bool force) {
+    if (CHECKPOINT.empty()) return true;
+
+    vector<shared_ptr<const Part<Player>>> shards;
+    vector<uint64_t> stamps;
+    {
+        lock_guard<mutex> publishLock(playerSnapshots.publishMutex);
+        if (playerSnapshots.shards.size() != shardCount()) return true;
+        shards = playerSnapshots.shards;
+        stamps = playerSnapshots.stamps;
+    }
+
+    lock_guard<mutex> lock(checkpointMutex);
+    if (!force && steadyMillis() - checkpointedAt < CHECKPOINT_INTERVAL_MILLIS) return true;
+    checkpointedAt = steadyMillis();
+    if (stamps == checkpointStamps) return true;
+
+    if (!Checkpoint::write(CHECKPOINT, engine->name(), stamps, shards)) {
+        logger.error("Failed to write checkpoint " + CHECKPOINT);
+        return false;
+    }
+    checkpointStamps = stamps;
+    return true;
+}
+
+/**
+ * @brief Loads the parsed players from the checkpoint image
+ * @param stamps Current generation of each account shard
+ * @param shards Output players of each shard
+ * @return false if the image is missing or stale
+ */
+template<>
+bool DB::restoreCheckpoint<Player>(const vector<uint64_t>& stamps, vector<vector<Player>>& shards) {
+    if (CHECKPOINT.empty() || !Checkpoint::read(CHECKPOINT, engine->name(), stamps, shards)) return false;
+    lock_guard<mutex> lock(checkpointMutex);
+    checkpointStamps = stamps;
+    logger.info("Player records loaded from checkpoint " + CHECKPOINT);
+    return true;
+}
+
+/**
+ * @brief Gets the lock of a shard within the process
+ * @param table "Account" or "Game"
+ * @param shard Shard index
+ * @return Reference to the shard's mutex
+ */
+mutex& DB::shardLock(const string& table, size_t shard) {
+    lock_guard<mutex> lock(lockTableMutex);
+    unique_ptr<mutex>& entry = shardLocks[table + "." + to_string(shard)];
+    if (!entry) entry = make_unique<mutex>();
+    return *entry;
+}
+
+/**
+ * @brief Takes the lock file of a shard, recording the wait
+ * @param table "Account" or "Game"
+ * @param shard Shard index
+ * @param mode Shared for reads, exclusive for writes
+ * @return The held lock, or no lock if the engine is private to this process
+ */
+FileLock DB::lockFile(const string& table, size_t shard, FileLock::Mode mode) {
+    string path = engine->lockPath(table, shard);
+    if (path.empty()) return FileLock();
+
+    auto start = chrono::steady_clock::now();
+    FileLock lock(path, mode);
+    lockWaitHistogram.record(chrono::steady_clock::now() - start);
+    return lock;
+}
+
+/**
+ * @brief Publishes snapshots after a commit
+ * @param batch Writes that were applied
+ * 
+ * Writes to an account shard are applied to that shard's part of the
+ * player snapshot only: the part's record pointers are copied and each
+ * written record is replaced or inserted at its place in key order, found
+ * by binary search. The combined snapshot is dropped and recombined from
+ * the parts by its next reader. Nothing is published before the first read has built
+ * the parts. Writes to a game shard drop the game parts. Either way the
+ * type's sequence is bumped, so a rebuild racing the commit is not kept.
+ * Publishing never fails the commit: if a written record cannot be parsed,
+ * the player parts are dropped and the next reader rebuilds them.
+ */
+void DB::publish(const WriteBatch& batch) {
+    const string accounts = baseName<Account>();
+    map<size_t, vector<const WriteBatch::Operation*>> accountShards;
+    bool gamesChanged = false;
+    for (const auto& op : batch.operations) {
+        if (op.table == accounts) accountShards[shardOf(op.key)].push_back(&op);
+        else gamesChanged = true;
     }
 
-    // Initialize Game.json if it doesn't exist
-    if (!filesystem::exists(GAMEDATA)) {
+    if (!accountShards.empty()) {
+        lock_guard<mutex> lock(playerSnapshots.publishMutex);
+        playerSnapshots.sequence++;
+        atomic_store(&playerSnapshots.combined, shared_ptr<const vector<Player>>());
         try {
-            ofstream file(GAMEDATA);
-            file << "[]";
-            file.close();
+            for (const auto& [shard, ops] : accountShards) {
+                if (playerSnapshots.shards.size() != shardCount()) break;
+                Part<Player> players = *playerSnapshots.shards[shard];
+                for (const WriteBatch::Operation* op : ops) {
+                    auto it = players.begin() + (lowerBound(players, op->key) - players.cbegin());
+                    bool stored = it != players.end() && (*it)->getUsername() == op->key;
+                    if (!op->value) {
+                        if (stored) players.erase(it);
+                        playerRanks.erase(op->key);
+                        continue;
+                    }
+                    vector<Player> parsed = Player::from_json("[" + *op->value + "]");
+                    if (parsed.empty()) continue;
+                    auto player = make_shared<const Player>(move(parsed.front()));
+                    playerRanks.update(*player);
+                    if (stored) *it = move(player);
+                    else players.insert(it, move(player));
+                }
+                playerSnapshots.shards[shard] = make_shared<const Part<Player>>(move(players));
+                playerSnapshots.stamps[shard] = engine->generation(accounts, shard);
+            }
         } catch (const exception& e) {
-            LOG_ERROR("Error creating Game.json: " + string(e.what()));
+            // The batch is committed; let the next reader rebuild the parts from storage
+            logger.error("Error publishing player snapshot: " + string(e.what()));
+            playerSnapshots.shards.clear();
+            playerSnapshots.stamps.clear();
         }
     }
-}
\ No newline at end of file
+
+    if (gamesChanged) {
+        lock_guard<mutex> lock(gameSnapshots.publishMutex);
+        gameSnapshots.shards.clear();
+        gameSnapshots.stamps.clear();
+        gameSnapshots.sequence++;
+        atomic_store(&gameSnapshots.combined, shared_ptr<const vector<Game>>());
+    }
+}
+
+/**
+ * @brief Drops every published snapshot
+ */
+void DB::invalidateSnapshots() {
+    {
+        lock_guard<mutex> lock(playerSnapshots.publishMutex);
+        playerSnapshots.shards.clear();
+        playerSnapshots.stamps.clear();
+        playerSnapshots.sequence++;
+        atomic_store(&playerSnapshots.combined, shared_ptr<const vector<Player>>());
+    }
+    lock_guard<mutex> lock(gameSnapshots.publishMutex);
+    gameSnapshots.shards.clear();
+    gameSnapshots.stamps.clear();
+    gameSnapshots.sequence++;
+    atomic_store(&gameSnapshots.combined, shared_ptr<const vector<Game>>());
+}
+
+#pragma region Transaction
+
+/**
+ * @brief Reads the current JSON of a record
+ * @param table "Account" or "Game"
+ * @param key Record key
+ * @param value Output record JSON
+ * @return true if the record exists, counting staged writes
+ */
+bool DB::Transaction::get(const string& table, const string& key, string& value) {
+    lock(table, db.shardOf(key));
+    for (auto it = batch.operations.rbegin(); it != batch.operations.rend(); ++it) {
+        if (it->table != table || it->key != key) continue;
+        if (!it->value) return false;
+        value = *it->value;
+        return true;
+    }
+    return db.engine->get(table, key, value);
+}
+
+/**
+ * @brief Stages an insert or replacement of a record
+ * @param table "Account" or "Game"
+ * @param key Record key
+ * @param value Record JSON
+ */
+void DB::Transaction::put(const string& table, const string& key, const string& value) {
+    lock(table, db.shardOf(key));
+    batch.put(table, key, value);
+}
+
+/**
+ * @brief Stages a delete of a record
+ * @param table "Account" or "Game"
+ * @param key Record key
+ */
+void DB::Transaction::remove(const string& table, const string& key) {
+    lock(table, db.shardOf(key));
+    batch.remove(table, key);
+}
+
+/**
+ * @brief Locks every shard of a table, in ascending order
+ * @param table "Account" or "Game"
+ */
+void DB::Transaction::lockTable(const string& table) {
+    for (size_t shard = 0; shard < db.shardCount(); ++shard) {
+        lock(table, shard);
+    }
+}
+
+/**
+ * @brief Applies every staged write as one batch and releases the locks
+ * @return true if the batch was applied
+ *
+ * The file engine writes the batch as one log record before replacing any
+ * file, so a crash leaves either none or all of the writes once the log is
+ * replayed.
+ */
+bool DB::Transaction::commit() {
+    bool ok = batch.empty() || db.engine->apply(batch);
+    if (!ok) {
+        db.logger.error("Failed to commit transaction");
+    }
+    else if (!batch.empty()) {
+        // Publish new snapshots while the shard locks are still held
+        db.publish(batch);
+    }
+    rollback();
+    return ok;
+}
+
+/**
+ * @brief Discards every staged write and releases the locks
+ */
+void DB::Transaction::rollback() {
+    batch.operations.clear();
+    processLocks.clear();
+    locks.clear();
+    lockedShards.clear();
+}
+
+/**
+ * @brief Locks a shard the first time the transaction touches it
+ * @param table "Account" or "Game"
+ * @param shard Shard index
+ *
+ * The lock within the process is taken first, so threads of one process
+ * queue on a mutex and only one of them waits on the lock file.
+ */
+void DB::Transaction::lock(const string& table, size_t shard) {
+    string name = table + "." + to_string(shard);
+    for (const string& locked : lockedShards) {
+        if (locked == name) return;
+    }
+    auto start = chrono::steady_clock::now();
+    locks.emplace_back(db.shardLock(table, shard));
+    string path = db.engine->lockPath(table, shard);
+    if (!path.empty()) processLocks.push_back(FileLock(path, FileLock::Mode::EXCLUSIVE));
+    db.lockWaitHistogram.record(chrono::steady_clock::now() - start);
+    lockedShards.push_back(name);
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,570 @@
+/**
+ * @file FileEngine.cpp
+ * @brief Implementation of the sharded JSON file storage engine
+ */
+
+#include "../include/FileEngine.h"
+#include "../include/Crc32c.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#include <future>
+#include <map>
+#include <unordered_map>
+
+/**
+ * @brief Creates an engine over a data directory
+ * @param root Data directory
+ * @param logger Logger receiving the engine's messages
+ * @param sharedLog Write-ahead log to use, or null to own a new one
+ * @param defaultShards Shard count of a new data directory
+ */
+FileEngine::FileEngine(const string& root, Logger& logger, WriteAheadLog* sharedLog, size_t defaultShards)
+    : DATADIR(root),
+      ACCOUNTDATA(root + "/Account.json"),
+      GAMEDATA(root + "/Game.json"),
+      SHARDDATA(root + "/Shards.json"),
+      WALDATA(root + "/wal.log"),
+      QUARANTINEDIR(root + "/quarantine"),
+      logger(logger),
+      ownedLog(sharedLog ? nullptr : make_unique<WriteAheadLog>()),
+      wal(sharedLog ? *sharedLog : *ownedLog),
+      shards(defaultShards) {}
+
+/**
+ * @brief Creates the data directory and the shard files
+ * @return true if the directory can be used
+ *
+ * This method performs the following steps:
+ * 1. Checks if the data directory exists, creates it if it doesn't
+ * 2. Opens the write-ahead log and replays commits left by a crash
+ * 3. Reads the shard count from Shards.json, or creates it; data files
+ *    from before sharding are split into shards at this point
+ * 4. Removes shard files beyond the shard count and creates every
+ *    missing one without records
+ *
+ * Steps 2 to 4 run while this process holds the log exclusively, so a second
+ * process started meanwhile waits for them in WriteAheadLog::open().
+ */
+bool FileEngine::open() {
+    // Check and create data directory
+    if (!filesystem::exists(DATADIR)) {
+        try {
+            logger.info("Data directory creating...");
+            filesystem::create_directories(DATADIR);
+            logger.info("Data directory created!");
+        } catch (const filesystem::filesystem_error& e) {
+            logger.error("Error creating data directory: " + string(e.what()));
+            return false;
+        }
+    }
+    else {
+        logger.info("Data directory exists!");
+    }
+
+    // Replay the write-ahead log before anything reads the data files
+    if (wal.open(WALDATA)) {
+        wal.recover();
+    }
+
+    // Read the shard count, or lay out a new data directory
+    string content = readFile(SHARDDATA);
+    size_t pos = content.find("\"count\":");
+    if (pos != string::npos) {
+        shards = max<size_t>(1, stoul(content.substr(pos + 8)));
+        logger.info("Data split into " + to_string(shards) + " shards");
+    }
+    else if (filesystem::exists(ACCOUNTDATA) || filesystem::exists(GAMEDATA)) {
+        logger.info("Splitting data files into shards...");
+        if (!redistribute({{ACCOUNTDATA}, {GAMEDATA}}, shards)) {
+            logger.error("Error splitting data files into shards");
+        }
+    }
+    else if (!wal.commit(SHARDDATA, "{\"count\":" + to_string(shards) + "}")) {
+        logger.error("Error creating Shards.json");
+    }
+
+    // Replaying the log can bring back files an earlier reshard removed
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(DATADIR, ec)) {
+        string file = entry.path().filename().string();
+        for (const string& table : TABLES) {
+            if (file.rfind(table + ".", 0) != 0 || file.size() < table.size() + 7 ||
+                file.compare(file.size() - 5, 5, ".json") != 0) continue;
+            string index = file.substr(table.size() + 1, file.size() - table.size() - 6);
+            if (index.empty() || index.find_first_not_of("0123456789") != string::npos) continue;
+            if (stoul(index) >= shards) {
+                filesystem::remove(entry.path(), ec);
+                filesystem::remove(entry.path().string() + ".lock", ec);
+            }
+        }
+    }
+
+    // Initialize missing shard files
+    bool ok = true;
+    for (size_t shard = 0; shard < shards; ++shard) {
+        for (const string& table : TABLES) {
+            string path = shardPath(table, shard);
+            if (!filesystem::exists(path) && !wal.commit(path, frameRecords({}, nextGeneration(0)))) {
+                logger.error("Error creating " + path);
+                ok = false;
+            }
+        }
+    }
+
+    // Let other processes waiting on the data directory start
+    wal.releaseExclusive();
+    return ok;
+}
+
+/**
+ * @brief Gets a stamp that changes whenever a shard is written
+ * @param table Table name
+ * @param shard Shard index
+ * @return Generation in the shard file's header line, 0 if it is missing
+ *
+ * Only the header line is read.
+ */
+uint64_t FileEngine::generation(const string& table, size_t shard) {
+    return readGeneration(shardPath(table, shard));
+}
+
+/**
+ * @brief Reads one record
+ * @param table Table name
+ * @param key Record key
+ * @param value Output record JSON
+ * @return true if the record exists
+ *
+ * Only the key's shard file is read.
+ */
+bool FileEngine::get(const string& table, const string& key, string& value) {
+    string recordKey;
+    for (string& record : readRecords(shardPath(table, shardOf(key, shards)))) {
+        if (keyOf(table, record, recordKey) && recordKey == key) {
+            value = move(record);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reads every record of a table
+ * @param table Table name
+ * @return Pairs of key and record JSON, in shard and file order
+ *
+ * The shard files are read in parallel.
+ */
+vector<pair<string, string>> FileEngine::scan(const string& table) {
+    auto readShard = [this, &table](size_t shard) {
+        return scanShard(table, shard);
+    };
+    if (shards == 1) return readShard(0);
+
+    vector<future<vector<pair<string, string>>>> parts;
+    for (size_t shard = 0; shard < shards; ++shard) {
+        parts.push_back(async(launch::async, readShard, shard));
+    }
+
+    vector<pair<string, string>> results;
+    for (auto& part : parts) {
+        vector<pair<string, string>> records = part.get();
+        results.insert(results.end(), make_move_iterator(records.begin()), make_move_iterator(records.end()));
+    }
+    return results;
+}
+
+/**
+ * @brief Reads the records of one shard file
+ * @param table Table name
+ * @param shard Shard index
+ * @return Pairs of key and record JSON, in file order
+ */
+vector<pair<string, string>> FileEngine::scanShard(const string& table, size_t shard) {
+    vector<pair<string, string>> records;
+    string path = shardPath(table, shard);
+    string key;
+    for (string& record : readRecords(path)) {
+        if (keyOf(table, record, key)) records.emplace_back(key, move(record));
+        else logger.error("Record without key skipped in " + path);
+    }
+    return records;
+}
+
+/**
+ * @brief Applies every operation of a batch as one log record
+ * @param batch Changes to apply
+ * @return true if every touched shard file was rewritten
+ *
+ * Each touched shard file is read once, its records replaced, appended or
+ * dropped in place, and the new content of every file committed together,
+ * so a crash leaves either none or all of the batch once the log is
+ * replayed.
+ */
+bool FileEngine::apply(const WriteBatch& batch) {
+    map<pair<string, size_t>, vector<const WriteBatch::Operation*>> touched;
+    for (const auto& op : batch.operations) {
+        touched[{op.table, shardOf(op.key, shards)}].push_back(&op);
+    }
+
+    vector<pair<string, string>> writes;
+    for (const auto& [shard, ops] : touched) {
+        string path = shardPath(shard.first, shard.second);
+        uint64_t current = 0;
+        vector<string> records = readRecords(path, &current);
+        unordered_map<string, size_t> positions;
+        string key;
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (keyOf(shard.first, records[i], key)) positions.emplace(key, i);
+        }
+
+        for (const WriteBatch::Operation* op : ops) {
+            auto it = positions.find(op->key);
+            if (!op->value) {
+                if (it == positions.end()) continue;
+                records[it->second].clear();
+                positions.erase(it);
+            }
+            else if (it != positions.end()) {
+                records[it->second] = *op->value;
+            }
+            else {
+                positions.emplace(op->key, records.size());
+                records.push_back(*op->value);
+            }
+        }
+
+        writes.emplace_back(path, frameRecords(records, nextGeneration(current)));
+    }
+
+    if (!writes.empty() && !wal.commit(writes)) {
+        logger.error("Failed to commit " + to_string(writes.size()) + " shard files");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Redistributes every record over a new number of shard files
+ * @param newCount New shard count
+ * @return true if the data was rewritten
+ */
+bool FileEngine::reshard(size_t newCount) {
+    if (newCount == 0) {
+        logger.error("Shard count must be positive");
+        return false;
+    }
+    if (!wal.acquireExclusive()) {
+        logger.error("Cannot reshard while another process uses the data directory");
+        return false;
+    }
+
+    vector<vector<string>> sources(TABLES.size());
+    for (size_t table = 0; table < TABLES.size(); ++table) {
+        for (size_t shard = 0; shard < shards; ++shard) {
+            sources[table].push_back(shardPath(TABLES[table], shard));
+        }
+    }
+    bool ok = redistribute(sources, newCount);
+    wal.releaseExclusive();
+    return ok;
+}
+
+/**
+ * @brief Rewrites the records of the given source files into shard files
+ * @param sources Files holding the records of each table, in TABLES order
+ * @param newCount New shard count
+ * @return true if the data was rewritten
+ *
+ * Records are moved as raw JSON, so nothing is lost to a parse/serialise
+ * round trip. Every new shard file and the manifest go into one log record;
+ * source files that are not part of the new layout are removed afterwards.
+ */
+bool FileEngine::redistribute(const vector<vector<string>>& sources, size_t newCount) {
+    vector<pair<string, string>> writes;
+    for (size_t table = 0; table < TABLES.size(); ++table) {
+        vector<vector<string>> buckets(newCount);
+        string key;
+        for (const string& source : sources[table]) {
+            for (string& record : readRecords(source)) {
+                if (!keyOf(TABLES[table], record, key)) {
+                    logger.error("Record without key skipped in " + source);
+                    continue;
+                }
+                buckets[shardOf(key, newCount)].push_back(move(record));
+            }
+        }
+        for (size_t shard = 0; shard < newCount; ++shard) {
+            string path = shardPath(TABLES[table], shard);
+            writes.emplace_back(path, frameRecords(buckets[shard], nextGeneration(readGeneration(path))));
+        }
+    }
+    writes.emplace_back(SHARDDATA, "{\"count\":" + to_string(newCount) + "}");
+
+    if (!wal.commit(writes)) {
+        logger.error("Failed to write " + to_string(newCount) + " shards");
+        return false;
+    }
+    shards = newCount;
+
+    // Remove source files the new layout no longer uses
+    for (const auto& tableSources : sources) {
+        for (const string& source : tableSources) {
+            bool kept = false;
+            for (const auto& write : writes) kept = kept || write.first == source;
+            error_code ec;
+            if (!kept) {
+                filesystem::remove(source, ec);
+                filesystem::remove(source + ".lock", ec);
+            }
+        }
+    }
+
+    logger.info("Data redistributed into " + to_string(newCount) + " shards");
+    return true;
+}
+
+/**
+ * @brief Splits a JSON array of objects into one string per object
+ * @param json Content of a data file
+ * @return Trimmed JSON object strings, in file order
+ */
+vector<string> FileEngine::splitRecords(const string& json) {
+    vector<string> records;
+    size_t start = json.find('[');
+    size_t end = json.find_last_of(']');
+    if (start == string::npos || end == string::npos) return records;
+
+    string gamesStr = json.substr(start + 1, end - start - 1);
+    int braceCount = 0;
+    string currentGame;
+
+    for (size_t i = 0; i < gamesStr.length(); ++i) {
+        char c = gamesStr[i];
+        if (c == '{') {
+            braceCount++;
+            currentGame += c;
+        }
+        else if (c == '}') {
+            braceCount--;
+            currentGame += c;
+            if (braceCount == 0 && !currentGame.empty()) {
+                // Remove leading and trailing whitespace
+                while (!currentGame.empty() && isspace(currentGame.front())) {
+                    currentGame.erase(0, 1);
+                }
+                while (!currentGame.empty() && isspace(currentGame.back())) {
+                    currentGame.pop_back();
+                }
+                if (!currentGame.empty()) {
+                    records.push_back(currentGame);
+                }
+                currentGame.clear();
+            }
+        }
+        else if (braceCount > 0) {
+            currentGame += c;
+        }
+    }
+    return records;
+}
+
+/**
+ * @brief Builds the content of a framed shard file
+ * @param records Record JSON strings, empty ones skipped
+ * @param generation Generation written to the header line
+ * @return Header line followed by one checksummed frame per record
+ */
+string FileEngine::frameRecords(const vector<string>& records, uint64_t generation) {
+    size_t bytes = FRAME_MAGIC.size() + 22;
+    for (const string& record : records) bytes += record.size() + 32;
+
+    string content;
+    content.reserve(bytes);
+    content += FRAME_MAGIC + " " + to_string(generation) + "\n";
+    char header[32];
+    for (const string& record : records) {
+        if (record.empty()) continue;
+        snprintf(header, sizeof(header), "%zu %08x\n", record.size(), static_cast<unsigned>(Crc32c::compute(record)));
+        content += header;
+        content += record;
+        content += '\n';
+    }
+    return content;
+}
+
+/**
+ * @brief Parses the header line of a framed shard file
+ * @param content Content of the file, or at least its first line
+ * @param body Output offset of the first frame
+ * @param generation Output generation, 0 if the header has none
+ * @return false if the content is not framed
+ *
+ * Files framed before generations were added have FRAME_MAGIC alone on
+ * the line; they count as generation 0 until their next write.
+ */
+bool FileEngine::parseHeader(const string& content, size_t& body, uint64_t& generation) {
+    if (content.compare(0, FRAME_MAGIC.size(), FRAME_MAGIC) != 0) return false;
+    size_t lineEnd = content.find('\n', FRAME_MAGIC.size());
+    if (lineEnd == string::npos) return false;
+
+    generation = 0;
+    size_t pos = FRAME_MAGIC.size();
+    if (pos < lineEnd) {
+        if (content[pos] != ' ' || pos + 1 == lineEnd) return false;
+        for (++pos; pos < lineEnd; ++pos) {
+            if (!isdigit(static_cast<unsigned char>(content[pos]))) return false;
+            generation = generation * 10 + (content[pos] - '0');
+        }
+    }
+    body = lineEnd + 1;
+    return true;
+}
+
+/**
+ * @brief Reads the generation of a shard file from its header line
+ * @param path File path
+ * @return Generation, 0 if the file is missing or has none
+ */
+uint64_t FileEngine::readGeneration(const string& path) {
+    ifstream inFile(path, ios::binary);
+    string line;
+    if (!getline(inFile, line)) return 0;
+    line += '\n';
+    size_t body = 0;
+    uint64_t generation = 0;
+    return parseHeader(line, body, generation) ? generation : 0;
+}
+
+/**
+ * @brief Gets the generation of the next version of a file
+ * @param current Generation of the current version
+ * @return current + 1, or the time in microseconds since the epoch if later
+ *
+ * Starting from the clock keeps a file removed by a reshard and created
+ * again from reusing a generation an old reader may still hold.
+ */
+uint64_t FileEngine::nextGeneration(uint64_t current) {
+    uint64_t now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    return max(current + 1, now);
+}
+
+/**
+ * @brief Reads the records of a shard or legacy data file
+ * @param path File path
+ * @param generation Output generation of the file, if not null
+ * @return Record JSON strings whose checksum matched, in file order
+ *
+ * Frames are found by their length. When a frame is damaged, reading
+ * goes on line by line until the next intact frame, and everything
+ * skipped is quarantined as one piece. A file without a framed header
+ * is read as a JSON array, unchecked, and has generation 0.
+ */
+vector<string> FileEngine::readRecords(const string& path, uint64_t* generation) {
+    string content = readFile(path);
+    size_t pos = 0;
+    uint64_t version = 0;
+    bool headed = parseHeader(content, pos, version);
+    if (generation) *generation = version;
+    if (!headed) return splitRecords(content);
+
+    vector<string> records;
+    size_t damaged = string::npos;
+    while (pos < content.size()) {
+        size_t lineEnd = content.find('\n', pos);
+        if (lineEnd == string::npos) lineEnd = content.size();
+
+        // "<length> <crc>": decimal length, one space, eight hex digits
+        size_t space = lineEnd >= pos + 10 ? lineEnd - 9 : pos;
+        bool framed = space > pos && space - pos <= 12 && content[space] == ' ' && lineEnd < content.size();
+        size_t length = 0;
+        uint32_t crc = 0;
+        for (size_t i = pos; framed && i < space; ++i) {
+            framed = isdigit(static_cast<unsigned char>(content[i])) != 0;
+            length = length * 10 + (content[i] - '0');
+        }
+        for (size_t i = space + 1; framed && i < lineEnd; ++i) {
+            char c = content[i];
+            framed = isxdigit(static_cast<unsigned char>(c)) != 0;
+            crc = (crc << 4) | static_cast<uint32_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        if (framed) {
+            size_t body = lineEnd + 1;
+            framed = length < content.size() - body && content[body + length] == '\n' &&
+                     Crc32c::compute(content.data() + body, length) == crc;
+            if (framed) {
+                if (damaged != string::npos) {
+                    quarantine(path, version, damaged, content.substr(damaged, pos - damaged));
+                    damaged = string::npos;
+                }
+                records.emplace_back(content, body, length);
+                pos = body + length + 1;
+                continue;
+            }
+        }
+        if (damaged == string::npos) damaged = pos;
+        pos = lineEnd + 1;
+    }
+    if (damaged != string::npos) quarantine(path, version, damaged, content.substr(damaged));
+    return records;
+}
+
+/**
+ * @brief Copies corrupt bytes of a data file to the quarantine directory
+ * @param path Data file
+ * @param generation Generation of the file
+ * @param offset Offset of the bytes in the file
+ * @param bytes Corrupt bytes
+ *
+ * Each damaged range is quarantined once per version of the file, however
+ * often the shard is read before its next write drops it.
+ */
+void FileEngine::quarantine(const string& path, uint64_t generation, size_t offset, const string& bytes) {
+    error_code ec;
+    string id = path + "@" + to_string(generation) + ":" + to_string(offset);
+
+    lock_guard<mutex> lock(quarantineMutex);
+    if (!quarantined.insert(id).second) return;
+
+    string name = filesystem::path(path).filename().string();
+    filesystem::create_directories(QUARANTINEDIR, ec);
+    ofstream out(QUARANTINEDIR + "/" + name + ".bad", ios::binary | ios::app);
+    time_t now = time(nullptr);
+    out << "# offset " << offset << ", " << bytes.size() << " bytes, quarantined " << ctime(&now) << bytes << "\n";
+    logger.error("Corrupt record in " + path + " at offset " + to_string(offset) + " quarantined to " + QUARANTINEDIR);
+}
+
+/**
+ * @brief Reads a whole file
+ * @param path File path
+ * @return Content, empty if the file is missing
+ */
+string FileEngine::readFile(const string& path) {
+    ifstream inFile(path, ios::binary);
+    return string((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Finds the key of a raw record
+ * @param table Table the record belongs to
+ * @param record Record JSON
+ * @param key Output key
+ * @return false if the record has no key field
+ *
+ * Accounts are keyed by "username" and games by "ID"; the first occurrence
+ * of the field is the record's own, since both are written first.
+ */
+bool FileEngine::keyOf(const string& table, const string& record, string& key) {
+    string marker = table == "Game" ? "\"ID\":\"" : "\"username\":\"";
+    size_t start = record.find(marker);
+    if (start == string::npos) return false;
+    start += marker.size();
+    size_t end = record.find('"', start);
+    if (end == string::npos) return false;
+    key = record.substr(start, end - start);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+/**
+ * @file FileLock.cpp
+ * @brief Implementation of the FileLock class
+ */
+
+#include "../include/FileLock.h"
+#include "../include/Logger.h"
+
+#include <cerrno>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    int openLockFile(const string& path) {
+        return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    bool lockFile(int fd, bool exclusive, bool wait) {
+        OVERLAPPED overlapped = {};
+        HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+        return LockFileEx(handle, flags, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+    }
+    bool lockBusy() { return GetLastError() == ERROR_LOCK_VIOLATION; }
+    void closeLockFile(int fd) { _close(fd); }
+#else
+    int openLockFile(const string& path) {
+        return ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    // flock locks belong to the open file, so threads of one process conflict too
+    bool lockFile(int fd, bool exclusive, bool wait) {
+        int result;
+        do {
+            result = ::flock(fd, (exclusive ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB));
+        } while (result != 0 && errno == EINTR);
+        return result == 0;
+    }
+    bool lockBusy() { return errno == EWOULDBLOCK; }
+    void closeLockFile(int fd) { ::close(fd); }
+#endif
+}
+
+/**
+ * @brief Takes a lock
+ * @param path Lock file path
+ * @param mode Lock mode
+ * @param wait Whether to wait for a conflicting lock to be released
+ */
+FileLock::FileLock(const string& path, Mode mode, bool wait) {
+    int handle = openLockFile(path);
+    if (handle < 0) {
+        LOG_ERROR("Failed to open lock file: " + path);
+        return;
+    }
+    if (!lockFile(handle, mode == Mode::EXCLUSIVE, wait)) {
+        // Without waiting, a lock held elsewhere is an expected outcome
+        if (wait || !lockBusy()) LOG_ERROR("Failed to lock file: " + path);
+        closeLockFile(handle);
+        return;
+    }
+    fd = handle;
+}
+
+/**
+ * @brief Releases the lock
+ */
+FileLock::~FileLock() {
+    unlock();
+}
+
+/**
+ * @brief Takes over the lock of another object
+ * @param other Object to move from, left holding no lock
+ */
+FileLock::FileLock(FileLock&& other) noexcept : fd(exchange(other.fd, -1)) {}
+
+/**
+ * @brief Releases the current lock and takes over the lock of another object
+ * @param other Object to move from, left holding no lock
+ * @return Reference to this object
+ */
+FileLock& FileLock::operator=(FileLock&& other) noexcept {
+    if (this != &other) {
+        unlock();
+        fd = exchange(other.fd, -1);
+    }
+    return *this;
+}
+
+/**
+ * @brief Releases the lock early
+ * 
+ * Closing the lock file releases the lock.
+ */
+void FileLock::unlock() {
+    if (fd >= 0) {
+        closeLockFile(fd);
+        fd = -1;
+    }
+}
\ No newline at end of file
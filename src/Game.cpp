@@ -7,21 +7,43 @@
 #include "../include/Player.h"
 #include "../include/DB.h"
 #include "../include/Util.h"
+#include "../include/GameLog.h"
+#include "../include/Replay.h"
+#include "../include/MatchHistory.h"
+#include "../include/Ratings.h"
+#include "../include/WindowedStats.h"
+#include "../include/Persistence.h"
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <mutex>
+#include <random>
+#include <unordered_map>
 
 using namespace std;
 
+namespace {
+    mutex noticeMutex;          ///< Guards notices
+    vector<string> notices;     ///< Status lines not yet shown
+}
+
+/**
+ * @brief Constructs a Game object bound to the default database
+ * @param empty If true, creates an empty game without generating ID
+ */
+Game::Game(bool empty) : Game(DB::getInstance(), empty) {}
+
 /**
  * @brief Constructs a Game object
+ * @param db Database the game is saved to
  * @param empty If true, creates an empty game without generating ID
  */
-Game::Game(bool empty) : currentTurn(0), isOver(false), winner(nullptr) {
+Game::Game(DB& db, bool empty) : winnerIndex(-1), currentTurn(0), isOver(false), database(&db) {
     if (!empty) {
         gameId = generateGameId();
     }
@@ -40,9 +62,12 @@ string Game::getGameId() const {
 /**
  * @brief Gets the winner of the game
  * @return Pointer to winning player, nullptr if no winner
+ *
+ * The winner is kept as an index so the pointer stays valid in copies.
  */
 Player* Game::getWinner() const { 
-    return winner; 
+    if (winnerIndex < 0) return nullptr;
+    return const_cast<Player*>(&players[winnerIndex]); 
 }
 
 /**
@@ -53,6 +78,14 @@ const vector<Player>& Game::getPlayers() const {
     return players; 
 }
 
+/**
+ * @brief Gets the seed the players' boards were generated from
+ * @return Board seed
+ */
+uint32_t Game::getSeed() const {
+    return seed;
+}
+
 /**
  * @brief Gets the current turn number
  * @return String representation of current turn
@@ -78,7 +111,10 @@ void Game::setGameId(const string& gameId) {
  * @param player Pointer to the winning player
  */
 void Game::setWinner(Player* player) { 
-    winner = player; 
+    winnerIndex = -1;
+    for (size_t i = 0; i < players.size(); ++i) {
+        if (&players[i] == player) winnerIndex = static_cast<int>(i);
+    }
 }
 
 #pragma endregion
@@ -92,247 +128,145 @@ bool Game::isGameOver() const {
 }
 
 /**
- * @brief Saves the current game state to storage
- * 
- * This method saves the current game state to a JSON file. It handles:
- * - Reading existing game data
- * - Updating or adding new game state
- * - Writing back to file
+ * @brief Converts the game state to a JSON string
+ * @return JSON object with ID, players, current turn, winner and every board
  */
-void Game::save() {
-    // Read existing game data
-    ifstream inFile("../data/Game.json");
-    string jsonContent;
-    string line;
-    while (getline(inFile, line)) {
-        jsonContent += line;
-    }
-    inFile.close();
-
-    // Parse existing games
-    vector<string> existingGames;
-    size_t start = jsonContent.find('[');
-    size_t end = jsonContent.find_last_of(']');
-    if (start != string::npos && end != string::npos) {
-        string gamesStr = jsonContent.substr(start + 1, end - start - 1);
-        size_t pos = 0;
-        int braceCount = 0;
-        string currentGame;
-        
-        for (size_t i = 0; i < gamesStr.length(); ++i) {
-            char c = gamesStr[i];
-            if (c == '{') {
-                braceCount++;
-                currentGame += c;
-            }
-            else if (c == '}') {
-                braceCount--;
-                currentGame += c;
-                if (braceCount == 0 && !currentGame.empty()) {
-                    // Remove leading and trailing whitespace
-                    while (!currentGame.empty() && isspace(currentGame.front())) {
-                        currentGame.erase(0, 1);
-                    }
-                    while (!currentGame.empty() && isspace(currentGame.back())) {
-                        currentGame.pop_back();
-                    }
-                    if (!currentGame.empty()) {
-                        existingGames.push_back(currentGame);
-                    }
-                    currentGame.clear();
-                }
-            }
-            else if (braceCount > 0) {
-                currentGame += c;
-            }
-        }
-    }
+string Game::to_json() const {
+    string state = "{";
+    state += "\"ID\":\"" + getGameId() + "\",";
 
-    // Create new game state JSON
-    string newGameState = "{";
-    newGameState += "\"ID\":\"" + getGameId() + "\",";
-    
     // Add players array
-    newGameState += "\"Players\":[";
+    state += "\"Players\":[";
     for (size_t i = 0; i < players.size(); ++i) {
-        newGameState += "\"" + players[i].getUsername() + "\"";
-        if (i < players.size() - 1) newGameState += ",";
+        state += "\"" + players[i].getUsername() + "\"";
+        if (i < players.size() - 1) state += ",";
     }
-    newGameState += "],";
+    state += "],";
 
     // Add Current turn player index
-    newGameState += "\"CurrentTurn\":" + to_string(currentTurn) + ",";
+    state += "\"CurrentTurn\":" + to_string(currentTurn) + ",";
 
     // Add winner
-    newGameState += "\"Winner\":\"" + (winner ? winner->getUsername() : "") + "\",";
+    state += "\"Winner\":\"" + (getWinner() ? getWinner()->getUsername() : "") + "\",";
 
     // Add game status
-    newGameState += "\"Status\":[{";
+    state += "\"Status\":[{";
     for (size_t i = 0; i < players.size(); ++i) {
         const auto& player = players[i];
-        if (i > 0) newGameState += ",";
-        newGameState += "\"" + player.getUsername() + "\":" + player.getBoardState();
-    }
-    newGameState += "}]}";
-
-    // Update or add the game state
-    bool roomFound = false;
-    string finalJson = "[";
-    for (size_t i = 0; i < existingGames.size(); ++i) {
-        if (!existingGames[i].empty()) {  // Only process non-empty game data
-            if (existingGames[i].find("\"ID\":\"" + getGameId() + "\"") != string::npos) {
-                if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-                finalJson += newGameState;
-                roomFound = true;
-            } else {
-                if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-                finalJson += existingGames[i];
-            }
-        }
-    }
-    
-    if (!roomFound) {
-        if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-        finalJson += newGameState;
-    }
-    finalJson += "]";
-
-    // Write back to file
-    ofstream outFile("../data/Game.json");
-    if (outFile.is_open()) {
-        outFile << finalJson;
-        outFile.close();
-        cout << "Game saved successfully in room: " << getGameId() << "\n";
-    } else {
-        cout << "Error: Could not save game state.\n";
+        if (i > 0) state += ",";
+        state += "\"" + player.getUsername() + "\":" + player.getBoardState();
     }
+    state += "}]}";
+    return state;
 }
 
 /**
- * @brief Saves multiple games to storage
- * @param games Vector of games to save
- * 
- * Similar to save(), but handles multiple games at once
+ * @brief Replaces or adds game states and drops removed games
+ * @param states Pairs of game ID and game state JSON
+ * @param removals IDs of games to drop
+ * @return true if the changes were written, false otherwise
+ *
+ * The changes are applied in one DB transaction, which holds the lock of
+ * every shard it touches so rooms evicted from several threads cannot
+ * overwrite each other's saves. Shards are visited in ascending order.
  */
-void Game::save(vector<Game>& games) {
-    // Read existing game data
-    ifstream inFile("../data/Game.json");
-    string jsonContent;
-    string line;
-    while (getline(inFile, line)) {
-        jsonContent += line;
-    }
-    inFile.close();
-
-    // Parse existing games
-    vector<string> existingGames;
-    size_t start = jsonContent.find('[');
-    size_t end = jsonContent.find_last_of(']');
-    if (start != string::npos && end != string::npos) {
-        string gamesStr = jsonContent.substr(start + 1, end - start - 1);
-        size_t pos = 0;
-        int braceCount = 0;
-        string currentGame;
-        
-        for (size_t i = 0; i < gamesStr.length(); ++i) {
-            char c = gamesStr[i];
-            if (c == '{') {
-                braceCount++;
-                currentGame += c;
-            }
-            else if (c == '}') {
-                braceCount--;
-                currentGame += c;
-                if (braceCount == 0 && !currentGame.empty()) {
-                    // Remove leading and trailing whitespace
-                    while (!currentGame.empty() && isspace(currentGame.front())) {
-                        currentGame.erase(0, 1);
-                    }
-                    while (!currentGame.empty() && isspace(currentGame.back())) {
-                        currentGame.pop_back();
-                    }
-                    if (!currentGame.empty()) {
-                        existingGames.push_back(currentGame);
-                    }
-                    currentGame.clear();
-                }
-            }
-            else if (braceCount > 0) {
-                currentGame += c;
-            }
-        }
+bool Game::storeStates(DB& db, const vector<pair<string, string>>& states, const vector<string>& removals) {
+    map<size_t, pair<vector<const pair<string, string>*>, vector<string>>> shards;
+    for (const auto& state : states) shards[db.shardOf(state.first)].first.push_back(&state);
+    for (const string& gameId : removals) shards[db.shardOf(gameId)].second.push_back(gameId);
+
+    DB::Transaction txn = db.begin();
+    for (const auto& [shard, changes] : shards) {
+        for (const string& gameId : changes.second) txn.remove<Game>(gameId);
+        for (const auto* state : changes.first) txn.put<Game>(state->first, state->second);
+    }
+    if (!txn.commit()) {
+        db.getLogger().error("Failed to write game shards");
+        return false;
     }
+    return true;
+}
 
-    // Create new game state JSON
-    string newGameState;
+/**
+ * @brief Writes the current game state to storage without console output
+ * @return true if the state was written, false otherwise
+ */
+bool Game::persist() const {
+    return storeStates(*database, {{getGameId(), to_json()}});
+}
 
-    for (Game& game : games) {
-        if (games.begin()->generateGameId() == game.getGameId()) {
-            newGameState += "{";
-        }
-        else{
-            newGameState += ",{";
-        }
-        newGameState += "\"ID\":\"" + game.getGameId() + "\",";
-        
-        // Add players array
-        newGameState += "\"Players\":[";
-        for (size_t i = 0; i < game.getPlayers().size(); ++i) {
-            newGameState += "\"" + game.getPlayers()[i].getUsername() + "\"";
-            if (i < game.getPlayers().size() - 1) newGameState += ",";
-        }
+/**
+ * @brief Saves the current game state to storage
+ * 
+ * The state is handed to the persistence service, which updates the
+ * existing record of this game or adds a new one in the background. The
+ * player does not wait for it: the outcome is posted as a notice for the
+ * next menu.
+ */
+void Game::save() {
+    string gameId = getGameId();
+    Persistence::of(*database).saveGame(*this, [gameId](bool written) {
+        postNotice(written ? "Game saved successfully in room: " + gameId
+                           : "Failed to save game in room: " + gameId + "; see the log");
+    });
+    cout << "Saving game in room: " << gameId << "\n";
+}
 
-        newGameState += "],";
+/**
+ * @brief Queues a status line for the next menu
+ * @param notice Line to show
+ */
+void Game::postNotice(const string& notice) {
+    lock_guard<mutex> lock(noticeMutex);
+    notices.push_back(notice);
+}
 
-        // Add Current turn player index
-        newGameState += "\"CurrentTurn\":" + game.getCurrentTurn() + ",";
+/**
+ * @brief Takes the status lines posted since the last call
+ * @return Notices about saves written in the background, oldest first
+ */
+vector<string> Game::takeNotices() {
+    lock_guard<mutex> lock(noticeMutex);
+    vector<string> taken;
+    swap(taken, notices);
+    return taken;
+}
 
-        // Add winner
-        newGameState += "\"Winner\":\"" + (game.getWinner() ? game.getWinner()->getUsername() : "") + "\",";
+/**
+ * @brief Saves multiple games to storage
+ * @param games Vector of games to save
+ * 
+ * Similar to save(), but handles multiple games at once. The games are
+ * written to the database of the first one.
+ */
+void Game::save(vector<Game>& games) {
+    if (games.empty()) return;
 
-        // Add game status
-        newGameState += "\"Status\":[{";
-        for (size_t i = 0; i < players.size(); ++i) {
-            const auto& player = players[i];
-            if (i > 0) newGameState += ",";
-            newGameState += "\"" + player.getUsername() + "\":" + player.getBoardState();
-        }
-        newGameState += "}]}";
-    }
-
-    // Update or add the game state
-    bool roomFound = false;
-    string finalJson = "[";
-    for (size_t i = 0; i < existingGames.size(); ++i) {
-        if (!existingGames[i].empty()) {  // Only process non-empty game data
-            if (existingGames[i].find("\"ID\":\"" + getGameId() + "\"") != string::npos) {
-                if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-                finalJson += newGameState;
-                roomFound = true;
-            } else {
-                if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-                finalJson += existingGames[i];
-            }
-        }
+    vector<pair<string, string>> states;
+    for (const Game& game : games) {
+        states.emplace_back(game.getGameId(), game.to_json());
     }
-    
-    if (!roomFound) {
-        if (finalJson.length() > 1) finalJson += ",";  // Add comma only when needed
-        finalJson += newGameState;
-    }
-    finalJson += "]";
-
-    // Write back to file
-    ofstream outFile("../data/Game.json");
-    if (outFile.is_open()) {
-        outFile << finalJson;
-        outFile.close();
-        // cout << "Game saved successfully in room: " << getGameId() << "\n";
-    } else {
+
+    if (!storeStates(*games.front().database, states)) {
         cout << "Error: Could not save game state.\n";
     }
 }
 
+/**
+ * @brief Loads a single saved game by ID
+ * @param gameId ID of the game to load
+ * @param game Output game
+ * @return true if the game was found, false otherwise
+ *
+ * Only the matching record is read and parsed, rather than every saved game.
+ */
+bool Game::loadById(const string& gameId, Game& game) {
+    optional<Game> found = game.database->find<Game>(gameId);
+    if (!found) return false;
+    game = *found;
+    return true;
+}
+
 /**
  * @brief Checks if the game state is saved
  * @return true if game is saved, false otherwise
@@ -344,27 +278,27 @@ bool Game::isGameSaved() const {
 /**
  * @brief Handles cleanup when exiting a game room
  * 
- * If the game is not over, prompts the user to save the game state
+ * Every move is already in the game log, so leaving an unfinished game
+ * only refreshes its entry in the saved-game list and checkpoints the log.
  */
 void Game::cleanupRoom() {
     if (!isOver) {
-        char saveChoice;
-        cout << "Do you want to save the game state? (Y/N): ";
-        cin >> saveChoice;
-        if (toupper(saveChoice) == 'Y') {
-            save();
-            isSaved = true;
-            cout << "Game saved successfully in room: " << getGameId() << "\n";
-        }
+        GameLog::checkpoint(*this);
+        save();
+        isSaved = true;
     }
 }
 
 /**
  * @brief Displays list of saved games for given players
- * @param allSavedGames Vector of all saved games
+ * @param allSavedGames Vector of all saved games, narrowed to the games listed
  * @param p1 First player
  * @param p2 Second player
  * @return true if saved games exist for players, false otherwise
+ *
+ * Evicted hosted rooms and games that lost a player, whose account no
+ * longer exists, are skipped. The listed numbers index the narrowed
+ * vector.
  */
 bool Game::displaySavedGames(vector<Game>& allSavedGames, Player& p1, Player& p2) {
     if (allSavedGames.empty()) {
@@ -376,12 +310,14 @@ bool Game::displaySavedGames(vector<Game>& allSavedGames, Player& p1, Player& p2
     vector<Game> savedGames;
 
     for (Game& game : allSavedGames) {
+        if (game.getGameId().compare(0, ROOM_PREFIX.size(), ROOM_PREFIX) == 0 || game.getPlayers().size() < 2) continue;
         if (game.getPlayers()[0].getUsername() == p1.getUsername() && game.getPlayers()[1].getUsername() == p2.getUsername()) {
             savedGames.push_back(game);
         }
     }
+    allSavedGames = move(savedGames);
 
-    if (savedGames.empty()) {
+    if (allSavedGames.empty()) {
         cout << "\nNo saved games found.\n";
         Util::waitEnter();
         return false;
@@ -392,11 +328,11 @@ bool Game::displaySavedGames(vector<Game>& allSavedGames, Player& p1, Player& p2
     cout << left << setw(10) << "Number" << setw(20) << "Game ID" << endl;
     cout << string(50, '-') << endl;
     
-    for (size_t i = 0; i < savedGames.size(); ++i) {
-        cout << left << setw(10) << (i + 1) << setw(20) << savedGames[i].getGameId() << endl;
+    for (size_t i = 0; i < allSavedGames.size(); ++i) {
+        cout << left << setw(10) << (i + 1) << setw(20) << allSavedGames[i].getGameId() << endl;
     }
     cout << string(50, '=') << endl;
-    cout << "\nPlease enter the Number (1-" << savedGames.size() << ") to select a game." << endl;
+    cout << "\nPlease enter the Number (1-" << allSavedGames.size() << ") to select a game." << endl;
     return true;
 }
 
@@ -404,23 +340,54 @@ bool Game::displaySavedGames(vector<Game>& allSavedGames, Player& p1, Player& p2
  * @brief Starts a new game with given players
  * @param ps Vector of pointers to players
  * 
- * Initializes the game board for each player and sets up initial game state
+ * Initializes the game board for each player and sets up initial game state.
+ * The game is listed as saved and its log is started right away, so every
+ * move afterwards is autosaved by a single append.
  */
 void Game::startGame(vector<Player*> ps) {
+    initPlayers(ps);
+    persist();
+    logged = GameLog::start(*this);
+
+    cout << "Game started between " << players[0].getUsername()
+        << " and " << players[1].getUsername() << ".\n\n";
+
+    cout << players[currentTurn].getUsername() << "'s board:\n";
+    players[currentTurn].displayBoard();
+}
+
+/**
+ * @brief Sets up players and fresh boards without any console output
+ * @param ps Vector of pointers to players
+ * @param gameSeed Board seed; 0 picks a random one
+ *
+ * Used directly by hosted rooms, where no terminal is attached. Boards
+ * are derived from one game seed so the game log can rebuild them.
+ */
+void Game::initPlayers(vector<Player*> ps, uint32_t gameSeed) {
+    thread_local mt19937 seedEngine(random_device{}());
+    while (gameSeed == 0) {
+        gameSeed = static_cast<uint32_t>(seedEngine());
+    }
+    seed = gameSeed;
 
     for (const Player* p : ps) {
         players.push_back(*p);
-        players.back().generateBoard();
+        players.back().generateBoard(boardSeed(seed, players.size() - 1));
     }
 
     currentTurn = 0;
     isOver = false;
+}
 
-    cout << "Game started between " << players[0].getUsername()
-        << " and " << players[1].getUsername() << ".\n\n";
-
-    cout << players[currentTurn].getUsername() << "'s board:\n";
-    players[currentTurn].displayBoard();
+/**
+ * @brief Derives the board seed of one player from the game seed
+ * @param gameSeed Seed of the game
+ * @param playerIndex Index of the player
+ * @return Seed passed to Player::generateBoard
+ */
+uint32_t Game::boardSeed(uint32_t gameSeed, size_t playerIndex) {
+    return gameSeed + static_cast<uint32_t>(playerIndex) * 0x9E3779B9u;
 }
 
 /**
@@ -480,76 +447,28 @@ void Game::playTurn() {
         return;
     }
 
-    bool numberMarked = false;
-    for (auto& player : players) {
-        if (player.markNumber(number)) {
-            numberMarked = true;
-        }
-    }
-
-    if (numberMarked) {
-        usedNumbers.insert(number);
+    callNumber(number);
+    if (getWinner() == nullptr) {
+        advanceTurn();
     }
+    GameLog::appendCall(*this, number);
 
     system("cls");
     cout << currentPlayer.getUsername() << "'s board after marking " << number << ":\n";
     currentPlayer.displayBoard();
 
-    bool gameWon = false;
-
-    for (auto& player : players) {
-        if (player.checkWin()) {
-            gameWon = true;
-            setWinner(&player);
-            break;
-        }
-    }
-
-    if (gameWon && getWinner() != nullptr) {
+    if (getWinner() != nullptr) {
         cout << "\n" << getWinner()->getUsername() << " wins!\n";
         isOver = true;
-
-        for (auto& player : players) {
-            player.updateStats(player.getUsername() == getWinner()->getUsername());
-        }
-
-        vector<Player> allSavedPlayers = DB::getInstance().load<Player>();
-
-        allSavedPlayers.erase(
-            remove_if(allSavedPlayers.begin(), allSavedPlayers.end(),
-                [this](const Player& savedPlayer) {
-                    return any_of(players.begin(), players.end(),
-                        [&savedPlayer](const Player& currentPlayer) {
-                            return savedPlayer.getUsername() == currentPlayer.getUsername();
-                        });
-                }),
-            allSavedPlayers.end()
-        );
+        finish(true);
 
         cout << "\nFinal boards:\n";
         for (const auto& player : players) {
-            allSavedPlayers.push_back(player);
             cout << "\n" << player.getUsername() << "'s board:\n";
             player.displayBoard();
         }
-        
-        DB::getInstance().reset<Player>();
-        for (Player& player : allSavedPlayers) {
-            DB::getInstance().save(player);
-        }
 
-        vector<Game> savedGames = DB::getInstance().load<Game>();
-
-        savedGames.erase(
-            remove_if(savedGames.begin(), savedGames.end(),
-                [this](const Game& game) {
-                    return game.getGameId() == getGameId();
-                }),
-            savedGames.end()
-        );
-        DB::getInstance().reset<Game>();
-        Game::save(savedGames);
-        cout << "Player data updated...";
+        cout << "Saving player data...";
         cin.ignore();
         cin.get();
         return;
@@ -564,12 +483,196 @@ void Game::playTurn() {
     cin.ignore();
     cin.get();
 
-    currentTurn = (currentTurn + 1) % players.size();
     cout << players[currentTurn].getUsername() << "'s turn.\n";
     cout << "Your board:\n";
     players[currentTurn].displayBoard();
 }
 
+/**
+ * @brief Calls a number for all players without any console interaction
+ * @param number The number to call (1-25)
+ * @return true if the number was valid and not yet used, false otherwise
+ *
+ * This method:
+ * - Marks the number on every player's board
+ * - Records the newly marked cells and completed lines as the last update
+ * - Sets the winner to the first player with five or more lines and ends the game
+ */
+bool Game::callNumber(int number) {
+    if (isOver || number < 1 || number > 25) return false;
+    if (usedNumbers.find(number) != usedNumbers.end()) return false;
+
+    BoardUpdate update;
+    update.sequence = ++sequence;
+    update.number = number;
+
+    bool numberMarked = false;
+    for (auto& player : players) {
+        uint32_t markedBefore = player.getMarkedMask();
+        uint16_t linesBefore = player.getLineMask();
+        if (player.markNumber(number)) {
+            numberMarked = true;
+        }
+        update.markedDelta.push_back(player.getMarkedMask() & ~markedBefore);
+        update.newLines.push_back(player.getLineMask() & ~linesBefore);
+    }
+
+    if (numberMarked) {
+        usedNumbers.insert(number);
+    }
+    lastUpdate = update;
+
+    for (auto& player : players) {
+        if (player.checkWin()) {
+            setWinner(&player);
+            isOver = true;
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Estimates the heap and object memory held by the game
+ * @return Approximate size in bytes
+ *
+ * Counts the game object, each player with its board rows, the called
+ * numbers (one tree node each) and the last update. Used by the room
+ * cache to keep resident rooms within its memory budget.
+ */
+size_t Game::memoryFootprint() const {
+    const size_t setNodeBytes = 48;
+    size_t bytes = sizeof(Game) + gameId.capacity();
+
+    for (const Player& player : players) {
+        bytes += sizeof(Player) + player.getUsername().capacity() + player.getPassword().capacity();
+        bytes += 5 * (sizeof(vector<int>) + 5 * sizeof(int));      // board rows
+        bytes += 5 * (sizeof(vector<bool>) + sizeof(unsigned long)); // marked rows
+    }
+
+    bytes += usedNumbers.size() * setNodeBytes;
+    bytes += lastUpdate.markedDelta.capacity() * sizeof(uint32_t);
+    bytes += lastUpdate.newLines.capacity() * sizeof(uint16_t);
+    return bytes;
+}
+
+/**
+ * @brief Passes the turn to the next player without calling a number
+ *
+ * The skip is appended to the game's log, if it has one.
+ */
+void Game::skipTurn() {
+    if (isOver || players.empty()) return;
+    advanceTurn();
+    if (logged) GameLog::appendSkip(*this);
+}
+
+/**
+ * @brief Ends the game with the current player forfeiting
+ *
+ * The next player in turn order is recorded as the winner. The forfeit is
+ * appended to the game's log, if it has one, and the result is recorded
+ * like that of a won game, without waiting for it to be written: hosted
+ * rooms forfeit while their shard is locked.
+ */
+void Game::forfeit() {
+    if (isOver || players.size() < 2) return;
+    endByForfeit();
+    if (logged) GameLog::appendForfeit(*this);
+    finish(false);
+}
+
+/**
+ * @brief Passes the turn to the next player without logging it
+ *
+ * Also used when a call did not end the game and when a log is replayed.
+ */
+void Game::advanceTurn() {
+    if (isOver || players.empty()) return;
+    currentTurn = (currentTurn + 1) % players.size();
+}
+
+/**
+ * @brief Records the next player as the winner without logging it
+ */
+void Game::endByForfeit() {
+    if (isOver || players.size() < 2) return;
+    setWinner(&players[(currentTurn + 1) % players.size()]);
+    isOver = true;
+}
+
+/**
+ * @brief Records the result of the finished game
+ * @param report If true, posts a notice once the result is written or given up
+ *
+ * Statistics and save removal commit together; the replay and the match
+ * history are written from the move log before the log is dropped, and the
+ * new game is rated and counted from the history. A game without a log
+ * only has its statistics recorded.
+ */
+void Game::finish(bool report) {
+    const Player* winner = getWinner();
+    if (!winner) return;
+    for (auto& player : players) {
+        player.updateStats(player.getUsername() == winner->getUsername());
+    }
+
+    string finishedId = getGameId();
+    string winnerName = winner->getUsername();
+    Persistence& persistence = Persistence::of(*database);
+    DB* db = database;
+    bool hasLog = logged;
+    persistence.finishGame(players, winnerName, finishedId, [db, finishedId, winnerName, hasLog] {
+        if (!hasLog) return;
+        GameHistory history;
+        if (GameLog::readHistory(*db, finishedId, history)) {
+            ReplayArchive::write(*db, finishedId, history);
+            if (MatchHistory::of(*db).append(history, winnerName)) {
+                Ratings::of(*db).update();
+                WindowedStats::of(*db).update();
+            }
+        } else {
+            db->getLogger().error("No move log to archive for " + finishedId);
+        }
+        GameLog::remove(*db, finishedId);
+    }, [report, finishedId](bool written) {
+        if (!report) return;
+        postNotice(written ? "Player data updated for " + finishedId
+                           : "Failed to update player data for " + finishedId + "; see the log");
+    });
+    logged = false;
+}
+
+/**
+ * @brief Gets the delta produced by the most recent called number
+ * @return Constant reference to the last update
+ */
+const BoardUpdate& Game::getLastUpdate() const {
+    return lastUpdate;
+}
+
+/**
+ * @brief Builds a full snapshot of the game for join or resync
+ * @return Snapshot of every player's board and marks
+ */
+BoardSnapshot Game::snapshot() const {
+    BoardSnapshot result;
+    result.sequence = sequence;
+    result.currentTurn = currentTurn;
+
+    for (const Player& player : players) {
+        vector<int> cells;
+        for (const auto& row : player.getBoard()) {
+            cells.insert(cells.end(), row.begin(), row.end());
+        }
+        result.usernames.push_back(player.getUsername());
+        result.boards.push_back(cells);
+        result.marked.push_back(player.getMarkedMask());
+        result.lines.push_back(player.getLineMask());
+    }
+    return result;
+}
+
 /**
  * @brief Parses game status data from JSON
  * @param json The JSON string containing game status
@@ -649,9 +752,22 @@ vector<vector<bool>> Game::parseGameMarkedData(const vector<vector<int>>& data)
 /**
  * @brief Parses a JSON string into a vector of Game objects
  * @param json The JSON string to parse
- * @return Vector of Game objects
+ * @return Vector of Game objects bound to the default database
  */
 vector<Game> Game::from_json(const string& json) {
+    return from_json(json, DB::getInstance());
+}
+
+/**
+ * @brief Converts JSON string to vector of Game objects bound to a database
+ * @param json JSON string containing game data
+ * @param db Database the games were read from, also used to look up their players
+ * @return Vector of Game objects
+ *
+ * Players are looked up by name in the database's player snapshot, a
+ * binary search in their shard's part.
+ */
+vector<Game> Game::from_json(const string& json, DB& db) {
     vector<Game> games;
     stringstream ss(json);
     string line;
@@ -664,10 +780,17 @@ vector<Game> Game::from_json(const string& json) {
     while (getline(ss, line, '{')) {
         // Skip empty entries
         if (line == "[") continue;
-        Game game(true);
+        Game game(db, true);
         size_t pos;
 
         if (loopCount % 2 != 0) {
+            // A game that lost a player has no boards to restore; the saved-game list skips it
+            if (games[gameIndex].players.size() < 2) {
+                gameIndex++;
+                loopCount++;
+                continue;
+            }
+
             // Parse Status array for game boards
             size_t posP1 = line.find(games[gameIndex].getPlayers()[0].getUsername());
             size_t posP2 = line.find(games[gameIndex].getPlayers()[1].getUsername());
@@ -683,6 +806,21 @@ vector<Game> Game::from_json(const string& json) {
             games[gameIndex].players[0].setBoard(boardP1, markedBoardP1);
             games[gameIndex].players[1].setBoard(boardP2, markedBoardP2);
 
+            // Marked cells are stored as "x", so rebuild the called numbers
+            // from the numbers still visible on the first board
+            set<int> unmarked;
+            for (const auto& row : boardP1) {
+                for (int value : row) {
+                    if (value > 0) unmarked.insert(value);
+                }
+            }
+            for (int number = 1; number <= 25; ++number) {
+                if (unmarked.find(number) == unmarked.end()) {
+                    games[gameIndex].usedNumbers.insert(number);
+                }
+            }
+            games[gameIndex].sequence = static_cast<uint32_t>(games[gameIndex].usedNumbers.size());
+
             gameIndex++;
         }
 
@@ -706,17 +844,14 @@ vector<Game> Game::from_json(const string& json) {
                 // Split players string by comma
                 stringstream playersSS(playersStr);
                 string playerName;
-                vector<Account> accList = DB::getInstance().load<Account>();
                 
                 while (getline(playersSS, playerName, ',')) {
                     // Remove quotes and whitespace
                     playerName = playerName.substr(playerName.find("\"") + 1);
                     playerName = playerName.substr(0, playerName.find("\""));
-                    for (const Account& acc : accList) {
-                        if (acc.getUsername() == playerName) {
-                            Player player(acc.getUsername(), acc.getPassword());
-                            players.push_back(player);
-                        }
+                    if (shared_ptr<const Player> account = db.snapshotFind<Player>(playerName)) {
+                        Player player(account->getUsername(), account->getPassword());
+                        players.push_back(player);
                     }
                 }
             }
@@ -731,7 +866,7 @@ vector<Game> Game::from_json(const string& json) {
                     // Find the winning player and set them as winner
                     for (Player& player : game.players) {
                         if (player.getUsername() == winner) {
-                            game.winner = &player;
+                            game.setWinner(&player);
                             game.isOver = true;
                             break;
                         }
@@ -765,26 +900,33 @@ vector<Game> Game::from_json(const string& json) {
  * @return true if game ID exists, false otherwise
  */
 bool Game::isGameIdExist(const string& gameId) {
-    vector<Game> games = DB::getInstance().load<Game>();
-    for (const Game& game : games) {
-        if (game.getGameId() == gameId) return true;
-    }
-    return false;
+    return database->find<Game>(gameId).has_value();
 }
 
 /**
  * @brief Generates a unique game ID
  * @return String containing the generated game ID
  * 
- * Uses current timestamp and random numbers to generate a unique ID
+ * The number is the current time in microseconds, kept above the last
+ * one handed out by this process, so an ID is never reused after its game
+ * is finished and removed: the replay index and the match history key on
+ * it. IDs that are saved, have a move log or have a replay are skipped
+ * too, in case another process took the same microsecond.
  */
 string Game::generateGameId() {
-    int nextId = 1;
+    static atomic<uint64_t> lastId{0};
+    uint64_t now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    uint64_t previous = lastId.load();
+    uint64_t next;
     string gameId;
+    ReplayInfo replay;
     do {
-        gameId = "Game_" + to_string(nextId);
-        nextId++;
-    } while (isGameIdExist(gameId));
+        do {
+            next = max(previous + 1, now);
+        } while (!lastId.compare_exchange_weak(previous, next));
+        previous = next;
+        gameId = "Game_" + to_string(next);
+    } while (isGameIdExist(gameId) || GameLog::exists(*database, gameId) || ReplayArchive::find(*database, gameId, replay));
     
     return gameId;
 }
@@ -0,0 +1,401 @@
+/**
+ * @file GameLog.cpp
+ * @brief Implementation of the GameLog class
+ */
+
+#include "../include/GameLog.h"
+#include "../include/DB.h"
+#include "../include/Logger.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+const string GameLog::LOGDIR = "games";
+
+/**
+ * @brief Starts a new log for a game, replacing any previous one
+ * @param game The freshly started game
+ * @return true if the log was written, false otherwise
+ */
+bool GameLog::start(const Game& game) {
+    const DB& db = *game.database;
+    try {
+        filesystem::create_directories(db.getRoot() + "/" + LOGDIR);
+        filesystem::remove(checkpointPath(db, game.getGameId()));
+    } catch (const filesystem::filesystem_error& e) {
+        db.getLogger().error("Error preparing game log directory: " + string(e.what()));
+        return false;
+    }
+
+    long long now = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    string event = "{\"type\":\"start\",\"seed\":" + to_string(game.getSeed()) +
+        ",\"time\":" + to_string(now) + ",\"players\":[";
+    for (size_t i = 0; i < game.getPlayers().size(); ++i) {
+        if (i > 0) event += ",";
+        event += "\"" + game.getPlayers()[i].getUsername() + "\"";
+    }
+    event += "]}";
+
+    ofstream outFile(logPath(db, game.getGameId()), ios::trunc);
+    if (!outFile.is_open()) {
+        db.getLogger().error("Failed to open file: " + logPath(db, game.getGameId()));
+        return false;
+    }
+    outFile << event << "\n";
+    return outFile.good();
+}
+
+/**
+ * @brief Appends a called number and checkpoints if due
+ * @param game The game after the number was called
+ * @param number The called number
+ * @return true if the event was appended, false otherwise
+ */
+bool GameLog::appendCall(const Game& game, int number) {
+    if (!append(game, "{\"type\":\"call\",\"number\":" + to_string(number) + "}")) {
+        return false;
+    }
+    if (game.sequence % CHECKPOINT_INTERVAL == 0) {
+        checkpoint(game);
+    }
+    return true;
+}
+
+/**
+ * @brief Appends a skipped turn
+ * @param game The game after the turn was skipped
+ * @return true if the event was appended, false otherwise
+ */
+bool GameLog::appendSkip(const Game& game) {
+    return append(game, "{\"type\":\"skip\"}");
+}
+
+/**
+ * @brief Appends a forfeit by the player whose turn it was
+ * @param game The game after the forfeit
+ * @return true if the event was appended, false otherwise
+ */
+bool GameLog::appendForfeit(const Game& game) {
+    return append(game, "{\"type\":\"forfeit\"}");
+}
+
+/**
+ * @brief Writes a checkpoint of the game's current state
+ * @param game The game to checkpoint
+ * @return true if the checkpoint was written, false otherwise
+ *
+ * The checkpoint is written to a temporary file and renamed over the old
+ * one, so a crash leaves either the previous or the new checkpoint.
+ */
+bool GameLog::checkpoint(const Game& game) {
+    const DB& db = *game.database;
+    string path = checkpointPath(db, game.getGameId());
+    string tempPath = path + ".tmp";
+
+    try {
+        uintmax_t offset = filesystem::file_size(logPath(db, game.getGameId()));
+
+        string state = "{\"offset\":" + to_string(offset) +
+            ",\"sequence\":" + to_string(game.sequence) +
+            ",\"turn\":" + to_string(game.currentTurn) + ",\"marked\":[";
+        for (size_t i = 0; i < game.players.size(); ++i) {
+            if (i > 0) state += ",";
+            state += to_string(game.players[i].getMarkedMask());
+        }
+        state += "]}";
+
+        ofstream outFile(tempPath, ios::trunc);
+        if (!outFile.is_open()) {
+            db.getLogger().error("Failed to open file: " + tempPath);
+            return false;
+        }
+        outFile << state;
+        outFile.close();
+        filesystem::rename(tempPath, path);
+        return true;
+    } catch (const exception& e) {
+        db.getLogger().error("Error writing checkpoint: " + string(e.what()));
+        return false;
+    }
+}
+
+/**
+ * @brief Checks whether a log exists for a game
+ * @param db Database the game is bound to
+ * @param gameId ID of the game
+ * @return true if a log exists, false otherwise
+ */
+bool GameLog::exists(const DB& db, const string& gameId) {
+    return filesystem::exists(logPath(db, gameId));
+}
+
+/**
+ * @brief Rebuilds a game from its checkpoint and log
+ * @param gameId ID of the game
+ * @param game Output game; its players are looked up in the database it is bound to
+ * @return true if the game was rebuilt, false if the log is missing or invalid
+ *
+ * This method:
+ * 1. Reads the start event, looks up only the game's players and
+ *    regenerates every board from the seed
+ * 2. Restores the marks, turn and sequence from the checkpoint, if valid
+ * 3. Replays the events after the checkpoint (or after the start event)
+ *
+ * A torn last line left by a crash mid-append is ignored.
+ */
+bool GameLog::rebuild(const string& gameId, Game& game) {
+    DB& db = *game.database;
+    ifstream inFile(logPath(db, gameId));
+    if (!inFile.is_open()) return false;
+
+    string startEvent;
+    GameHistory history;
+    if (!getline(inFile, startEvent) || !parseStart(startEvent, history)) {
+        db.getLogger().error("Invalid game log: " + logPath(db, gameId));
+        return false;
+    }
+
+    // Look up the players' accounts for their passwords, in the game's database
+    vector<Player> players;
+    for (const string& playerName : history.players) {
+        optional<Player> account = db.find<Player>(playerName);
+        players.emplace_back(playerName, account ? account->getPassword() : "");
+    }
+
+    Game rebuilt(db, true);
+    rebuilt.setGameId(gameId);
+    vector<Player*> ps;
+    for (Player& p : players) ps.push_back(&p);
+    rebuilt.initPlayers(ps, history.seed);
+
+    // Restore the checkpoint, if there is a usable one
+    streamoff replayFrom = inFile.tellg();
+    ifstream ckptFile(checkpointPath(db, gameId));
+    string ckpt;
+    long long offset, sequence, turn;
+    if (ckptFile.is_open() && getline(ckptFile, ckpt) &&
+        readNumber(ckpt, "offset", offset) && readNumber(ckpt, "sequence", sequence) && readNumber(ckpt, "turn", turn) &&
+        offset >= replayFrom && static_cast<uintmax_t>(offset) <= filesystem::file_size(logPath(db, gameId))) {
+
+        size_t maskPos = ckpt.find("\"marked\":[");
+        stringstream masks(maskPos == string::npos ? "" : ckpt.substr(maskPos + 10));
+        string mask;
+        size_t index = 0;
+        while (index < rebuilt.players.size() && getline(masks, mask, ',')) {
+            rebuilt.players[index++].setMarkedMask(static_cast<uint32_t>(stoul(mask)));
+        }
+
+        if (index == rebuilt.players.size()) {
+            uint32_t marked = rebuilt.players[0].getMarkedMask();
+            const auto& board = rebuilt.players[0].getBoard();
+            for (int cell = 0; cell < 25; ++cell) {
+                if (marked & (1u << cell)) rebuilt.usedNumbers.insert(board[cell / 5][cell % 5]);
+            }
+            rebuilt.sequence = static_cast<uint32_t>(sequence);
+            rebuilt.currentTurn = static_cast<int>(turn) % static_cast<int>(rebuilt.players.size());
+            for (Player& player : rebuilt.players) {
+                if (player.checkWin()) {
+                    rebuilt.setWinner(&player);
+                    rebuilt.isOver = true;
+                    break;
+                }
+            }
+            replayFrom = offset;
+        } else {
+            // Unusable checkpoint: start again from fresh boards
+            for (Player& player : rebuilt.players) player.setMarkedMask(0);
+        }
+    }
+
+    // Replay the remaining events
+    inFile.clear();
+    inFile.seekg(replayFrom);
+    string event;
+    while (getline(inFile, event)) {
+        if (event.empty() || event.back() != '}') break;  // torn write
+        if (!apply(rebuilt, event)) {
+            db.getLogger().error("Unknown event in game log " + gameId + ": " + event);
+            return false;
+        }
+    }
+
+    rebuilt.logged = true;
+    game = rebuilt;
+    return true;
+}
+
+/**
+ * @brief Reads the full event history of a game
+ * @param db Database the game is bound to
+ * @param gameId ID of the game
+ * @param history Output history
+ * @return true if the log was read, false if it is missing or invalid
+ */
+bool GameLog::readHistory(const DB& db, const string& gameId, GameHistory& history) {
+    ifstream inFile(logPath(db, gameId));
+    if (!inFile.is_open()) return false;
+
+    string line;
+    GameHistory result;
+    if (!getline(inFile, line) || !parseStart(line, result)) {
+        db.getLogger().error("Invalid game log: " + logPath(db, gameId));
+        return false;
+    }
+
+    while (getline(inFile, line)) {
+        if (line.empty() || line.back() != '}') break;  // torn write
+        int code;
+        if (!eventCode(line, code)) return false;
+        result.events.push_back(code);
+    }
+
+    history = result;
+    return true;
+}
+
+/**
+ * @brief Deletes the log and checkpoint of a game
+ * @param db Database the game is bound to
+ * @param gameId ID of the game
+ */
+void GameLog::remove(const DB& db, const string& gameId) {
+    error_code ec;
+    filesystem::remove(logPath(db, gameId), ec);
+    filesystem::remove(checkpointPath(db, gameId), ec);
+}
+
+/**
+ * @brief Gets the log path of a game
+ * @param db Database the game is bound to
+ * @param gameId ID of the game
+ * @return Path of the log file
+ */
+string GameLog::logPath(const DB& db, const string& gameId) {
+    return db.getRoot() + "/" + LOGDIR + "/" + gameId + ".log";
+}
+
+/**
+ * @brief Gets the checkpoint path of a game
+ * @param db Database the game is bound to
+ * @param gameId ID of the game
+ * @return Path of the checkpoint file
+ */
+string GameLog::checkpointPath(const DB& db, const string& gameId) {
+    return db.getRoot() + "/" + LOGDIR + "/" + gameId + ".ckpt";
+}
+
+/**
+ * @brief Appends one event line to a game's log
+ * @param game The game
+ * @param event JSON event without the trailing newline
+ * @return true if the line was written, false otherwise
+ */
+bool GameLog::append(const Game& game, const string& event) {
+    const DB& db = *game.database;
+    ofstream outFile(logPath(db, game.getGameId()), ios::app);
+    if (!outFile.is_open()) {
+        db.getLogger().error("Failed to open file: " + logPath(db, game.getGameId()));
+        return false;
+    }
+    outFile << event << "\n";
+    return outFile.good();
+}
+
+/**
+ * @brief Parses the start event of a log
+ * @param event First line of the log
+ * @param history Output seed, start time and players
+ * @return true if the line is a valid start event, false otherwise
+ */
+bool GameLog::parseStart(const string& event, GameHistory& history) {
+    if (event.find("\"type\":\"start\"") == string::npos) return false;
+
+    long long seed;
+    if (!readNumber(event, "seed", seed)) return false;
+    history.seed = static_cast<uint32_t>(seed);
+    if (!readNumber(event, "time", history.startTime)) history.startTime = 0;
+
+    // Parse player names
+    size_t pos = event.find("\"players\":[");
+    if (pos == string::npos) return false;
+    string playersStr = event.substr(pos + 11);
+    playersStr = playersStr.substr(0, playersStr.find(']'));
+
+    history.players.clear();
+    stringstream playersSS(playersStr);
+    string playerName;
+    while (getline(playersSS, playerName, ',')) {
+        playerName = playerName.substr(playerName.find("\"") + 1);
+        playerName = playerName.substr(0, playerName.find("\""));
+        history.players.push_back(playerName);
+    }
+    return !history.players.empty();
+}
+
+/**
+ * @brief Converts an event line to its history code
+ * @param event JSON event line
+ * @param code Output: called number, SKIP or FORFEIT
+ * @return true if the event was understood, false otherwise
+ */
+bool GameLog::eventCode(const string& event, int& code) {
+    if (event.find("\"type\":\"call\"") != string::npos) {
+        long long number;
+        if (!readNumber(event, "number", number) || number < 1 || number > 25) return false;
+        code = static_cast<int>(number);
+        return true;
+    }
+    if (event.find("\"type\":\"skip\"") != string::npos) {
+        code = SKIP;
+        return true;
+    }
+    if (event.find("\"type\":\"forfeit\"") != string::npos) {
+        code = FORFEIT;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Applies one event line to a game being rebuilt
+ * @param game The game
+ * @param event JSON event line
+ * @return true if the event was understood, false otherwise
+ *
+ * A call advances the turn unless it ended the game, as Game::playTurn does.
+ * Nothing is appended or recorded while replaying.
+ */
+bool GameLog::apply(Game& game, const string& event) {
+    int code;
+    if (!eventCode(event, code)) return false;
+
+    if (code == SKIP) {
+        game.advanceTurn();
+    } else if (code == FORFEIT) {
+        game.endByForfeit();
+    } else {
+        game.callNumber(code);
+        if (!game.isGameOver()) game.advanceTurn();
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a numeric field from a JSON line
+ * @param line JSON line
+ * @param field Field name
+ * @param value Output value
+ * @return true if the field was found, false otherwise
+ */
+bool GameLog::readNumber(const string& line, const string& field, long long& value) {
+    size_t pos = line.find("\"" + field + "\":");
+    if (pos == string::npos) return false;
+    try {
+        value = stoll(line.substr(pos + field.length() + 3));
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "../include/Leaderboard.h"
 #include "../include/DB.h"
 #include "../include/Util.h"
+#include "../include/Ratings.h"
+#include "../include/WindowedStats.h"
 
 #include <iostream>
 #include <algorithm>
@@ -13,54 +15,266 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <functional>
+#include <numeric>
+
+namespace {
+    /**
+     * @brief Gets the ordering of a sort key, best first
+     */
+    function<bool(const RankEntry&, const RankEntry&)> better(Leaderboard::SortKey key) {
+        switch (key) {
+            case Leaderboard::SortKey::WINS:
+                return [](const RankEntry& a, const RankEntry& b) {
+                    if (a.wins != b.wins) return a.wins > b.wins;
+                    if (a.winRate != b.winRate) return a.winRate > b.winRate;
+                    return a.username < b.username;
+                };
+            case Leaderboard::SortKey::GAMES:
+                return [](const RankEntry& a, const RankEntry& b) {
+                    if (a.games != b.games) return a.games > b.games;
+                    if (a.wins != b.wins) return a.wins > b.wins;
+                    return a.username < b.username;
+                };
+            case Leaderboard::SortKey::RATING:
+                return [](const RankEntry& a, const RankEntry& b) {
+                    double ratingA = a.rating - 2.0 * a.deviation, ratingB = b.rating - 2.0 * b.deviation;
+                    if (ratingA != ratingB) return ratingA > ratingB;
+                    if (a.games != b.games) return a.games > b.games;
+                    return a.username < b.username;
+                };
+            default:
+                return [](const RankEntry& a, const RankEntry& b) {
+                    if (a.winRate != b.winRate) return a.winRate > b.winRate;
+                    if (a.wins != b.wins) return a.wins > b.wins;
+                    return a.username < b.username;
+                };
+        }
+    }
+
+    /**
+     * @brief Selects one page of statistics in an order
+     * 
+     * One nth_element moves the players better than the page in front, a
+     * second one the page after them, and only the page itself is sorted,
+     * so a page costs O(n + k log k) instead of sorting all n players.
+     */
+    vector<RankEntry> selectPage(const vector<RankEntry>& all, size_t k, size_t offset, Leaderboard::SortKey key) {
+        if (offset >= all.size() || k == 0) return {};
+        size_t end = min(all.size(), offset + k);
+
+        // Select on indices so no statistics are copied
+        auto order = better(key);
+        auto compare = [&](uint32_t a, uint32_t b) { return order(all[a], all[b]); };
+        vector<uint32_t> positions(all.size());
+        iota(positions.begin(), positions.end(), 0);
+        if (offset > 0) nth_element(positions.begin(), positions.begin() + offset, positions.end(), compare);
+        if (end < all.size()) nth_element(positions.begin() + offset, positions.begin() + end, positions.end(), compare);
+        sort(positions.begin() + offset, positions.begin() + end, compare);
+
+        vector<RankEntry> page;
+        for (size_t i = offset; i < end; ++i) page.push_back(all[positions[i]]);
+        return page;
+    }
+
+    uint64_t currentTime() {
+        return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+/**
+ * @brief Gets one page of the ranking
+ * @param k Maximum number of players returned
+ * @param offset Number of better players to skip
+ * @param key Order of the ranking
+ * @param period Games the statistics count; only players with a game in it are ranked
+ * @return Players ranked offset + 1 to offset + k
+ * 
+ * The all-time win-rate order is read from the database's RankIndex, and
+ * the ratings of its page looked up by name. The other orders select the
+ * page from the cached statistics, and those of a period from the
+ * players' windowed totals.
+ */
+vector<RankEntry> Leaderboard::top(size_t k, size_t offset, SortKey key, Period period) const {
+    if (period != Period::ALL_TIME) return selectPage(statistics(period), k, offset, key);
+    if (key == SortKey::WIN_RATE) {
+        vector<RankEntry> page = db.ranks().page(offset, k);
+        Ratings& ratings = Ratings::of(db);
+        for (RankEntry& entry : page) {
+            Rating rating = ratings.get(entry.username);
+            entry.rating = rating.rating;
+            entry.deviation = rating.deviation;
+        }
+        return page;
+    }
+
+    return selectPage(*statistics(), k, offset, key);
+}
+
+/**
+ * @brief Gets the number of ranked players
+ * @param period Games the statistics count
+ */
+size_t Leaderboard::size(Period period) const {
+    if (period != Period::ALL_TIME) return statistics(period).size();
+    return db.ranks().size();
+}
 
 /**
  * @brief Displays a formatted table of player rankings and statistics
  * 
+ * Shows the first page by win rate; see displayPage().
+ */
+void Leaderboard::displayLeaderboard() const {
+    if (displayPage(0, PAGE_SIZE, SortKey::WIN_RATE) == 0) {
+        Util::showLine();
+        Util::waitEnter();
+    }
+}
+
+/**
+ * @brief Displays one page of the leaderboard
+ * @param offset Number of better players to skip
+ * @param count Maximum number of rows
+ * @param key Order of the ranking
+ * @param period Games the statistics count
+ * @return Total number of ranked players
+ * 
  * This method performs the following operations:
- * 1. Loads all player records from the database
+ * 1. Reads the requested page with top()
  * 2. If no records exist, displays a "No records found" message
- * 3. Sorts players by win rate in descending order
- * 4. Displays a formatted table with columns for:
+ * 3. Displays a formatted table with columns for:
  *    - Rank (position in leaderboard)
  *    - Player name
  *    - Total games played
  *    - Number of wins
  *    - Win rate percentage
+ *    - Rating and its deviation
  * 
  * The table is formatted using setw for consistent column widths
- * and fixed precision for win rate percentages.
+ * and fixed precision for win rate percentages. Only the rows of the
+ * page are printed.
  */
-void Leaderboard::displayLeaderboard() const {
-    cout << "\n=== Leaderboard ===\n";
-    vector<Player> records = DB::getInstance().load<Player>();
-    if (records.empty()) {
+size_t Leaderboard::displayPage(size_t offset, size_t count, SortKey key, Period period) const {
+    static const char* const ORDER_NAMES[] = {"win rate", "wins", "games played", "rating"};
+    static const char* const PERIOD_NAMES[] = {"all time", "last 24 hours", "last 7 days", "season"};
+    cout << "\n=== Leaderboard (" << PERIOD_NAMES[static_cast<int>(period)] << ", by "
+        << ORDER_NAMES[static_cast<int>(key)] << ") ===\n";
+    size_t total = size(period);
+    vector<RankEntry> records = top(count, offset, key, period);
+    if (total == 0) {
         cout << "No records found.\n";
-        Util::showLine();
-        Util::waitEnter();
-        return;
+        return 0;
     }
 
-    // Sort players by win rate in descending order
-    sort(records.begin(), records.end(), [](const Player& a, const Player& b) {
-        return a.getWinRate() > b.getWinRate();
-    });
-
     // Display table header with fixed column widths
     cout << left << setw(10) << "Rank" 
         << setw(20) << "Name" 
         << setw(15) << "Games Played"
         << setw(10) << "Wins" 
-        << "Win Rate (%)" << endl;
-    cout << string(65, '-') << endl;
+        << setw(15) << "Win Rate (%)"
+        << "Rating" << endl;
+    cout << string(80, '-') << endl;
 
     // Display each player's statistics in table format
     for (size_t i = 0; i < records.size(); ++i) {
         cout << left 
-            << setw(10) << (i + 1)
-            << setw(20) << records[i].getUsername()
-            << setw(15) << records[i].getGameCount()
-            << setw(10) << records[i].getWinCount()
-            << fixed << setprecision(2) << records[i].getWinRate() << endl;
+            << setw(10) << (offset + i + 1)
+            << setw(20) << records[i].username
+            << setw(15) << records[i].games
+            << setw(10) << records[i].wins
+            << setw(15) << fixed << setprecision(2) << records[i].winRate
+            << setprecision(0) << records[i].rating << " +/- " << records[i].deviation << endl;
     }
+    if (records.empty()) cout << "No players on this page.\n";
+    else cout << "Players " << offset + 1 << "-" << offset + records.size() << " of " << total << endl;
+    return total;
+}
+
+
+/**
+ * @brief Builds the player snapshot, its ranking, the ratings and the windowed counters ahead of the next display
+ */
+void Leaderboard::prepare() const {
+    db.ranks();
+    Ratings::of(db);
+    WindowedStats::of(db);
 }
+
+/**
+ * @brief Gets the statistics of the current player snapshot, reading them only if not cached
+ * 
+ * The statistics are a compact copy of the fields the orders compare, so
+ * selecting a page does not touch the full player records. They are kept
+ * per shard part: after a commit only the parts it replaced are read
+ * again, with each player's rating looked up by name, and the cached
+ * statistics of the others are reused. All parts are read again when any
+ * rating changed.
+ */
+shared_ptr<const vector<RankEntry>> Leaderboard::statistics() const {
+    vector<shared_ptr<const PlayerPart>> parts = db.snapshotParts<Player>();
+    Ratings& ratings = Ratings::of(db);
+    uint64_t ratingsVersion = ratings.version();
+
+    lock_guard<mutex> lock(statsMutex);
+    if (stats && statsParts == parts && statsRatings == ratingsVersion) return stats;
+
+    bool rerated = !stats || statsRatings != ratingsVersion || statsParts.size() != parts.size();
+    unordered_map<string, Rating> rated;
+    if (rerated) {
+        rated = ratings.all();
+        partStats.assign(parts.size(), {});
+    }
+    size_t total = 0;
+    for (size_t shard = 0; shard < parts.size(); ++shard) {
+        if (rerated || statsParts[shard] != parts[shard]) {
+            vector<RankEntry>& entries = partStats[shard];
+            entries.clear();
+            entries.reserve(parts[shard]->size());
+            for (const auto& player : *parts[shard]) {
+                Rating rating;
+                if (rerated) {
+                    auto it = rated.find(player->getUsername());
+                    if (it != rated.end()) rating = it->second;
+                } else {
+                    rating = ratings.get(player->getUsername());
+                }
+                entries.push_back({player->getUsername(), player->getGameCount(), player->getWinCount(),
+                                   player->getWinRate(), rating.rating, rating.deviation});
+            }
+        }
+        total += partStats[shard].size();
+    }
+
+    auto entries = make_shared<vector<RankEntry>>();
+    entries->reserve(total);
+    for (const auto& part : partStats) entries->insert(entries->end(), part.begin(), part.end());
+
+    statsParts = parts;
+    statsRatings = ratingsVersion;
+    stats = entries;
+    return stats;
+}
+
+/**
+ * @brief Gets the statistics of the players who played in a period other than ALL_TIME
+ * 
+ * Summed from the windowed counters on every call, since the window
+ * moves with the clock; the games and wins count the period only, the
+ * rating stays the current one.
+ */
+vector<RankEntry> Leaderboard::statistics(Period period) const {
+    static const StatWindow WINDOWS[] = {StatWindow::DAY, StatWindow::DAY, StatWindow::WEEK, StatWindow::SEASON};
+    vector<WindowTotals> totals = WindowedStats::of(db).totals(WINDOWS[static_cast<int>(period)], currentTime());
+    Ratings& ratings = Ratings::of(db);
+
+    vector<RankEntry> entries;
+    entries.reserve(totals.size());
+    for (const WindowTotals& player : totals) {
+        Rating rating = ratings.get(player.username);
+        entries.push_back({player.username, player.games, player.wins,
+                            static_cast<double>(player.wins) / player.games * 100, rating.rating, rating.deviation});
+    }
+    return entries;
+}
\ No newline at end of file
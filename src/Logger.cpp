@@ -18,15 +18,15 @@ namespace fs = std::filesystem;
  * 
  * This method:
  * 1. Acquires a lock to ensure thread safety
- * 2. Creates a Log directory if it doesn't exist
+ * 2. Creates the log directory if it doesn't exist
  * 3. Opens the log file in append mode
  */
 void Logger::init(const string& filename) {
     lock_guard<std::mutex> lock(mtx);
     
-    fs::path logDir("../Log");
+    fs::path logDir(logRoot);
     if (!fs::exists(logDir)) {
-        fs::create_directory(logDir);
+        fs::create_directories(logDir);
     }
     
     fs::path logPath = logDir / filename;
@@ -0,0 +1,982 @@
+/**
+ * @file LsmEngine.cpp
+ * @brief Implementation of the log-structured merge-tree storage engine
+ */
+
+#include "../include/LsmEngine.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    int openFile(const string& path, bool append) {
+        int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC);
+        return _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+    }
+    int syncFile(int fd) { return _commit(fd); }
+    int closeFile(int fd) { return _close(fd); }
+    int truncateFile(int fd, uint64_t size) { return _chsize_s(fd, static_cast<long long>(size)); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return _write(fd, data, static_cast<unsigned int>(length));
+    }
+    void syncDirectory(const string&) {}
+#else
+    int openFile(const string& path, bool append) {
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+        return ::open(path.c_str(), flags, 0644);
+    }
+    int syncFile(int fd) { return ::fsync(fd); }
+    int closeFile(int fd) { return ::close(fd); }
+    int truncateFile(int fd, uint64_t size) { return ::ftruncate(fd, static_cast<off_t>(size)); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return ::write(fd, data, length);
+    }
+    void syncDirectory(const string& path) {
+        int dir = ::open(path.c_str(), O_RDONLY);
+        if (dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+#endif
+
+    /**
+     * @brief Writes a whole buffer, retrying short writes
+     */
+    bool writeAll(int fd, const string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            long long n = writeSome(fd, data.data() + done, data.size() - done);
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Checksum of a log record payload (32-bit FNV-1a)
+     */
+    uint32_t checksum(const string& data) {
+        uint32_t hash = 2166136261u;
+        for (char c : data) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Parses the number of a "<number>.<extension>" file name
+     * @return false if the name has another form
+     */
+    bool fileNumber(const string& name, const string& extension, uint64_t& number) {
+        if (name.size() <= extension.size() ||
+            name.compare(name.size() - extension.size(), extension.size(), extension) != 0) return false;
+        string digits = name.substr(0, name.size() - extension.size());
+        if (digits.empty() || digits.find_first_not_of("0123456789") != string::npos) return false;
+        number = stoull(digits);
+        return true;
+    }
+}
+
+/**
+ * @brief Creates an engine over a directory
+ * @param root Directory of the store
+ * @param logger Logger receiving the engine's messages
+ * @param shards Number of shards per table
+ */
+LsmEngine::LsmEngine(const string& root, Logger& logger, size_t shards)
+    : DIR(root),
+      MANIFEST(root + "/MANIFEST"),
+      logger(logger),
+      shards(shards == 0 ? 1 : shards),
+      memtable(make_shared<Memtable>()),
+      compactPointers(LEVELS) {
+    auto empty = make_shared<Version>();
+    empty->levels.resize(LEVELS);
+    version = empty;
+}
+
+/**
+ * @brief Stops the background thread; the memtable stays in the log
+ *
+ * A frozen memtable is still flushed before the thread exits; a running
+ * compaction is finished, pending ones are left for the next start.
+ * BATCHED writes not synced yet are synced first.
+ */
+LsmEngine::~LsmEngine() {
+    {
+        unique_lock<shared_mutex> lock(stateMutex);
+        stopping = true;
+    }
+    stateChanged.notify_all();
+    if (worker.joinable()) worker.join();
+    if (logFd >= 0 && durability.load() == WriteAheadLog::Durability::BATCHED && syncedGroups < loggedGroups) syncFile(logFd);
+    if (logFd >= 0) closeFile(logFd);
+}
+
+/**
+ * @brief Loads the manifest, replays the logs and starts the background thread
+ * @return false if the directory is used by another process or damaged
+ *
+ * Table files the manifest does not list are leftovers of an interrupted
+ * flush or compaction and are removed. Logs from the manifest's log number
+ * on are replayed and written out as a level-0 table, so the new memtable
+ * starts empty.
+ */
+bool LsmEngine::open() {
+    error_code ec;
+    filesystem::create_directories(DIR, ec);
+    dirLock = FileLock(DIR + "/LOCK", FileLock::Mode::EXCLUSIVE, false);
+    if (!dirLock.held()) {
+        logger.error("LSM store " + DIR + " is used by another process");
+        return false;
+    }
+
+    // Live tables and the oldest log still needed
+    auto loaded = make_shared<Version>();
+    loaded->levels.resize(LEVELS);
+    uint64_t firstLog = 0;
+    uint64_t next = 1;
+    vector<uint64_t> live;
+    ifstream manifest(MANIFEST);
+    string word;
+    while (manifest >> word) {
+        if (word == "next") manifest >> next;
+        else if (word == "log") manifest >> firstLog;
+        else if (word == "table") {
+            int level;
+            uint64_t number;
+            manifest >> level >> number;
+            shared_ptr<SSTable> table = level >= 0 && level < LEVELS ? SSTable::open(tablePath(number), number) : nullptr;
+            if (!table) {
+                logger.error("LSM manifest lists a missing or damaged table: " + tablePath(number));
+                return false;
+            }
+            loaded->levels[level].push_back(table);
+            live.push_back(number);
+        }
+    }
+    manifest.close();
+    sort(loaded->levels[0].begin(), loaded->levels[0].end(),
+        [](const auto& a, const auto& b) { return a->number() > b->number(); });
+    for (int level = 1; level < LEVELS; ++level) {
+        sort(loaded->levels[level].begin(), loaded->levels[level].end(),
+            [](const auto& a, const auto& b) { return a->smallest() < b->smallest(); });
+    }
+
+    // Remove leftovers and collect the logs to replay
+    vector<uint64_t> logs;
+    for (const auto& entry : filesystem::directory_iterator(DIR, ec)) {
+        string name = entry.path().filename().string();
+        uint64_t number;
+        if (fileNumber(name, ".sst", number)) {
+            if (find(live.begin(), live.end(), number) == live.end()) filesystem::remove(entry.path(), ec);
+        }
+        else if (fileNumber(name, ".log", number)) {
+            if (number < firstLog) filesystem::remove(entry.path(), ec);
+            else logs.push_back(number);
+        }
+        else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) {
+            filesystem::remove(entry.path(), ec);
+            continue;
+        }
+        else continue;
+        next = max(next, number + 1);
+    }
+    sort(logs.begin(), logs.end());
+    nextFileNumber = next;
+
+    size_t replayed = 0;
+    Memtable recovered;
+    for (uint64_t number : logs) replayed += replayLog(logPath(number), recovered);
+
+    {
+        unique_lock<shared_mutex> lock(stateMutex);
+        if (recovered.size() > 0) {
+            shared_ptr<SSTable> table = writeTable(recovered);
+            if (!table) return false;
+            loaded->levels[0].insert(loaded->levels[0].begin(), table);
+        }
+        version = loaded;
+        if (!openLog() || !writeManifest(*version)) return false;
+        generationBase = logNumber << 32;
+        for (uint64_t number : logs) filesystem::remove(logPath(number), ec);
+
+        opened = true;
+        worker = thread(&LsmEngine::backgroundLoop, this);
+    }
+    logger.info("LSM store opened with " + describe() + ", " + to_string(replayed) + " batches recovered");
+    return true;
+}
+
+/**
+ * @brief Gets a stamp that changes whenever a shard is written
+ * @param table Table name
+ * @param shard Shard index
+ * @return Number of batches that wrote the shard since the store was
+ *         opened, offset by a base unique to this open
+ *
+ * The counters restart with every open; the base keeps a stamp taken in
+ * an earlier run (such as a checkpoint's) from matching a later one.
+ */
+uint64_t LsmEngine::generation(const string& table, size_t shard) {
+    shared_lock<shared_mutex> lock(stateMutex);
+    auto it = generations.find(table);
+    return generationBase + (it == generations.end() || shard >= it->second.size() ? 0 : it->second[shard]);
+}
+
+/**
+ * @brief Reads one record
+ * @param table Table name
+ * @param key Record key
+ * @param value Output record JSON
+ * @return true if the record exists
+ *
+ * The newest source that knows the key decides, a tombstone included.
+ * A table whose block for the key is unreadable decides too: the record
+ * is reported missing rather than read from an older table, which could
+ * resurrect an overwritten or deleted value.
+ */
+bool LsmEngine::get(const string& table, const string& key, string& value) {
+    string internal = internalKey(table, key);
+    shared_ptr<const Version> current;
+    {
+        shared_lock<shared_mutex> lock(stateMutex);
+        for (const Memtable* source : {static_cast<const Memtable*>(memtable.get()), immutable.get()}) {
+            if (!source) continue;
+            if (const optional<string>* found = source->find(internal)) {
+                if (!*found) return false;
+                value = **found;
+                return true;
+            }
+        }
+        current = version;
+    }
+
+    auto check = [&](const SSTable& sstable, bool& decided) {
+        SSTable::Lookup result = sstable.get(internal, value);
+        if (result == SSTable::Lookup::CORRUPT) {
+            logger.error("LSM record " + table + "/" + key + " is in a damaged block of table " +
+                         to_string(sstable.number()) + "; older tables are not consulted");
+        }
+        decided = result != SSTable::Lookup::MISSING;
+        return result == SSTable::Lookup::FOUND;
+    };
+
+    bool decided = false;
+    for (const auto& sstable : current->levels[0]) {
+        bool found = check(*sstable, decided);
+        if (decided) return found;
+    }
+    for (int level = 1; level < LEVELS; ++level) {
+        const auto& tables = current->levels[level];
+        auto it = lower_bound(tables.begin(), tables.end(), internal,
+            [](const shared_ptr<SSTable>& sstable, const string& target) { return sstable->largest() < target; });
+        if (it == tables.end() || internal < (*it)->smallest()) continue;
+        bool found = check(**it, decided);
+        if (decided) return found;
+    }
+    return false;
+}
+
+/**
+ * @brief Reads every record of a table
+ * @param table Table name
+ * @return Pairs of key and record JSON, in key order
+ */
+vector<pair<string, string>> LsmEngine::scan(const string& table) {
+    return scanWhere(table, [](const string&) { return true; });
+}
+
+/**
+ * @brief Reads the records of one shard of a table
+ * @param table Table name
+ * @param shard Shard index
+ * @return Pairs of key and record JSON, in key order
+ *
+ * Every source is still walked, but only the shard's entries are kept.
+ */
+vector<pair<string, string>> LsmEngine::scanShard(const string& table, size_t shard) {
+    return scanWhere(table, [this, shard](const string& key) { return shardOf(key, shards) == shard; });
+}
+
+/**
+ * @brief Reads the live records of a table whose keys pass a filter
+ * @param table Table name
+ * @param keep Filter on the record key
+ * @return Pairs of key and record JSON, in key order
+ *
+ * Sources are read from newest to oldest and the first entry seen for a
+ * key wins; tombstones hide older values and are then dropped. Keys in
+ * the range of an unreadable block are left out of every older table too.
+ */
+vector<pair<string, string>> LsmEngine::scanWhere(const string& table, const function<bool(const string&)>& keep) {
+    string prefix = internalKey(table, "");
+    map<string, optional<string>> merged;
+    auto wanted = [&](const string& key) {
+        return keep(key.substr(prefix.size()));
+    };
+    auto collect = [&](const Memtable& source) {
+        for (auto it = source.lowerBound(prefix); it.valid() && it.key().compare(0, prefix.size(), prefix) == 0; it.next()) {
+            if (wanted(it.key())) merged.emplace(it.key(), it.value());
+        }
+    };
+
+    shared_ptr<const Memtable> frozen;
+    shared_ptr<const Version> current;
+    {
+        shared_lock<shared_mutex> lock(stateMutex);
+        collect(*memtable);
+        frozen = immutable;
+        current = version;
+    }
+    if (frozen) collect(*frozen);
+
+    vector<pair<string, string>> damaged;
+    auto shadowed = [&damaged](const string& key) {
+        for (const auto& range : damaged) {
+            if (key >= range.first && key <= range.second) return true;
+        }
+        return false;
+    };
+    for (const auto& tables : current->levels) {
+        for (const auto& sstable : tables) {
+            if (sstable->largest() < prefix) continue;
+            SSTable::Iterator it(sstable);
+            for (it.seek(prefix); it.valid() && it.key().compare(0, prefix.size(), prefix) == 0; it.next()) {
+                if (wanted(it.key()) && !shadowed(it.key())) merged.emplace(it.key(), it.value());
+            }
+            damaged.insert(damaged.end(), it.damaged().begin(), it.damaged().end());
+        }
+    }
+
+    vector<pair<string, string>> results;
+    for (auto& entry : merged) {
+        if (entry.second) results.emplace_back(entry.first.substr(prefix.size()), move(*entry.second));
+    }
+    return results;
+}
+
+/**
+ * @brief Applies every operation of a batch
+ * @param batch Changes to apply
+ * @return true if the batch was logged and applied
+ *
+ * The batch is appended to the log as one checksummed record, and synced
+ * as the durability level requires, before the memtable changes, so after
+ * a crash it is replayed whole or not at all. The caller either waits for
+ * the writer ahead of it to log its batch along with its own group, or is
+ * first in the queue and writes the group itself.
+ */
+bool LsmEngine::apply(const WriteBatch& batch) {
+    Writer self;
+    self.batch = &batch;
+    string payload;
+    SSTable::putVarint(payload, batch.operations.size());
+    for (const auto& op : batch.operations) {
+        payload.push_back(op.value ? 0 : 1);
+        SSTable::putVarint(payload, op.table.size());
+        payload += op.table;
+        SSTable::putVarint(payload, op.key.size());
+        payload += op.key;
+        SSTable::putVarint(payload, op.value ? op.value->size() : 0);
+        if (op.value) payload += *op.value;
+    }
+    SSTable::putFixed(self.record, payload.size(), 4);
+    SSTable::putFixed(self.record, checksum(payload), 4);
+    self.record += payload;
+
+    unique_lock<mutex> queue(writersMutex);
+    writers.push_back(&self);
+    awaitTurn(self, queue);
+    if (self.done) return self.ok;
+
+    // Take the batches queued behind this one along, up to GROUP_BYTES
+    vector<Writer*> group;
+    size_t groupBytes = 0;
+    for (Writer* writer : writers) {
+        if (!writer->batch || (!group.empty() && groupBytes + writer->record.size() > GROUP_BYTES)) break;
+        group.push_back(writer);
+        groupBytes += writer->record.size();
+    }
+    queue.unlock();
+
+    bool ok = writeGroup(group);
+
+    queue.lock();
+    for (Writer* writer : group) {
+        writer->ok = ok;
+        writer->done = true;
+    }
+    endTurn(group.size(), queue);
+    return ok;
+}
+
+/**
+ * @brief Writes the memtable to a table and waits for due compactions
+ * @return false if the engine is not open
+ *
+ * The memtable is frozen on the writers' turn, so no group is being
+ * logged to the old log meanwhile.
+ */
+bool LsmEngine::flush() {
+    Writer self;
+    unique_lock<mutex> queue(writersMutex);
+    writers.push_back(&self);
+    awaitTurn(self, queue);
+    queue.unlock();
+
+    unique_lock<shared_mutex> lock(stateMutex);
+    bool ok = opened;
+    if (ok) stateChanged.wait(lock, [this] { return !immutable || stopping; });
+    ok = ok && (memtable->size() == 0 || freezeMemtable());
+    lock.unlock();
+
+    queue.lock();
+    endTurn(1, queue);
+    queue.unlock();
+    if (!ok) return false;
+
+    lock.lock();
+    idle = false;
+    stateChanged.notify_all();
+    stateChanged.wait(lock, [this] { return (idle && !immutable) || stopping; });
+    return !stopping;
+}
+
+/**
+ * @brief Sets how durable a batch is when apply() returns
+ * @param level New level
+ */
+void LsmEngine::setDurability(WriteAheadLog::Durability level) {
+    durability.store(level);
+    stateChanged.notify_all();
+}
+
+/**
+ * @brief Gets the number of tables on each level
+ * @return Text such as "L0 2, L1 5"
+ */
+string LsmEngine::describe() const {
+    shared_ptr<const Version> current;
+    {
+        shared_lock<shared_mutex> lock(stateMutex);
+        current = version;
+    }
+    string text;
+    for (int level = 0; level < LEVELS; ++level) {
+        if (current->levels[level].empty() && level > 0) continue;
+        if (!text.empty()) text += ", ";
+        text += "L" + to_string(level) + " " + to_string(current->levels[level].size());
+    }
+    return text;
+}
+
+/**
+ * @brief Waits until a writer is first in the queue or done
+ * @param self Writer, added to the queue
+ * @param queue Held lock on the queue
+ */
+void LsmEngine::awaitTurn(Writer& self, unique_lock<mutex>& queue) {
+    self.turn.wait(queue, [&] { return self.done || writers.front() == &self; });
+}
+
+/**
+ * @brief Removes the first writers from the queue and wakes the next one
+ * @param count Number of writers to remove
+ * @param queue Held lock on the queue
+ *
+ * Removed writers that are done are woken as well. They can only return
+ * once the queue lock is released, so their Writer outlives the notify.
+ */
+void LsmEngine::endTurn(size_t count, unique_lock<mutex>&) {
+    for (size_t i = 0; i < count; ++i) {
+        Writer* writer = writers.front();
+        writers.pop_front();
+        if (writer->done) writer->turn.notify_one();
+    }
+    if (!writers.empty()) writers.front()->turn.notify_one();
+}
+
+/**
+ * @brief Logs a group of batches and installs them in the memtable
+ * @param group Writers whose batches to write, in queue order
+ * @return true if every batch was logged and applied
+ *
+ * The state lock is only held to make room in the memtable and to install
+ * the batches; the log is written and synced without it. Only the first
+ * writer in the queue switches logs, so the log stays open meanwhile. A
+ * group that fails to be written or synced is cut from the log again, so
+ * recovery does not replay batches reported as failed.
+ */
+bool LsmEngine::writeGroup(const vector<Writer*>& group) {
+    int fd;
+    uint64_t start;
+    uint64_t number;
+    bool sync;
+    {
+        unique_lock<shared_mutex> lock(stateMutex);
+        if (!opened || !makeRoomForWrite(lock)) return false;
+        fd = logFd;
+        start = logBytes;
+        number = loggedGroups + 1;
+        WriteAheadLog::Durability level = durability.load();
+        sync = level == WriteAheadLog::Durability::EVERY_COMMIT ||
+            (level == WriteAheadLog::Durability::BATCHED && chrono::steady_clock::now() - lastSync >= BATCH_INTERVAL);
+    }
+
+    string records;
+    for (const Writer* writer : group) records += writer->record;
+    bool ok = writeAll(fd, records) && (!sync || syncFile(fd) == 0);
+
+    unique_lock<shared_mutex> lock(stateMutex);
+    if (!ok) {
+        logger.error("Failed to append to LSM log " + logPath(logNumber));
+        if (truncateFile(fd, start) != 0) logger.error("Failed to cut a failed write from LSM log " + logPath(logNumber));
+        return false;
+    }
+    logBytes += records.size();
+    loggedGroups = number;
+    if (sync) {
+        syncedGroups = number;
+        lastSync = chrono::steady_clock::now();
+    } else if (durability.load() == WriteAheadLog::Durability::BATCHED) {
+        stateChanged.notify_all();
+    }
+
+    for (const Writer* writer : group) {
+        for (const auto& op : writer->batch->operations) {
+            memtableBytes += op.table.size() + op.key.size() + (op.value ? op.value->size() : 0) + 32;
+            memtable->insertOrAssign(internalKey(op.table, op.key), op.value);
+            auto& counts = generations[op.table];
+            counts.resize(shards, 0);
+            ++counts[shardOf(op.key, shards)];
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Syncs BATCHED writes that are still unsynced
+ * @param lock Held exclusive lock on the state, released during the sync
+ *
+ * The sync runs under a shared lock, which keeps the log from being
+ * switched and closed but lets reads and log appends go on. It covers
+ * every group logged before it started.
+ */
+void LsmEngine::syncBatched(unique_lock<shared_mutex>& lock) {
+    uint64_t target = loggedGroups;
+    lock.unlock();
+    bool ok;
+    {
+        shared_lock<shared_mutex> shared(stateMutex);
+        ok = syncFile(logFd) == 0;
+    }
+    lock.lock();
+    lastSync = chrono::steady_clock::now();
+    if (ok) syncedGroups = max(syncedGroups, target);
+    else logger.error("Failed to sync LSM log " + logPath(logNumber));
+}
+
+/**
+ * @brief Starts a new log file for the memtable
+ * @return false if the file cannot be created
+ *
+ * Writes still unsynced in the old log are synced before it is closed,
+ * unless the durability level is NONE.
+ */
+bool LsmEngine::openLog() {
+    uint64_t number = nextFileNumber++;
+    int fd = openFile(logPath(number), true);
+    if (fd < 0) {
+        logger.error("Failed to create LSM log " + logPath(number));
+        return false;
+    }
+    if (logFd >= 0) {
+        if (syncedGroups < loggedGroups && durability.load() != WriteAheadLog::Durability::NONE) syncFile(logFd);
+        closeFile(logFd);
+    }
+    syncedGroups = loggedGroups;
+    logFd = fd;
+    logNumber = number;
+    logBytes = 0;
+    syncDirectory(DIR);
+    return true;
+}
+
+/**
+ * @brief Replays a log file into a memtable
+ * @param path Log file
+ * @param target Memtable to fill
+ * @return Number of batches replayed; replay stops at a torn record
+ */
+size_t LsmEngine::replayLog(const string& path, Memtable& target) {
+    ifstream in(path, ios::binary);
+    string log((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    size_t batches = 0;
+    while (pos + 8 <= log.size()) {
+        uint64_t length = SSTable::getFixed(log, pos, 4);
+        uint32_t sum = static_cast<uint32_t>(SSTable::getFixed(log, pos + 4, 4));
+        if (length > log.size() - pos - 8) break;
+        string payload = log.substr(pos + 8, length);
+        if (checksum(payload) != sum) break;
+
+        size_t at = 0;
+        uint64_t count;
+        vector<pair<string, optional<string>>> writes;
+        bool valid = SSTable::getVarint(payload, at, count);
+        for (uint64_t i = 0; valid && i < count; ++i) {
+            if (at >= payload.size()) { valid = false; break; }
+            bool deleted = payload[at++] != 0;
+            string fields[3];
+            for (string& field : fields) {
+                uint64_t size;
+                if (!SSTable::getVarint(payload, at, size) || size > payload.size() - at) { valid = false; break; }
+                field = payload.substr(at, size);
+                at += size;
+            }
+            if (valid) writes.emplace_back(internalKey(fields[0], fields[1]), deleted ? nullopt : optional<string>(fields[2]));
+        }
+        if (!valid) break;
+
+        for (auto& write : writes) target.insertOrAssign(write.first, move(write.second));
+        ++batches;
+        pos += 8 + length;
+    }
+    if (pos < log.size()) logger.error("Torn record at the end of LSM log " + path + " ignored");
+    return batches;
+}
+
+/**
+ * @brief Replaces the manifest
+ * @param next Tables to list
+ * @return false if the manifest could not be written
+ *
+ * Written to a temporary file, synced and renamed, so the manifest is
+ * always either the old or the new list.
+ */
+bool LsmEngine::writeManifest(const Version& next) {
+    ostringstream content;
+    content << "next " << nextFileNumber.load() << "\n";
+    content << "log " << (immutable ? immutableLog : logNumber) << "\n";
+    for (int level = 0; level < LEVELS; ++level) {
+        for (const auto& sstable : next.levels[level]) {
+            content << "table " << level << " " << sstable->number() << "\n";
+        }
+    }
+
+    string tmpPath = MANIFEST + ".tmp";
+    int fd = openFile(tmpPath, false);
+    bool ok = fd >= 0 && writeAll(fd, content.str()) && syncFile(fd) == 0;
+    if (fd >= 0) closeFile(fd);
+    error_code ec;
+    if (ok) filesystem::rename(tmpPath, MANIFEST, ec);
+    if (!ok || ec) {
+        logger.error("Failed to write LSM manifest " + MANIFEST);
+        filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    syncDirectory(DIR);
+    return true;
+}
+
+/**
+ * @brief Writes a memtable as a table file
+ * @param source Memtable
+ * @return The new table, or null on error
+ */
+shared_ptr<SSTable> LsmEngine::writeTable(const Memtable& source) {
+    uint64_t number = nextFileNumber++;
+    SSTableBuilder builder(tablePath(number));
+    for (auto it = source.begin(); it.valid(); it.next()) {
+        if (!builder.add(it.key(), it.value())) break;
+    }
+    if (!builder.finish()) return nullptr;
+    return SSTable::open(tablePath(number), number);
+}
+
+/**
+ * @brief Waits until the memtable has room and level 0 is not overfull
+ * @param lock Held exclusive lock on the state
+ * @return false if the engine is shutting down or a new log cannot be created
+ *
+ * A full memtable is frozen for the background thread unless the previous
+ * one is still being flushed, in which case the writer waits. Writers
+ * also wait while level 0 has L0_STOP_WRITES tables, which bounds the
+ * number of tables a lookup may have to check.
+ */
+bool LsmEngine::makeRoomForWrite(unique_lock<shared_mutex>& lock) {
+    while (!stopping) {
+        bool full = memtableBytes >= MEMTABLE_BYTES;
+        if (!full && version->levels[0].size() < L0_STOP_WRITES) return true;
+        if (full && !immutable) {
+            if (!freezeMemtable()) return false;
+            stateChanged.notify_all();
+            continue;
+        }
+        stateChanged.wait(lock);
+    }
+    return false;
+}
+
+/**
+ * @brief Freezes the memtable and switches to a new log
+ * @return false if the new log cannot be created
+ */
+bool LsmEngine::freezeMemtable() {
+    uint64_t frozenLog = logNumber;
+    if (!openLog()) return false;
+    immutable = memtable;
+    immutableLog = frozenLog;
+    memtable = make_shared<Memtable>();
+    memtableBytes = 0;
+    return true;
+}
+
+/**
+ * @brief Runs flushes and compactions until the engine stops
+ *
+ * The state lock is released while table files are written, so reads and
+ * writes continue during a flush or a compaction.
+ */
+void LsmEngine::backgroundLoop() {
+    unique_lock<shared_mutex> lock(stateMutex);
+    while (true) {
+        if (immutable) {
+            idle = false;
+            shared_ptr<const Memtable> frozen = immutable;
+            lock.unlock();
+            shared_ptr<SSTable> table = writeTable(*frozen);
+            lock.lock();
+
+            auto next = make_shared<Version>(*version);
+            if (table) next->levels[0].insert(next->levels[0].begin(), table);
+            uint64_t obsoleteLog = immutableLog;
+            immutable.reset();
+            if (table && writeManifest(*next)) {
+                version = next;
+                error_code ec;
+                filesystem::remove(logPath(obsoleteLog), ec);
+            } else {
+                // Keep the frozen entries readable; they stay in their log
+                logger.error("Failed to flush LSM memtable, retrying");
+                if (table) table->markObsolete();
+                immutable = frozen;
+                immutableLog = obsoleteLog;
+                stateChanged.wait_for(lock, chrono::seconds(1));
+            }
+            stateChanged.notify_all();
+            continue;
+        }
+        if (stopping) break;
+
+        optional<Compaction> job = pickCompaction();
+        if (job) {
+            idle = false;
+            bool dropDeletes = true;
+            for (int level = job->level + 2; level < LEVELS; ++level) {
+                dropDeletes = dropDeletes && version->levels[level].empty();
+            }
+            lock.unlock();
+            bool ok = true;
+            vector<shared_ptr<SSTable>> outputs = runCompaction(*job, dropDeletes, ok);
+            lock.lock();
+
+            auto next = make_shared<Version>(*version);
+            auto without = [](vector<shared_ptr<SSTable>>& tables, const vector<shared_ptr<SSTable>>& removed) {
+                tables.erase(remove_if(tables.begin(), tables.end(), [&removed](const shared_ptr<SSTable>& sstable) {
+                    return find(removed.begin(), removed.end(), sstable) != removed.end();
+                }), tables.end());
+            };
+            without(next->levels[job->level], job->inputs);
+            without(next->levels[job->level + 1], job->overlaps);
+            auto& target = next->levels[job->level + 1];
+            target.insert(target.end(), outputs.begin(), outputs.end());
+            sort(target.begin(), target.end(), [](const auto& a, const auto& b) { return a->smallest() < b->smallest(); });
+
+            if (ok && writeManifest(*next)) {
+                version = next;
+                for (const auto& sstable : job->inputs) sstable->markObsolete();
+                for (const auto& sstable : job->overlaps) sstable->markObsolete();
+            } else {
+                logger.error("LSM compaction of level " + to_string(job->level) + " failed, retrying");
+                for (const auto& sstable : outputs) sstable->markObsolete();
+                stateChanged.wait_for(lock, chrono::seconds(1));
+            }
+            stateChanged.notify_all();
+            continue;
+        }
+
+        // BATCHED writes no later write has synced are synced within the interval
+        bool unsynced = durability.load() == WriteAheadLog::Durability::BATCHED && syncedGroups < loggedGroups;
+        if (unsynced && chrono::steady_clock::now() >= lastSync + BATCH_INTERVAL) {
+            syncBatched(lock);
+            continue;
+        }
+
+        idle = true;
+        stateChanged.notify_all();
+        if (unsynced) stateChanged.wait_until(lock, lastSync + BATCH_INTERVAL);
+        else stateChanged.wait(lock);
+    }
+    idle = true;
+    stateChanged.notify_all();
+}
+
+/**
+ * @brief Picks the next compaction, if any level is over its budget
+ * @return The compaction, or nothing
+ *
+ * Level 0 goes first, whole. On deeper levels one table is taken, the
+ * tables of each level in turn after the last key compacted there.
+ */
+optional<LsmEngine::Compaction> LsmEngine::pickCompaction() {
+    const auto& levels = version->levels;
+    Compaction job;
+    string smallest, largest;
+
+    if (levels[0].size() >= L0_COMPACTION_TRIGGER) {
+        job.level = 0;
+        job.inputs = levels[0];
+    }
+    else {
+        for (int level = 1; level < LEVELS - 1 && job.inputs.empty(); ++level) {
+            if (totalBytes(levels[level]) <= maxBytes(level)) continue;
+            const auto& tables = levels[level];
+            auto it = find_if(tables.begin(), tables.end(),
+                [&](const shared_ptr<SSTable>& sstable) { return sstable->smallest() > compactPointers[level]; });
+            if (it == tables.end()) it = tables.begin();
+            job.level = level;
+            job.inputs.push_back(*it);
+            compactPointers[level] = (*it)->largest();
+        }
+    }
+    if (job.inputs.empty()) return nullopt;
+
+    smallest = job.inputs.front()->smallest();
+    largest = job.inputs.front()->largest();
+    for (const auto& sstable : job.inputs) {
+        smallest = min(smallest, sstable->smallest());
+        largest = max(largest, sstable->largest());
+    }
+    for (const auto& sstable : levels[job.level + 1]) {
+        if (sstable->largest() >= smallest && sstable->smallest() <= largest) job.overlaps.push_back(sstable);
+    }
+    return job;
+}
+
+/**
+ * @brief Merges the tables of a compaction into new tables
+ * @param job Tables to merge
+ * @param dropDeletes Whether tombstones can be dropped
+ * @param ok Set to false on a write error or an unreadable input block
+ * @return New tables of the next level, in key order
+ *
+ * A k-way merge over iterators of every input, newest input first, keeps
+ * the newest entry of each key. Only one block per input is in memory.
+ * An input block that cannot be read stops the merge: writing the outputs
+ * without it would drop its entries and let older values take their place.
+ */
+vector<shared_ptr<SSTable>> LsmEngine::runCompaction(const Compaction& job, bool dropDeletes, bool& ok) {
+    vector<SSTable::Iterator> cursors;
+    for (const auto& sstable : job.inputs) cursors.emplace_back(sstable);
+    for (const auto& sstable : job.overlaps) cursors.emplace_back(sstable);
+
+    // Smallest key first; for equal keys the newest input (lowest index) first
+    auto later = [&cursors](size_t a, size_t b) {
+        int order = cursors[a].key().compare(cursors[b].key());
+        return order != 0 ? order > 0 : a > b;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+    auto damaged = [&](const SSTable::Iterator& cursor) {
+        if (cursor.damaged().empty()) return false;
+        logger.error("LSM compaction of level " + to_string(job.level) + " stopped at a damaged block");
+        return true;
+    };
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (damaged(cursors[i])) ok = false;
+        if (cursors[i].valid()) heap.push(i);
+    }
+
+    vector<shared_ptr<SSTable>> outputs;
+    unique_ptr<SSTableBuilder> builder;
+    uint64_t number = 0;
+    auto finishTable = [&]() {
+        if (!builder) return;
+        shared_ptr<SSTable> table = builder->finish() ? SSTable::open(tablePath(number), number) : nullptr;
+        if (table) outputs.push_back(table);
+        else ok = false;
+        builder.reset();
+    };
+
+    string lastKey;
+    bool first = true;
+    while (!heap.empty() && ok) {
+        size_t top = heap.top();
+        heap.pop();
+        SSTable::Iterator& cursor = cursors[top];
+
+        if (first || cursor.key() != lastKey) {
+            lastKey = cursor.key();
+            first = false;
+            if (cursor.value() || !dropDeletes) {
+                if (!builder) {
+                    number = nextFileNumber++;
+                    builder = make_unique<SSTableBuilder>(tablePath(number));
+                }
+                if (!builder->add(cursor.key(), cursor.value())) ok = false;
+                if (builder->fileSize() >= TABLE_BYTES) finishTable();
+            }
+        }
+
+        cursor.next();
+        if (damaged(cursor)) ok = false;
+        if (cursor.valid()) heap.push(top);
+    }
+    if (ok) finishTable();
+    if (!ok) {
+        for (const auto& sstable : outputs) sstable->markObsolete();
+        outputs.clear();
+    }
+    return outputs;
+}
+
+/**
+ * @brief Gets the byte budget of a level
+ * @param level Level from 1
+ * @return LEVEL1_BYTES times ten for each level below level 1
+ */
+uint64_t LsmEngine::maxBytes(int level) {
+    uint64_t bytes = LEVEL1_BYTES;
+    for (int i = 1; i < level; ++i) bytes *= 10;
+    return bytes;
+}
+
+/**
+ * @brief Gets the bytes of a list of tables
+ * @param tables Tables
+ * @return Sum of their file sizes
+ */
+uint64_t LsmEngine::totalBytes(const vector<shared_ptr<SSTable>>& tables) {
+    uint64_t bytes = 0;
+    for (const auto& sstable : tables) bytes += sstable->fileSize();
+    return bytes;
+}
\ No newline at end of file
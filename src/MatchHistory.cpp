@@ -0,0 +1,536 @@
+/**
+ * @file MatchHistory.cpp
+ * @brief Implementation of the MatchHistory class
+ */
+
+#include "../include/MatchHistory.h"
+#include "../include/Crc32c.h"
+#include "../include/DB.h"
+#include "../include/FileLock.h"
+#include "../include/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    const char MAGIC[4] = {'B', 'M', 'H', '1'};
+    const size_t HEADER_BYTES = 16;
+    const size_t DIRECTORY_ENTRY = 24;
+    const size_t PACK_HEADER = 13;
+    const uint64_t FORFEIT_CALL = 26;
+
+    /**
+     * @brief Columns of a segment, in file order
+     */
+    enum Column { NAMES, START, DURATION, PLAYER_COUNT, PLAYERS, WINNER, TURNS, CALLS, COLUMN_COUNT };
+
+    /**
+     * @brief Decoded columns of a segment or of the tail; only the requested ones are filled
+     */
+    struct Columns {
+        size_t rows = 0;
+        vector<string> names;                   ///< Dictionary of player names
+        vector<uint64_t> values[COLUMN_COUNT];  ///< Integer columns, indexed by Column
+    };
+
+    void put32(string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    void put64(string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    uint32_t get32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    uint64_t get64(const char* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    /**
+     * @brief Frame-of-reference bit-packs an integer column
+     * @return Minimum (8 bytes), bit width (1), count (4), then the packed bits and 8 bytes of padding
+     */
+    string pack(const vector<uint64_t>& values) {
+        uint64_t base = values.empty() ? 0 : *min_element(values.begin(), values.end());
+        uint64_t spread = 0;
+        for (uint64_t value : values) spread |= value - base;
+        int width = 0;
+        while (width < 64 && (spread >> width) != 0) ++width;
+        if (width > 56) width = 64;
+
+        string out;
+        put64(out, base);
+        out.push_back(static_cast<char>(width));
+        put32(out, static_cast<uint32_t>(values.size()));
+        string bits((values.size() * width + 7) / 8 + 8, '\0');
+        for (size_t i = 0; i < values.size(); ++i) {
+            uint64_t delta = values[i] - base;
+            for (size_t bit = i * width, end = bit + width; bit < end; ++bit, delta >>= 1) {
+                if (delta & 1) bits[bit / 8] = static_cast<char>(bits[bit / 8] | (1 << (bit % 8)));
+            }
+        }
+        return out + bits;
+    }
+
+    /**
+     * @brief Unpacks a column written by pack()
+     * @return false if the column is truncated
+     *
+     * Each value is one unaligned 8-byte load, a shift and a mask, so the
+     * loop does not branch on the data.
+     */
+    bool unpack(const string& data, vector<uint64_t>& out) {
+        if (data.size() < PACK_HEADER) return false;
+        uint64_t base = get64(data.data());
+        int width = static_cast<uint8_t>(data[8]);
+        size_t count = get32(data.data() + 9);
+        if (width > 64 || data.size() < PACK_HEADER + (count * width + 7) / 8 + 8) return false;
+
+        out.resize(count);
+        const char* bits = data.data() + PACK_HEADER;
+        if (width == 64) {
+            for (size_t i = 0; i < count; ++i) out[i] = base + get64(bits + 8 * i);
+            return true;
+        }
+        const uint64_t mask = (uint64_t(1) << width) - 1;
+        for (size_t i = 0; i < count; ++i) {
+            size_t bit = i * width;
+            out[i] = base + ((get64(bits + bit / 8) >> (bit % 8)) & mask);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Adds one game to decoded columns
+     */
+    void addRow(Columns& columns, unordered_map<string, uint64_t>& ids, uint64_t start, uint64_t end,
+                uint64_t winner, const vector<string>& players, const vector<uint64_t>& calls) {
+        columns.values[START].push_back(start);
+        columns.values[DURATION].push_back(start > 0 && end > start ? end - start : 0);
+        columns.values[PLAYER_COUNT].push_back(players.size());
+        for (const string& name : players) {
+            auto it = ids.find(name);
+            if (it == ids.end()) {
+                it = ids.emplace(name, columns.names.size()).first;
+                columns.names.push_back(name);
+            }
+            columns.values[PLAYERS].push_back(it->second);
+        }
+        columns.values[WINNER].push_back(winner);
+        columns.values[TURNS].push_back(calls.size());
+        columns.values[CALLS].insert(columns.values[CALLS].end(), calls.begin(), calls.end());
+        columns.rows++;
+    }
+
+    /**
+     * @brief Parses the rows of a tail file
+     * @return Every column of the complete rows; a torn last line is ignored
+     *
+     * A row is: start, end, winner, player count, the player names and the
+     * space-separated calls, separated by tabs.
+     */
+    Columns readTail(const string& path) {
+        Columns columns;
+        unordered_map<string, uint64_t> ids;
+        ifstream in(path, ios::binary);
+        string line;
+        while (getline(in, line) && !in.eof()) {
+            vector<string> fields;
+            stringstream ss(line);
+            string field;
+            while (getline(ss, field, '\t')) fields.push_back(field);
+            if (!line.empty() && line.back() == '\t') fields.push_back("");
+            if (fields.size() < 5) continue;
+            try {
+                size_t playerCount = stoul(fields[3]);
+                if (fields.size() != 5 + playerCount) continue;
+                vector<string> players(fields.begin() + 4, fields.begin() + 4 + playerCount);
+                vector<uint64_t> calls;
+                stringstream callStream(fields.back());
+                uint64_t call;
+                while (callStream >> call) calls.push_back(call);
+                addRow(columns, ids, stoull(fields[0]), stoull(fields[1]), stoull(fields[2]), players, calls);
+            } catch (const exception&) {
+                LOG_ERROR("Damaged row skipped in " + path);
+            }
+        }
+        return columns;
+    }
+
+    /**
+     * @brief Writes decoded columns as a segment, replacing any file at the path atomically
+     */
+    bool writeSegment(const string& path, const Columns& columns) {
+        vector<string> payloads(COLUMN_COUNT);
+        put32(payloads[NAMES], static_cast<uint32_t>(columns.names.size()));
+        for (const string& name : columns.names) {
+            put32(payloads[NAMES], static_cast<uint32_t>(name.size()));
+            payloads[NAMES] += name;
+        }
+        for (int column = START; column < COLUMN_COUNT; ++column) payloads[column] = pack(columns.values[column]);
+
+        string segment(MAGIC, 4);
+        put32(segment, static_cast<uint32_t>(columns.rows));
+        put32(segment, COLUMN_COUNT);
+        put32(segment, 0);
+        uint64_t offset = HEADER_BYTES + DIRECTORY_ENTRY * COLUMN_COUNT;
+        for (const string& payload : payloads) {
+            put64(segment, offset);
+            put64(segment, payload.size());
+            put32(segment, Crc32c::compute(payload));
+            put32(segment, 0);
+            offset += payload.size();
+        }
+        for (const string& payload : payloads) segment += payload;
+
+        string tmpPath = path + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            out.write(segment.data(), segment.size());
+            if (!out.flush()) return false;
+        }
+        error_code ec;
+        filesystem::rename(tmpPath, path, ec);
+        return !ec;
+    }
+
+    /**
+     * @brief Reads some columns of a segment
+     * @param path Segment file
+     * @param wanted Columns to read
+     * @param columns Output columns
+     * @return false if the segment is damaged
+     */
+    bool readSegment(const string& path, const vector<Column>& wanted, Columns& columns) {
+        ifstream in(path, ios::binary);
+        string head(HEADER_BYTES + DIRECTORY_ENTRY * COLUMN_COUNT, '\0');
+        if (!in.read(&head[0], head.size()) || head.compare(0, 4, MAGIC, 4) != 0 ||
+            get32(&head[8]) != COLUMN_COUNT) {
+            return false;
+        }
+        columns.rows = get32(&head[4]);
+
+        for (Column column : wanted) {
+            const char* entry = &head[HEADER_BYTES + DIRECTORY_ENTRY * column];
+            string payload(get64(entry + 8), '\0');
+            in.seekg(static_cast<streamoff>(get64(entry)));
+            if (!in.read(&payload[0], payload.size()) || Crc32c::compute(payload) != get32(entry + 16)) return false;
+
+            if (column != NAMES) {
+                if (!unpack(payload, columns.values[column])) return false;
+                continue;
+            }
+            if (payload.size() < 4) return false;
+            size_t count = get32(payload.data()), at = 4;
+            columns.names.clear();
+            for (size_t i = 0; i < count; ++i) {
+                if (at + 4 > payload.size()) return false;
+                size_t length = get32(payload.data() + at);
+                if (at + 4 + length > payload.size()) return false;
+                columns.names.emplace_back(payload, at + 4, length);
+                at += 4 + length;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Gets the sealed segment numbers, in ascending order
+     */
+    vector<uint64_t> segmentNumbers(const string& directory) {
+        vector<uint64_t> numbers;
+        error_code ec;
+        for (const auto& entry : filesystem::directory_iterator(directory, ec)) {
+            string file = entry.path().filename().string();
+            if (file.size() < 5 || file.compare(file.size() - 4, 4, ".col") != 0) continue;
+            string number = file.substr(0, file.size() - 4);
+            if (number.find_first_not_of("0123456789") != string::npos) continue;
+            numbers.push_back(stoull(number));
+        }
+        sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+
+    string segmentPath(const string& directory, uint64_t number) {
+        return directory + "/" + to_string(number) + ".col";
+    }
+
+    string tailPath(const string& directory, uint64_t number) {
+        return directory + "/" + to_string(number) + ".tail";
+    }
+
+    /**
+     * @brief Runs a scan over every segment and then the tail
+     * @param directory Directory of the history
+     * @param historyMutex Lock of the history within the process
+     * @param wanted Columns the scan reads
+     * @param visit Called with the columns of each segment and of the tail
+     * @param keep Optional test on a segment's dictionary; other columns of
+     *             segments it rejects are not read
+     */
+    void scan(const string& directory, mutex& historyMutex, const vector<Column>& wanted,
+              const function<void(const Columns&)>& visit,
+              const function<bool(const vector<string>&)>& keep = nullptr) {
+        if (!filesystem::exists(directory)) return;
+        lock_guard<mutex> lock(historyMutex);
+        FileLock readLock(directory + "/History.lock", FileLock::Mode::SHARED);
+
+        vector<uint64_t> numbers = segmentNumbers(directory);
+        for (uint64_t number : numbers) {
+            Columns columns;
+            bool ok = true;
+            string path = segmentPath(directory, number);
+            if (keep) {
+                ok = readSegment(path, {NAMES}, columns);
+                if (ok && !keep(columns.names)) continue;
+            }
+            if (!ok || !readSegment(path, wanted, columns)) {
+                LOG_ERROR("Damaged match history segment skipped: " + path);
+                continue;
+            }
+            visit(columns);
+        }
+        Columns tail = readTail(tailPath(directory, numbers.empty() ? 1 : numbers.back() + 1));
+        if (!keep || keep(tail.names)) visit(tail);
+    }
+}
+
+/**
+ * @brief Gets the history of a database
+ * @param db The database
+ * @return History under the database's root, created on first use
+ *
+ * Histories live until program exit, like the persistence services, so
+ * every user of one database shares one history and its lock.
+ */
+MatchHistory& MatchHistory::of(DB& db) {
+    static mutex registryMutex;
+    static unordered_map<DB*, unique_ptr<MatchHistory>> histories;
+    lock_guard<mutex> lock(registryMutex);
+    unique_ptr<MatchHistory>& history = histories[&db];
+    if (!history) history = make_unique<MatchHistory>(db.getRoot() + "/History");
+    return *history;
+}
+
+/**
+ * @brief Reads the results of every game from a segment on, in archive order
+ * @param first Number of the first segment or tail to read
+ * @param workers Number of segments decoded at once
+ * @param visit Called with each window in archive order, the tail last
+ *
+ * Segments are read and decoded in batches of workers on as many threads,
+ * then visited in segment order, so the result does not depend on the
+ * thread count and at most one batch is held in memory. A damaged segment
+ * is logged and visited as an empty window. Appends wait until the replay
+ * is done.
+ */
+void MatchHistory::replay(uint64_t first, size_t workers, const function<void(const MatchWindow&)>& visit) {
+    if (!filesystem::exists(DIRECTORY)) return;
+    lock_guard<mutex> lock(historyMutex);
+    FileLock readLock(DIRECTORY + "/History.lock", FileLock::Mode::SHARED);
+
+    auto toWindow = [](uint64_t number, Columns& columns) {
+        MatchWindow window;
+        window.number = number;
+        window.names = move(columns.names);
+        window.playerCounts = move(columns.values[PLAYER_COUNT]);
+        window.players = move(columns.values[PLAYERS]);
+        window.winners = move(columns.values[WINNER]);
+        const vector<uint64_t>& starts = columns.values[START];
+        const vector<uint64_t>& durations = columns.values[DURATION];
+        window.rows = min({columns.rows, starts.size(), durations.size(), window.playerCounts.size(), window.winners.size()});
+        window.finished.resize(window.rows);
+        for (size_t row = 0; row < window.rows; ++row) {
+            window.finished[row] = starts[row] == 0 ? 0 : starts[row] + durations[row];
+        }
+        return window;
+    };
+
+    vector<uint64_t> numbers = segmentNumbers(DIRECTORY);
+    uint64_t tailNumber = numbers.empty() ? 1 : numbers.back() + 1;
+    numbers.erase(numbers.begin(), lower_bound(numbers.begin(), numbers.end(), first));
+    workers = max<size_t>(workers, 1);
+
+    for (size_t begin = 0; begin < numbers.size(); begin += workers) {
+        size_t end = min(numbers.size(), begin + workers);
+        vector<MatchWindow> windows(end - begin);
+        auto decode = [&](size_t i) {
+            uint64_t number = numbers[begin + i];
+            Columns columns;
+            if (!readSegment(segmentPath(DIRECTORY, number), {NAMES, START, DURATION, PLAYER_COUNT, PLAYERS, WINNER}, columns)) {
+                LOG_ERROR("Damaged match history segment skipped: " + segmentPath(DIRECTORY, number));
+                windows[i].number = number;
+                return;
+            }
+            windows[i] = toWindow(number, columns);
+        };
+        vector<thread> threads;
+        for (size_t i = 1; i < windows.size(); ++i) threads.emplace_back(decode, i);
+        decode(0);
+        for (thread& t : threads) t.join();
+        for (const MatchWindow& window : windows) visit(window);
+    }
+
+    if (tailNumber >= first) {
+        Columns tail = readTail(tailPath(DIRECTORY, tailNumber));
+        visit(toWindow(tailNumber, tail));
+    }
+}
+
+/**
+ * @brief Appends a finished game
+ * @param history Players, start time and events of the game
+ * @param winner Username of the winner, empty if nobody won
+ * @return true if the game was written, false otherwise
+ *
+ * The row goes to the tail; the tail is sealed into a segment when it is
+ * full. Tails left behind by a crash after their segment was written are
+ * removed.
+ */
+bool MatchHistory::append(const GameHistory& history, const string& winner) {
+    if (history.players.empty()) return false;
+
+    uint64_t winnerPosition = 0;
+    string row = to_string(history.startTime) + "\t" +
+                 to_string(chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count());
+    for (size_t p = 0; p < history.players.size(); ++p) {
+        if (history.players[p] == winner) winnerPosition = p + 1;
+    }
+    row += "\t" + to_string(winnerPosition) + "\t" + to_string(history.players.size());
+    for (const string& name : history.players) row += "\t" + name;
+    row += "\t";
+    for (size_t i = 0; i < history.events.size(); ++i) {
+        int code = history.events[i];
+        if (i > 0) row += " ";
+        row += to_string(code == GameLog::FORFEIT ? FORFEIT_CALL : static_cast<uint64_t>(code));
+    }
+    row += "\n";
+
+    lock_guard<mutex> lock(historyMutex);
+    try {
+        filesystem::create_directories(DIRECTORY);
+        FileLock writeLock(DIRECTORY + "/History.lock", FileLock::Mode::EXCLUSIVE);
+
+        vector<uint64_t> numbers = segmentNumbers(DIRECTORY);
+        uint64_t current = numbers.empty() ? 1 : numbers.back() + 1;
+        error_code ec;
+        for (uint64_t number : numbers) filesystem::remove(tailPath(DIRECTORY, number), ec);
+
+        string tail = tailPath(DIRECTORY, current);
+        {
+            ofstream out(tail, ios::binary | ios::app);
+            out << row;
+            if (!out.flush()) {
+                LOG_ERROR("Failed to write match history");
+                return false;
+            }
+        }
+
+        // Rows are counted by their line ends; the tail is only parsed to seal it
+        ifstream in(tail, ios::binary);
+        size_t rows = std::count(istreambuf_iterator<char>(in), istreambuf_iterator<char>(), '\n');
+        in.close();
+        if (rows >= SEGMENT_ROWS) {
+            Columns columns = readTail(tail);
+            if (!writeSegment(segmentPath(DIRECTORY, current), columns)) {
+                LOG_ERROR("Failed to seal match history segment " + to_string(current));
+                return true;
+            }
+            filesystem::remove(tail, ec);
+            LOG_INFO("Match history segment " + to_string(current) + " sealed");
+        }
+    } catch (const exception& e) {
+        LOG_ERROR("Error writing match history: " + string(e.what()));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the record of two players against each other
+ * @param playerA Username of the first player
+ * @param playerB Username of the second player
+ * @return Games played together and the wins of each
+ *
+ * The player columns are only read from segments whose dictionary holds
+ * both names.
+ */
+HeadToHead MatchHistory::headToHead(const string& playerA, const string& playerB) {
+    HeadToHead result;
+    auto has = [&](const vector<string>& names) {
+        return find(names.begin(), names.end(), playerA) != names.end() &&
+               find(names.begin(), names.end(), playerB) != names.end();
+    };
+    scan(DIRECTORY, historyMutex, {NAMES, PLAYER_COUNT, PLAYERS, WINNER}, [&](const Columns& columns) {
+        uint64_t a = find(columns.names.begin(), columns.names.end(), playerA) - columns.names.begin();
+        uint64_t b = find(columns.names.begin(), columns.names.end(), playerB) - columns.names.begin();
+        const vector<uint64_t>& counts = columns.values[PLAYER_COUNT];
+        const vector<uint64_t>& players = columns.values[PLAYERS];
+        const vector<uint64_t>& winners = columns.values[WINNER];
+        size_t at = 0;
+        for (size_t row = 0; row < counts.size() && row < winners.size(); ++row) {
+            uint64_t positionA = 0, positionB = 0;
+            for (uint64_t p = 0; p < counts[row] && at + p < players.size(); ++p) {
+                if (players[at + p] == a) positionA = p + 1;
+                if (players[at + p] == b) positionB = p + 1;
+            }
+            at += counts[row];
+            if (positionA == 0 || positionB == 0) continue;
+            result.games++;
+            if (winners[row] == positionA) result.winsA++;
+            else if (winners[row] == positionB) result.winsB++;
+        }
+    }, has);
+    return result;
+}
+
+/**
+ * @brief Gets the average number of turns of a finished game
+ * @return Average event count, 0 if no game was archived
+ */
+double MatchHistory::averageLength() {
+    uint64_t games = 0, turns = 0;
+    scan(DIRECTORY, historyMutex, {TURNS}, [&](const Columns& columns) {
+        for (uint64_t value : columns.values[TURNS]) turns += value;
+        games += columns.values[TURNS].size();
+    });
+    return games == 0 ? 0.0 : static_cast<double>(turns) / games;
+}
+
+/**
+ * @brief Counts how often each number was called
+ * @return Calls of each number 1-25 at its index; index 0 counts skipped turns
+ */
+array<uint64_t, 26> MatchHistory::callFrequency() {
+    array<uint64_t, 27> counts{};
+    scan(DIRECTORY, historyMutex, {CALLS}, [&](const Columns& columns) {
+        for (uint64_t call : columns.values[CALLS]) counts[call <= FORFEIT_CALL ? call : FORFEIT_CALL]++;
+    });
+    array<uint64_t, 26> frequency{};
+    copy(counts.begin(), counts.begin() + 26, frequency.begin());
+    return frequency;
+}
+
+/**
+ * @brief Gets the number of archived games
+ */
+size_t MatchHistory::count() {
+    size_t games = 0;
+    scan(DIRECTORY, historyMutex, {}, [&](const Columns& columns) { games += columns.rows; });
+    return games;
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+/**
+ * @file Matchmaker.cpp
+ * @brief Implementation of the Matchmaker class
+ */
+
+#include "../include/Matchmaker.h"
+#include "../include/Logger.h"
+
+/**
+ * @brief Constructs a matchmaker
+ * @param rooms Room manager used to open rooms for matched pairs
+ * @param workerCount Number of pairing threads (0 uses the hardware concurrency)
+ * @param useBands If true, only players in the same win-rate band are paired
+ * @param capacity Capacity of each queue, must be a power of two
+ */
+Matchmaker::Matchmaker(RoomManager& rooms, size_t workerCount, bool useBands, size_t capacity)
+    : rooms(rooms),
+      workerCount(workerCount != 0 ? workerCount : max(1u, thread::hardware_concurrency())),
+      useBands(useBands),
+      intake(capacity) {
+    int bandCount = useBands ? BAND_COUNT : 1;
+    for (int i = 0; i < bandCount; ++i) {
+        bands.push_back(make_unique<MPMCQueue<unique_ptr<MatchTicket>>>(capacity));
+    }
+}
+
+/**
+ * @brief Destructor, stops the pairing workers
+ */
+Matchmaker::~Matchmaker() {
+    stop();
+}
+
+/**
+ * @brief Starts the pairing workers
+ */
+void Matchmaker::start() {
+    if (running.exchange(true)) return;
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&Matchmaker::workerLoop, this);
+    }
+    LOG_INFO("Matchmaker started with " + to_string(workerCount) + " workers");
+}
+
+/**
+ * @brief Stops the pairing workers; unmatched tickets stay queued
+ */
+void Matchmaker::stop() {
+    if (!running.exchange(false)) return;
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    LOG_INFO("Matchmaker stopped, " + to_string(matchCount()) + " matches, wait " + waitHistogram.summary());
+}
+
+/**
+ * @brief Adds a player to the matchmaking queue
+ * @param player The authenticated player
+ * @return true if queued, false if the queue is full
+ */
+bool Matchmaker::enqueue(const Player& player) {
+    auto ticket = make_unique<MatchTicket>(MatchTicket{player, chrono::steady_clock::now()});
+    depth.fetch_add(1, memory_order_relaxed);
+    if (!intake.push(move(ticket))) {
+        depth.fetch_sub(1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the callback invoked for every match
+ * @param callback Function receiving the room ID and both players
+ */
+void Matchmaker::setMatchCallback(MatchCallback callback) {
+    onMatch = move(callback);
+}
+
+/**
+ * @brief Gets the number of players waiting to be matched
+ * @return Queue depth
+ */
+int64_t Matchmaker::queueDepth() const {
+    return depth.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of rooms created so far
+ * @return Match count
+ */
+uint64_t Matchmaker::matchCount() const {
+    return matches.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the histogram of time spent in the queue by matched players
+ * @return Constant reference to the wait-time histogram
+ */
+const LatencyHistogram& Matchmaker::waitTimes() const {
+    return waitHistogram;
+}
+
+/**
+ * @brief Maps a win rate to a band index
+ * @param winRate Win rate percentage (0-100)
+ * @return Band index from 0 to BAND_COUNT - 1
+ */
+int Matchmaker::bandOf(double winRate) {
+    int band = static_cast<int>(winRate / (100.0 / BAND_COUNT));
+    if (band < 0) return 0;
+    if (band >= BAND_COUNT) return BAND_COUNT - 1;
+    return band;
+}
+
+/**
+ * @brief Main loop of a pairing worker
+ *
+ * Workers spin briefly when idle and then back off with short sleeps,
+ * so an empty queue costs almost no CPU.
+ */
+void Matchmaker::workerLoop() {
+    int idleRounds = 0;
+    while (running.load(memory_order_relaxed)) {
+        bool progressed = drainIntake();
+        if (!progressed) {
+            progressed = sweepBands();
+        }
+
+        if (progressed) {
+            idleRounds = 0;
+        } else if (++idleRounds < 64) {
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+}
+
+/**
+ * @brief Moves one ticket from intake into its band, pairing it if possible
+ * @return true if a ticket was processed
+ */
+bool Matchmaker::drainIntake() {
+    unique_ptr<MatchTicket> ticket;
+    if (!intake.pop(ticket)) return false;
+
+    int band = useBands ? bandOf(ticket->player.getWinRate()) : 0;
+    unique_ptr<MatchTicket> partner;
+    if (bands[band]->pop(partner)) {
+        if (partner->player.getUsername() != ticket->player.getUsername()) {
+            pair(*partner, *ticket);
+            return true;
+        }
+        park(band, move(partner));
+    }
+    park(band, move(ticket));
+    return true;
+}
+
+/**
+ * @brief Pairs tickets that were parked in the same band by different workers
+ * @return true if any pair was made
+ *
+ * Two workers can each find a band empty and park their tickets at the
+ * same moment; the sweep pairs such leftovers.
+ */
+bool Matchmaker::sweepBands() {
+    bool paired = false;
+    for (size_t band = 0; band < bands.size(); ++band) {
+        if (bands[band]->sizeApprox() < 2) continue;
+
+        unique_ptr<MatchTicket> first, second;
+        if (!bands[band]->pop(first)) continue;
+        if (!bands[band]->pop(second)) {
+            park(static_cast<int>(band), move(first));
+            continue;
+        }
+
+        if (first->player.getUsername() != second->player.getUsername()) {
+            pair(*first, *second);
+            paired = true;
+        } else {
+            park(static_cast<int>(band), move(first));
+            park(static_cast<int>(band), move(second));
+        }
+    }
+    return paired;
+}
+
+/**
+ * @brief Parks a ticket in a band queue, retrying while the queue is full
+ * @param band Band index
+ * @param ticket The ticket to park
+ */
+void Matchmaker::park(int band, unique_ptr<MatchTicket> ticket) {
+    while (!bands[band]->push(move(ticket))) {
+        this_thread::yield();
+    }
+}
+
+/**
+ * @brief Opens a room for two tickets and records metrics
+ * @param first Ticket that waited longer
+ * @param second Ticket that arrived later
+ */
+void Matchmaker::pair(const MatchTicket& first, const MatchTicket& second) {
+    auto now = chrono::steady_clock::now();
+    waitHistogram.record(now - first.enqueuedAt);
+    waitHistogram.record(now - second.enqueuedAt);
+
+    string roomId = rooms.createRoom(first.player, second.player);
+    depth.fetch_sub(2, memory_order_relaxed);
+    matches.fetch_add(1, memory_order_relaxed);
+
+    if (onMatch) {
+        onMatch(roomId, first.player, second.player);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+/**
+ * @file MemoryEngine.cpp
+ * @brief Implementation of the in-memory storage engine
+ */
+
+#include "../include/MemoryEngine.h"
+
+#include <mutex>
+
+/**
+ * @brief Creates an empty engine
+ * @param shards Number of shards per table
+ */
+MemoryEngine::MemoryEngine(size_t shards) : shards(shards == 0 ? 1 : shards) {}
+
+/**
+ * @brief Gets a stamp that changes whenever a shard is written
+ * @param table Table name
+ * @param shard Shard index
+ * @return Number of batches that wrote the shard
+ */
+uint64_t MemoryEngine::generation(const string& table, size_t shard) {
+    shared_lock<shared_mutex> lock(tableMutex);
+    auto it = generations.find(table);
+    return it == generations.end() || shard >= it->second.size() ? 0 : it->second[shard];
+}
+
+/**
+ * @brief Reads one record
+ * @param table Table name
+ * @param key Record key
+ * @param value Output record JSON
+ * @return true if the record exists
+ */
+bool MemoryEngine::get(const string& table, const string& key, string& value) {
+    shared_lock<shared_mutex> lock(tableMutex);
+    auto records = tables.find(table);
+    if (records == tables.end()) return false;
+    auto it = records->second.find(key);
+    if (it == records->second.end()) return false;
+    value = it->second;
+    return true;
+}
+
+/**
+ * @brief Reads every record of a table
+ * @param table Table name
+ * @return Pairs of key and record JSON
+ */
+vector<pair<string, string>> MemoryEngine::scan(const string& table) {
+    shared_lock<shared_mutex> lock(tableMutex);
+    auto records = tables.find(table);
+    if (records == tables.end()) return {};
+    return vector<pair<string, string>>(records->second.begin(), records->second.end());
+}
+
+/**
+ * @brief Applies every operation of a batch
+ * @param batch Changes to apply
+ * @return Always true
+ */
+bool MemoryEngine::apply(const WriteBatch& batch) {
+    unique_lock<shared_mutex> lock(tableMutex);
+    for (const auto& op : batch.operations) {
+        auto& records = tables[op.table];
+        if (op.value) records[op.key] = *op.value;
+        else records.erase(op.key);
+
+        auto& counts = generations[op.table];
+        counts.resize(shards, 0);
+        ++counts[shardOf(op.key, shards)];
+    }
+    return true;
+}
\ No newline at end of file
@@ -6,15 +6,53 @@
 #include "../include/Menu.h"
 #include "../include/Leaderboard.h"
 #include "../include/Game.h"
+#include "../include/GameLog.h"
+#include "../include/Replay.h"
 #include "../include/DB.h"
+#include "../include/Logger.h"
 #include "../include/Util.h"
 
 #include <chrono>
 
 /**
- * @brief Constructor initializes the menu with isRunning set to true
+ * @brief Constructor initializes the menu with isRunning set to true, using the default database
  */
-Menu::Menu() : isRunning(true) {}
+Menu::Menu() : Menu(DB::getInstance()) {}
+
+/**
+ * @brief Constructor for Menu class
+ * @param db Database games and players are loaded from and saved to
+ */
+Menu::Menu(DB& db) : db(db), isRunning(true), leaderboard(db) {}
+
+/**
+ * @brief Starts loading what the menu needs on background threads
+ * 
+ * The snapshots are published by the database, so any later reader gets
+ * them without parsing; the ranking index is built with the player
+ * snapshot and kept up to date by later commits. The ratings and the
+ * windowed counters are loaded with it and take in any games archived
+ * since they were saved.
+ */
+void Menu::warmUp() {
+    playersWarm = async(launch::async, [this] { leaderboard.prepare(); });
+    gamesWarm = async(launch::async, [this] { db.snapshot<Game>(); });
+}
+
+/**
+ * @brief Waits for a warm-up task if it has not been joined yet
+ * @param task Task started by warmUp()
+ * 
+ * A failed warm-up is only logged; the caller then loads the data itself.
+ */
+void Menu::join(future<void>& task) {
+    if (!task.valid()) return;
+    try {
+        task.get();
+    } catch (const exception& e) {
+        db.getLogger().error("Warm-up failed: " + string(e.what()));
+    }
+}
 
 /**
  * @brief Displays the game rules in a formatted manner
@@ -68,7 +106,7 @@ void Menu::handleStartGame(Player& p1, Player& p2) {
     system("cls");
     displayCurrentTime();
     
-    Game game = Game();
+    Game game(db);
 
     system("cls");
     displayCurrentTime();
@@ -86,9 +124,8 @@ void Menu::handleStartGame(Player& p1, Player& p2) {
         game.playTurn();
     }
 
-    // reload player saved data
-    vector<Player> updatedPlayers = DB::getInstance().load<Player>();
-    for (const Player& updatedPlayer : updatedPlayers) {
+    // take the updated statistics from the game, the save may still be in flight
+    for (const Player& updatedPlayer : game.getPlayers()) {
         if (updatedPlayer.getUsername() == p1.getUsername()) {
             p1 = updatedPlayer;
         }
@@ -117,7 +154,8 @@ void Menu::handleLoadGame(Player& p1, Player& p2) {
     displayCurrentTime();
     cout << "\n=== Load Game ===" << endl;
     
-    vector<Game> games = DB::getInstance().load<Game>();
+    join(gamesWarm);
+    vector<Game> games = *db.snapshot<Game>();
     
     if (!Game::displaySavedGames(games, p1, p2)) {
         return;
@@ -153,10 +191,23 @@ void Menu::handleLoadGame(Player& p1, Player& p2) {
         }
 
         Game game = games[choice - 1];
+        // The move log holds the exact state, including numbers already called
+        if (GameLog::exists(db, game.getGameId())) {
+            GameLog::rebuild(game.getGameId(), game);
+        }
         vector<Player> ps = {p1, p2};
         game.loadPlayerData(ps);
         game.continueGame();
 
+        for (const Player& updatedPlayer : game.getPlayers()) {
+            if (updatedPlayer.getUsername() == p1.getUsername()) {
+                p1 = updatedPlayer;
+            }
+            if (updatedPlayer.getUsername() == p2.getUsername()) {
+                p2 = updatedPlayer;
+            }
+        }
+
     } catch (...) {
         cout << "Invalid input. Please enter a number from the list above.\n";
         cout << "Press Enter to continue...";
@@ -170,13 +221,16 @@ void Menu::handleLoadGame(Player& p1, Player& p2) {
  * @brief Handles searching and displaying player records
  * 
  * This method:
- * 1. Loads all players from the database
+ * 1. Takes the players of the current snapshot, part by part, without
+ *    waiting for pending saves or combining the snapshot
  * 2. Displays a list of players
  * 3. Allows user to select a player
  * 4. Shows detailed statistics for the selected player
  */
 void Menu::handleSearchRecord() {
-    vector<Player> players = DB::getInstance().load<Player>();
+    join(playersWarm);
+    PlayerPart players;
+    for (const auto& part : db.snapshotParts<Player>()) players.insert(players.end(), part->begin(), part->end());
     if (players.empty()) {
         cout << "No players found." << endl;
         Util::waitEnter();
@@ -189,9 +243,9 @@ void Menu::handleSearchRecord() {
 
         int count = 0;
         string choice;
-        for (Player& player : players) {
+        for (const auto& player : players) {
             count++;
-            cout << count << ". " << player.getUsername() << endl;
+            cout << count << ". " << player->getUsername() << endl;
         }
 
         Util::showLine();
@@ -206,19 +260,19 @@ void Menu::handleSearchRecord() {
         }
 
         int input = stoi(choice);
-        if (input < 1 || input > players.size()) {
+        if (input < 1 || static_cast<size_t>(input) > players.size()) {
             cout << "Invalid input! Please enter again.\n";
             Util::showLine();
             Util::waitEnter();
             continue;
         }
 
-        cout << "\nBingo Game Statistics for " << players[input - 1].getUsername() << ":\n";
+        cout << "\nBingo Game Statistics for " << players[input - 1]->getUsername() << ":\n";
         cout << string(40, '-') << "\n";
-        cout << "Total Games Completed: " << players[input - 1].getGameCount() << "\n";
-        cout << "Victories: " << players[input - 1].getWinCount() << "\n";
-        cout << "Losses: " << players[input - 1].getLoseCount() << "\n";
-        cout << "Win Rate: " << fixed << setprecision(1) << players[input - 1].getWinRate() << "%\n";
+        cout << "Total Games Completed: " << players[input - 1]->getGameCount() << "\n";
+        cout << "Victories: " << players[input - 1]->getWinCount() << "\n";
+        cout << "Losses: " << players[input - 1]->getLoseCount() << "\n";
+        cout << "Win Rate: " << fixed << setprecision(1) << players[input - 1]->getWinRate() << "%\n";
         Util::showLine();
         Util::waitEnter();
         break;
@@ -228,14 +282,140 @@ void Menu::handleSearchRecord() {
 /**
  * @brief Handles displaying the leaderboard
  * 
- * Clears the screen, displays the leaderboard, and waits for user input
- * before returning to the main menu.
+ * Shows the leaderboard one page at a time; the user pages forwards and
+ * backwards, switches the order between win rate, wins, games played
+ * and rating, or switches between all games and those of the last day,
+ * week or season, until they quit back to the main menu.
  */
 void Menu::handleViewLeaderboard() {
+    join(playersWarm);
+
+    size_t offset = 0;
+    Leaderboard::SortKey key = Leaderboard::SortKey::WIN_RATE;
+    Leaderboard::Period period = Leaderboard::Period::ALL_TIME;
+    while (true) {
+        system("cls");
+        size_t total = leaderboard.displayPage(offset, Leaderboard::PAGE_SIZE, key, period);
+        Util::showLine();
+        if (total == 0 && period == Leaderboard::Period::ALL_TIME) {
+            Util::waitEnter();
+            return;
+        }
+
+        cout << "N = next, P = previous, W = win rate, V = wins, G = games played, R = rating," << endl;
+        cout << "A = all time, D = last 24 hours, K = last 7 days, S = season, Q = quit: ";
+        string command;
+        if (!(cin >> command) || command == "q" || command == "Q") break;
+        if (command == "n" || command == "N") {
+            if (offset + Leaderboard::PAGE_SIZE < total) offset += Leaderboard::PAGE_SIZE;
+        } else if (command == "p" || command == "P") {
+            offset = offset >= Leaderboard::PAGE_SIZE ? offset - Leaderboard::PAGE_SIZE : 0;
+        } else if (command == "w" || command == "W") {
+            key = Leaderboard::SortKey::WIN_RATE;
+            offset = 0;
+        } else if (command == "v" || command == "V") {
+            key = Leaderboard::SortKey::WINS;
+            offset = 0;
+        } else if (command == "g" || command == "G") {
+            key = Leaderboard::SortKey::GAMES;
+            offset = 0;
+        } else if (command == "r" || command == "R") {
+            key = Leaderboard::SortKey::RATING;
+            offset = 0;
+        } else if (command == "a" || command == "A") {
+            period = Leaderboard::Period::ALL_TIME;
+            offset = 0;
+        } else if (command == "d" || command == "D") {
+            period = Leaderboard::Period::DAY;
+            offset = 0;
+        } else if (command == "k" || command == "K") {
+            period = Leaderboard::Period::WEEK;
+            offset = 0;
+        } else if (command == "s" || command == "S") {
+            period = Leaderboard::Period::SEASON;
+            offset = 0;
+        }
+    }
+}
+
+/**
+ * @brief Handles browsing archived replays turn by turn
+ * 
+ * Lists the most recent replays, then lets the user step through the
+ * selected game or jump straight to any turn.
+ */
+void Menu::handleWatchReplay() {
+    vector<ReplayInfo> replays = ReplayArchive::list(db, 10);
+    if (replays.empty()) {
+        cout << "No replays found." << endl;
+        Util::waitEnter();
+        return;
+    }
+
     system("cls");
-    leaderboard.displayLeaderboard();
+    cout << "\n=== Recent Replays ===" << endl;
+    for (size_t i = 0; i < replays.size(); ++i) {
+        cout << i + 1 << ". " << replays[i].gameId << endl;
+    }
     Util::showLine();
-    Util::waitEnter();
+    cout << "Enter Replay Number: ";
+    string choice;
+    cin >> choice;
+
+    size_t selected = Util::isNumber(choice) ? static_cast<size_t>(stoi(choice)) : 0;
+    if (selected < 1 || selected > replays.size()) {
+        cout << "Invalid input!\n";
+        Util::waitEnter();
+        return;
+    }
+
+    ReplayReader reader;
+    if (!reader.open(db, replays[selected - 1].gameId)) {
+        cout << "Replay could not be read.\n";
+        Util::waitEnter();
+        return;
+    }
+
+    size_t turn = 0;
+    BoardSnapshot state;
+    while (reader.seek(turn, state)) {
+        system("cls");
+        cout << "\n=== Replay " << replays[selected - 1].gameId << " ===" << endl;
+        cout << "Turn " << turn << " of " << reader.turnCount();
+        if (turn > 0) {
+            int event = reader.eventAt(turn - 1);
+            if (event == 0) cout << " (turn skipped)";
+            else if (event == 255) cout << " (forfeit)";
+            else cout << " (called " << event << ")";
+        }
+        cout << endl;
+
+        for (size_t p = 0; p < state.usernames.size(); ++p) {
+            cout << "\n" << state.usernames[p] << "'s board:" << endl;
+            for (int cell = 0; cell < 25; ++cell) {
+                if (state.marked[p] & (1u << cell)) cout << setw(4) << "X";
+                else cout << setw(4) << state.boards[p][cell];
+                if (cell % 5 == 4) cout << endl;
+            }
+        }
+        if (turn == reader.turnCount() && reader.getWinner() >= 0) {
+            cout << "\nWinner: " << reader.getPlayers()[reader.getWinner()] << endl;
+        }
+
+        Util::showLine();
+        cout << "N = next, P = previous, number = jump to turn, Q = quit: ";
+        string command;
+        cin >> command;
+
+        if (command == "q" || command == "Q") break;
+        if (command == "n" || command == "N") {
+            if (turn < reader.turnCount()) turn++;
+        } else if (command == "p" || command == "P") {
+            if (turn > 0) turn--;
+        } else if (Util::isNumber(command) && stoul(command) <= reader.turnCount()) {
+            turn = stoul(command);
+        }
+    }
 }
 
 /**
@@ -263,6 +443,7 @@ void Menu::displayMainMenu(Player& p1, Player& p2) {
     while (isRunning) {
         system("cls");
         displayCurrentTime();
+        for (const string& notice : Game::takeNotices()) cout << notice << endl;
             
         cout << "\n=== Bingo Game Menu ===" << endl;
         cout << "1. View Rules" << endl;
@@ -270,13 +451,14 @@ void Menu::displayMainMenu(Player& p1, Player& p2) {
         cout << "3. Load Saved Game" << endl;
         cout << "4. Search Record" << endl;
         cout << "5. View Leaderboard" << endl;
-        cout << "6. Exit" << endl;
-        cout << "Choose (1-6): ";
+        cout << "6. Watch Replay" << endl;
+        cout << "7. Exit" << endl;
+        cout << "Choose (1-7): ";
 
         string input;
         cin >> input;
             
-        if (input.length() == 1 && input[0] >= '1' && input[0] <= '6') {
+        if (input.length() == 1 && input[0] >= '1' && input[0] <= '7') {
             int choice = input[0] - '0';
                 
             switch (choice) {
@@ -285,10 +467,11 @@ void Menu::displayMainMenu(Player& p1, Player& p2) {
                 case 3: handleLoadGame(p1, p2); break;
                 case 4: handleSearchRecord(); break;
                 case 5: handleViewLeaderboard(); break;
-                case 6: exitProgram(); break;
+                case 6: handleWatchReplay(); break;
+                case 7: exitProgram(); break;
             }
         } else {
-            cout << "Please enter a number between 1 and 6." << endl;
+            cout << "Please enter a number between 1 and 7." << endl;
             cout << "Press Enter to continue..." << endl;
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             cin.get();
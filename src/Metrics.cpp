@@ -0,0 +1,95 @@
+/**
+ * @file Metrics.cpp
+ * @brief Implementation of the LatencyHistogram class
+ */
+
+#include "../include/Metrics.h"
+
+#include <sstream>
+
+/**
+ * @brief Records one duration sample
+ * @param duration The duration to record
+ */
+void LatencyHistogram::record(chrono::nanoseconds duration) {
+    uint64_t micros = duration.count() <= 0 ? 0 : static_cast<uint64_t>(duration.count()) / 1000;
+    int index = 0;
+    while (index < BUCKETS - 1 && (micros >> index) != 0) {
+        index++;
+    }
+
+    buckets[index].fetch_add(1, memory_order_relaxed);
+    total.fetch_add(1, memory_order_relaxed);
+    sumMicros.fetch_add(micros, memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the total number of samples
+ * @return Sample count
+ */
+uint64_t LatencyHistogram::count() const {
+    return total.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of samples in one bucket
+ * @param index Bucket index (0 to BUCKETS - 1)
+ * @return Sample count in the bucket, 0 for an out-of-range index
+ */
+uint64_t LatencyHistogram::bucket(int index) const {
+    if (index < 0 || index >= BUCKETS) return 0;
+    return buckets[index].load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the mean of all samples
+ * @return Mean duration in microseconds
+ */
+double LatencyHistogram::meanMicros() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sumMicros.load(memory_order_relaxed)) / n;
+}
+
+/**
+ * @brief Estimates a percentile from the buckets
+ * @param p Percentile in the range 0-100
+ * @return Upper bound of the bucket containing the percentile, in microseconds
+ */
+uint64_t LatencyHistogram::percentileMicros(double p) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(n * (p / 100.0));
+    if (target >= n) target = n - 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += bucket(i);
+        if (seen > target) return 1ull << i;
+    }
+    return 1ull << (BUCKETS - 1);
+}
+
+/**
+ * @brief Formats count, mean, p50 and p99 as one line
+ * @return Summary string suitable for logging
+ */
+string LatencyHistogram::summary() const {
+    stringstream ss;
+    ss << "count=" << count()
+        << " mean=" << static_cast<uint64_t>(meanMicros()) << "us"
+        << " p50<=" << percentileMicros(50) << "us"
+        << " p99<=" << percentileMicros(99) << "us";
+    return ss.str();
+}
+
+/**
+ * @brief Clears all buckets
+ */
+void LatencyHistogram::reset() {
+    for (auto& b : buckets) {
+        b.store(0, memory_order_relaxed);
+    }
+    total.store(0, memory_order_relaxed);
+    sumMicros.store(0, memory_order_relaxed);
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+/**
+ * @file Migration.cpp
+ * @brief Implementation of the Migration class
+ */
+
+#include "../include/Migration.h"
+#include "../include/Player.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+namespace {
+    string readFile(const string& path) {
+        ifstream in(path, ios::binary);
+        stringstream buffer;
+        buffer << in.rdbuf();
+        return buffer.str();
+    }
+
+    /**
+     * @brief Replaces a small file through a temporary file and a rename
+     */
+    bool replaceFile(const string& path, const string& content) {
+        string tmpPath = path + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            out << content;
+            if (!out.flush()) return false;
+        }
+        error_code ec;
+        filesystem::rename(tmpPath, path, ec);
+        return !ec;
+    }
+
+    /**
+     * @brief Version 1 to 2: account records written by Account::create() get player statistics
+     *
+     * Player::from_json() needs the game, win and lose counts, so a record
+     * with only a username and password made its whole shard unreadable.
+     */
+    string addPlayerStatistics(const string& record) {
+        if (record.find("\"gameCount\"") != string::npos) return record;
+        vector<Account> accounts = Account::from_json(record);
+        if (accounts.size() != 1) throw runtime_error("not an account record");
+        return Player(accounts.front().getUsername(), accounts.front().getPassword()).to_json();
+    }
+}
+
+/**
+ * @brief Gets every converter, in version order
+ */
+const vector<Migration::Converter>& Migration::converters() {
+    static const vector<Converter> all = {
+        {"Account", 1, "add player statistics to account records", addPlayerStatistics},
+    };
+    return all;
+}
+
+/**
+ * @brief Creates a migration of a database
+ * @param db Database whose records are converted; init() must have been called
+ * @param logger Logger receiving the migration's messages
+ */
+Migration::Migration(DB& db, Logger& logger)
+    : db(db),
+      logger(logger),
+      SCHEMA(db.getRoot() + "/Schema.json"),
+      PROGRESS(db.getRoot() + "/Migration.json") {}
+
+/**
+ * @brief Gets the schema version of the stored records
+ * @return Version from Schema.json, 1 if there is none
+ */
+int Migration::storedVersion() const {
+    string content = readFile(SCHEMA);
+    size_t pos = content.find("\"version\":");
+    if (pos == string::npos) return 1;
+    return atoi(content.c_str() + pos + 10);
+}
+
+/**
+ * @brief Converts every stored record to the current schema
+ * @param workers Number of shards converted at once
+ * @return true if the store is at the current version afterwards
+ *
+ * This method performs the following steps:
+ * 1. Reads the stored version and the shards an interrupted run finished
+ * 2. Lists the shards of every table that has converters to apply
+ * 3. Converts the pending shards, workers at a time, recording each one
+ *    in Migration.json as it commits
+ * 4. Writes the new version to Schema.json and removes Migration.json
+ *
+ * The memory engine keeps nothing between runs, so there is nothing to
+ * convert.
+ */
+bool Migration::run(size_t workers) {
+    if (db.storage().name() == "memory") return true;
+
+    int from = storedVersion();
+    if (from >= CURRENT_VERSION) {
+        logger.info("Schema is at version " + to_string(from) + ", nothing to migrate");
+        return true;
+    }
+    loadProgress(from);
+
+    // Steps to apply to each table, and the shards still to convert
+    map<string, vector<const Converter*>> steps;
+    for (const Converter& converter : converters()) {
+        if (converter.from < from) continue;
+        steps[converter.table].push_back(&converter);
+        logger.info("Migration step " + to_string(converter.from) + " to " + to_string(converter.from + 1) +
+                    ": " + converter.description);
+    }
+    vector<pair<const string*, size_t>> pending;
+    for (const auto& table : steps) {
+        for (size_t shard = 0; shard < db.shardCount(); ++shard) {
+            if (!done.count(table.first + "." + to_string(shard))) pending.push_back({&table.first, shard});
+        }
+    }
+    logger.info("Migrating schema " + to_string(from) + " to " + to_string(CURRENT_VERSION) + ": " +
+                to_string(pending.size()) + " shards pending, " + to_string(done.size()) + " already done");
+
+    // Workers take the next pending shard until none is left
+    atomic<size_t> next{0};
+    atomic<bool> ok{true};
+    auto work = [&]() {
+        for (size_t i = next++; i < pending.size(); i = next++) {
+            const string& table = *pending[i].first;
+            size_t shard = pending[i].second;
+            if (!migrateShard(table, shard, steps.at(table)) || !markDone(from, table + "." + to_string(shard))) {
+                ok = false;
+            }
+        }
+    };
+    vector<thread> threads;
+    for (size_t i = 1; i < min(max<size_t>(1, workers), pending.size()); ++i) threads.emplace_back(work);
+    work();
+    for (thread& t : threads) t.join();
+
+    if (!ok) {
+        logger.error("Migration incomplete, run it again to convert the remaining shards");
+        return false;
+    }
+    if (!replaceFile(SCHEMA, "{\"version\":" + to_string(CURRENT_VERSION) + "}")) {
+        logger.error("Error writing " + SCHEMA);
+        return false;
+    }
+    error_code ec;
+    filesystem::remove(PROGRESS, ec);
+    logger.info("Schema migrated to version " + to_string(CURRENT_VERSION));
+    return true;
+}
+
+/**
+ * @brief Reads the shards finished by an earlier run of the same migration
+ * @param from Stored version
+ *
+ * Progress left by a migration from another version, or before the
+ * store was resharded, is ignored.
+ */
+void Migration::loadProgress(int from) {
+    lock_guard<mutex> lock(progressMutex);
+    done.clear();
+    string content = readFile(PROGRESS);
+    size_t pos = content.find("\"from\":");
+    if (pos == string::npos || atoi(content.c_str() + pos + 7) != from) return;
+    if (content.find("\"to\":" + to_string(CURRENT_VERSION) + ",") == string::npos) return;
+    if (content.find("\"shards\":" + to_string(db.shardCount()) + ",") == string::npos) return;
+
+    pos = content.find("\"done\":[");
+    if (pos == string::npos) return;
+    size_t end = content.find(']', pos);
+    for (pos = content.find('"', pos + 8); pos < end; pos = content.find('"', pos + 1)) {
+        size_t close = content.find('"', pos + 1);
+        if (close == string::npos || close > end) break;
+        done.insert(content.substr(pos + 1, close - pos - 1));
+        pos = close;
+    }
+}
+
+/**
+ * @brief Records a finished shard in the progress file
+ * @param from Stored version
+ * @param shard Shard name, "<table>.<shard>"
+ * @return false if the progress file could not be written
+ */
+bool Migration::markDone(int from, const string& shard) {
+    lock_guard<mutex> lock(progressMutex);
+    done.insert(shard);
+    string content = "{\"from\":" + to_string(from) + ",\"to\":" + to_string(CURRENT_VERSION) +
+                     ",\"shards\":" + to_string(db.shardCount()) + ",\"done\":[";
+    bool first = true;
+    for (const string& name : done) {
+        if (!first) content += ",";
+        content += "\"" + name + "\"";
+        first = false;
+    }
+    content += "]}";
+    if (!replaceFile(PROGRESS, content)) {
+        logger.error("Error writing " + PROGRESS);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Converts the records of one shard
+ * @param table "Account" or "Game"
+ * @param shard Shard index
+ * @param steps Converters to apply, in order
+ * @return false if a record could not be converted or the commit failed
+ *
+ * The shard stays locked from the read to the commit, so writers in this
+ * and other processes can keep using the rest of the store. Only records
+ * the converters changed are written.
+ */
+bool Migration::migrateShard(const string& table, size_t shard, const vector<const Converter*>& steps) {
+    DB::Transaction txn = db.begin();
+    txn.lockShard(table, shard);
+
+    size_t total = 0, converted = 0;
+    for (auto& record : db.storage().scanShard(table, shard)) {
+        ++total;
+        string value = record.second;
+        try {
+            for (const Converter* step : steps) value = step->convert(value);
+        } catch (const exception& e) {
+            logger.error("Cannot convert " + table + " record " + record.first + ": " + e.what());
+            return false;
+        }
+        if (value == record.second) continue;
+        txn.put(table, record.first, value);
+        ++converted;
+    }
+    if (!txn.commit()) {
+        logger.error("Error committing " + table + " shard " + to_string(shard));
+        return false;
+    }
+    logger.info("Migrated " + table + " shard " + to_string(shard) + ": " + to_string(converted) + " of " +
+                to_string(total) + " records converted");
+    return true;
+}
\ No newline at end of file
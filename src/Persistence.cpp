@@ -0,0 +1,385 @@
+/**
+ * @file Persistence.cpp
+ * @brief Implementation of the Persistence class
+ */
+
+#include "../include/Persistence.h"
+#include "../include/Game.h"
+#include "../include/DB.h"
+#include "../include/Logger.h"
+
+#include <chrono>
+#include <iterator>
+#include <memory>
+
+/**
+ * @brief Starts the background writer thread
+ */
+void Persistence::start() {
+    lock_guard<mutex> lock(queueMutex);
+    if (running) return;
+    running = true;
+    worker = thread(&Persistence::run, this);
+}
+
+/**
+ * @brief Writes everything pending and stops the writer thread
+ *
+ * The worker drains the pending batch before it exits, so stop() doubles
+ * as the shutdown barrier.
+ */
+void Persistence::stop() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (!running) return;
+        running = false;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+/**
+ * @brief Stops the worker
+ */
+Persistence::~Persistence() {
+    stop();
+}
+
+/**
+ * @brief Gets the service writing to a database
+ * @param db The database
+ * @return getInstance() for the default database, else a service created on first use
+ *
+ * Services of other databases live until program exit, so the database
+ * must not be destroyed while games bound to it are still saved.
+ */
+Persistence& Persistence::of(DB& db) {
+    if (&db == &DB::getInstance()) return getInstance();
+
+    static mutex registryMutex;
+    static unordered_map<DB*, unique_ptr<Persistence>> services;
+    lock_guard<mutex> lock(registryMutex);
+    unique_ptr<Persistence>& service = services[&db];
+    if (!service) service = make_unique<Persistence>(db);
+    return *service;
+}
+
+/**
+ * @brief Queues the current state of a game
+ * @param game The game to save
+ * @param done Optional callback run on the writer thread with whether the state was written
+ *
+ * A callback of an older pending state of the same game is told the
+ * outcome of the newer one that replaced it.
+ */
+void Persistence::saveGame(const Game& game, function<void(bool)> done) {
+    string gameId = game.getGameId();
+    string json = game.to_json();
+    enqueue("game:" + gameId, [&](Batch& batch) {
+        GameWrite& write = batch.games[gameId];
+        write.json = json;
+        write.remove = false;
+        if (done) write.done.push_back(done);
+    });
+}
+
+/**
+ * @brief Queues removal of a game from the saved-game list
+ * @param gameId ID of the game
+ * @param after Optional action run on the writer thread once the removal is written
+ */
+void Persistence::removeGame(const string& gameId, function<void()> after) {
+    enqueue("game:" + gameId, [&](Batch& batch) {
+        GameWrite& write = batch.games[gameId];
+        write.json.clear();
+        write.remove = true;
+        if (after) write.after.push_back(after);
+    });
+}
+
+/**
+ * @brief Queues the result of a game together with its removal
+ * @param players Players of the game
+ * @param winner Username of the winner
+ * @param gameId ID of the finished game
+ * @param after Optional action run on the writer thread once the batch is written
+ * @param done Optional callback run on the writer thread with whether the result was written
+ */
+void Persistence::finishGame(const vector<Player>& players, const string& winner, const string& gameId,
+                             function<void()> after, function<void(bool)> done) {
+    enqueue("game:" + gameId, [&](Batch& batch) {
+        for (const Player& player : players) {
+            PlayerWrite& write = batch.players[player.getUsername()];
+            if (player.getUsername() == winner) write.wins++;
+            else write.losses++;
+        }
+        GameWrite& write = batch.games[gameId];
+        write.json.clear();
+        write.remove = true;
+        if (after) write.after.push_back(after);
+        if (done) write.done.push_back(done);
+    });
+}
+
+/**
+ * @brief Blocks until every write queued before the call is on disk or given up
+ * @return false if a batch was given up while waiting
+ */
+bool Persistence::flush() {
+    unique_lock<mutex> lock(queueMutex);
+    uint64_t target = enqueued;
+    uint64_t lostBefore = lostCount.load(memory_order_relaxed);
+    progress.wait(lock, [&] { return written >= target; });
+    return lostCount.load(memory_order_relaxed) == lostBefore;
+}
+
+/**
+ * @brief Gets the number of pending keys
+ * @return Pending game and player writes
+ */
+size_t Persistence::pending() {
+    lock_guard<mutex> lock(queueMutex);
+    return pendingBatch.games.size() + pendingBatch.players.size();
+}
+
+/**
+ * @brief Gets the number of writes absorbed by a newer write of the same key
+ * @return Coalesced write count
+ */
+uint64_t Persistence::coalesced() const {
+    return coalescedCount.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of batches written
+ * @return Batch count
+ */
+uint64_t Persistence::batches() const {
+    return batchCount.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of batches given up after repeated write failures
+ * @return Lost batch count
+ */
+uint64_t Persistence::lost() const {
+    return lostCount.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Waits for room and queues a write
+ * @param key Pending key, used for the capacity bound
+ * @param apply Merges the write into the pending batch
+ *
+ * A write to a key that is already pending replaces it in place and never
+ * blocks. When the service is not running the write is applied immediately
+ * on the calling thread.
+ */
+void Persistence::enqueue(const string& key, const function<void(Batch&)>& apply) {
+    unique_lock<mutex> lock(queueMutex);
+    if (!running) {
+        lock.unlock();
+        Batch batch;
+        apply(batch);
+        for (int attempt = 1; !write(batch); ++attempt) {
+            if (attempt == MAX_ATTEMPTS) {
+                db.getLogger().error("Gave up saving after " + to_string(attempt) + " failed attempts");
+                lostCount.fetch_add(1, memory_order_relaxed);
+                giveUp(batch);
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(RETRY_MILLIS << (attempt - 1)));
+        }
+        return;
+    }
+
+    auto isPending = [&] {
+        return key.compare(0, 5, "game:") == 0
+            ? pendingBatch.games.count(key.substr(5)) > 0
+            : pendingBatch.players.count(key.substr(7)) > 0;
+    };
+
+    if (isPending()) {
+        coalescedCount.fetch_add(1, memory_order_relaxed);
+    } else {
+        progress.wait(lock, [&] {
+            return isPending() || pendingBatch.games.size() + pendingBatch.players.size() < CAPACITY;
+        });
+    }
+
+    apply(pendingBatch);
+    enqueued++;
+    lock.unlock();
+    wake.notify_one();
+}
+
+/**
+ * @brief Writer thread loop
+ *
+ * Takes the whole pending batch under the lock, writes it without the lock,
+ * then publishes progress so flush() callers can return. After a write
+ * the player table is checkpointed if the last image is old enough.
+ * A failed batch is requeued and retried after RETRY_MILLIS, doubled per
+ * attempt (without pausing once stopping), until MAX_ATTEMPTS fail in a
+ * row; progress is only published once it is written or given up.
+ */
+void Persistence::run() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        wake.wait(lock, [&] {
+            return !running || !pendingBatch.games.empty() || !pendingBatch.players.empty();
+        });
+        if (pendingBatch.games.empty() && pendingBatch.players.empty()) {
+            if (!running) break;
+            continue;
+        }
+
+        Batch batch;
+        swap(batch, pendingBatch);
+        uint64_t target = enqueued;
+        progress.notify_all();  // room for blocked producers
+        lock.unlock();
+
+        bool ok = write(batch);
+        if (ok) {
+            batchCount.fetch_add(1, memory_order_relaxed);
+            db.checkpoint(false);
+        }
+
+        lock.lock();
+        if (!ok && ++failedAttempts < MAX_ATTEMPTS) {
+            requeue(batch);
+            wake.wait_for(lock, chrono::milliseconds(RETRY_MILLIS << (failedAttempts - 1)), [&] { return !running; });
+            continue;
+        }
+        if (!ok) {
+            db.getLogger().error("Gave up saving " + to_string(batch.games.size()) + " games and " +
+                                 to_string(batch.players.size()) + " players after " + to_string(failedAttempts) + " failed attempts");
+            lostCount.fetch_add(1, memory_order_relaxed);
+            lock.unlock();
+            giveUp(batch);
+            lock.lock();
+        }
+        failedAttempts = 0;
+        written = target;
+        progress.notify_all();
+    }
+}
+
+/**
+ * @brief Applies a pending player write to the stored record
+ * @param stored Stored record, updated in place with its version bumped
+ * @param write Pending change
+ *
+ * The queued wins and losses are added on top of the record read inside
+ * the batch transaction, which holds the record's shard lock, so a
+ * concurrent writer can never be overwritten.
+ */
+void Persistence::applyPlayer(Player& stored, const PlayerWrite& write) {
+    for (int i = 0; i < write.wins; ++i) stored.updateStats(true);
+    for (int i = 0; i < write.losses; ++i) stored.updateStats(false);
+
+    stored.setVersion(stored.getVersion() + 1);
+}
+
+/**
+ * @brief Writes a batch to the data files
+ * @param batch Writes to apply
+ *
+ * Player records and game records are written in one transaction, so
+ * finishing a game updates the players' statistics and removes the saved
+ * game together or not at all. Only the records the batch names are read
+ * and written.
+ * Completion callbacks, then follow-up actions, run after the commit. The
+ * batch is left unchanged, so a failed batch can be written again.
+ * @return true if the batch was committed
+ */
+bool Persistence::write(Batch& batch) {
+    try {
+        DB::Transaction txn = db.begin();
+
+        // Account shards first, in ascending order, then game shards
+        map<size_t, vector<string>> playerShards;
+        for (const auto& entry : batch.players) playerShards[db.shardOf(entry.first)].push_back(entry.first);
+
+        for (const auto& [shard, usernames] : playerShards) {
+            for (const string& username : usernames) {
+                const PlayerWrite& write = batch.players[username];
+                optional<Player> record = txn.get<Player>(username);
+                if (!record) {
+                    db.getLogger().error("No stored record to update for " + username);
+                    continue;
+                }
+                applyPlayer(*record, write);
+                txn.put(*record);
+            }
+        }
+
+        map<size_t, vector<string>> gameShards;
+        for (const auto& entry : batch.games) gameShards[db.shardOf(entry.first)].push_back(entry.first);
+        for (const auto& [shard, gameIds] : gameShards) {
+            for (const string& gameId : gameIds) {
+                const auto& change = batch.games[gameId];
+                if (change.remove) txn.remove<Game>(gameId);
+                else txn.put<Game>(gameId, change.json);
+            }
+        }
+
+        if (!txn.commit()) {
+            db.getLogger().error("Failed to write saved data");
+            return false;
+        }
+    } catch (const exception& e) {
+        db.getLogger().error("Error writing saved data: " + string(e.what()));
+        return false;
+    }
+
+    for (auto& entry : batch.games) {
+        for (auto& done : entry.second.done) done(true);
+    }
+    for (auto& entry : batch.games) {
+        for (auto& action : entry.second.after) action();
+    }
+    return true;
+}
+
+/**
+ * @brief Tells the completion callbacks of a given-up batch that it failed
+ * @param batch Batch that was given up
+ */
+void Persistence::giveUp(Batch& batch) {
+    for (auto& entry : batch.games) {
+        for (auto& done : entry.second.done) done(false);
+    }
+}
+
+/**
+ * @brief Puts a failed batch back under the pending writes; the caller holds the queue lock
+ * @param failed Batch that could not be written
+ *
+ * Newer pending writes of the same key win, except that wins and losses
+ * add up and the follow-up actions and completion callbacks of both run,
+ * older first, once the key is written.
+ */
+void Persistence::requeue(Batch& failed) {
+    for (auto& [gameId, older] : failed.games) {
+        auto it = pendingBatch.games.find(gameId);
+        if (it == pendingBatch.games.end()) {
+            pendingBatch.games.emplace(gameId, move(older));
+            continue;
+        }
+        vector<function<void()>>& after = it->second.after;
+        after.insert(after.begin(), make_move_iterator(older.after.begin()), make_move_iterator(older.after.end()));
+        vector<function<void(bool)>>& done = it->second.done;
+        done.insert(done.begin(), make_move_iterator(older.done.begin()), make_move_iterator(older.done.end()));
+    }
+    for (auto& [username, older] : failed.players) {
+        auto it = pendingBatch.players.find(username);
+        if (it == pendingBatch.players.end()) {
+            pendingBatch.players.emplace(username, move(older));
+            continue;
+        }
+        it->second.wins += older.wins;
+        it->second.losses += older.losses;
+    }
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "../include/Player.h"
 #include "../include/Logger.h"
 #include "../include/DB.h"
+#include "../include/BoardProtocol.h"
 
 #include <iostream>
 #include <iomanip>
@@ -15,6 +16,50 @@
 #include <algorithm>
 #include <numeric>
 #include <sstream>
+#include <bitset>
+#include <cstdlib>
+
+namespace {
+    /**
+     * @brief Finds the value of a field in one record
+     * @param record Record JSON
+     * @param field Field name
+     * @param from Offset to search from
+     * @return Offset just past "field":, npos if the field is missing
+     *
+     * The quoted name and the colon are matched together, so the name
+     * occurring inside a username or password does not count.
+     */
+    size_t valueOf(const string& record, const string& field, size_t from = 0) {
+        size_t pos = record.find("\"" + field + "\":", from);
+        return pos == string::npos ? pos : pos + field.size() + 3;
+    }
+
+    /**
+     * @brief Reads a quoted string field
+     * @return The value, empty if missing; end is set past its closing quote
+     */
+    string readString(const string& record, const string& field, size_t from, size_t& end) {
+        size_t pos = valueOf(record, field, from);
+        if (pos == string::npos || pos >= record.size() || record[pos] != '"') {
+            end = from;
+            return "";
+        }
+        size_t close = record.find('"', pos + 1);
+        if (close == string::npos) close = record.size();
+        end = close;
+        return record.substr(pos + 1, close - pos - 1);
+    }
+
+    /**
+     * @brief Reads a numeric field
+     * @return The value, 0 if the field is missing or not a number
+     */
+    double readNumber(const string& record, const string& field, size_t from) {
+        size_t pos = valueOf(record, field, from);
+        return pos == string::npos ? 0.0 : strtod(record.c_str() + pos, nullptr);
+    }
+}
 
 /**
  * @brief Constructor initializes a new Player with default values
@@ -22,7 +67,7 @@
  * @param pwd Password for the player's account
  */
 Player::Player(string user, string pwd)
-    : Account(user, pwd), gameCount(0), winCount(0), loseCount(0) {
+    : Account(user, pwd), gameCount(0), winCount(0), loseCount(0), version(0) {
     board.resize(5, vector<int>(5));
     marked.resize(5, vector<bool>(5, false));
 }
@@ -61,6 +106,14 @@ int Player::getLoseCount() const {
     return loseCount;
 }
 
+/**
+ * @brief Get the version of the stored record this player was read from
+ * @return Record version, 0 if never stored
+ */
+uint64_t Player::getVersion() const {
+    return version;
+}
+
 /**
  * @brief Get the current board state as a JSON string
  * @return JSON string representing the board state
@@ -84,6 +137,36 @@ string Player::getBoardState() const {
     return state;
 }
 
+/**
+ * @brief Get the board numbers
+ * @return 5x5 board in row-major order
+ */
+const vector<vector<int>>& Player::getBoard() const {
+    return board;
+}
+
+/**
+ * @brief Get the marked cells as a bitmask
+ * @return 25-bit mask, bit (row * 5 + col) set when that cell is marked
+ */
+uint32_t Player::getMarkedMask() const {
+    uint32_t mask = 0;
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) {
+            if (marked[i][j]) mask |= 1u << (i * 5 + j);
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Get the completed lines as a bitmask
+ * @return 12-bit mask: bits 0-4 rows, 5-9 columns, 10 main diagonal, 11 anti-diagonal
+ */
+uint16_t Player::getLineMask() const {
+    return BoardProtocol::lineMask(getMarkedMask());
+}
+
 #pragma endregion
 
 #pragma region Setter
@@ -130,6 +213,14 @@ void Player::setWinRate(double rate) {
     this->winRate = rate;
 }
 
+/**
+ * @brief Set the record version
+ * @param version New version value
+ */
+void Player::setVersion(uint64_t version) {
+    this->version = version;
+}
+
 #pragma endregion
 
 #pragma region Validator
@@ -143,9 +234,10 @@ void Player::setWinRate(double rate) {
  * 3. Validates credentials
  * 4. Creates or loads player data
  * 
+ * @param db Database holding the accounts
  * @return Pointer to authenticated Player object or nullptr
  */
-Player* Player::authenticator() {
+Player* Player::authenticator(DB& db) {
     string choice, name, password;
     int input;
 
@@ -182,22 +274,20 @@ Player* Player::authenticator() {
             cin >> password;
 
             Player* p = new Player(name, password);
-            if (Player::check(*p)) {
+            if (Player::check(*p, db)) {
                 system("cls");
                 // Load existing player data
-                vector<Player> players = DB::getInstance().load<Player>();
-                for (const Player& player : players) {
-                    if (player.getUsername() == name && player.getPassword() == password) {
-                        delete p;  // Delete temporary object
-                        return new Player(player);  // Return new object with all data
-                    }
+                shared_ptr<const Player> player = db.snapshotFind<Player>(name);
+                if (player && player->getPassword() == password) {
+                    delete p;  // Delete temporary object
+                    return new Player(*player);  // Return new object with all data
                 }
             }
             cout << "Invalid username or password!\n";
-            LOG_INFO("Account not available");
+            db.getLogger().info("Account not available");
             delete p;
             Util::waitEnter();
-            return authenticator();
+            return authenticator(db);
         }
         else if (input == 2) {
             system("cls");
@@ -208,13 +298,15 @@ Player* Player::authenticator() {
             cin >> password;
 
             Player* p = new Player(name, password);
-            if (Player::create(*p)) {
+            if (Player::create(*p, db)) {
                 system("cls");
                 return p;
             } else {
-                LOG_ERROR("Account creation failed!");
+                cout << "Username already taken!\n";
+                db.getLogger().error("Account creation failed!");
                 delete p;
-                return authenticator();
+                Util::waitEnter();
+                return authenticator(db);
             }
         }
     } while (true);
@@ -228,69 +320,19 @@ Player* Player::authenticator() {
  * @return true if player has 5 or more completed lines
  */
 bool Player::checkWin() {
-    int completedLines = 0;
-
-    // check rows
-    for (int i = 0; i < 5; ++i) {
-        if (std::all_of(marked[i].begin(), marked[i].end(), [](bool m) { return m; })) {
-            completedLines++;
-        }
-    }
-    
-    // check columns
-    for (int i = 0; i < 5; ++i) {
-        bool columnComplete = true;
-        for (int j = 0; j < 5; ++j) {
-            if (!marked[j][i]) {
-                columnComplete = false;
-                break;
-            }
-        }
-        if (columnComplete) {
-            completedLines++;
-        }
-    }
-    
-    // check first diagonal (top-left to bottom-right)
-    bool diagonal1Complete = true;
-    for (int i = 0; i < 5; ++i) {
-        if (!marked[i][i]) {
-            diagonal1Complete = false;
-            break;
-        }
-    }
-    if (diagonal1Complete) {
-        completedLines++;
-    }
-    
-    // Check second diagonal (top-right to bottom-left)
-    bool diagonal2Complete = true;
-    for (int i = 0; i < 5; ++i) {
-        if (!marked[i][4 - i]) {
-            diagonal2Complete = false;
-            break;
-        }
-    }
-    if (diagonal2Complete) {
-        completedLines++;
-    }
-    
+    int completedLines = static_cast<int>(bitset<12>(getLineMask()).count());
     return completedLines >= 5;
 }
 
 /**
  * @brief Check if player exists in database
  * @param p Player object to check
+ * @param db Database to search
  * @return true if player exists with matching credentials
  */
-bool Player::check(const Player& p) {
-    vector<Player> players = DB::getInstance().load<Player>();
-    if (players.empty()) return false;
-
-    for (const Player& player : players) {
-        if (player.getUsername() == p.getUsername() && player.getPassword() == p.getPassword()) return true;
-    }
-    return false;
+bool Player::check(const Player& p, DB& db) {
+    shared_ptr<const Player> player = db.snapshotFind<Player>(p.getUsername());
+    return player && player->getPassword() == p.getPassword();
 }
 
 #pragma endregion
@@ -329,40 +371,21 @@ vector<Player> Player::from_json(const string& json) {
         if (line[0] == ',') line = line.substr(1);
         if (line[0] == '{') line = line.substr(1);
 
-        size_t pos;
-        
-        // Parse username
-        pos = line.find("username");
-        string username = line.substr(pos + 11); // skip "username":"
-        username = username.substr(0, username.find("\""));
-
-        // Parse password
-        pos = line.find("password");
-        string password = line.substr(pos + 11); // skip "password":"
-        password = password.substr(0, password.find("\""));
-
-        // Create player object
+        // Username and password come first; the numbers are looked for
+        // after them, so text inside either is never taken for a field
+        size_t end = 0;
+        string username = readString(line, "username", 0, end);
+        string password = readString(line, "password", end, end);
         Player player(username, password);
 
-        // Parse gameCount
-        pos = line.find("gameCount");
-        string gameCount = line.substr(pos + 11); // skip "gameCount":
-        player.gameCount = stoi(gameCount.substr(0, gameCount.find(",")));
-
-        // Parse winCount
-        pos = line.find("winCount");
-        string winCount = line.substr(pos + 10); // skip "winCount":
-        player.winCount = stoi(winCount.substr(0, winCount.find(",")));
-
-        // Parse loseCount
-        pos = line.find("loseCount");
-        string loseCount = line.substr(pos + 11); // skip "loseCount":
-        player.loseCount = stoi(loseCount.substr(0, loseCount.find(",")));
-
-        // Parse winRate
-        pos = line.find("winRate");
-        string winRate = line.substr(pos + 9); // skip "winRate":
-        player.winRate = stod(winRate.substr(0, winRate.find(",")));
+        // Missing or malformed numbers read as 0, e.g. in records written
+        // before statistics or versioning
+        player.gameCount = static_cast<int>(readNumber(line, "gameCount", end));
+        player.winCount = static_cast<int>(readNumber(line, "winCount", end));
+        player.loseCount = static_cast<int>(readNumber(line, "loseCount", end));
+        player.winRate = readNumber(line, "winRate", end);
+        size_t pos = valueOf(line, "version", end);
+        if (pos != string::npos) player.version = strtoull(line.c_str() + pos, nullptr, 10);
 
         players.push_back(player);
     }
@@ -375,17 +398,19 @@ vector<Player> Player::from_json(const string& json) {
  * @return JSON string representation of player data
  */
 string Player::to_json() const {
-    return "{\"username\":\"" + getUsername() + "\",\"password\":\"" + getPassword() + "\",\"gameCount\":" + to_string(gameCount) + ",\"winCount\":" + to_string(winCount) + ",\"loseCount\":" + to_string(loseCount) + ",\"winRate\":" + to_string(getWinRate()) + "}";
+    return "{\"username\":\"" + getUsername() + "\",\"password\":\"" + getPassword() + "\",\"gameCount\":" + to_string(gameCount) + ",\"winCount\":" + to_string(winCount) + ",\"loseCount\":" + to_string(loseCount) + ",\"winRate\":" + to_string(getWinRate()) + ",\"version\":" + to_string(version) + "}";
 }
 
 /**
  * @brief Create a new player in the database
  * @param p Player object to create
- * @return true if creation successful, false if player already exists
+ * @param db Database to create the player in
+ * @return true if creation successful, false if the username is taken
+ *
+ * Never replaces a stored account, whatever its password.
  */
-bool Player::create(const Player& p) {
-    if (Player::check(p)) return false;
-    return DB::getInstance().save(p);
+bool Player::create(const Player& p, DB& db) {
+    return db.insert(p);
 }
 
 #pragma endregion
@@ -401,8 +426,8 @@ bool Player::create(const Player& p) {
 void Player::generateBoard() {
     std::vector<int> numbers(25);
     std::iota(numbers.begin(), numbers.end(), 1);
-    std::random_device rd;
-    std::mt19937 g(rd());
+    // One engine per thread: seeding from random_device on every call costs a syscall
+    thread_local std::mt19937 g(std::random_device{}());
     std::shuffle(numbers.begin(), numbers.end(), g);
 
     for (int i = 0; i < 5; ++i) {
@@ -413,6 +438,42 @@ void Player::generateBoard() {
     }
 }
 
+/**
+ * @brief Generate a BINGO board deterministically from a seed
+ * @param seed Seed; the same seed always yields the same board
+ * 
+ * Uses a Fisher-Yates shuffle driven directly by mt19937, whose output is
+ * fixed by the standard, so a board can be rebuilt from its seed on any
+ * platform when replaying a game log.
+ */
+void Player::generateBoard(uint32_t seed) {
+    std::vector<int> numbers(25);
+    std::iota(numbers.begin(), numbers.end(), 1);
+    std::mt19937 g(seed);
+    for (int i = 24; i > 0; --i) {
+        std::swap(numbers[i], numbers[g() % (i + 1)]);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) {
+            board[i][j] = numbers[i * 5 + j];
+            marked[i][j] = false;
+        }
+    }
+}
+
+/**
+ * @brief Replace the marked cells with a bitmask
+ * @param mask 25-bit mask, bit (row * 5 + col) set when that cell is marked
+ */
+void Player::setMarkedMask(uint32_t mask) {
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 5; ++j) {
+            marked[i][j] = (mask >> (i * 5 + j)) & 1u;
+        }
+    }
+}
+
 /**
  * @brief Display the current board state
  * 
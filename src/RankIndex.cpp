@@ -0,0 +1,233 @@
+/**
+ * @file RankIndex.cpp
+ * @brief Implementation of the RankIndex class
+ */
+
+#include "../include/RankIndex.h"
+
+#include <algorithm>
+#include <mutex>
+
+/**
+ * @brief Creates an empty index
+ */
+RankIndex::RankIndex() : random(random_device{}()) {
+    head.next.assign(MAX_HEIGHT, nullptr);
+    head.width.assign(MAX_HEIGHT, 1);
+}
+
+RankIndex::~RankIndex() = default;
+
+/**
+ * @brief Checks whether a ranks before b
+ */
+bool RankIndex::before(const RankEntry& a, const RankEntry& b) {
+    if (a.winRate != b.winRate) return a.winRate > b.winRate;
+    if (a.wins != b.wins) return a.wins > b.wins;
+    return a.username < b.username;
+}
+
+/**
+ * @brief Inserts a player or moves it to the position of its new statistics
+ * @param player The player
+ */
+void RankIndex::update(const Player& player) {
+    RankEntry entry{player.getUsername(), player.getGameCount(), player.getWinCount(), player.getWinRate()};
+    unique_lock<shared_mutex> lock(indexMutex);
+    eraseLocked(entry.username);
+    insertLocked(entry);
+}
+
+/**
+ * @brief Removes a player
+ * @param username Player name
+ */
+void RankIndex::erase(const string& username) {
+    unique_lock<shared_mutex> lock(indexMutex);
+    eraseLocked(username);
+}
+
+/**
+ * @brief Replaces the whole index
+ * @param shards Every player to rank, by shard
+ *
+ * The players are sorted once and the levels linked left to right, which
+ * is much faster than inserting them one by one. Of a name listed twice,
+ * only the better ranked statistics are kept.
+ */
+void RankIndex::rebuild(const vector<shared_ptr<const PlayerPart>>& shards) {
+    vector<RankEntry> entries;
+    for (const auto& shard : shards) {
+        for (const auto& player : *shard) {
+            entries.push_back({player->getUsername(), player->getGameCount(), player->getWinCount(), player->getWinRate()});
+        }
+    }
+    sort(entries.begin(), entries.end(), before);
+
+    unique_lock<shared_mutex> lock(indexMutex);
+    nodes.clear();
+    nodes.reserve(entries.size());
+    head.next.assign(MAX_HEIGHT, nullptr);
+    head.width.assign(MAX_HEIGHT, 1);
+    height = 1;
+
+    // Last node linked on each level and its position (the head is at 0)
+    Node* last[MAX_HEIGHT];
+    size_t lastPosition[MAX_HEIGHT] = {};
+    for (int level = 0; level < MAX_HEIGHT; ++level) last[level] = &head;
+
+    size_t position = 0;
+    for (RankEntry& entry : entries) {
+        auto slot = nodes.emplace(entry.username, nullptr);
+        if (!slot.second) continue;
+        ++position;
+        int nodeHeight = 1;
+        while (nodeHeight < MAX_HEIGHT && (random() & 3) == 0) ++nodeHeight;
+        height = max(height, nodeHeight);
+
+        auto created = make_unique<Node>();
+        created->next.assign(nodeHeight, nullptr);
+        created->width.assign(nodeHeight, 1);
+        for (int level = 0; level < nodeHeight; ++level) {
+            last[level]->next[level] = created.get();
+            last[level]->width[level] = position - lastPosition[level];
+            last[level] = created.get();
+            lastPosition[level] = position;
+        }
+        created->entry = move(entry);
+        slot.first->second = move(created);
+    }
+    count = position;
+    for (int level = 0; level < MAX_HEIGHT; ++level) last[level]->width[level] = count - lastPosition[level] + 1;
+}
+
+/**
+ * @brief Gets the number of ranked players
+ */
+size_t RankIndex::size() const {
+    shared_lock<shared_mutex> lock(indexMutex);
+    return count;
+}
+
+/**
+ * @brief Gets the rank of a player
+ * @param username Player name
+ * @return 1 for the best player, 0 if the player is not ranked
+ *
+ * The player's statistics are looked up by name, then the search for them
+ * adds up the widths of the links it follows.
+ */
+size_t RankIndex::rankOf(const string& username) const {
+    shared_lock<shared_mutex> lock(indexMutex);
+    auto it = nodes.find(username);
+    if (it == nodes.end()) return 0;
+    const RankEntry& entry = it->second->entry;
+
+    const Node* node = &head;
+    size_t position = 0;
+    for (int level = height - 1; level >= 0; --level) {
+        while (node->next[level] && before(node->next[level]->entry, entry)) {
+            position += node->width[level];
+            node = node->next[level];
+        }
+    }
+    return position + 1;
+}
+
+/**
+ * @brief Gets consecutive players in rank order
+ * @param offset Number of better players to skip
+ * @param limit Maximum number of players returned
+ * @return Players ranked offset + 1 to offset + limit
+ *
+ * Finding the first player costs O(log n); the rest are read along the
+ * bottom level.
+ */
+vector<RankEntry> RankIndex::page(size_t offset, size_t limit) const {
+    vector<RankEntry> entries;
+    shared_lock<shared_mutex> lock(indexMutex);
+    if (offset >= count || limit == 0) return entries;
+
+    const Node* node = &head;
+    size_t position = 0;
+    for (int level = height - 1; level >= 0; --level) {
+        while (node->next[level] && position + node->width[level] <= offset) {
+            position += node->width[level];
+            node = node->next[level];
+        }
+    }
+    for (node = node->next[0]; node && entries.size() < limit; node = node->next[0]) {
+        entries.push_back(node->entry);
+    }
+    return entries;
+}
+
+/**
+ * @brief Links a player in; the caller holds the exclusive lock
+ *
+ * The last node passed on each level and its position are recorded on the
+ * way down; links the new node splits are divided between it and that
+ * node, and higher links that pass over it grow by one.
+ */
+void RankIndex::insertLocked(const RankEntry& entry) {
+    Node* previous[MAX_HEIGHT];
+    size_t positions[MAX_HEIGHT];
+    Node* node = &head;
+    size_t position = 0;
+    for (int level = MAX_HEIGHT - 1; level >= 0; --level) {
+        while (level < height && node->next[level] && before(node->next[level]->entry, entry)) {
+            position += node->width[level];
+            node = node->next[level];
+        }
+        previous[level] = node;
+        positions[level] = position;
+    }
+
+    int nodeHeight = 1;
+    while (nodeHeight < MAX_HEIGHT && (random() & 3) == 0) ++nodeHeight;
+    if (nodeHeight > height) {
+        for (int level = height; level < nodeHeight; ++level) head.width[level] = count + 1;
+        height = nodeHeight;
+    }
+
+    auto created = make_unique<Node>();
+    created->entry = entry;
+    created->next.assign(nodeHeight, nullptr);
+    created->width.assign(nodeHeight, 1);
+    for (int level = 0; level < nodeHeight; ++level) {
+        size_t skipped = positions[0] - positions[level];
+        created->next[level] = previous[level]->next[level];
+        created->width[level] = previous[level]->width[level] - skipped;
+        previous[level]->next[level] = created.get();
+        previous[level]->width[level] = skipped + 1;
+    }
+    for (int level = nodeHeight; level < height; ++level) previous[level]->width[level]++;
+
+    nodes[entry.username] = move(created);
+    count++;
+}
+
+/**
+ * @brief Unlinks a player; the caller holds the exclusive lock
+ */
+void RankIndex::eraseLocked(const string& username) {
+    auto it = nodes.find(username);
+    if (it == nodes.end()) return;
+    Node* target = it->second.get();
+
+    Node* node = &head;
+    for (int level = height - 1; level >= 0; --level) {
+        while (node->next[level] && node->next[level] != target && before(node->next[level]->entry, target->entry)) {
+            node = node->next[level];
+        }
+        if (level < static_cast<int>(target->next.size()) && node->next[level] == target) {
+            node->width[level] += target->width[level] - 1;
+            node->next[level] = target->next[level];
+        } else {
+            node->width[level]--;
+        }
+    }
+
+    nodes.erase(it);
+    count--;
+}
\ No newline at end of file
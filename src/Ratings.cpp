@@ -0,0 +1,358 @@
+/**
+ * @file Ratings.cpp
+ * @brief Implementation of the Ratings class
+ */
+
+#include "../include/Ratings.h"
+#include "../include/Crc32c.h"
+#include "../include/DB.h"
+#include "../include/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+namespace {
+    const char MAGIC[4] = {'B', 'R', 'T', '1'};
+    const double Q = log(10.0) / 400.0;
+    const double PI = 3.14159265358979323846;
+
+    void put32(string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    void put64(string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    void putDouble(string& out, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        put64(out, bits);
+    }
+
+    uint32_t get32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    uint64_t get64(const char* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    double getDouble(const char* data) {
+        uint64_t bits = get64(data);
+        double value;
+        memcpy(&value, &bits, sizeof value);
+        return value;
+    }
+
+    /**
+     * @brief Weight of an opponent's result by the uncertainty of their rating
+     */
+    double weight(double deviation) {
+        return 1.0 / sqrt(1.0 + 3.0 * Q * Q * deviation * deviation / (PI * PI));
+    }
+}
+
+/**
+ * @brief Gets the ratings of a database, loading them on first use
+ * @param db The database
+ *
+ * Ratings live until program exit, like the database's match history.
+ */
+Ratings& Ratings::of(DB& db) {
+    static mutex registryMutex;
+    static unordered_map<DB*, unique_ptr<Ratings>> instances;
+    lock_guard<mutex> lock(registryMutex);
+    unique_ptr<Ratings>& ratings = instances[&db];
+    if (!ratings) ratings.reset(new Ratings(MatchHistory::of(db), db.getRoot() + "/Ratings.dat"));
+    return *ratings;
+}
+
+/**
+ * @brief Loads the saved ratings and rates the games archived since they were saved
+ * @param history Match history the ratings are computed from
+ * @param path Path of the saved ratings
+ */
+Ratings::Ratings(MatchHistory& history, const string& path) : history(history), PATH(path) {
+    lock_guard<mutex> lock(ratingsMutex);
+    if (!load()) {
+        ratings.clear();
+        window = 0;
+        row = 0;
+    }
+    size_t rated = 0;
+    history.replay(window, 4, [&](const MatchWindow& matches) {
+        rated += applyLocked(matches);
+    });
+    unsaved = rated;
+    if (rated > 0) LOG_INFO("Rated " + to_string(rated) + " games archived since the ratings were saved");
+}
+
+/**
+ * @brief Applies one game to a set of ratings
+ * @param ratings Ratings of the players, by name; missing players are added
+ * @param players Players of the game
+ * @param winner Position of the winner in players, or players.size() for none
+ * @param finished End of the game in seconds since the epoch, 0 if unknown
+ *
+ * Glicko with the game as one rating period: the winner's results are a
+ * win against every other player, theirs a loss against the winner, and
+ * each player's new rating is computed from everyone's rating before the
+ * game.
+ */
+void Ratings::rate(unordered_map<string, Rating>& ratings, const vector<string>& players,
+                   size_t winner, uint64_t finished) {
+    vector<Rating*> slots;
+    for (const string& name : players) slots.push_back(&ratings[name]);
+    rate(slots, winner, finished);
+}
+
+/**
+ * @brief Applies one game to the ratings of its players
+ * @param players Rating of each player of the game, in turn order
+ * @param winner Position of the winner in players, or players.size() for none
+ * @param finished End of the game in seconds since the epoch, 0 if unknown
+ */
+void Ratings::rate(const vector<Rating*>& players, size_t winner, uint64_t finished) {
+    if (winner >= players.size() || players.size() < 2) return;
+
+    // Deviations grow with the time since each player's last game
+    vector<Rating> before(players.size());
+    for (size_t p = 0; p < players.size(); ++p) {
+        const Rating& current = *players[p];
+        before[p] = current;
+        if (current.games > 0 && finished > current.lastPlayed) {
+            double days = static_cast<double>(finished - current.lastPlayed) / 86400.0;
+            before[p].deviation = min(MAX_DEVIATION, sqrt(current.deviation * current.deviation + DAILY_DRIFT * DAILY_DRIFT * days));
+        }
+    }
+
+    auto update = [&](size_t p, size_t opponent, double score, double& variance, double& change) {
+        double g = weight(before[opponent].deviation);
+        double expected = 1.0 / (1.0 + exp(-g * Q * (before[p].rating - before[opponent].rating)));
+        variance += g * g * expected * (1.0 - expected);
+        change += g * (score - expected);
+    };
+
+    for (size_t p = 0; p < players.size(); ++p) {
+        double variance = 0.0, change = 0.0;
+        if (p == winner) {
+            for (size_t opponent = 0; opponent < players.size(); ++opponent) {
+                if (opponent != winner) update(p, opponent, 1.0, variance, change);
+            }
+        } else {
+            update(p, winner, 0.0, variance, change);
+        }
+
+        double precision = 1.0 / (before[p].deviation * before[p].deviation) + Q * Q * variance;
+        Rating& after = *players[p];
+        after.rating = before[p].rating + Q / precision * change;
+        after.deviation = max(MIN_DEVIATION, sqrt(1.0 / precision));
+        after.lastPlayed = max(before[p].lastPlayed, finished);
+        after.games++;
+    }
+}
+
+/**
+ * @brief Rates the games of one window after the current position; the caller holds the lock
+ * @return Number of games rated
+ *
+ * Each name of the window is looked up once, so rating a game only
+ * follows pointers; elements of an unordered_map stay put when it grows.
+ */
+size_t Ratings::applyLocked(const MatchWindow& matches) {
+    size_t first = matches.number == window ? row : 0;
+    size_t at = 0, rated = 0;
+    vector<Rating*> slots;
+    for (const string& name : matches.names) slots.push_back(&ratings[name]);
+
+    vector<Rating*> players;
+    for (size_t game = 0; game < matches.rows; ++game) {
+        size_t count = matches.playerCounts[game];
+        if (game >= first && at + count <= matches.players.size()) {
+            players.clear();
+            bool valid = true;
+            for (size_t p = 0; p < count; ++p) {
+                uint64_t id = matches.players[at + p];
+                if (id >= slots.size()) valid = false;
+                else players.push_back(slots[id]);
+            }
+            if (valid) {
+                size_t winner = matches.winners[game] == 0 ? count : matches.winners[game] - 1;
+                rate(players, winner, matches.finished[game]);
+            }
+            rated++;
+        }
+        at += count;
+    }
+    window = matches.number;
+    row = max(first, matches.rows);
+    if (rated > 0) changes++;
+    return rated;
+}
+
+/**
+ * @brief Rates every game archived since the last update
+ * @return Number of games rated
+ *
+ * Reads the history from the window of the last rated game, normally just
+ * the tail. The ratings are saved once SAVE_INTERVAL games have been rated
+ * since the last save.
+ */
+size_t Ratings::update() {
+    lock_guard<mutex> lock(ratingsMutex);
+    size_t rated = 0;
+    history.replay(window, 1, [&](const MatchWindow& matches) {
+        rated += applyLocked(matches);
+    });
+    unsaved += rated;
+    if (unsaved >= SAVE_INTERVAL) saveLocked();
+    return rated;
+}
+
+/**
+ * @brief Rebuilds every rating from the whole match history
+ * @param workers Number of history segments decoded at once
+ * @return Number of games rated
+ *
+ * The segments are decoded workers at a time in parallel while the
+ * decoded windows are rated in archive order, so the ratings are exactly
+ * those of rating every game in turn. Updates wait for the rebuild.
+ */
+size_t Ratings::recompute(size_t workers) {
+    lock_guard<mutex> lock(ratingsMutex);
+    ratings.clear();
+    window = 0;
+    row = 0;
+    size_t rated = 0;
+    history.replay(0, workers, [&](const MatchWindow& matches) {
+        rated += applyLocked(matches);
+    });
+    changes++;
+    saveLocked();
+    LOG_INFO("Ratings recomputed from " + to_string(rated) + " games");
+    return rated;
+}
+
+/**
+ * @brief Gets the rating of a player
+ * @param username Player name
+ * @return The player's rating, the initial rating if they have no rated game
+ */
+Rating Ratings::get(const string& username) const {
+    lock_guard<mutex> lock(ratingsMutex);
+    auto it = ratings.find(username);
+    return it == ratings.end() ? Rating() : it->second;
+}
+
+/**
+ * @brief Gets the ratings of every rated player
+ */
+unordered_map<string, Rating> Ratings::all() const {
+    lock_guard<mutex> lock(ratingsMutex);
+    return ratings;
+}
+
+/**
+ * @brief Gets a counter that changes whenever a rating changes
+ */
+uint64_t Ratings::version() const {
+    lock_guard<mutex> lock(ratingsMutex);
+    return changes;
+}
+
+/**
+ * @brief Writes the ratings and their history position to <root>/Ratings.dat
+ * @return true if the file was replaced
+ */
+bool Ratings::save() {
+    lock_guard<mutex> lock(ratingsMutex);
+    return saveLocked();
+}
+
+/**
+ * @brief Writes the ratings; the caller holds the lock
+ *
+ * Layout (little-endian): "BRT1", window, row, player count, then per
+ * player its name length and name, rating, deviation, last game and game
+ * count, and finally a CRC32C of everything before it. The file is
+ * written beside PATH and renamed over it.
+ */
+bool Ratings::saveLocked() {
+    string data(MAGIC, 4);
+    put64(data, window);
+    put64(data, row);
+    put32(data, static_cast<uint32_t>(ratings.size()));
+    for (const auto& [name, rating] : ratings) {
+        put32(data, static_cast<uint32_t>(name.size()));
+        data += name;
+        putDouble(data, rating.rating);
+        putDouble(data, rating.deviation);
+        put64(data, rating.lastPlayed);
+        put32(data, rating.games);
+    }
+    put32(data, Crc32c::compute(data));
+
+    try {
+        filesystem::create_directories(filesystem::path(PATH).parent_path());
+        string tmpPath = PATH + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            out.write(data.data(), data.size());
+            if (!out.flush()) {
+                LOG_ERROR("Failed to write ratings");
+                return false;
+            }
+        }
+        filesystem::rename(tmpPath, PATH);
+    } catch (const exception& e) {
+        LOG_ERROR("Error saving ratings: " + string(e.what()));
+        return false;
+    }
+    unsaved = 0;
+    return true;
+}
+
+/**
+ * @brief Reads the saved ratings
+ * @return false if there are none or the file is damaged
+ */
+bool Ratings::load() {
+    ifstream in(PATH, ios::binary);
+    if (!in) return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (data.size() < 28 || data.compare(0, 4, MAGIC, 4) != 0 ||
+        Crc32c::compute(data.data(), data.size() - 4) != get32(data.data() + data.size() - 4)) {
+        LOG_ERROR("Damaged ratings file ignored: " + PATH);
+        return false;
+    }
+
+    size_t end = data.size() - 4, at = 24;
+    window = get64(data.data() + 4);
+    row = get64(data.data() + 12);
+    size_t count = get32(data.data() + 20);
+    ratings.clear();
+    ratings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (at + 4 > end) return false;
+        size_t length = get32(data.data() + at);
+        if (at + 4 + length + 28 > end) return false;
+        Rating& rating = ratings[data.substr(at + 4, length)];
+        at += 4 + length;
+        rating.rating = getDouble(data.data() + at);
+        rating.deviation = getDouble(data.data() + at + 8);
+        rating.lastPlayed = get64(data.data() + at + 16);
+        rating.games = get32(data.data() + at + 24);
+        at += 28;
+    }
+    return true;
+}
\ No newline at end of file
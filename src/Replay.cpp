@@ -0,0 +1,524 @@
+/**
+ * @file Replay.cpp
+ * @brief Implementation of the ReplayArchive and ReplayReader classes
+ */
+
+#include "../include/Replay.h"
+#include "../include/Game.h"
+#include "../include/DB.h"
+#include "../include/Logger.h"
+#include "../include/FileLock.h"
+
+#include <bitset>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    const char MAGIC[4] = {'B', 'R', 'P', 'L'};
+    const uint8_t VERSION = 1;
+    const uint8_t NO_WINNER = 0xFF;
+    const uint8_t FORFEIT_BYTE = 0xFF;
+    const size_t FIXED_HEADER = 32;
+    const size_t ID_BYTES = 48;
+
+    /**
+     * @brief Appends an unsigned integer in little-endian order
+     */
+    void putLE(vector<uint8_t>& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    /**
+     * @brief Reads an unsigned little-endian integer
+     */
+    uint64_t getLE(const vector<uint8_t>& in, size_t pos, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(in[pos + i]) << (8 * i);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Writes an unsigned integer in little-endian order at a position
+     */
+    void setLE(vector<uint8_t>& out, size_t pos, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out[pos + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    /**
+     * @brief Applies one event byte to a marked-mask state
+     * @return false if the event byte is invalid
+     */
+    bool applyEvent(uint8_t event, const vector<vector<int>>& boards, BoardSnapshot& state, bool& over) {
+        if (over) return true;
+        size_t playerCount = state.marked.size();
+
+        if (event == FORFEIT_BYTE) {
+            over = true;
+            return true;
+        }
+        if (event > 25) return false;
+
+        if (event != 0) {
+            for (size_t p = 0; p < playerCount; ++p) {
+                for (int cell = 0; cell < 25; ++cell) {
+                    if (boards[p][cell] == event) state.marked[p] |= 1u << cell;
+                }
+                state.lines[p] = BoardProtocol::lineMask(state.marked[p]);
+                if (bitset<12>(state.lines[p]).count() >= 5) over = true;
+            }
+        }
+        if (!over) {
+            state.currentTurn = (state.currentTurn + 1) % static_cast<int>(playerCount);
+        }
+        return true;
+    }
+
+    mutex archiveMutex;  ///< Serialises appends to the archive and index
+
+    /**
+     * @struct IndexCache
+     * @brief Entries of one replay index read so far, hashed by game ID
+     */
+    struct IndexCache {
+        mutex cacheMutex;                           ///< Guards the fields below
+        uint64_t bytes = 0;                         ///< Bytes of the index file read
+        vector<ReplayInfo> entries;                 ///< Entries in file order
+        unordered_map<string, size_t> positions;    ///< Newest entry of each game ID
+    };
+
+    mutex cachesMutex;                                  ///< Guards indexCaches
+    unordered_map<string, IndexCache> indexCaches;      ///< Cache of each index path
+
+    /**
+     * @brief Gets the cache of an index file, created empty on first use
+     * @param path Path of the index file
+     * @return The cache; entries are never removed, so the reference stays valid
+     */
+    IndexCache& cacheOf(const string& path) {
+        lock_guard<mutex> lock(cachesMutex);
+        return indexCaches[path];
+    }
+
+    /**
+     * @brief Reads the index entries appended since the last call; the caller holds cacheMutex
+     * @param indexCache Cache of the index
+     * @param path Path of the index file
+     *
+     * The new entries are read in one piece, from this or another process.
+     * A torn entry at the end is left for the next call, and an index that
+     * shrank (removed or replaced) is read again from the start.
+     */
+    void refreshIndex(IndexCache& indexCache, const string& path) {
+        ifstream index(path, ios::binary);
+        if (!index.is_open()) return;
+        index.seekg(0, ios::end);
+        uint64_t size = static_cast<uint64_t>(index.tellg());
+        if (size < indexCache.bytes) {
+            indexCache.bytes = 0;
+            indexCache.entries.clear();
+            indexCache.positions.clear();
+        }
+        uint64_t complete = size / ReplayArchive::INDEX_ENTRY * ReplayArchive::INDEX_ENTRY;
+        if (complete <= indexCache.bytes) return;
+
+        vector<uint8_t> data(complete - indexCache.bytes);
+        index.seekg(indexCache.bytes);
+        if (!index.read(reinterpret_cast<char*>(data.data()), data.size())) return;
+        for (size_t at = 0; at < data.size(); at += ReplayArchive::INDEX_ENTRY) {
+            ReplayInfo info;
+            info.gameId.assign(reinterpret_cast<const char*>(data.data() + at), strnlen(reinterpret_cast<const char*>(data.data() + at), ID_BYTES));
+            info.offset = getLE(data, at + ID_BYTES, 8);
+            info.length = getLE(data, at + ID_BYTES + 8, 8);
+            indexCache.positions[info.gameId] = indexCache.entries.size();
+            indexCache.entries.push_back(move(info));
+        }
+        indexCache.bytes = complete;
+    }
+}
+
+#pragma region ReplayArchive
+
+/**
+ * @brief Archives the replay of a finished game from its move log
+ * @param db Database the game was bound to
+ * @param gameId ID of the game
+ * @return true if the replay was written, false otherwise
+ */
+bool ReplayArchive::record(const DB& db, const string& gameId) {
+    GameHistory history;
+    if (!GameLog::readHistory(db, gameId, history)) {
+        db.getLogger().error("No move log to archive for " + gameId);
+        return false;
+    }
+    return write(db, gameId, history);
+}
+
+/**
+ * @brief Archives a replay from an event history
+ * @param db Database the game was bound to
+ * @param gameId ID of the game
+ * @param history Seed, players and events of the game
+ * @return true if the replay was written, false otherwise
+ *
+ * The game is re-simulated from the seed to capture a keyframe every
+ * KEYFRAME_INTERVAL events, then the record and its index entry are
+ * appended. The index entry is written last, so a crash in between leaves
+ * an unreferenced record rather than a dangling entry.
+ */
+bool ReplayArchive::write(const DB& db, const string& gameId, const GameHistory& history) {
+    Logger& logger = db.getLogger();
+    if (history.players.empty() || history.players.size() > 255 || history.events.size() > 65535 ||
+        gameId.size() >= ID_BYTES) {
+        logger.error("Cannot archive replay for " + gameId);
+        return false;
+    }
+
+    // Regenerate the boards from the seed
+    size_t playerCount = history.players.size();
+    vector<vector<int>> boards;
+    for (size_t p = 0; p < playerCount; ++p) {
+        Player player(history.players[p], "");
+        player.generateBoard(Game::boardSeed(history.seed, p));
+        vector<int> cells;
+        for (const auto& row : player.getBoard()) cells.insert(cells.end(), row.begin(), row.end());
+        boards.push_back(cells);
+    }
+
+    // Encode the events and simulate to collect keyframes
+    vector<uint8_t> eventBytes;
+    for (int code : history.events) {
+        eventBytes.push_back(code == GameLog::FORFEIT ? FORFEIT_BYTE : static_cast<uint8_t>(code));
+    }
+
+    BoardSnapshot state;
+    state.marked.assign(playerCount, 0);
+    state.lines.assign(playerCount, 0);
+    bool over = false;
+    vector<vector<uint8_t>> keyframes;
+    for (size_t i = 0; i <= eventBytes.size(); ++i) {
+        if (i % KEYFRAME_INTERVAL == 0) {
+            vector<uint8_t> frame;
+            putLE(frame, i, 2);
+            frame.push_back(static_cast<uint8_t>(state.currentTurn));
+            frame.push_back(over ? 1 : 0);
+            for (uint32_t mask : state.marked) putLE(frame, mask, 4);
+            keyframes.push_back(frame);
+        }
+        if (i < eventBytes.size()) {
+            applyEvent(eventBytes[i], boards, state, over);
+        }
+    }
+
+    int winner = -1;
+    for (size_t p = 0; p < playerCount && winner < 0; ++p) {
+        if (bitset<12>(state.lines[p]).count() >= 5) winner = static_cast<int>(p);
+    }
+    if (winner < 0 && !eventBytes.empty() && eventBytes.back() == FORFEIT_BYTE) {
+        winner = (state.currentTurn + 1) % static_cast<int>(playerCount);
+    }
+
+    // Header
+    vector<uint8_t> record(MAGIC, MAGIC + 4);
+    record.push_back(VERSION);
+    record.push_back(static_cast<uint8_t>(playerCount));
+    record.push_back(static_cast<uint8_t>(KEYFRAME_INTERVAL));
+    record.push_back(winner < 0 ? NO_WINNER : static_cast<uint8_t>(winner));
+    putLE(record, eventBytes.size(), 2);
+    putLE(record, keyframes.size(), 2);
+    putLE(record, 0, 4);  // header length, patched below
+    putLE(record, static_cast<uint64_t>(history.startTime), 8);
+    putLE(record, static_cast<uint64_t>(chrono::duration_cast<chrono::seconds>(
+        chrono::system_clock::now().time_since_epoch()).count()), 8);
+    for (size_t p = 0; p < playerCount; ++p) {
+        const string& name = history.players[p];
+        size_t length = name.size() > 255 ? 255 : name.size();
+        record.push_back(static_cast<uint8_t>(length));
+        record.insert(record.end(), name.begin(), name.begin() + length);
+        for (int value : boards[p]) record.push_back(static_cast<uint8_t>(value));
+    }
+    setLE(record, 12, record.size(), 4);
+
+    // Events, keyframe index, keyframes
+    record.insert(record.end(), eventBytes.begin(), eventBytes.end());
+    size_t indexPos = record.size();
+    record.resize(record.size() + 4 * keyframes.size());
+    for (size_t k = 0; k < keyframes.size(); ++k) {
+        setLE(record, indexPos + 4 * k, record.size(), 4);
+        record.insert(record.end(), keyframes[k].begin(), keyframes[k].end());
+    }
+
+    string archiveFile = archivePath(db);
+    lock_guard<mutex> lock(archiveMutex);
+    try {
+        filesystem::create_directories(db.getRoot());
+
+        // Other processes may append to the same archive
+        FileLock appendLock(archiveFile + ".lock", FileLock::Mode::EXCLUSIVE);
+        uint64_t offset = filesystem::exists(archiveFile) ? filesystem::file_size(archiveFile) : 0;
+
+        ofstream archive(archiveFile, ios::binary | ios::app);
+        archive.write(reinterpret_cast<const char*>(record.data()), record.size());
+        archive.close();
+        if (!archive) {
+            logger.error("Failed to write replay archive");
+            return false;
+        }
+
+        vector<uint8_t> entry(ID_BYTES, 0);
+        memcpy(entry.data(), gameId.data(), gameId.size());
+        putLE(entry, offset, 8);
+        putLE(entry, record.size(), 8);
+        ofstream index(indexPath(db), ios::binary | ios::app);
+        index.write(reinterpret_cast<const char*>(entry.data()), entry.size());
+        index.close();
+        if (!index) {
+            logger.error("Failed to write replay index");
+            return false;
+        }
+    } catch (const exception& e) {
+        logger.error("Error archiving replay: " + string(e.what()));
+        return false;
+    }
+
+    logger.info("Replay archived for " + gameId);
+    return true;
+}
+
+/**
+ * @brief Finds a replay in the index
+ * @param db Database holding the archive
+ * @param gameId ID of the game
+ * @param info Output index entry
+ * @return true if found, false otherwise
+ *
+ * The index is read once and kept hashed by game ID; later calls only
+ * read the entries appended since. A game archived twice resolves to its
+ * newest entry.
+ */
+bool ReplayArchive::find(const DB& db, const string& gameId, ReplayInfo& info) {
+    string path = indexPath(db);
+    IndexCache& indexCache = cacheOf(path);
+    lock_guard<mutex> lock(indexCache.cacheMutex);
+    refreshIndex(indexCache, path);
+    auto it = indexCache.positions.find(gameId);
+    if (it == indexCache.positions.end()) return false;
+    info = indexCache.entries[it->second];
+    return true;
+}
+
+/**
+ * @brief Lists the most recent replays
+ * @param db Database holding the archive
+ * @param limit Maximum number of entries (0 for all)
+ * @return Index entries, most recent first
+ *
+ * Served from the same cached index as find().
+ */
+vector<ReplayInfo> ReplayArchive::list(const DB& db, size_t limit) {
+    string path = indexPath(db);
+    IndexCache& indexCache = cacheOf(path);
+    lock_guard<mutex> lock(indexCache.cacheMutex);
+    refreshIndex(indexCache, path);
+    const vector<ReplayInfo>& entries = indexCache.entries;
+    size_t count = limit == 0 ? entries.size() : min(limit, entries.size());
+    return vector<ReplayInfo>(entries.rbegin(), entries.rbegin() + count);
+}
+
+/**
+ * @brief Gets the path of the replay archive
+ * @param db Database holding the archive
+ * @return Path of Replay.dat under the database root
+ */
+string ReplayArchive::archivePath(const DB& db) {
+    return db.getRoot() + "/Replay.dat";
+}
+
+/**
+ * @brief Gets the path of the replay index
+ * @param db Database holding the archive
+ * @return Path of Replay.idx under the database root
+ */
+string ReplayArchive::indexPath(const DB& db) {
+    return db.getRoot() + "/Replay.idx";
+}
+
+#pragma endregion
+
+#pragma region ReplayReader
+
+/**
+ * @brief Opens the replay of a game
+ * @param db Database holding the archive
+ * @param gameId ID of the game
+ * @return true if the replay was found and its header is valid
+ */
+bool ReplayReader::open(const DB& db, const string& gameId) {
+    ReplayInfo info;
+    if (!ReplayArchive::find(db, gameId, info)) return false;
+
+    file.close();
+    file.clear();
+    file.open(ReplayArchive::archivePath(db), ios::binary);
+    if (!file.is_open()) return false;
+    base = info.offset;
+
+    vector<uint8_t> fixed;
+    if (!readAt(0, FIXED_HEADER, fixed) || memcmp(fixed.data(), MAGIC, 4) != 0 || fixed[4] != VERSION) {
+        db.getLogger().error("Corrupt replay record for " + gameId);
+        return false;
+    }
+
+    size_t playerCount = fixed[5];
+    interval = fixed[6] == 0 ? 1 : fixed[6];
+    winner = fixed[7] == NO_WINNER ? -1 : fixed[7];
+    events = static_cast<uint16_t>(getLE(fixed, 8, 2));
+    keyframes = static_cast<uint16_t>(getLE(fixed, 10, 2));
+    uint32_t headerLength = static_cast<uint32_t>(getLE(fixed, 12, 4));
+    startTime = static_cast<int64_t>(getLE(fixed, 16, 8));
+    endTime = static_cast<int64_t>(getLE(fixed, 24, 8));
+
+    vector<uint8_t> header;
+    if (headerLength < FIXED_HEADER || headerLength > info.length ||
+        !readAt(FIXED_HEADER, headerLength - FIXED_HEADER, header)) {
+        return false;
+    }
+
+    players.clear();
+    boards.clear();
+    size_t pos = 0;
+    for (size_t p = 0; p < playerCount; ++p) {
+        if (pos >= header.size()) return false;
+        size_t length = header[pos++];
+        if (pos + length + 25 > header.size()) return false;
+        players.emplace_back(header.begin() + pos, header.begin() + pos + length);
+        pos += length;
+        boards.emplace_back(header.begin() + pos, header.begin() + pos + 25);
+        pos += 25;
+    }
+
+    eventsOffset = headerLength;
+    indexOffset = headerLength + events;
+    return true;
+}
+
+/**
+ * @brief Gets the number of recorded events
+ * @return Event count (the last turn that can be seeked to)
+ */
+size_t ReplayReader::turnCount() const {
+    return events;
+}
+
+/**
+ * @brief Gets the player names in turn order
+ * @return Constant reference to the names
+ */
+const vector<string>& ReplayReader::getPlayers() const {
+    return players;
+}
+
+/**
+ * @brief Gets the index of the winning player
+ * @return Winner index, or -1 if nobody won
+ */
+int ReplayReader::getWinner() const {
+    return winner;
+}
+
+/**
+ * @brief Gets the Unix time the game started
+ * @return Start time, 0 if unknown
+ */
+int64_t ReplayReader::getStartTime() const {
+    return startTime;
+}
+
+/**
+ * @brief Gets the Unix time the replay was archived
+ * @return End time
+ */
+int64_t ReplayReader::getEndTime() const {
+    return endTime;
+}
+
+/**
+ * @brief Gets the called number of an event
+ * @param turn Event index (0-based)
+ * @return Called number, 0 for a skip, 255 for a forfeit, -1 if out of range
+ */
+int ReplayReader::eventAt(size_t turn) {
+    vector<uint8_t> byte;
+    if (turn >= events || !readAt(eventsOffset + turn, 1, byte)) return -1;
+    return byte[0];
+}
+
+/**
+ * @brief Reconstructs the state after a given number of events
+ * @param turn Number of events applied (0 is the initial deal)
+ * @param state Output state; sequence holds the event count
+ * @return true on success, false if the turn is out of range or the data is corrupt
+ *
+ * Reads the keyframe index entry, the nearest earlier keyframe and the
+ * events after it, then applies at most KEYFRAME_INTERVAL - 1 events.
+ */
+bool ReplayReader::seek(size_t turn, BoardSnapshot& state) {
+    if (turn > events || players.empty()) return false;
+
+    size_t keyframe = turn / interval;
+    if (keyframe >= keyframes) keyframe = keyframes - 1;
+
+    vector<uint8_t> entry;
+    if (!readAt(indexOffset + 4 * keyframe, 4, entry)) return false;
+    uint64_t frameOffset = getLE(entry, 0, 4);
+
+    vector<uint8_t> frame;
+    if (!readAt(frameOffset, 4 + 4 * players.size(), frame)) return false;
+
+    BoardSnapshot result;
+    size_t frameTurn = getLE(frame, 0, 2);
+    result.currentTurn = frame[2];
+    bool over = frame[3] != 0;
+    result.usernames = players;
+    result.boards = boards;
+    for (size_t p = 0; p < players.size(); ++p) {
+        uint32_t mask = static_cast<uint32_t>(getLE(frame, 4 + 4 * p, 4));
+        result.marked.push_back(mask);
+        result.lines.push_back(BoardProtocol::lineMask(mask));
+    }
+    if (frameTurn > turn) return false;
+
+    vector<uint8_t> pending;
+    if (turn > frameTurn && !readAt(eventsOffset + frameTurn, turn - frameTurn, pending)) return false;
+    for (uint8_t event : pending) {
+        if (!applyEvent(event, boards, result, over)) return false;
+    }
+
+    result.sequence = static_cast<uint32_t>(turn);
+    state = result;
+    return true;
+}
+
+/**
+ * @brief Reads bytes at an offset relative to the record
+ * @param offset Relative offset
+ * @param length Number of bytes
+ * @param out Output buffer
+ * @return true if all bytes were read
+ */
+bool ReplayReader::readAt(uint64_t offset, size_t length, vector<uint8_t>& out) {
+    out.resize(length);
+    file.clear();
+    file.seekg(static_cast<streamoff>(base + offset));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(out.data()), length));
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,288 @@
+/**
+ * @file RoomManager.cpp
+ * @brief Implementation of the RoomManager class
+ */
+
+#include "../include/RoomManager.h"
+#include "../include/Logger.h"
+
+#include <chrono>
+
+/**
+ * @brief Constructs a room manager
+ * @param shardCount Number of independently locked shards (at least 1)
+ * @param memoryBudget Maximum bytes of resident games (0 for unlimited)
+ * @param db Database rooms are evicted to
+ *
+ * The budget is split evenly between shards so that eviction decisions
+ * never need more than the one shard lock already held.
+ */
+RoomManager::RoomManager(size_t shardCount, size_t memoryBudget, DB& db)
+    : shardBudget(memoryBudget == 0 ? 0 : max<size_t>(1, memoryBudget / max<size_t>(1, shardCount))),
+      db(db),
+      nextRoomId(chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count()) {
+    if (shardCount == 0) shardCount = 1;
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+}
+
+/**
+ * @brief Creates a room and deals fresh boards to both players
+ * @param p1 First player (moves first)
+ * @param p2 Second player
+ * @return ID of the new room
+ *
+ * Room IDs come from an atomic counter rather than Game::generateGameId,
+ * which scans the saved-game file and would serialise room creation. The
+ * counter starts at the construction time in microseconds, so a restart
+ * continues past every ID handed out before unless rooms were created
+ * faster than one per microsecond on average.
+ * Nothing is logged here, since the logger holds a process-wide lock.
+ */
+string RoomManager::createRoom(const Player& p1, const Player& p2) {
+    string roomId = Game::ROOM_PREFIX + to_string(nextRoomId.fetch_add(1));
+
+    auto game = make_unique<Game>(db, true);
+    game->setGameId(roomId);
+    Player first = p1;
+    Player second = p2;
+    game->initPlayers({&first, &second});
+
+    Shard& shard = shardFor(roomId);
+    {
+        unique_lock<mutex> lock(shard.mtx);
+        Room& room = shard.rooms[roomId];
+        room.game = move(game);
+        room.bytes = room.game->memoryFootprint();
+        shard.lru.push_front(roomId);
+        room.lruPos = shard.lru.begin();
+        shard.bytes += room.bytes;
+        residentTotal.fetch_add(room.bytes);
+        resident.fetch_add(1);
+        openRooms.fetch_add(1);
+        enforceBudget(shard, lock, roomId);
+    }
+    return roomId;
+}
+
+/**
+ * @brief Runs a function on a room while holding its shard lock
+ * @param roomId ID of the room
+ * @param fn Function to run on the room's game
+ * @return true if the room exists and is resident or could be rehydrated, false otherwise
+ */
+bool RoomManager::withRoom(const string& roomId, const function<void(Game&)>& fn) {
+    Shard& shard = shardFor(roomId);
+    unique_lock<mutex> lock(shard.mtx);
+    auto it = shard.rooms.find(roomId);
+    if (it == shard.rooms.end()) return false;
+
+    Room& room = it->second;
+    if (!touch(shard, roomId, room)) return false;
+    fn(*room.game);
+    room.uses++;
+    remeasure(shard, room);
+    enforceBudget(shard, lock, roomId);
+    return true;
+}
+
+/**
+ * @brief Closes a room, releases its game and removes its stored record
+ * @param roomId ID of the room
+ * @return true if the room existed, false otherwise
+ *
+ * The record is removed after the shard lock is released. If an eviction
+ * is writing the room's state meanwhile, the evicting thread removes the
+ * record again once its write is done, so a closed room never stays in
+ * the store.
+ */
+bool RoomManager::closeRoom(const string& roomId) {
+    Shard& shard = shardFor(roomId);
+    bool stored;
+    {
+        lock_guard<mutex> lock(shard.mtx);
+        auto it = shard.rooms.find(roomId);
+        if (it == shard.rooms.end()) return false;
+
+        Room& room = it->second;
+        if (room.game) {
+            shard.lru.erase(room.lruPos);
+            shard.bytes -= room.bytes;
+            residentTotal.fetch_sub(room.bytes);
+            resident.fetch_sub(1);
+        }
+        stored = room.stored;
+        shard.rooms.erase(it);
+        openRooms.fetch_sub(1);
+    }
+    if (stored && !Game::storeStates(db, {}, {roomId})) {
+        LOG_ERROR("Failed to remove stored room " + roomId);
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the number of open rooms
+ * @return Open room count
+ */
+size_t RoomManager::roomCount() const {
+    return openRooms.load();
+}
+
+/**
+ * @brief Gets the number of rooms whose game is held in memory
+ * @return Resident room count
+ */
+size_t RoomManager::residentRooms() const {
+    return resident.load();
+}
+
+/**
+ * @brief Gets the estimated memory held by resident games
+ * @return Resident bytes
+ */
+size_t RoomManager::residentBytes() const {
+    return residentTotal.load();
+}
+
+/**
+ * @brief Gets the number of evictions so far
+ * @return Eviction count
+ */
+uint64_t RoomManager::evictions() const {
+    return evictionCount.load();
+}
+
+/**
+ * @brief Gets the histogram of rehydration latency
+ * @return Constant reference to the rehydration histogram
+ */
+const LatencyHistogram& RoomManager::rehydrationLatency() const {
+    return rehydrateHistogram;
+}
+
+/**
+ * @brief Gets the shard responsible for a room ID
+ * @param roomId ID of the room
+ * @return Reference to the shard
+ */
+RoomManager::Shard& RoomManager::shardFor(const string& roomId) {
+    return *shards[hash<string>{}(roomId) % shards.size()];
+}
+
+/**
+ * @brief Makes a room resident and most recently used
+ * @param shard Shard holding the room (lock held)
+ * @param roomId ID of the room
+ * @param room The room entry
+ * @return true if the room's game is resident afterwards
+ *
+ * An evicted room is rehydrated from the game store; the time taken is
+ * recorded in the rehydration histogram.
+ */
+bool RoomManager::touch(Shard& shard, const string& roomId, Room& room) {
+    if (room.game) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, room.lruPos);
+        return true;
+    }
+
+    auto start = chrono::steady_clock::now();
+    auto game = make_unique<Game>(db, true);
+    if (!Game::loadById(roomId, *game)) {
+        LOG_ERROR("Failed to rehydrate room " + roomId);
+        return false;
+    }
+    rehydrateHistogram.record(chrono::steady_clock::now() - start);
+
+    room.game = move(game);
+    room.bytes = room.game->memoryFootprint();
+    shard.lru.push_front(roomId);
+    room.lruPos = shard.lru.begin();
+    shard.bytes += room.bytes;
+    residentTotal.fetch_add(room.bytes);
+    resident.fetch_add(1);
+    return true;
+}
+
+/**
+ * @brief Re-measures a resident room after it was used
+ * @param shard Shard holding the room (lock held)
+ * @param room The room entry
+ */
+void RoomManager::remeasure(Shard& shard, Room& room) {
+    size_t bytes = room.game->memoryFootprint();
+    shard.bytes = shard.bytes - room.bytes + bytes;
+    residentTotal.fetch_add(bytes);
+    residentTotal.fetch_sub(room.bytes);
+    room.bytes = bytes;
+}
+
+/**
+ * @brief Evicts least recently used rooms until the shard fits its budget
+ * @param shard Shard to trim
+ * @param lock Held lock of the shard, released while the victims are written
+ * @param keep ID of a room that must stay resident
+ *
+ * Victims are picked from the cold end of the LRU list and their states
+ * taken under the lock; the states are then written in one transaction
+ * without the lock. Back under the lock, a victim is only released if it
+ * was not used meanwhile, so the store always holds the state that is
+ * dropped from memory. A victim closed during the write has its record
+ * removed again. A room whose state cannot be written stays resident, so
+ * a failing store degrades to exceeding the budget rather than losing
+ * games.
+ */
+void RoomManager::enforceBudget(Shard& shard, unique_lock<mutex>& lock, const string& keep) {
+    if (shardBudget == 0 || shard.bytes <= shardBudget) return;
+
+    vector<pair<string, string>> states;
+    vector<uint64_t> uses;
+    size_t freed = 0;
+    for (auto victim = shard.lru.rbegin(); victim != shard.lru.rend() && shard.bytes - freed > shardBudget; ++victim) {
+        Room& room = shard.rooms[*victim];
+        if (*victim == keep || room.evicting) continue;
+        room.evicting = true;
+        states.emplace_back(*victim, room.game->to_json());
+        uses.push_back(room.uses);
+        freed += room.bytes;
+    }
+    if (states.empty()) return;
+
+    lock.unlock();
+    bool written = Game::storeStates(db, states);
+    lock.lock();
+
+    vector<string> closed;
+    for (size_t i = 0; i < states.size(); ++i) {
+        const string& roomId = states[i].first;
+        auto it = shard.rooms.find(roomId);
+        if (it == shard.rooms.end()) {
+            if (written) closed.push_back(roomId);
+            continue;
+        }
+
+        Room& room = it->second;
+        room.evicting = false;
+        if (!written) {
+            LOG_ERROR("Failed to evict room " + roomId);
+            continue;
+        }
+        room.stored = true;
+        if (!room.game || room.uses != uses[i]) continue;
+
+        shard.lru.erase(room.lruPos);
+        shard.bytes -= room.bytes;
+        residentTotal.fetch_sub(room.bytes);
+        resident.fetch_sub(1);
+        evictionCount.fetch_add(1);
+        room.game.reset();
+        room.bytes = 0;
+    }
+
+    if (!closed.empty()) {
+        lock.unlock();
+        if (!Game::storeStates(db, {}, closed)) LOG_ERROR("Failed to remove stored rooms closed during eviction");
+        lock.lock();
+    }
+}
\ No newline at end of file
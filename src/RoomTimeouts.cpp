@@ -0,0 +1,148 @@
+/**
+ * @file RoomTimeouts.cpp
+ * @brief Implementation of the RoomTimeouts class
+ */
+
+#include "../include/RoomTimeouts.h"
+#include "../include/Logger.h"
+
+/**
+ * @brief Constructs the timeout service
+ * @param rooms Room manager owning the rooms
+ * @param turnTimeout Time a player has to make a move
+ * @param idleTimeout Time without any move after which the room is closed
+ * @param action What to do when the turn timer expires
+ * @param tick Timer resolution
+ */
+RoomTimeouts::RoomTimeouts(RoomManager& rooms, chrono::milliseconds turnTimeout, chrono::milliseconds idleTimeout,
+                           TurnAction action, chrono::milliseconds tick)
+    : rooms(rooms), wheel(tick), turnTimeout(turnTimeout), idleTimeout(idleTimeout), action(action) {}
+
+/**
+ * @brief Starts both timers for a newly opened room
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::watch(const string& roomId) {
+    armTurn(roomId);
+    armIdle(roomId);
+}
+
+/**
+ * @brief Restarts both timers after a move in a room
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::onMove(const string& roomId) {
+    armTurn(roomId);
+    armIdle(roomId);
+}
+
+/**
+ * @brief Cancels both timers of a room
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::unwatch(const string& roomId) {
+    auto it = timers.find(roomId);
+    if (it == timers.end()) return;
+    wheel.cancel(it->second.turn);
+    wheel.cancel(it->second.idle);
+    timers.erase(it);
+}
+
+/**
+ * @brief Fires every expired timer; called by the event loop
+ * @param now Current time
+ * @return Number of timers fired
+ */
+size_t RoomTimeouts::poll(chrono::steady_clock::time_point now) {
+    return wheel.advance(now);
+}
+
+/**
+ * @brief Gets the number of turn timeouts handled
+ * @return Turn timeout count
+ */
+uint64_t RoomTimeouts::turnTimeouts() const {
+    return turnTimeoutCount;
+}
+
+/**
+ * @brief Gets the number of rooms closed for being idle
+ * @return Idle expiry count
+ */
+uint64_t RoomTimeouts::idleExpiries() const {
+    return idleExpiryCount;
+}
+
+/**
+ * @brief Gets the number of watched rooms
+ * @return Watched room count
+ */
+size_t RoomTimeouts::watchedRooms() const {
+    return timers.size();
+}
+
+/**
+ * @brief (Re)arms the turn timer of a room
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::armTurn(const string& roomId) {
+    Timers& t = timers[roomId];
+    wheel.cancel(t.turn);
+    t.turn = wheel.schedule(turnTimeout, [this, roomId]() { onTurnTimeout(roomId); });
+}
+
+/**
+ * @brief (Re)arms the idle timer of a room
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::armIdle(const string& roomId) {
+    Timers& t = timers[roomId];
+    wheel.cancel(t.idle);
+    t.idle = wheel.schedule(idleTimeout, [this, roomId]() { onIdleTimeout(roomId); });
+}
+
+/**
+ * @brief Handles an expired turn timer
+ * @param roomId ID of the room
+ *
+ * With SKIP the turn passes on and the timer restarts for the next player.
+ * With FORFEIT the game ends; the room then stays until its idle timer
+ * expires so both players can see the result.
+ */
+void RoomTimeouts::onTurnTimeout(const string& roomId) {
+    auto it = timers.find(roomId);
+    if (it == timers.end()) return;
+    it->second.turn = 0;
+    turnTimeoutCount++;
+
+    bool gameOver = true;
+    bool exists = rooms.withRoom(roomId, [this, &gameOver](Game& game) {
+        if (action == TurnAction::SKIP) game.skipTurn();
+        else game.forfeit();
+        gameOver = game.isGameOver();
+    });
+
+    if (!exists) {
+        unwatch(roomId);
+        return;
+    }
+    if (!gameOver) {
+        armTurn(roomId);
+    }
+}
+
+/**
+ * @brief Handles an expired idle timer
+ * @param roomId ID of the room
+ */
+void RoomTimeouts::onIdleTimeout(const string& roomId) {
+    auto it = timers.find(roomId);
+    if (it == timers.end()) return;
+    it->second.idle = 0;
+    idleExpiryCount++;
+
+    unwatch(roomId);
+    if (rooms.closeRoom(roomId)) {
+        LOG_INFO("Room " + roomId + " closed after being idle");
+    }
+}
\ No newline at end of file
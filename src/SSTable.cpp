@@ -0,0 +1,526 @@
+/**
+ * @file SSTable.cpp
+ * @brief Implementation of the SSTable reader and builder
+ */
+
+#include "../include/SSTable.h"
+#include "../include/Logger.h"
+#include "../include/Crc32c.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <mutex>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    int openRead(const string& path) {
+        return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    }
+    int openWrite(const string& path) {
+        return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    // No positioned read on Windows descriptors, so seek and read under one lock
+    bool readAt(int fd, uint64_t offset, size_t length, string& out) {
+        static mutex seekMutex;
+        lock_guard<mutex> lock(seekMutex);
+        out.resize(length);
+        if (_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0) return false;
+        return _read(fd, &out[0], static_cast<unsigned int>(length)) == static_cast<int>(length);
+    }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return _write(fd, data, static_cast<unsigned int>(length));
+    }
+    int syncFile(int fd) { return _commit(fd); }
+    int closeFile(int fd) { return _close(fd); }
+#else
+    int openRead(const string& path) {
+        return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    int openWrite(const string& path) {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    bool readAt(int fd, uint64_t offset, size_t length, string& out) {
+        out.resize(length);
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = ::pread(fd, &out[done], length - done, static_cast<off_t>(offset + done));
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return ::write(fd, data, length);
+    }
+    int syncFile(int fd) { return ::fsync(fd); }
+    int closeFile(int fd) { return ::close(fd); }
+#endif
+}
+
+#pragma region SSTable
+
+/**
+ * @brief Opens a table file
+ * @param path Table file path
+ * @param number File number of the table
+ * @return The table, or null if the file is missing or malformed
+ *
+ * Reads the footer, then the filter and the index into memory.
+ */
+shared_ptr<SSTable> SSTable::open(const string& path, uint64_t number) {
+    shared_ptr<SSTable> table(new SSTable());
+    table->path = path;
+    table->fileNumber = number;
+
+    error_code ec;
+    table->size = filesystem::file_size(path, ec);
+    if (ec || table->size < FOOTER_BYTES) {
+        LOG_ERROR("Table file missing or too short: " + path);
+        return nullptr;
+    }
+    table->fd = openRead(path);
+    if (table->fd < 0) {
+        LOG_ERROR("Failed to open table file: " + path);
+        return nullptr;
+    }
+
+    string footer;
+    if (!readAt(table->fd, table->size - FOOTER_BYTES, FOOTER_BYTES, footer) ||
+        (getFixed(footer, 44, 4) != MAGIC && getFixed(footer, 44, 4) != UNCHECKED_MAGIC)) {
+        LOG_ERROR("Bad table footer: " + path);
+        return nullptr;
+    }
+    table->checksummed = getFixed(footer, 44, 4) == MAGIC;
+    uint64_t filterOffset = getFixed(footer, 0, 8);
+    uint64_t filterSize = getFixed(footer, 8, 8);
+    uint64_t indexOffset = getFixed(footer, 16, 8);
+    uint64_t indexSize = getFixed(footer, 24, 8);
+    table->entries = getFixed(footer, 32, 8);
+    table->probes = static_cast<uint32_t>(getFixed(footer, 40, 4));
+    if (filterOffset + filterSize > table->size || indexOffset + indexSize > table->size - FOOTER_BYTES) {
+        LOG_ERROR("Bad table footer: " + path);
+        return nullptr;
+    }
+
+    string index;
+    if (!readAt(table->fd, filterOffset, filterSize, table->filter) ||
+        !readAt(table->fd, indexOffset, indexSize, index)) {
+        LOG_ERROR("Failed to read table index: " + path);
+        return nullptr;
+    }
+
+    size_t pos = 0;
+    uint64_t length, count;
+    if (!getVarint(index, pos, length) || length > index.size() - pos) return nullptr;
+    table->smallestKey = index.substr(pos, length);
+    pos += length;
+    if (!getVarint(index, pos, count) || count == 0) {
+        LOG_ERROR("Bad table index: " + path);
+        return nullptr;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        BlockHandle handle;
+        if (!getVarint(index, pos, length) || length > index.size() - pos) return nullptr;
+        handle.lastKey = index.substr(pos, length);
+        pos += length;
+        if (!getVarint(index, pos, handle.offset) || !getVarint(index, pos, handle.size)) return nullptr;
+        table->blocks.push_back(move(handle));
+    }
+    return table;
+}
+
+/**
+ * @brief Closes the file, deleting it if the table is obsolete
+ */
+SSTable::~SSTable() {
+    if (fd >= 0) closeFile(fd);
+    if (obsolete) {
+        error_code ec;
+        filesystem::remove(path, ec);
+    }
+}
+
+/**
+ * @brief Looks a key up
+ * @param key Key
+ * @param value Output value when found
+ * @return Whether the key has a value, was deleted, is not in the table or is unreadable
+ *
+ * A block that fails its checksum yields CORRUPT rather than MISSING, so
+ * the caller does not fall through to older tables that may still hold
+ * an overwritten or deleted value of the key.
+ */
+SSTable::Lookup SSTable::get(const string& key, string& value) const {
+    if (key < smallestKey || key > largest() || !mayContain(key)) return Lookup::MISSING;
+
+    auto it = lower_bound(blocks.begin(), blocks.end(), key,
+        [](const BlockHandle& handle, const string& target) { return handle.lastKey < target; });
+    if (it == blocks.end()) return Lookup::MISSING;
+
+    string data;
+    if (!readBlock(static_cast<size_t>(it - blocks.begin()), data)) return Lookup::CORRUPT;
+
+    size_t pos = 0;
+    string entryKey;
+    optional<string> entryValue;
+    while (pos < data.size() && decodeEntry(data, pos, entryKey, entryValue)) {
+        if (entryKey < key) continue;
+        if (entryKey > key) break;
+        if (!entryValue) return Lookup::DELETED;
+        value = move(*entryValue);
+        return Lookup::FOUND;
+    }
+    return Lookup::MISSING;
+}
+
+/**
+ * @brief Checks the Bloom filter
+ * @param key Key
+ * @return false if the key is certainly absent
+ *
+ * Probe positions come from two halves of one 64-bit hash (double hashing).
+ */
+bool SSTable::mayContain(const string& key) const {
+    if (filter.empty() || probes == 0) return true;
+    uint64_t bits = filter.size() * 8;
+    uint64_t h = hash(key);
+    uint64_t delta = (h >> 33) | 1;
+    for (uint32_t i = 0; i < probes; ++i) {
+        uint64_t bit = h % bits;
+        if (!(static_cast<uint8_t>(filter[bit / 8]) & (1u << (bit % 8)))) return false;
+        h += delta;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a data block
+ * @param index Block index
+ * @param out Output content
+ * @return false on a read error or a checksum mismatch
+ */
+bool SSTable::readBlock(size_t index, string& out) const {
+    const BlockHandle& handle = blocks[index];
+    if (!readAt(fd, handle.offset, handle.size + (checksummed ? 4 : 0), out)) {
+        LOG_ERROR("Failed to read block " + to_string(index) + " of " + path);
+        return false;
+    }
+    if (!checksummed) return true;
+
+    uint32_t stored = static_cast<uint32_t>(getFixed(out, handle.size, 4));
+    out.resize(handle.size);
+    if (Crc32c::compute(out) == stored) return true;
+    LOG_ERROR("Checksum mismatch in block " + to_string(index) + " of " + path);
+    out.clear();
+    return false;
+}
+
+/**
+ * @brief Hashes a key for the Bloom filter
+ * @param key Key
+ * @return 64-bit FNV-1a hash, with a final mix
+ */
+uint64_t SSTable::hash(const string& key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
+
+/**
+ * @brief Decodes the entry at a position of a data block
+ * @param data Block content
+ * @param pos Read position, advanced past the entry
+ * @param key Output key
+ * @param value Output value, empty for a deletion
+ * @return false if the entry is malformed
+ */
+bool SSTable::decodeEntry(const string& data, size_t& pos, string& key, optional<string>& value) {
+    uint64_t length;
+    if (!getVarint(data, pos, length) || length > data.size() - pos) return false;
+    key.assign(data, pos, length);
+    pos += length;
+    if (pos >= data.size()) return false;
+    bool deleted = data[pos++] != 0;
+    if (!getVarint(data, pos, length) || length > data.size() - pos) return false;
+    if (deleted) value.reset();
+    else value = data.substr(pos, length);
+    pos += length;
+    return true;
+}
+
+/**
+ * @brief Appends an unsigned LEB128 varint
+ * @param out Output buffer
+ * @param value Value to append
+ */
+void SSTable::putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief Reads an unsigned LEB128 varint
+ * @param data Input buffer
+ * @param pos Read position, advanced past the varint
+ * @param value Output value
+ * @return false if the data ended early or the value overflowed
+ */
+bool SSTable::getVarint(const string& data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) return false;
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Appends a little-endian fixed-width integer
+ * @param out Output buffer
+ * @param value Value to append
+ * @param bytes Width in bytes
+ */
+void SSTable::putFixed(string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+/**
+ * @brief Reads a little-endian fixed-width integer
+ * @param data Input buffer, at least pos + bytes long
+ * @param pos Read position
+ * @param bytes Width in bytes
+ * @return The value
+ */
+uint64_t SSTable::getFixed(const string& data, size_t pos, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+    }
+    return value;
+}
+
+#pragma endregion
+
+#pragma region Iterator
+
+/**
+ * @brief Creates an iterator positioned on the first entry
+ * @param table Table to read, kept alive by the iterator
+ */
+SSTable::Iterator::Iterator(shared_ptr<const SSTable> table) : table(move(table)) {
+    if (load(0)) next();
+}
+
+/**
+ * @brief Moves to the first entry not less than a key
+ * @param target Key to seek to
+ */
+void SSTable::Iterator::seek(const string& target) {
+    const auto& blocks = table->blocks;
+    auto it = lower_bound(blocks.begin(), blocks.end(), target,
+        [](const BlockHandle& handle, const string& key) { return handle.lastKey < key; });
+    onEntry = false;
+    if (it == blocks.end() || !load(static_cast<size_t>(it - blocks.begin()))) return;
+
+    next();
+    while (onEntry && currentKey < target) next();
+}
+
+/**
+ * @brief Moves to the next entry
+ *
+ * Crosses into the following block when the current one is exhausted.
+ */
+void SSTable::Iterator::next() {
+    while (pos >= data.size()) {
+        if (!load(block + 1)) {
+            onEntry = false;
+            return;
+        }
+    }
+    onEntry = decodeEntry(data, pos, currentKey, currentValue);
+    if (!onEntry) pos = data.size();
+}
+
+/**
+ * @brief Loads a block and positions before its first entry
+ * @param index Block index
+ * @return false past the last block
+ *
+ * A block that cannot be read or fails its checksum is loaded empty, so
+ * iteration goes on with the next one; its key range is added to
+ * damaged(). The range starts at the last key of the previous block,
+ * which only errs towards covering too much.
+ */
+bool SSTable::Iterator::load(size_t index) {
+    if (index >= table->blocks.size()) {
+        data.clear();
+        block = table->blocks.size();
+        pos = 0;
+        return false;
+    }
+    if (!table->readBlock(index, data)) {
+        data.clear();
+        const string& first = index == 0 ? table->smallestKey : table->blocks[index - 1].lastKey;
+        damagedRanges.emplace_back(first, table->blocks[index].lastKey);
+    }
+    block = index;
+    pos = 0;
+    return true;
+}
+
+#pragma endregion
+
+#pragma region SSTableBuilder
+
+/**
+ * @brief Starts a table
+ * @param path Final file path
+ */
+SSTableBuilder::SSTableBuilder(const string& path) : path(path), tempPath(path + ".tmp") {
+    fd = openWrite(tempPath);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create table file: " + tempPath);
+        ok = false;
+    }
+}
+
+/**
+ * @brief Removes the temporary file unless finish() succeeded
+ */
+SSTableBuilder::~SSTableBuilder() {
+    if (fd >= 0) closeFile(fd);
+    if (!finished) {
+        error_code ec;
+        filesystem::remove(tempPath, ec);
+    }
+}
+
+/**
+ * @brief Appends an entry
+ * @param key Key, greater than every key added before
+ * @param value Value, empty for a deletion
+ * @return false on a write error
+ */
+bool SSTableBuilder::add(const string& key, const optional<string>& value) {
+    if (hashes.empty()) smallestKey = key;
+    lastKey = key;
+    hashes.push_back(SSTable::hash(key));
+
+    SSTable::putVarint(block, key.size());
+    block += key;
+    block.push_back(value ? 0 : 1);
+    SSTable::putVarint(block, value ? value->size() : 0);
+    if (value) block += *value;
+
+    if (block.size() >= SSTable::BLOCK_BYTES) flushBlock();
+    return ok;
+}
+
+/**
+ * @brief Writes the filter, index and footer, syncs and renames the file
+ * @return false on a write error
+ */
+bool SSTableBuilder::finish() {
+    if (!ok || hashes.empty()) return false;
+    flushBlock();
+
+    // Bloom filter sized for the keys actually added
+    uint64_t bits = max<uint64_t>(64, hashes.size() * FILTER_BITS_PER_KEY);
+    uint32_t probes = 7;
+    string filter((bits + 7) / 8, '\0');
+    bits = filter.size() * 8;
+    for (uint64_t h : hashes) {
+        uint64_t delta = (h >> 33) | 1;
+        for (uint32_t i = 0; i < probes; ++i) {
+            uint64_t bit = h % bits;
+            filter[bit / 8] = static_cast<char>(static_cast<uint8_t>(filter[bit / 8]) | (1u << (bit % 8)));
+            h += delta;
+        }
+    }
+    uint64_t filterOffset = offset;
+    write(filter);
+
+    string index;
+    SSTable::putVarint(index, smallestKey.size());
+    index += smallestKey;
+    SSTable::putVarint(index, blocks.size());
+    for (const auto& handle : blocks) {
+        SSTable::putVarint(index, handle.lastKey.size());
+        index += handle.lastKey;
+        SSTable::putVarint(index, handle.offset);
+        SSTable::putVarint(index, handle.size);
+    }
+    uint64_t indexOffset = offset;
+    write(index);
+
+    string footer;
+    SSTable::putFixed(footer, filterOffset, 8);
+    SSTable::putFixed(footer, filter.size(), 8);
+    SSTable::putFixed(footer, indexOffset, 8);
+    SSTable::putFixed(footer, index.size(), 8);
+    SSTable::putFixed(footer, hashes.size(), 8);
+    SSTable::putFixed(footer, probes, 4);
+    SSTable::putFixed(footer, SSTable::MAGIC, 4);
+    write(footer);
+
+    if (ok && syncFile(fd) != 0) ok = false;
+    closeFile(fd);
+    fd = -1;
+
+    error_code ec;
+    if (ok) filesystem::rename(tempPath, path, ec);
+    if (!ok || ec) {
+        LOG_ERROR("Failed to write table file: " + path);
+        return false;
+    }
+    finished = true;
+    return true;
+}
+
+/**
+ * @brief Writes bytes at the end of the file
+ * @param data Bytes to write
+ */
+void SSTableBuilder::write(const string& data) {
+    size_t done = 0;
+    while (ok && done < data.size()) {
+        long long n = writeSome(fd, data.data() + done, data.size() - done);
+        if (n <= 0) ok = false;
+        else done += static_cast<size_t>(n);
+    }
+    offset += data.size();
+}
+
+/**
+ * @brief Writes the current data block and adds it to the index
+ */
+void SSTableBuilder::flushBlock() {
+    if (block.empty()) return;
+    blocks.push_back({lastKey, offset, block.size()});
+    string data;
+    data.swap(block);
+    SSTable::putFixed(data, Crc32c::compute(data), 4);
+    write(data);
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,183 @@
+/**
+ * @file TimingWheel.cpp
+ * @brief Implementation of the TimingWheel class
+ */
+
+#include "../include/TimingWheel.h"
+
+/**
+ * @brief Constructs a timing wheel
+ * @param tick Duration of one tick (timer resolution)
+ * @param start Time corresponding to tick 0
+ */
+TimingWheel::TimingWheel(chrono::milliseconds tick, chrono::steady_clock::time_point start)
+    : tickLength(tick.count() > 0 ? tick : chrono::milliseconds(1)), startTime(start) {
+    slots.fill(NIL);
+}
+
+/**
+ * @brief Schedules a timer
+ * @param delay Time until expiry, rounded up to whole ticks
+ * @param callback Function run on expiry
+ * @return Handle used to cancel the timer
+ */
+TimingWheel::TimerId TimingWheel::schedule(chrono::milliseconds delay, Callback callback) {
+    uint32_t index;
+    if (freeHead != NIL) {
+        index = freeHead;
+        freeHead = nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    uint64_t ticks = delay.count() <= 0 ? 1 : (delay.count() + tickLength.count() - 1) / tickLength.count();
+    Node& node = nodes[index];
+    node.expiry = currentTick + ticks;
+    node.callback = move(callback);
+    node.active = true;
+    place(index);
+    pendingCount++;
+
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+/**
+ * @brief Cancels a pending timer
+ * @param id Handle from schedule()
+ * @return true if the timer was pending, false if it already fired or was cancelled
+ */
+bool TimingWheel::cancel(TimerId id) {
+    uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFFu);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes.size()) return false;
+
+    Node& node = nodes[index];
+    if (!node.active || node.generation != generation) return false;
+
+    unlink(index);
+    release(index);
+    pendingCount--;
+    return true;
+}
+
+/**
+ * @brief Advances the wheel to the given time and runs every expired timer
+ * @param now Current time
+ * @return Number of timers fired
+ *
+ * Each tick first cascades any higher-level slot whose turn has come,
+ * then fires the level-0 slot. Nodes are unlinked one at a time before
+ * their callback runs, so callbacks may freely schedule or cancel timers.
+ */
+size_t TimingWheel::advance(chrono::steady_clock::time_point now) {
+    if (now <= startTime) return 0;
+    uint64_t target = static_cast<uint64_t>(chrono::duration_cast<chrono::milliseconds>(now - startTime).count()) / tickLength.count();
+    size_t fired = 0;
+
+    while (currentTick < target) {
+        // Nothing pending: jump straight to the target tick
+        if (pendingCount == 0) {
+            currentTick = target;
+            break;
+        }
+
+        currentTick++;
+        for (int level = 1; level < LEVELS; ++level) {
+            uint64_t lowerBits = currentTick & ((1ull << (SLOT_BITS * level)) - 1);
+            if (lowerBits != 0) break;
+            cascade(level, static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+        }
+
+        uint32_t& head = slots[currentTick & (SLOTS - 1)];
+        while (head != NIL) {
+            uint32_t index = head;
+            unlink(index);
+            Callback callback = move(nodes[index].callback);
+            release(index);
+            pendingCount--;
+            fired++;
+            callback();
+        }
+    }
+    return fired;
+}
+
+/**
+ * @brief Gets the number of pending timers
+ * @return Pending timer count
+ */
+size_t TimingWheel::pending() const {
+    return pendingCount;
+}
+
+/**
+ * @brief Links a node into the slot matching its expiry
+ * @param index Node index
+ *
+ * The level is chosen from the distance to expiry; expiries beyond the
+ * top level's span are clamped into its furthest slot and re-cascaded.
+ * A cascaded timer due on the current tick lands in the level-0 slot that
+ * advance() is about to fire.
+ */
+void TimingWheel::place(uint32_t index) {
+    Node& node = nodes[index];
+    uint64_t distance = node.expiry > currentTick ? node.expiry - currentTick : 0;
+
+    int level = 0;
+    while (level < LEVELS - 1 && distance >= (1ull << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    uint64_t expiry = node.expiry;
+    if (distance >= (1ull << (SLOT_BITS * LEVELS))) {
+        expiry = currentTick + (1ull << (SLOT_BITS * LEVELS)) - 1;
+    }
+
+    int slot = static_cast<int>((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+    node.slot = static_cast<uint16_t>(level * SLOTS + slot);
+    node.prev = NIL;
+    node.next = slots[node.slot];
+    if (node.next != NIL) nodes[node.next].prev = index;
+    slots[node.slot] = index;
+}
+
+/**
+ * @brief Unlinks a node from its slot list
+ * @param index Node index
+ */
+void TimingWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) nodes[node.prev].next = node.next;
+    else slots[node.slot] = node.next;
+    if (node.next != NIL) nodes[node.next].prev = node.prev;
+    node.prev = node.next = NIL;
+}
+
+/**
+ * @brief Returns a node to the free list
+ * @param index Node index
+ */
+void TimingWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.active = false;
+    node.callback = nullptr;
+    node.generation++;
+    node.next = freeHead;
+    freeHead = index;
+}
+
+/**
+ * @brief Re-places every timer in a higher-level slot
+ * @param level Level of the slot
+ * @param slot Slot index within the level
+ */
+void TimingWheel::cascade(int level, int slot) {
+    uint32_t index = slots[level * SLOTS + slot];
+    slots[level * SLOTS + slot] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes[index].next;
+        place(index);
+        index = next;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,334 @@
+/**
+ * @file WindowedStats.cpp
+ * @brief Implementation of the WindowedStats class
+ */
+
+#include "../include/WindowedStats.h"
+#include "../include/Crc32c.h"
+#include "../include/DB.h"
+#include "../include/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+namespace {
+    const char MAGIC[4] = {'B', 'W', 'S', '1'};
+    const size_t BUCKET_BYTES = 12;
+
+    void put32(string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    void put64(string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    uint32_t get32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    uint64_t get64(const char* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = (value << 8) | static_cast<uint8_t>(data[i]);
+        return value;
+    }
+
+    uint32_t hourOf(uint64_t time) {
+        return static_cast<uint32_t>(time / 3600);
+    }
+
+    uint32_t dayOf(uint64_t time) {
+        return static_cast<uint32_t>(time / 86400);
+    }
+
+    /**
+     * @brief Gets the week number of a time; weeks start on Monday (the epoch was a Thursday)
+     */
+    uint32_t weekOf(uint64_t time) {
+        return static_cast<uint32_t>((time / 86400 + 3) / 7);
+    }
+
+    uint64_t currentTime() {
+        return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Counts a game in the bucket of its period
+     *
+     * A bucket of an older period is cleared first. A game older than the
+     * bucket's period is a whole ring behind it, so outside the window.
+     */
+    template <typename Ring>
+    void add(Ring& ring, uint32_t period, bool won) {
+        auto& bucket = ring[period % ring.size()];
+        if (bucket.period > period) return;
+        if (bucket.period < period) bucket = {period, 0, 0};
+        bucket.games++;
+        if (won) bucket.wins++;
+    }
+
+    /**
+     * @brief Sums the buckets of the last ring.size() periods up to current
+     */
+    template <typename Ring>
+    void sumRing(const Ring& ring, uint32_t current, WindowTotals& totals) {
+        for (const auto& bucket : ring) {
+            if (bucket.period <= current && bucket.period + ring.size() > current) {
+                totals.games += bucket.games;
+                totals.wins += bucket.wins;
+            }
+        }
+    }
+
+    template <typename Ring>
+    void putRing(string& out, const Ring& ring) {
+        for (const auto& bucket : ring) {
+            put32(out, bucket.period);
+            put32(out, bucket.games);
+            put32(out, bucket.wins);
+        }
+    }
+
+    template <typename Ring>
+    const char* getRing(const char* data, Ring& ring) {
+        for (auto& bucket : ring) {
+            bucket = {get32(data), get32(data + 4), get32(data + 8)};
+            data += BUCKET_BYTES;
+        }
+        return data;
+    }
+}
+
+/**
+ * @brief Gets the counters of a database, loading them on first use
+ * @param db The database
+ *
+ * Counters live until program exit, like the database's match history.
+ */
+WindowedStats& WindowedStats::of(DB& db) {
+    static mutex registryMutex;
+    static unordered_map<DB*, unique_ptr<WindowedStats>> instances;
+    lock_guard<mutex> lock(registryMutex);
+    unique_ptr<WindowedStats>& stats = instances[&db];
+    if (!stats) stats.reset(new WindowedStats(MatchHistory::of(db), db.getRoot() + "/WindowedStats.dat"));
+    return *stats;
+}
+
+/**
+ * @brief Loads the saved counters and counts the games archived since they were saved
+ * @param history Match history the counters are computed from
+ * @param path Path of the saved counters
+ */
+WindowedStats::WindowedStats(MatchHistory& history, const string& path) : history(history), PATH(path) {
+    lock_guard<mutex> lock(statsMutex);
+    if (!load()) {
+        players.clear();
+        window = 0;
+        row = 0;
+    }
+    size_t counted = 0;
+    history.replay(window, 4, [&](const MatchWindow& matches) {
+        counted += applyLocked(matches);
+    });
+    unsaved = counted;
+    if (counted > 0) LOG_INFO("Counted " + to_string(counted) + " games archived since the windowed statistics were saved");
+}
+
+/**
+ * @brief Counts a game in a player's rings; the caller holds the lock
+ */
+void WindowedStats::recordLocked(Counters& counters, bool won, uint64_t finished) {
+    add(counters.hours, hourOf(finished), won);
+    add(counters.days, dayOf(finished), won);
+    add(counters.weeks, weekOf(finished), won);
+}
+
+/**
+ * @brief Sums a player's buckets of a window; the caller holds the lock
+ */
+WindowTotals WindowedStats::sum(const Counters& counters, StatWindow window, uint64_t now) {
+    WindowTotals totals;
+    switch (window) {
+        case StatWindow::DAY: sumRing(counters.hours, hourOf(now), totals); break;
+        case StatWindow::WEEK: sumRing(counters.days, dayOf(now), totals); break;
+        case StatWindow::SEASON: sumRing(counters.weeks, weekOf(now), totals); break;
+    }
+    return totals;
+}
+
+/**
+ * @brief Counts the games of one history window after the current position; the caller holds the lock
+ * @return Number of games counted
+ *
+ * Games whose end time is unknown are skipped.
+ */
+size_t WindowedStats::applyLocked(const MatchWindow& matches) {
+    size_t first = matches.number == window ? row : 0;
+    size_t at = 0, counted = 0;
+    for (size_t game = 0; game < matches.rows; ++game) {
+        size_t count = matches.playerCounts[game];
+        if (game >= first && matches.finished[game] > 0) {
+            for (size_t p = 0; p < count && at + p < matches.players.size(); ++p) {
+                uint64_t id = matches.players[at + p];
+                if (id >= matches.names.size()) continue;
+                recordLocked(players[matches.names[id]], matches.winners[game] == p + 1, matches.finished[game]);
+            }
+        }
+        if (game >= first) counted++;
+        at += count;
+    }
+    window = matches.number;
+    row = max(first, matches.rows);
+    return counted;
+}
+
+/**
+ * @brief Counts every game archived since the last update
+ * @return Number of games counted
+ *
+ * Reads the history from the window of the last counted game, normally
+ * just the tail.
+ */
+size_t WindowedStats::update() {
+    lock_guard<mutex> lock(statsMutex);
+    size_t counted = 0;
+    history.replay(window, 1, [&](const MatchWindow& matches) {
+        counted += applyLocked(matches);
+    });
+    unsaved += counted;
+    if (unsaved >= SAVE_INTERVAL) saveLocked();
+    return counted;
+}
+
+/**
+ * @brief Gets the totals of one player
+ * @param username Player name
+ * @param window Window to sum
+ * @param now Current time in seconds since the epoch
+ */
+WindowTotals WindowedStats::get(const string& username, StatWindow window, uint64_t now) const {
+    lock_guard<mutex> lock(statsMutex);
+    auto it = players.find(username);
+    WindowTotals totals = it == players.end() ? WindowTotals() : sum(it->second, window, now);
+    totals.username = username;
+    return totals;
+}
+
+/**
+ * @brief Gets the totals of every player who played in a window
+ * @param window Window to sum
+ * @param now Current time in seconds since the epoch
+ * @return One entry per player with at least one game, in no particular order
+ */
+vector<WindowTotals> WindowedStats::totals(StatWindow window, uint64_t now) const {
+    vector<WindowTotals> result;
+    lock_guard<mutex> lock(statsMutex);
+    for (const auto& [name, counters] : players) {
+        WindowTotals totals = sum(counters, window, now);
+        if (totals.games == 0) continue;
+        totals.username = name;
+        result.push_back(move(totals));
+    }
+    return result;
+}
+
+/**
+ * @brief Writes the counters and their history position to <root>/WindowedStats.dat
+ * @return true if the file was replaced
+ */
+bool WindowedStats::save() {
+    lock_guard<mutex> lock(statsMutex);
+    return saveLocked();
+}
+
+/**
+ * @brief Drops idle players and writes the counters; the caller holds the lock
+ *
+ * Layout (little-endian): "BWS1", window, row, player count, then per
+ * player its name length and name and its hour, day and week buckets
+ * (period, games, wins), and finally a CRC32C of everything before it.
+ * The file is written beside PATH and renamed over it.
+ */
+bool WindowedStats::saveLocked() {
+    // A player is idle once their newest week has left the season window
+    uint32_t week = weekOf(currentTime());
+    for (auto it = players.begin(); it != players.end();) {
+        uint32_t newest = 0;
+        for (const Bucket& bucket : it->second.weeks) newest = max(newest, bucket.period);
+        if (newest + WEEKS <= week) it = players.erase(it);
+        else ++it;
+    }
+
+    string data(MAGIC, 4);
+    put64(data, window);
+    put64(data, row);
+    put32(data, static_cast<uint32_t>(players.size()));
+    for (const auto& [name, counters] : players) {
+        put32(data, static_cast<uint32_t>(name.size()));
+        data += name;
+        putRing(data, counters.hours);
+        putRing(data, counters.days);
+        putRing(data, counters.weeks);
+    }
+    put32(data, Crc32c::compute(data));
+
+    try {
+        filesystem::create_directories(filesystem::path(PATH).parent_path());
+        string tmpPath = PATH + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            out.write(data.data(), data.size());
+            if (!out.flush()) {
+                LOG_ERROR("Failed to write windowed statistics");
+                return false;
+            }
+        }
+        filesystem::rename(tmpPath, PATH);
+    } catch (const exception& e) {
+        LOG_ERROR("Error saving windowed statistics: " + string(e.what()));
+        return false;
+    }
+    unsaved = 0;
+    return true;
+}
+
+/**
+ * @brief Reads the saved counters
+ * @return false if there are none or the file is damaged
+ */
+bool WindowedStats::load() {
+    ifstream in(PATH, ios::binary);
+    if (!in) return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (data.size() < 28 || data.compare(0, 4, MAGIC, 4) != 0 ||
+        Crc32c::compute(data.data(), data.size() - 4) != get32(data.data() + data.size() - 4)) {
+        LOG_ERROR("Damaged windowed statistics file ignored: " + PATH);
+        return false;
+    }
+
+    const size_t countersBytes = (HOURS + DAYS + WEEKS) * BUCKET_BYTES;
+    size_t end = data.size() - 4, at = 24;
+    window = get64(data.data() + 4);
+    row = get64(data.data() + 12);
+    size_t count = get32(data.data() + 20);
+    players.clear();
+    players.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (at + 4 > end) return false;
+        size_t length = get32(data.data() + at);
+        if (at + 4 + length + countersBytes > end) return false;
+        Counters& counters = players[data.substr(at + 4, length)];
+        const char* next = data.data() + at + 4 + length;
+        next = getRing(next, counters.hours);
+        next = getRing(next, counters.days);
+        getRing(next, counters.weeks);
+        at += 4 + length + countersBytes;
+    }
+    return true;
+}
\ No newline at end of file
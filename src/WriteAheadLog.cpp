@@ -0,0 +1,656 @@
+/**
+ * @file WriteAheadLog.cpp
+ * @brief Implementation of the WriteAheadLog class
+ */
+
+#include "../include/WriteAheadLog.h"
+#include "../include/Logger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char MAGIC[4] = {'W', 'A', 'L', '1'};
+    const char CANCELLED[4] = {'W', 'A', 'L', 'X'};
+    const size_t HEADER_BYTES = 20;
+    const uint64_t PROCESS_BYTE = 0;    // Held shared by every process using the log
+    const uint64_t PENDING_BYTE = 1;    // Held shared while a process has records not applied yet
+
+#ifdef _WIN32
+    int openFile(const string& path, bool append) {
+        int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC);
+        return _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+    }
+    int syncFile(int fd) { return _commit(fd); }
+    int closeFile(int fd) { return _close(fd); }
+    int truncateFile(int fd, uint64_t size = 0) { return _chsize_s(fd, static_cast<long long>(size)); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return _write(fd, data, static_cast<unsigned int>(length));
+    }
+    int openExisting(const string& path) { return _open(path.c_str(), _O_WRONLY | _O_BINARY); }
+    long long tellFile(int fd) { return _lseeki64(fd, 0, SEEK_CUR); }
+    bool seekFile(int fd, uint64_t offset) { return _lseeki64(fd, static_cast<long long>(offset), SEEK_SET) >= 0; }
+    void syncDirectory(const string&) {}
+    int openLockFile(const string& path) {
+        return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    bool lockByte(int fd, uint64_t byte, bool exclusive, bool wait) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(byte);
+        HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+        return LockFileEx(handle, flags, 0, 1, 0, &overlapped);
+    }
+    void unlockByte(int fd, uint64_t byte) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(byte);
+        UnlockFileEx(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), 0, 1, 0, &overlapped);
+    }
+    // Windows cannot convert a lock in place, so the old lock is dropped first
+    bool setProcessLock(int fd, bool exclusive, bool wait) {
+        unlockByte(fd, PROCESS_BYTE);
+        if (lockByte(fd, PROCESS_BYTE, exclusive, wait)) return true;
+        if (exclusive && !wait) lockByte(fd, PROCESS_BYTE, false, true);
+        return false;
+    }
+#else
+    int openFile(const string& path, bool append) {
+        int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+        return ::open(path.c_str(), flags, 0644);
+    }
+    int syncFile(int fd) { return ::fsync(fd); }
+    int closeFile(int fd) { return ::close(fd); }
+    int truncateFile(int fd, uint64_t size = 0) { return ::ftruncate(fd, static_cast<off_t>(size)); }
+    long long writeSome(int fd, const char* data, size_t length) {
+        return ::write(fd, data, length);
+    }
+    int openExisting(const string& path) { return ::open(path.c_str(), O_WRONLY | O_CLOEXEC); }
+    long long tellFile(int fd) { return ::lseek(fd, 0, SEEK_CUR); }
+    bool seekFile(int fd, uint64_t offset) { return ::lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0; }
+    void syncDirectory(const string& path) {
+        int dir = ::open(path.c_str(), O_RDONLY);
+        if (dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+    int openLockFile(const string& path) {
+        return ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    // fcntl locks belong to the process and are converted atomically
+    bool lockByte(int fd, uint64_t byte, bool exclusive, bool wait) {
+        struct flock lock = {};
+        lock.l_type = exclusive ? F_WRLCK : F_RDLCK;
+        lock.l_whence = SEEK_SET;
+        lock.l_start = static_cast<off_t>(byte);
+        lock.l_len = 1;
+        return ::fcntl(fd, wait ? F_SETLKW : F_SETLK, &lock) == 0;
+    }
+    void unlockByte(int fd, uint64_t byte) {
+        struct flock lock = {};
+        lock.l_type = F_UNLCK;
+        lock.l_whence = SEEK_SET;
+        lock.l_start = static_cast<off_t>(byte);
+        lock.l_len = 1;
+        ::fcntl(fd, F_SETLK, &lock);
+    }
+    bool setProcessLock(int fd, bool exclusive, bool wait) {
+        return lockByte(fd, PROCESS_BYTE, exclusive, wait);
+    }
+#endif
+
+    /**
+     * @brief Writes a whole buffer, retrying short writes
+     */
+    bool writeAll(int fd, const string& data) {
+        size_t done = 0;
+        while (done < data.size()) {
+            long long n = writeSome(fd, data.data() + done, data.size() - done);
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Overwrites part of an existing file and syncs it
+     */
+    bool writeAt(const string& path, uint64_t offset, const string& data) {
+        int handle = openExisting(path);
+        if (handle < 0) return false;
+        bool ok = seekFile(handle, offset) && writeAll(handle, data) && syncFile(handle) == 0;
+        closeFile(handle);
+        return ok;
+    }
+
+    void putLE(string& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    uint64_t getLE(const string& in, size_t pos, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(in[pos + i])) << (8 * i);
+        }
+        return value;
+    }
+}
+
+/**
+ * @brief Stops the sync thread and closes the log file
+ *
+ * BATCHED commits not synced yet are synced first.
+ */
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard<mutex> lock(logMutex);
+        stopping = true;
+    }
+    unsynced.notify_all();
+    if (syncer.joinable()) syncer.join();
+    if (fd >= 0 && durability.load() == Durability::BATCHED && durableLsn < appendedLsn) syncFile(fd);
+    if (fd >= 0) closeFile(fd);
+    if (lockFd >= 0) closeFile(lockFd);
+}
+
+/**
+ * @brief Opens or creates the log file
+ * @param path Path of the log file
+ * @return true if the log is open
+ *
+ * Takes the exclusive process lock if no other process uses the log, else
+ * waits for a shared one, which only blocks while another process is
+ * recovering.
+ */
+bool WriteAheadLog::open(const string& path) {
+    {
+        lock_guard<mutex> lock(processMutex);
+        if (lockFd >= 0) closeFile(lockFd);
+        lockFd = openLockFile(path + ".lock");
+        exclusive = lockFd < 0 || setProcessLock(lockFd, true, false);
+        if (lockFd < 0) {
+            LOG_ERROR("Failed to open log lock file, assuming no other process uses the log");
+        }
+        else if (!exclusive) {
+            LOG_INFO("Write-ahead log is shared with another process");
+            setProcessLock(lockFd, false, true);
+        }
+    }
+
+    lock_guard<mutex> lock(logMutex);
+    if (fd >= 0) closeFile(fd);
+
+    fd = openFile(path, true);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open write-ahead log: " + path);
+        return false;
+    }
+    logPath = path;
+    error_code ec;
+    logBytes = filesystem::file_size(path, ec);
+    if (ec) logBytes = 0;
+    lastSync = chrono::steady_clock::now();
+    if (!syncer.joinable()) syncer = thread(&WriteAheadLog::syncLoop, this);
+    return true;
+}
+
+/**
+ * @brief Re-applies every complete record in the log, then truncates it
+ * @return Number of records applied
+ *
+ * Replay stops at the first torn or corrupt record: a record is only
+ * acknowledged after it was fully appended, so anything after it was never
+ * reported as committed. Each file is written once, with its last logged
+ * content, and only if it does not hold that content already, so a clean
+ * shutdown leaves the data files (and their modification times) as they
+ * were.
+ */
+size_t WriteAheadLog::recover() {
+    {
+        lock_guard<mutex> lock(processMutex);
+        if (!exclusive) {
+            LOG_INFO("Recovery skipped, another process is using the write-ahead log");
+            return 0;
+        }
+    }
+
+    lock_guard<mutex> lock(logMutex);
+    if (fd < 0) return 0;
+
+    ifstream in(logPath, ios::binary);
+    string log((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    map<string, string> latest;
+    auto [records, pos] = decode(log, latest);
+
+    for (const auto& [path, content] : latest) {
+        ifstream current(path, ios::binary);
+        if (current) {
+            string existing((istreambuf_iterator<char>(current)), istreambuf_iterator<char>());
+            if (existing == content) continue;
+        }
+        replaceFile(path, content, true);
+    }
+
+    if (pos < log.size()) {
+        LOG_ERROR("Discarded " + to_string(log.size() - pos) + " bytes of incomplete log records");
+    }
+    if (records > 0) {
+        LOG_INFO("Recovered " + to_string(records) + " records from the write-ahead log");
+    }
+
+    syncDirectory(filesystem::path(logPath).parent_path().string());
+    truncateFile(fd);
+    syncFile(fd);
+    logBytes = 0;
+    return records;
+}
+
+/**
+ * @brief Tries to take the exclusive process lock without waiting
+ * @return true if no other process uses the log
+ */
+bool WriteAheadLog::acquireExclusive() {
+    lock_guard<mutex> lock(processMutex);
+    if (lockFd >= 0 && !exclusive) exclusive = setProcessLock(lockFd, true, false);
+    return exclusive || lockFd < 0;
+}
+
+/**
+ * @brief Turns the exclusive process lock back into a shared one
+ */
+void WriteAheadLog::releaseExclusive() {
+    lock_guard<mutex> lock(processMutex);
+    if (lockFd >= 0 && exclusive) {
+        setProcessLock(lockFd, false, true);
+        exclusive = false;
+    }
+}
+
+/**
+ * @brief Logs and applies a full rewrite of one file
+ * @param path File to replace
+ * @param content New content
+ * @return true if the file was written
+ */
+bool WriteAheadLog::commit(const string& path, const string& content) {
+    return commit(vector<pair<string, string>>{{path, content}});
+}
+
+/**
+ * @brief Logs and applies rewrites of several files as one record
+ * @param writes Pairs of path and new content
+ * @return true if every file was written
+ *
+ * Without an open log the files are still replaced atomically, just not
+ * logged.
+ */
+bool WriteAheadLog::commit(const vector<pair<string, string>>& writes) {
+    string record = encode(writes);
+    Durability level = durability.load();
+    uint64_t lsn;
+    bool due;
+
+    {
+        lock_guard<mutex> lock(logMutex);
+        if (fd < 0) {
+            bool ok = true;
+            for (const auto& write : writes) ok = replaceFile(write.first, write.second, false) && ok;
+            return ok;
+        }
+        if (pendingOffsets.empty()) setPending(true);
+        if (!writeAll(fd, record)) {
+            LOG_ERROR("Failed to append to write-ahead log");
+            if (pendingOffsets.empty()) setPending(false);
+            return false;
+        }
+        // Other processes append to the same log, so the size comes from the file offset
+        long long end = tellFile(fd);
+        logBytes = end >= 0 ? static_cast<uint64_t>(end) : logBytes + record.size();
+        lsn = ++appendedLsn;
+        pendingOffsets[lsn] = logBytes - record.size();
+        due = chrono::steady_clock::now() - lastSync >= chrono::milliseconds(batchMillis.load());
+    }
+
+    bool ok = true;
+    if (level == Durability::EVERY_COMMIT || (level == Durability::BATCHED && due)) {
+        ok = waitDurable(lsn);
+    } else if (level == Durability::BATCHED) {
+        unsynced.notify_one();
+    }
+
+    unique_lock<mutex> lock(logMutex);
+    applied.wait(lock, [&] { return appliedLsn == lsn - 1; });
+    if (ok) {
+        for (const auto& write : writes) {
+            ok = replaceFile(write.first, write.second, false) && ok;
+        }
+    }
+    appliedLsn = lsn;
+    pendingOffsets.erase(lsn);
+    if (pendingOffsets.empty()) setPending(false);
+    applied.notify_all();
+    commits.fetch_add(1, memory_order_relaxed);
+    checkpoint();
+    return ok;
+}
+
+/**
+ * @brief Sets the durability level
+ * @param level New level
+ */
+void WriteAheadLog::setDurability(Durability level) {
+    durability.store(level);
+    unsynced.notify_one();
+}
+
+/**
+ * @brief Gets the durability level
+ * @return Current level
+ */
+WriteAheadLog::Durability WriteAheadLog::getDurability() const {
+    return durability.load();
+}
+
+/**
+ * @brief Sets the longest time a BATCHED commit stays unsynced
+ * @param interval Batch interval
+ */
+void WriteAheadLog::setBatchInterval(chrono::milliseconds interval) {
+    batchMillis.store(interval.count());
+    unsynced.notify_one();
+}
+
+/**
+ * @brief Gets the number of commits
+ * @return Commit count
+ */
+uint64_t WriteAheadLog::commitCount() const {
+    return commits.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of log syncs
+ * @return Sync count
+ */
+uint64_t WriteAheadLog::syncCount() const {
+    return syncs.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Waits until a record is synced, syncing the log if no one else is
+ * @param lsn Sequence number of the record
+ * @return true if the sync succeeded
+ *
+ * The syncing thread covers every record appended before it started, so
+ * committers that arrive during a sync are all covered by the next one.
+ * If the sync fails, every record after the last synced one counts as
+ * failed, including records appended during the sync, and those not
+ * applied yet are cancelled in the log so recovery does not replay them.
+ * The log is not cut back, since other processes may have appended after
+ * them.
+ */
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    unique_lock<mutex> lock(logMutex);
+    while (durableLsn < lsn) {
+        if (lsn <= failedLsn) return false;
+        if (syncing) {
+            synced.wait(lock);
+            continue;
+        }
+
+        syncing = true;
+        uint64_t target = appendedLsn;
+        int handle = fd;
+        lock.unlock();
+        bool ok = syncFile(handle) == 0;
+        lock.lock();
+        syncing = false;
+        syncs.fetch_add(1, memory_order_relaxed);
+        if (!ok) {
+            LOG_ERROR("Failed to sync write-ahead log, dropping " + to_string(appendedLsn - durableLsn) + " unsynced records");
+            cancelPending();
+            failedLsn = appendedLsn;
+            synced.notify_all();
+            return false;
+        }
+        durableLsn = target;
+        lastSync = chrono::steady_clock::now();
+        synced.notify_all();
+    }
+    return true;
+}
+
+/**
+ * @brief Takes or drops the shared lock that holds off truncation
+ * @param active Whether this process has records not applied yet
+ *
+ * Taken before the first pending record is appended, so it waits while
+ * another process is truncating the log, and dropped once the last one is
+ * applied.
+ */
+void WriteAheadLog::setPending(bool active) {
+    lock_guard<mutex> lock(processMutex);
+    if (lockFd < 0) return;
+    if (!active) {
+        unlockByte(lockFd, PENDING_BYTE);
+    } else if (!lockByte(lockFd, PENDING_BYTE, false, true)) {
+        LOG_ERROR("Failed to lock write-ahead log against truncation");
+    }
+}
+
+/**
+ * @brief Marks the unsynced records of this process that are not applied yet as cancelled
+ *
+ * Only the magic of each record is overwritten, so recovery can still step
+ * over it to the records other processes appended after it. These records
+ * are pending, so no process can have truncated the log since they were
+ * appended and their offsets are still valid.
+ */
+void WriteAheadLog::cancelPending() {
+    size_t failed = 0;
+    for (auto it = pendingOffsets.upper_bound(durableLsn); it != pendingOffsets.end(); ++it) {
+        if (!writeAt(logPath, it->second, string(CANCELLED, 4))) failed++;
+    }
+    if (failed > 0) {
+        LOG_ERROR("Failed to cancel " + to_string(failed) + " unsynced records in write-ahead log");
+    }
+}
+
+/**
+ * @brief Sync thread loop
+ *
+ * Sleeps until a BATCHED commit leaves a record unsynced, then syncs once
+ * the batch interval since the last sync has passed, unless a commit did
+ * meanwhile. After a failed sync it waits one interval before trying
+ * again.
+ */
+void WriteAheadLog::syncLoop() {
+    unique_lock<mutex> lock(logMutex);
+    while (!stopping) {
+        if (durability.load() != Durability::BATCHED || fd < 0 || max(durableLsn, failedLsn) >= appendedLsn) {
+            unsynced.wait(lock);
+            continue;
+        }
+        auto interval = chrono::milliseconds(batchMillis.load());
+        if (chrono::steady_clock::now() < lastSync + interval) {
+            unsynced.wait_until(lock, lastSync + interval);
+            continue;
+        }
+
+        uint64_t target = appendedLsn;
+        lock.unlock();
+        bool ok = waitDurable(target);
+        lock.lock();
+        if (!ok) unsynced.wait_for(lock, interval, [&] { return stopping; });
+    }
+}
+
+/**
+ * @brief Syncs the data files and truncates the log once it is large
+ *
+ * Only runs when no sync is in progress and no process, this one
+ * included, has a logged commit it has not applied yet. Every file named
+ * in the log is synced first, whichever process wrote it, so nothing in
+ * the log is still needed afterwards.
+ */
+void WriteAheadLog::checkpoint() {
+    if (logBytes < CHECKPOINT_BYTES || appliedLsn != appendedLsn || syncing) return;
+    {
+        lock_guard<mutex> lock(processMutex);
+        if (lockFd >= 0 && !lockByte(lockFd, PENDING_BYTE, true, false)) return;
+    }
+
+    ifstream in(logPath, ios::binary);
+    string log((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    map<string, string> latest;
+    decode(log, latest);
+    for (const auto& entry : latest) {
+        int handle = openFile(entry.first, true);
+        if (handle >= 0) {
+            syncFile(handle);
+            closeFile(handle);
+        }
+    }
+    syncDirectory(filesystem::path(logPath).parent_path().string());
+
+    if (truncateFile(fd) == 0) {
+        syncFile(fd);
+        logBytes = 0;
+        durableLsn = appendedLsn;
+    }
+
+    lock_guard<mutex> lock(processMutex);
+    if (lockFd >= 0) unlockByte(lockFd, PENDING_BYTE);
+}
+
+/**
+ * @brief Encodes a record
+ * @param writes Pairs of path and new content
+ * @return Record bytes
+ */
+string WriteAheadLog::encode(const vector<pair<string, string>>& writes) {
+    string payload;
+    for (const auto& write : writes) {
+        putLE(payload, write.first.size(), 4);
+        payload += write.first;
+        putLE(payload, write.second.size(), 8);
+        payload += write.second;
+    }
+
+    string record(MAGIC, 4);
+    putLE(record, writes.size(), 4);
+    putLE(record, checksum(payload), 4);
+    putLE(record, payload.size(), 8);
+    return record + payload;
+}
+
+/**
+ * @brief Decodes the complete records at the start of a log
+ * @param log Log bytes
+ * @param latest Receives the last logged content of every file
+ * @return Number of records decoded and the offset where decoding stopped
+ *
+ * Decoding stops at the first torn or corrupt record. Cancelled records
+ * are stepped over without being decoded.
+ */
+pair<size_t, size_t> WriteAheadLog::decode(const string& log, map<string, string>& latest) {
+    size_t pos = 0;
+    size_t records = 0;
+    while (pos + HEADER_BYTES <= log.size()) {
+        bool cancelled = log.compare(pos, 4, CANCELLED, 4) == 0;
+        if (!cancelled && log.compare(pos, 4, MAGIC, 4) != 0) break;
+        uint32_t count = static_cast<uint32_t>(getLE(log, pos + 4, 4));
+        uint32_t sum = static_cast<uint32_t>(getLE(log, pos + 8, 4));
+        uint64_t length = getLE(log, pos + 12, 8);
+        if (length > log.size() - pos - HEADER_BYTES) break;
+        if (cancelled) {
+            pos += HEADER_BYTES + length;
+            continue;
+        }
+
+        string payload = log.substr(pos + HEADER_BYTES, length);
+        if (checksum(payload) != sum) break;
+
+        vector<pair<string, string>> writes;
+        size_t at = 0;
+        bool valid = true;
+        for (uint32_t i = 0; i < count && valid; ++i) {
+            if (at + 4 > payload.size()) { valid = false; break; }
+            uint64_t pathLength = getLE(payload, at, 4);
+            at += 4;
+            if (pathLength > payload.size() - at || payload.size() - at - pathLength < 8) { valid = false; break; }
+            string path = payload.substr(at, pathLength);
+            at += pathLength;
+            uint64_t contentLength = getLE(payload, at, 8);
+            at += 8;
+            if (contentLength > payload.size() - at) { valid = false; break; }
+            writes.emplace_back(path, payload.substr(at, contentLength));
+            at += contentLength;
+        }
+        if (!valid) break;
+
+        for (auto& write : writes) {
+            latest[write.first] = move(write.second);
+        }
+        records++;
+        pos += HEADER_BYTES + length;
+    }
+    return {records, pos};
+}
+
+/**
+ * @brief Checksum of a record payload
+ * @param data Payload bytes
+ * @return 32-bit FNV-1a hash
+ */
+uint32_t WriteAheadLog::checksum(const string& data) {
+    uint32_t hash = 2166136261u;
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Replaces a file through a temporary file and rename
+ * @param path File to replace
+ * @param content New content
+ * @param sync Whether to sync the temporary file before the rename
+ * @return true if the file was replaced
+ */
+bool WriteAheadLog::replaceFile(const string& path, const string& content, bool sync) {
+    string tmpPath = path + ".tmp";
+    int handle = openFile(tmpPath, false);
+    if (handle < 0) {
+        LOG_ERROR("Failed to open file: " + tmpPath);
+        return false;
+    }
+
+    bool ok = writeAll(handle, content);
+    if (ok && sync) ok = syncFile(handle) == 0;
+    closeFile(handle);
+
+    error_code ec;
+    if (ok) filesystem::rename(tmpPath, path, ec);
+    if (!ok || ec) {
+        LOG_ERROR("Failed to replace file: " + path);
+        filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -14,37 +14,322 @@
 #include "../include/Player.h"
 #include "../include/Menu.h"
 #include "../include/Util.h"
+#include "../include/Persistence.h"
+#include "../include/WriteAheadLog.h"
+#include "../include/Migration.h"
+#include "../include/Ratings.h"
+#include "../include/Matchmaker.h"
+#include "../include/RoomManager.h"
+#include "../include/RoomTimeouts.h"
+#include "../include/Crc32c.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <thread>
+
+/**
+ * @brief Runs the pairing service on synthetic players and prints how it scales
+ * @param playerCount Players queued per run, rounded down to an even number
+ * @return Process exit code
+ *
+ * The players live in an in-memory database, so nothing is written to
+ * data/. Each run doubles the pairing workers up to the hardware
+ * concurrency, with as many threads enqueueing, and prints the pairing
+ * rate and queue waits. Rooms are created under a memory budget of a
+ * quarter of their footprint, so most are evicted as others open. The
+ * rooms of the last run are then handed to RoomTimeouts: turn timers skip
+ * turns, rehydrating evicted rooms, until the idle timers close them all.
+ */
+static int stressMatchmaking(size_t playerCount) {
+    playerCount -= playerCount % 2;
+    DB db("../data", Logger::getInstance(), DB::Engine::MEMORY);
+    db.init();
+
+    // Partners of a pair share a win-rate band, so every band empties
+    vector<Player> players;
+    for (size_t i = 0; i < playerCount; ++i) {
+        Player player("stress" + to_string(i), "");
+        player.setWinRate(static_cast<double>(i / 2 % Matchmaker::BAND_COUNT) * 20.0 + 10.0);
+        players.push_back(player);
+    }
+    if (!db.saveAll(players)) {
+        cout << "Could not store the stress players" << endl;
+        return 1;
+    }
+
+    size_t roomCount = playerCount / 2;
+    size_t budget = max<size_t>(1, roomCount * 256);
+    size_t maxWorkers = max(1u, thread::hardware_concurrency());
+    vector<string> roomIds(roomCount);
+    unique_ptr<RoomManager> rooms;
+    for (size_t workers = 1;; workers = min(workers * 2, maxWorkers)) {
+        rooms = make_unique<RoomManager>(64, budget, db);
+        Matchmaker matchmaker(*rooms, workers);
+        atomic<size_t> opened{0};
+        matchmaker.setMatchCallback([&roomIds, &opened](const string& roomId, const Player&, const Player&) {
+            roomIds[opened.fetch_add(1)] = roomId;
+        });
+
+        auto start = chrono::steady_clock::now();
+        matchmaker.start();
+        vector<thread> producers;
+        for (size_t t = 0; t < workers; ++t) {
+            producers.emplace_back([&matchmaker, &players, t, workers] {
+                for (size_t i = t; i < players.size(); i += workers) {
+                    while (!matchmaker.enqueue(players[i])) this_thread::yield();
+                }
+            });
+        }
+        for (thread& producer : producers) producer.join();
+        auto deadline = chrono::steady_clock::now() + chrono::seconds(30);
+        while (matchmaker.matchCount() < roomCount && chrono::steady_clock::now() < deadline) {
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        matchmaker.stop();
+        if (matchmaker.matchCount() < roomCount) {
+            cout << workers << " workers: only " << matchmaker.matchCount() << " of " << roomCount << " rooms opened" << endl;
+            return 1;
+        }
+        cout << workers << " workers: " << roomCount << " rooms in " << static_cast<long long>(seconds * 1000) << " ms ("
+             << static_cast<long long>(playerCount / seconds) << " players/s), " << rooms->evictions()
+             << " evictions, queue wait " << matchmaker.waitTimes().summary() << endl;
+        if (workers == maxWorkers) break;
+    }
+
+    // Let every room of the last run time out
+    RoomTimeouts timeouts(*rooms, chrono::milliseconds(5), chrono::milliseconds(50),
+                          RoomTimeouts::TurnAction::SKIP, chrono::milliseconds(1));
+    auto start = chrono::steady_clock::now();
+    for (const string& roomId : roomIds) timeouts.watch(roomId);
+    while (timeouts.watchedRooms() > 0) {
+        timeouts.poll();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    cout << "Timeouts: " << timeouts.turnTimeouts() << " turns skipped and " << timeouts.idleExpiries()
+         << " idle rooms closed in " << elapsed.count() << " ms, " << rooms->roomCount() << " rooms left, rehydration "
+         << rooms->rehydrationLatency().summary() << endl;
+    return rooms->roomCount() == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Times loading the player table with and without checksummed frames
+ * @param playerCount Synthetic players stored
+ * @return Process exit code
+ *
+ * The players are saved to a scratch file database under data/bench, which
+ * frames every record with its length and CRC32C, and load<Player>() is
+ * timed. The shard files are then rewritten as plain JSON arrays, the
+ * format from before framing, and timed again; the checksum of every
+ * record is also timed on its own. Each figure is the best of five runs.
+ * The scratch directory is removed afterwards.
+ */
+static int benchLoad(size_t playerCount) {
+    const string root = "../data/bench";
+    const int rounds = 5;
+    error_code ec;
+    filesystem::remove_all(root, ec);
+
+    auto best = [rounds](const function<void()>& run) {
+        double fastest = 0;
+        for (int i = 0; i < rounds; ++i) {
+            auto start = chrono::steady_clock::now();
+            run();
+            double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (i == 0 || millis < fastest) fastest = millis;
+        }
+        return fastest;
+    };
+
+    bool ok = true;
+    {
+        DB db(root, Logger::getInstance(), DB::Engine::FILES);
+        db.init();
+        vector<Player> players;
+        for (size_t i = 0; i < playerCount; ++i) {
+            Player player("bench" + to_string(i), "password" + to_string(i));
+            player.setGameCount(static_cast<int>(i % 100));
+            player.setWinCount(static_cast<int>(i % 50));
+            players.push_back(player);
+        }
+        if (!db.saveAll(players)) {
+            cout << "Could not store the benchmark players" << endl;
+            return 1;
+        }
+
+        size_t loaded = 0;
+        double framed = best([&db, &loaded] { loaded = db.load<Player>().size(); });
+        ok = loaded == playerCount;
+
+        // Rewrite each shard as a plain JSON array
+        vector<string> shards(db.shardCount());
+        vector<string> records;
+        size_t bytes = 0;
+        for (const Player& player : players) {
+            string record = player.to_json();
+            string& shard = shards[db.shardOf(player.getUsername())];
+            shard += (shard.empty() ? "[\n" : ",\n") + record;
+            bytes += record.size();
+            records.push_back(move(record));
+        }
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            ofstream out(root + "/Account." + to_string(shard) + ".json", ios::binary | ios::trunc);
+            out << (shards[shard].empty() ? "[" : shards[shard]) << "\n]";
+        }
+        double unframed = best([&db, &loaded] { loaded = db.load<Player>().size(); });
+        ok = ok && loaded == playerCount;
+
+        double checksums = best([&records] {
+            for (const string& record : records) Crc32c::compute(record);
+        });
+
+        cout << fixed << setprecision(1)
+             << "Loaded " << playerCount << " players: framed " << framed << " ms, unframed " << unframed
+             << " ms (" << showpos << (framed - unframed) * 100.0 / unframed << noshowpos << "%); CRC32C of "
+             << bytes / 1024 << " KiB alone " << checksums << " ms ("
+             << checksums * 100.0 / framed << "% of the framed load)" << endl;
+    }
+    filesystem::remove_all(root, ec);
+    if (!ok) cout << "Not every player was loaded back" << endl;
+    return ok ? 0 : 1;
+}
 
 /**
  * @brief Main entry point of the BINGO game
  * 
  * The function performs the following steps:
+ * 0. Reads the optional --durability=none|batched|commit, --engine=file|lsm|memory,
+ *    --reshard N, --migrate, --rerate, --stress-match N and --bench-load N arguments; with
+ *    --reshard the data is redistributed over N shard files, with --migrate
+ *    the stored records are converted to the current schema, with --rerate
+ *    every rating is recomputed from the match history and timed, with
+ *    --stress-match N players are paired on ever more threads, with
+ *    --bench-load N players are loaded with and without record checksums,
+ *    and the program exits without starting a game
  * 1. Initializes the logging system with "app.log" as the log file
- * 2. Initializes the database connection
+ * 2. Initializes the database connection, starts the background writer and
+ *    starts loading player and game records while the players sign in
  * 3. Authenticates Player 1 through login/signup
  * 4. Authenticates Player 2, ensuring a different account from Player 1
  * 5. Creates and displays the main game menu
+ * 6. Waits for every pending save to reach disk and writes a checkpoint
+ *    of the player table for the next start
  * 
+ * @param argc Argument count
+ * @param argv Arguments
  * @return int Returns 0 on successful execution
  */
-int main() {
+int main(int argc, char* argv[]) {
+    long reshardCount = -1;
+    bool migrate = false;
+    bool rerate = false;
+    long stressPlayers = 0;
+    long benchPlayers = 0;
+
+    // Durability of data file commits (every commit is synced by default) and storage engine
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--durability=none") == 0) {
+            WriteAheadLog::getInstance().setDurability(WriteAheadLog::Durability::NONE);
+        } else if (strcmp(argv[i], "--durability=batched") == 0) {
+            WriteAheadLog::getInstance().setDurability(WriteAheadLog::Durability::BATCHED);
+        } else if (strcmp(argv[i], "--durability=commit") == 0) {
+            WriteAheadLog::getInstance().setDurability(WriteAheadLog::Durability::EVERY_COMMIT);
+        } else if (strcmp(argv[i], "--engine=file") == 0) {
+            DB::setDefaultEngine(DB::Engine::FILES);
+        } else if (strcmp(argv[i], "--engine=memory") == 0) {
+            DB::setDefaultEngine(DB::Engine::MEMORY);
+        } else if (strcmp(argv[i], "--engine=lsm") == 0) {
+            DB::setDefaultEngine(DB::Engine::LSM);
+        } else if (strcmp(argv[i], "--reshard") == 0 && i + 1 < argc) {
+            reshardCount = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--migrate") == 0) {
+            migrate = true;
+        } else if (strcmp(argv[i], "--rerate") == 0) {
+            rerate = true;
+        } else if (strcmp(argv[i], "--stress-match") == 0 && i + 1 < argc) {
+            stressPlayers = strtol(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--bench-load") == 0 && i + 1 < argc) {
+            benchPlayers = strtol(argv[++i], nullptr, 10);
+        }
+    }
+
     // Initialize logging and database systems
     Logger::getInstance().init("app.log");
-    DB::getInstance().init();
+
+    // Offline stress run of the pairing service; the data directory is not touched
+    if (stressPlayers > 0) {
+        return stressMatchmaking(static_cast<size_t>(stressPlayers));
+    }
+
+    // Offline benchmark of record checksums; only a scratch directory is written
+    if (benchPlayers > 0) {
+        return benchLoad(static_cast<size_t>(benchPlayers));
+    }
+
+    DB& db = DB::getInstance();
+    db.init();
+
+    // Offline rebalance: change the shard count and exit
+    if (reshardCount >= 0) {
+        size_t previous = db.shardCount();
+        if (reshardCount == 0 || !db.reshard(static_cast<size_t>(reshardCount))) {
+            cout << "Resharding failed, see app.log" << endl;
+            return 1;
+        }
+        cout << "Data moved from " << previous << " to " << reshardCount << " shards" << endl;
+        return 0;
+    }
+
+    // Offline conversion of the stored records to the current schema, resumable
+    if (migrate) {
+        Migration migration(db);
+        int previous = migration.storedVersion();
+        if (!migration.run()) {
+            cout << "Migration incomplete, see app.log; run it again to resume" << endl;
+            return 1;
+        }
+        if (previous >= Migration::CURRENT_VERSION) cout << "Schema already at version " << previous << endl;
+        else cout << "Schema migrated from version " << previous << " to " << Migration::CURRENT_VERSION << endl;
+        return 0;
+    }
+
+    // Offline rebuild of every rating from the match history
+    if (rerate) {
+        size_t workers = max(1u, thread::hardware_concurrency());
+        Ratings& ratings = Ratings::of(db);
+        auto start = chrono::steady_clock::now();
+        size_t games = ratings.recompute(workers);
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        cout << "Rated " << games << " games in " << elapsed.count() << " ms on " << workers << " threads" << endl;
+        return 0;
+    }
+
+    Persistence::getInstance().start();
+
+    // Load players and games in the background while the players sign in
+    Menu menu(db);
+    menu.warmUp();
 
     Player *player1, *player2;
 
     // Authenticate Player 1
     cout << "===== BINGO =====" << endl;
     cout << "Player 1 : " << endl;
-    player1 = Player::authenticator();
+    player1 = Player::authenticator(db);
     cout << "Player 1 : " << player1->getUsername() << " is ready!!"<< endl;
     Util::waitEnter();
 
     // Authenticate Player 2 (must be different from Player 1)
     do {
         cout << "Player 2 : " << endl;
-        player2 = Player::authenticator();
+        player2 = Player::authenticator(db);
         if (player2->getUsername() == player1->getUsername()) {
             cout << "This account already signed in as Player 1. Please sign in with another account." << endl;
             Util::waitEnter();
@@ -57,9 +342,13 @@ int main() {
         break;
     } while (true);
 
-    // Create and display the main game menu
-    Menu menu;
+    // Display the main game menu
     menu.displayMainMenu(*player1, *player2);
+
+    // Write out any saves still queued before exiting
+    Persistence::getInstance().stop();
+    db.checkpoint();
+    LOG_INFO("Data file lock waits " + db.lockWaits().summary());
     
     return 0;
 }
\ No newline at end of file